@@ -3,15 +3,35 @@
   caches/cache-test.cpp
   2014-09-08
 
-  Defines tests for caches.
+  Defines tests for caches. Pass "bench" to compare the hit rates and
+  throughput of the LFU caches on Zipfian and scan-mixed traces, and a
+  warm start from a snapshot with refilling a heap_cache item by item.
 */
 
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <future>
 #include <iostream>
+#include <memory>
 #include <random>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "caches/cache.hpp"
+#include "caches/cache_stats.hpp"
+#include "caches/concurrent_heap_cache.hpp"
 #include "caches/lfu_cache.hpp"
+#include "caches/tinylfu_cache.hpp"
+#include "util/bench.hpp"
+#include "util/node_pool.hpp"
+#include "util/uassert.hpp"
 
 using namespace caches;
 using namespace std;
@@ -23,11 +43,55 @@ minstd_rand0 gen(SEED);
 template<typename T>
 void cache_test(T t);
 
-int main() {
+// linked_cache eviction order tests
+void linked_test();
+
+// tinylfu_cache admission tests
+void tinylfu_test();
+
+// concurrent_heap_cache tests
+void concurrent_test();
+
+// statistics policy tests
+void stats_test();
+
+// save() and load() tests
+void snapshot_test();
+
+// hit rate and throughput comparison
+void bench();
+
+int main(int argc, char** argv) {
+  if(argc > 1 && strcmp(argv[1], "bench") == 0) {
+    bench();
+    return 0;
+  }
   cout << "LFU test" << endl;
   cout << "\nheap_cache test" << endl;
   lfu::heap_cache<int, int> lhc;
   cache_test(lhc);
+  cout << "\npooled heap_cache test" << endl;
+  lfu::heap_cache<int, int, equal_to<int>, hash<int>, lfu::heap_cache_traits,
+                  util::pool_allocator<int> > phc;
+  cache_test(phc);
+  cout << "\nlinked_cache test" << endl;
+  lfu::linked_cache<int, int> llc;
+  cache_test(llc);
+  cout << "\npooled linked_cache test" << endl;
+  lfu::linked_cache<int, int, equal_to<int>, hash<int>, lfu::heap_cache_traits,
+                    util::pool_allocator<int> > plc;
+  cache_test(plc);
+  linked_test();
+  cout << "\ntinylfu_cache test" << endl;
+  caches::tinylfu_cache<int, int> tlc;
+  cache_test(tlc);
+  tinylfu_test();
+  cout << "\nconcurrent_heap_cache test" << endl;
+  concurrent_test();
+  cout << "\ncache statistics test" << endl;
+  stats_test();
+  cout << "\ncache snapshot test" << endl;
+  snapshot_test();
   return 0;
 }
 
@@ -103,3 +167,521 @@ void cache_test(T lhc) {
   cout << "...Completed" << endl;
 #endif /* NDEBUG */
 }
+
+void linked_test() {
+  cout << "=====> Testing exact eviction" << endl;
+  {
+    lfu::linked_cache<int, int> lc(3);
+    for(int i = 0; i < 3; ++i)
+      lc.insert(make_pair(i, i));
+    UASSERT(!lc.insert(make_pair(0, 10))) << "replacement not reported";
+    UASSERT(*lc.lookup(0) == 10);
+    lc.lookup(0);
+    lc.lookup(1);
+    // 2 is the only one never looked up.
+    lc.insert(make_pair(3, 3));
+    UASSERT(lc.size() == 3 && !lc.contains(2));
+    // 3 is now least frequent.
+    lc.insert(make_pair(4, 4));
+    UASSERT(lc.size() == 3 && !lc.contains(3) && lc.contains(4));
+    // Ties go to the older key: 1 and 4 both have one lookup.
+    lc.lookup(4);
+    lc.insert(make_pair(5, 5));
+    lc.insert(make_pair(6, 6));
+    UASSERT(lc.contains(0) && lc.contains(6) && !lc.contains(5));
+    lc.lookup(6);
+    lc.lookup(6);
+    lc.insert(make_pair(7, 7));
+    UASSERT(lc.contains(0) && lc.contains(6) && lc.contains(7))
+        << "evicted the wrong one of 1 and 4";
+    UASSERT(!lc.contains(1) && !lc.contains(4));
+    lc.lookup(0);
+    lc.set_max_size(1);
+    UASSERT(lc.size() == 1 && lc.contains(0));
+  }
+  cout << "...... Complete!" << endl;
+
+  cout << "=====> Testing copies keep counts" << endl;
+  {
+    lfu::linked_cache<int, int> lc(2);
+    lc.insert(make_pair(0, 0));
+    lc.insert(make_pair(1, 1));
+    lc.lookup(1);
+    auto copy = lc;
+    copy.insert(make_pair(2, 2));
+    UASSERT(copy.contains(1) && !copy.contains(0));
+    auto moved = move(copy);
+    moved.lookup(2);
+    moved.lookup(2);
+    moved.insert(make_pair(3, 3));
+    UASSERT(moved.contains(2) && !moved.contains(1));
+    UASSERT(lc.size() == 2 && lc.contains(0));
+  }
+  cout << "...... Complete!" << endl;
+}
+
+void tinylfu_test() {
+  cout << "=====> Testing sequential semantics" << endl;
+  {
+    caches::tinylfu_cache<int, int> tc(1000);
+    for(int i = 0; i < 1000; ++i)
+      UASSERT(tc.insert(make_pair(i, 2 * i)));
+    UASSERT(!tc.insert(make_pair(0, 5))) << "replacement not reported";
+    UASSERT(*tc.lookup(0) == 5);
+    UASSERT(tc.size() == 1000) << "size " << tc.size();
+    for(int i = 1000; i < 5000; ++i)
+      tc.insert(make_pair(i, 2 * i));
+    UASSERT(tc.size() == 1000) << "size " << tc.size();
+    int present = 0;
+    for(int i = 0; i < 5000; ++i) {
+      if(!tc.contains(i)) continue;
+      ++present;
+      UASSERT(*tc.lookup(i) == (i ? 2 * i : 5));
+    }
+    UASSERT(present == 1000) << present << " present";
+    auto copy = tc;
+    tc.set_max_size(10);
+    UASSERT(tc.size() == 10 && copy.size() == 1000);
+    auto moved = move(copy);
+    UASSERT(moved.size() == 1000 && copy.empty());
+    copy.insert(make_pair(1, 1));
+    UASSERT(copy.size() == 1 && *copy.lookup(1) == 1);
+    tc.clear();
+    UASSERT(tc.empty() && !tc.contains(0));
+  }
+  cout << "...... Complete!" << endl;
+
+  cout << "=====> Testing scan resistance" << endl;
+  {
+    static const int kMax = 100, kHot = 50, kScan = 20000;
+    caches::tinylfu_cache<int, int> tc(kMax);
+    lfu::linked_cache<int, int> lc(kMax);
+    auto access = [&](int key) {
+      if(!tc.lookup(key)) tc.insert(make_pair(key, key));
+      if(!lc.lookup(key)) lc.insert(make_pair(key, key));
+    };
+    for(int rep = 0; rep < 10; ++rep)
+      for(int i = 0; i < kHot; ++i)
+        access(i);
+    // Each hot key is seen every kHot scanned keys.
+    for(int i = 0; i < kScan; ++i) {
+      access(i % kHot);
+      access(kHot + i);
+    }
+    int hot = 0;
+    for(int i = 0; i < kHot; ++i)
+      hot += tc.contains(i);
+    UASSERT(hot == kHot) << "only " << hot << " hot keys left";
+  }
+  cout << "...... Complete!" << endl;
+}
+
+void concurrent_test() {
+  cout << "=====> Testing sequential semantics" << endl;
+  {
+    lfu::concurrent_heap_cache<int, int> chc(100, 4);
+    UASSERT(chc.empty() && chc.shard_count() == 4);
+    for(int i = 0; i < 50; ++i)
+      UASSERT(chc.insert(make_pair(i, 2 * i)));
+    UASSERT(!chc.insert(make_pair(0, 0))) << "duplicate inserted";
+    UASSERT(chc.size() == 50) << "size " << chc.size();
+    for(int i = 0; i < 50; ++i) {
+      auto val = chc.lookup(i);
+      UASSERT(val.valid() && val.access() == 2 * i);
+    }
+    UASSERT(!chc.lookup(50).valid() && !chc.contains(50));
+    chc.clear();
+    UASSERT(chc.empty());
+  }
+  cout << "...... Complete!" << endl;
+
+  cout << "=====> Testing buffered lookups count" << endl;
+  {
+    lfu::concurrent_heap_cache<int, int> chc(4, 1);
+    for(int i = 0; i < 4; ++i)
+      chc.insert(make_pair(i, i));
+    // Key 3 sits at the back of the heap, so it would be the next one
+    // evicted if its lookups (which overflow the read buffer) went missing.
+    for(size_t i = 0; i < 3 * chc.kReadBuffer; ++i)
+      chc.lookup(3);
+    chc.flush();
+    for(int i = 4; i < 100; ++i)
+      chc.insert(make_pair(i, i));
+    UASSERT(chc.size() <= 4) << "size " << chc.size();
+    UASSERT(chc.contains(3)) << "frequently read key evicted";
+  }
+  cout << "...... Complete!" << endl;
+
+  cout << "=====> Testing concurrent inserts and lookups" << endl;
+  {
+    static const int kThreads = 4, kOps = 100000, kKeys = 2000;
+    static const size_t kMax = 500, kShards = 8;
+    lfu::concurrent_heap_cache<int, int> chc(kMax, kShards);
+    vector<future<void> > futs;
+    for(int t = 0; t < kThreads; ++t)
+      futs.push_back(async(launch::async, [&chc, t]() {
+            minstd_rand0 local(t);
+            for(int i = 0; i < kOps; ++i) {
+              int key = local() % kKeys;
+              auto val = chc.lookup(key);
+              UASSERT(!val.valid() || val.access() == key)
+                  << "value " << val.access() << " for key " << key;
+              if(!val.valid()) chc.insert(make_pair(key, key));
+            }
+          }));
+    for(auto& f : futs) f.get();
+    // Each shard rounds its share of the max up.
+    UASSERT(chc.size() <= kMax + kShards) << "size " << chc.size();
+  }
+  cout << "...... Complete!" << endl;
+}
+
+void stats_test() {
+  typedef equal_to<int> eq;
+  typedef hash<int> hs;
+  typedef lfu::heap_cache_traits tr;
+  typedef allocator<int> al;
+  static_assert(is_empty<stats::none>::value, "stats::none takes space");
+
+  cout << "=====> Testing heap_cache counts" << endl;
+  {
+    lfu::heap_cache<int, int, eq, hs, tr, al, stats::counting> hc(100);
+    for(int i = 0; i < 50; ++i)
+      hc.insert(make_pair(i, i));
+    hc.insert(make_pair(0, 0));
+    for(int i = 0; i < 60; ++i)
+      hc.lookup(i);
+    auto st = hc.get_stats();
+    UASSERT(st.inserts == 50 && st.replacements == 1)
+        << st.inserts << " inserts, " << st.replacements << " replacements";
+    UASSERT(st.hits == 50 && st.misses == 10) << st;
+    UASSERT(st.hit_rate() * 6 == 5) << st.hit_rate();
+    UASSERT(st.evictions == 0 && st.lookup_ns[0] == 0) << st;
+    hc.set_max_size(20);
+    st = hc.get_stats();
+    UASSERT(st.evictions == 50 - hc.size()) << st;
+    UASSERT(st.eviction_batches[stats::bin_of(st.evictions)] == 1);
+    hc.reset_stats();
+    st = hc.get_stats();
+    UASSERT(st.lookups() == 0 && st.inserts == 0 && st.evictions == 0);
+
+    // Batched evictions on insert.
+    lfu::heap_cache<int, int, eq, hs, tr, al, stats::counting> small(10);
+    for(int i = 0; i < 100; ++i)
+      small.insert(make_pair(i, i));
+    st = small.get_stats();
+    UASSERT(st.inserts - st.evictions == small.size()) << st;
+    size_t batches = 0;
+    for(int i = 0; i < stats::kBins; ++i)
+      batches += st.eviction_batches[i];
+    UASSERT(batches > 1 && batches < st.evictions) << st;
+
+    lfu::heap_cache<int, int> plain;
+    UASSERT(plain.get_stats().inserts == 0);
+    UASSERT(sizeof(plain) < sizeof(hc));
+  }
+  cout << "...... Complete!" << endl;
+
+  cout << "=====> Testing timed linked_cache" << endl;
+  {
+    lfu::linked_cache<int, int, eq, hs, tr, al, stats::timed> lc(10);
+    for(int i = 0; i < 20; ++i)
+      lc.insert(make_pair(i, i));
+    for(int i = 0; i < 1000; ++i)
+      lc.lookup(i % 30);
+    auto st = lc.get_stats();
+    UASSERT(st.evictions == 10 && st.eviction_batches[1] == 10) << st;
+    UASSERT(st.hits + st.misses == 1000) << st;
+    uint64_t timed = 0;
+    for(int i = 0; i < stats::kBins; ++i)
+      timed += st.lookup_ns[i];
+    UASSERT(timed == 1000) << timed << " lookups timed";
+    UASSERT(stats::quantile(st.lookup_ns, 0.5) <=
+            stats::quantile(st.lookup_ns, 0.99));
+  }
+  cout << "...... Complete!" << endl;
+
+  cout << "=====> Testing concurrent_heap_cache counts" << endl;
+  {
+    static const int kThreads = 4, kOps = 20000, kKeys = 1000;
+    lfu::concurrent_heap_cache<int, int, eq, hs, tr, al, synchro::locks::rw,
+                               stats::counting> chc(200, 4);
+    vector<future<void> > futs;
+    for(int t = 0; t < kThreads; ++t)
+      futs.push_back(async(launch::async, [&chc, t]() {
+            minstd_rand0 local(t);
+            for(int i = 0; i < kOps; ++i) {
+              int key = local() % kKeys;
+              if(!chc.lookup(key).valid()) chc.insert(make_pair(key, key));
+            }
+          }));
+    for(auto& f : futs) f.get();
+    auto st = chc.get_stats();
+    UASSERT(st.lookups() == kThreads * kOps) << st;
+    UASSERT(st.inserts + st.replacements == st.misses) << st;
+    UASSERT(st.inserts - st.evictions == chc.size()) << st;
+    chc.reset_stats();
+    UASSERT(chc.get_stats().lookups() == 0);
+  }
+  cout << "...... Complete!" << endl;
+}
+
+namespace {
+
+struct wide_counts {
+  typedef uint64_t count_type;
+};
+
+// Whether f() throws an E.
+template<typename E, typename F>
+bool throws(F f) {
+  try {
+    f();
+  } catch(const E&) {
+    return true;
+  }
+  return false;
+}
+
+// Shrinks copies of a and b to each size, checking they keep the same keys
+// in [0, nkeys).
+template<typename A, typename B>
+void same_evictions(const A& a, const B& b, int nkeys) {
+  for(size_t max : {50, 20, 5}) {
+    A ca = a;
+    B cb = b;
+    ca.set_max_size(max);
+    cb.set_max_size(max);
+    for(int i = 0; i < nkeys; ++i)
+      UASSERT(ca.contains(i) == cb.contains(i)) << "key " << i << ", max "
+                                                << max;
+  }
+}
+
+// Items i < n, valued 2 * i, looked up i % 7 times.
+template<typename C>
+void fill(C& c, int n) {
+  for(int i = 0; i < n; ++i)
+    c.insert(make_pair(i, 2 * i));
+  for(int i = 0; i < n; ++i)
+    for(int j = 0; j < i % 7; ++j)
+      c.lookup(i);
+}
+
+} // anonymous namespace
+
+void snapshot_test() {
+  static const char* kHeapPath = "cache-test.heap.snapshot";
+  static const char* kLinkedPath = "cache-test.linked.snapshot";
+  static const int kItems = 60;
+
+  cout << "=====> Testing heap_cache round trip" << endl;
+  lfu::heap_cache<int, int> hc(100);
+  fill(hc, kItems);
+  hc.save(kHeapPath);
+  {
+    lfu::heap_cache<int, int> loaded(100);
+    loaded.insert(make_pair(-1, -1));
+    loaded.load(kHeapPath);
+    UASSERT(loaded.size() == kItems) << "size " << loaded.size();
+    UASSERT(!loaded.contains(-1)) << "old contents kept";
+    for(int i = 0; i < kItems; ++i)
+      UASSERT(loaded.peek(i) && *loaded.peek(i) == 2 * i) << "key " << i;
+    // Same counts in the same heap: shrinking evicts the same items.
+    same_evictions(hc, loaded, kItems);
+
+    // A smaller cache keeps a prefix of the heap, so at least what an
+    // eviction down to its size would.
+    lfu::heap_cache<int, int> small(20), shrunk = hc;
+    small.load(kHeapPath);
+    shrunk.set_max_size(20);
+    UASSERT(small.size() == 20) << "size " << small.size();
+    for(int i = 0; i < kItems; ++i)
+      UASSERT(!shrunk.contains(i) || small.contains(i)) << "key " << i;
+
+    lfu::heap_cache<int, int> empty, from_empty(10);
+    empty.save(kHeapPath + string(".empty"));
+    from_empty.insert(make_pair(1, 1));
+    from_empty.load(kHeapPath + string(".empty"));
+    UASSERT(from_empty.empty());
+    remove((kHeapPath + string(".empty")).c_str());
+  }
+  cout << "...... Complete!" << endl;
+
+  cout << "=====> Testing linked_cache round trip" << endl;
+  lfu::linked_cache<int, int> lc(100);
+  fill(lc, kItems);
+  lc.save(kLinkedPath);
+  {
+    lfu::linked_cache<int, int> loaded(100);
+    loaded.load(kLinkedPath);
+    UASSERT(loaded.size() == kItems) << "size " << loaded.size();
+    for(int i = 0; i < kItems; ++i)
+      UASSERT(loaded.contains(i) && *loaded.lookup(i) == 2 * i);
+    // Undo the lookups above, so counts can be compared through evictions.
+    loaded.load(kLinkedPath);
+    same_evictions(lc, loaded, kItems);
+  }
+  cout << "...... Complete!" << endl;
+
+  cout << "=====> Testing snapshots across cache types" << endl;
+  {
+    lfu::linked_cache<int, int> from_heap(100);
+    from_heap.load(kHeapPath);
+    UASSERT(from_heap.size() == kItems);
+    // Sorted by count: the evicted keys were looked up least.
+    from_heap.set_max_size(10);
+    int least_kept = 7, most_evicted = -1;
+    for(int i = 0; i < kItems; ++i)
+      if(from_heap.contains(i)) least_kept = min(least_kept, i % 7);
+      else most_evicted = max(most_evicted, i % 7);
+    UASSERT(least_kept >= most_evicted) << least_kept << " < "
+                                        << most_evicted;
+
+    lfu::heap_cache<int, int> from_linked(100);
+    from_linked.load(kLinkedPath);
+    UASSERT(from_linked.size() == kItems);
+    for(int i = 0; i < kItems; ++i)
+      UASSERT(from_linked.peek(i) && *from_linked.peek(i) == 2 * i);
+  }
+  cout << "...... Complete!" << endl;
+
+  cout << "=====> Testing bad snapshots" << endl;
+  {
+    lfu::heap_cache<int, int> c(100);
+    c.insert(make_pair(1, 1));
+    UASSERT(throws<system_error>([&]() { c.load("no/such/snapshot"); }));
+    lfu::heap_cache<long long, int> wide(100);
+    UASSERT(throws<runtime_error>([&]() { wide.load(kHeapPath); }))
+        << "key size mismatch not caught";
+    lfu::heap_cache<int, int, equal_to<int>, hash<int>, wide_counts>
+        wide_count(100);
+    UASSERT(throws<runtime_error>([&]() { wide_count.load(kHeapPath); }))
+        << "count size mismatch not caught";
+
+    // Cut off the last count.
+    string bytes;
+    {
+      ifstream in(kHeapPath, ios::binary);
+      bytes.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    }
+    string cut = kHeapPath + string(".cut");
+    {
+      ofstream out(cut, ios::binary);
+      out.write(bytes.data(), bytes.size() - 1);
+    }
+    UASSERT(throws<runtime_error>([&]() { c.load(cut); }))
+        << "truncation not caught";
+    {
+      ofstream out(cut, ios::binary);
+      bytes[0] ^= 1;
+      out.write(bytes.data(), bytes.size());
+    }
+    UASSERT(throws<runtime_error>([&]() { c.load(cut); }))
+        << "bad magic not caught";
+    remove(cut.c_str());
+    UASSERT(c.size() == 1 && c.contains(1)) << "failed load changed cache";
+  }
+  cout << "...... Complete!" << endl;
+
+  remove(kHeapPath);
+  remove(kLinkedPath);
+}
+
+namespace {
+
+// Zipfian keys in [0, nkeys), with parameter 0.99.
+vector<int> zipf_trace(size_t len, int nkeys, minstd_rand0& gen) {
+  vector<double> weights;
+  for(int i = 1; i <= nkeys; ++i)
+    weights.push_back(1 / pow(i, 0.99));
+  discrete_distribution<int> dist(weights.begin(), weights.end());
+  vector<int> trace;
+  for(size_t i = 0; i < len; ++i)
+    trace.push_back(dist(gen));
+  return trace;
+}
+
+// Every 'every' accesses, a scan of 'scanlen' never repeated keys.
+vector<int> scan_mixed(const vector<int>& zipf, int nkeys, int every,
+                       int scanlen) {
+  vector<int> trace;
+  int next = nkeys;
+  for(size_t i = 0; i < zipf.size(); ++i) {
+    trace.push_back(zipf[i]);
+    if(i % every == 0)
+      for(int j = 0; j < scanlen; ++j)
+        trace.push_back(next++);
+  }
+  return trace;
+}
+
+template<typename C>
+void replay(util::bench::suite& suite, const string& name,
+            const vector<int>& trace, size_t max) {
+  size_t hits = 0;
+  unique_ptr<C> c;
+  suite.run_fixed(name, [&]() {
+      c.reset(new C(max));
+      hits = 0;
+    }, [&]() {
+      for(int key : trace) {
+        if(c->lookup(key)) ++hits;
+        else c->insert(make_pair(key, key));
+      }
+    }, trace.size());
+  suite.log() << "    hit rate " << 100.0 * hits / trace.size() << "%"
+              << endl;
+}
+
+void replay_all(const string& trace_name, const vector<int>& trace,
+                size_t max) {
+  util::bench::suite suite(
+      "LFU cache benchmark, " + trace_name + " (" +
+      to_string(trace.size()) + " accesses, size " + to_string(max) + ")");
+  replay<lfu::heap_cache<int, int> >(suite, "heap_cache", trace, max);
+  replay<lfu::linked_cache<int, int> >(suite, "linked_cache", trace, max);
+  replay<caches::tinylfu_cache<int, int> >(suite, "tinylfu_cache", trace,
+                                           max);
+}
+
+// Refilling a cache with its items and counts, from wherever they came
+// from, against loading a snapshot of it.
+void warm_start() {
+  typedef lfu::heap_cache<uint64_t, uint64_t> cache_type;
+  static const size_t kItems = 1 << 20;
+  static const char* kPath = "cache-test.bench.snapshot";
+  cache_type full(kItems);
+  vector<pair<uint64_t, cache_type::count_type> > items;
+  for(size_t i = 0; i < kItems; ++i) {
+    items.emplace_back(i * 2654435761u, i % 100);
+    full.insert(make_pair(items.back().first, i));
+    full.bump(items.back().first, items.back().second);
+  }
+  util::bench::suite suite("LFU cache warm start (" + to_string(kItems) +
+                           " items)");
+  suite.run_fixed("save", []() {}, [&]() { full.save(kPath); }, kItems);
+  unique_ptr<cache_type> c;
+  suite.run_fixed("insert and bump", [&]() { c.reset(new cache_type(kItems)); },
+                  [&]() {
+      for(size_t i = 0; i < kItems; ++i) {
+        c->insert(make_pair(items[i].first, i));
+        c->bump(items[i].first, items[i].second);
+      }
+    }, kItems);
+  suite.run_fixed("load", [&]() { c.reset(new cache_type(kItems)); },
+                  [&]() { c->load(kPath); }, kItems);
+  remove(kPath);
+}
+
+} // anonymous namespace
+
+void bench() {
+  static const int kKeys = 100000;
+  static const size_t kLen = 2000000, kMax = 2000;
+  auto zipf = zipf_trace(kLen, kKeys, gen);
+  replay_all("Zipfian", zipf, kMax);
+  replay_all("Zipfian with scans", scan_mixed(zipf, kKeys, 10000, 5000),
+             kMax);
+  warm_start();
+}
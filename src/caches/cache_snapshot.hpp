@@ -0,0 +1,147 @@
+/*
+  Vladimir Feinberg
+  caches/cache_snapshot.hpp
+  2026-10-15
+
+  On-disk snapshot format of the LFU caches (heap_cache::save() and
+  load(), linked_cache::save() and load()).
+*/
+
+#ifndef CACHES_CACHE_SNAPSHOT_HPP_
+#define CACHES_CACHE_SNAPSHOT_HPP_
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "util/mapped_file.hpp"
+
+namespace caches {
+namespace snapshot {
+
+// A snapshot is, in the writer's native byte order:
+//
+//   header
+//   key_type keys[items]
+//   value_type values[items]
+//   count_type counts[items]
+//
+// with no padding, each array holding the raw bytes of the objects. Items
+// go most valuable first, so that every prefix of a snapshot holds what
+// the cache would keep if it were shrunk to that size: heap order for a
+// heap_cache, decreasing count order for a linked_cache (which is a heap
+// order too). Loading a snapshot into a smaller cache keeps a prefix.
+//
+// The key, value and count types are only checked by size, so a snapshot
+// should be loaded into a cache of the same types it was saved from.
+// Anything else about the file is trusted once its header checks out.
+struct header {
+  char magic[8];
+  std::uint32_t version;
+  // kByteOrder, as the writer stored it.
+  std::uint32_t byte_order;
+  std::uint32_t key_size;
+  std::uint32_t value_size;
+  std::uint32_t count_size;
+  std::uint32_t reserved;
+  std::uint64_t items;
+};
+static_assert(sizeof(header) == 40, "snapshot header has padding");
+
+constexpr char kMagic[8] = {'L', 'F', 'U', 'S', 'N', 'A', 'P', '\0'};
+constexpr std::uint32_t kVersion = 1;
+constexpr std::uint32_t kByteOrder = 0x01020304;
+
+template<typename Key, typename Value, typename Count>
+header make_header(std::uint64_t items) {
+  static_assert(std::is_trivially_copyable<Key>::value &&
+                std::is_trivially_copyable<Value>::value,
+                "snapshots need trivially copyable keys and values");
+  header h;
+  std::memcpy(h.magic, kMagic, sizeof(kMagic));
+  h.version = kVersion;
+  h.byte_order = kByteOrder;
+  h.key_size = sizeof(Key);
+  h.value_size = sizeof(Value);
+  h.count_size = sizeof(Count);
+  h.reserved = 0;
+  h.items = items;
+  return h;
+}
+
+/*
+ * INPUT:
+ * const util::mapped_file& file - snapshot, as mapped by the loader
+ * PRECONDITION:
+ * BEHAVIOR:
+ * Checks that the file is a snapshot of this version and byte order, for
+ * these types, and exactly as long as its header says.
+ * RETURN:
+ * The file's header. Throws std::runtime_error if any check fails.
+ */
+template<typename Key, typename Value, typename Count>
+header check(const util::mapped_file& file) {
+  auto expect = make_header<Key, Value, Count>(0);
+  header h;
+  if (file.size() < sizeof(h))
+    throw std::runtime_error("cache snapshot: file too short");
+  std::memcpy(&h, file.data(), sizeof(h));
+  if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0)
+    throw std::runtime_error("cache snapshot: bad magic");
+  if (h.version != kVersion)
+    throw std::runtime_error("cache snapshot: unsupported version " +
+                             std::to_string(h.version));
+  if (h.byte_order != kByteOrder)
+    throw std::runtime_error("cache snapshot: foreign byte order");
+  if (h.key_size != expect.key_size || h.value_size != expect.value_size ||
+      h.count_size != expect.count_size)
+    throw std::runtime_error("cache snapshot: key, value or count size "
+                             "mismatch");
+  std::uint64_t item_size = std::uint64_t(h.key_size) + h.value_size +
+      h.count_size;
+  if ((file.size() - sizeof(h)) / item_size < h.items ||
+      sizeof(h) + h.items * item_size != file.size())
+    throw std::runtime_error("cache snapshot: size doesn't match header");
+  return h;
+}
+
+// Reads a T from possibly unaligned bytes.
+template<typename T>
+T read(const char* bytes) {
+  typename std::aligned_storage<sizeof(T), alignof(T)>::type buf;
+  std::memcpy(&buf, bytes, sizeof(T));
+  return *reinterpret_cast<const T*>(&buf);
+}
+
+// Where item i's key, value and count are in a checked snapshot.
+template<typename Key, typename Value, typename Count>
+class reader {
+ public:
+  explicit reader(const util::mapped_file& file) :
+      h_(check<Key, Value, Count>(file)),
+      keys_(file.data() + sizeof(header)),
+      values_(keys_ + h_.items * sizeof(Key)),
+      counts_(values_ + h_.items * sizeof(Value)) {}
+
+  std::uint64_t items() const { return h_.items; }
+  Key key(std::uint64_t i) const { return read<Key>(keys_ + i * sizeof(Key)); }
+  Value value(std::uint64_t i) const {
+    return read<Value>(values_ + i * sizeof(Value));
+  }
+  Count count(std::uint64_t i) const {
+    return read<Count>(counts_ + i * sizeof(Count));
+  }
+
+ private:
+  header h_;
+  const char* keys_;
+  const char* values_;
+  const char* counts_;
+};
+
+} // namespace snapshot
+} // namespace caches
+
+#endif /* CACHES_CACHE_SNAPSHOT_HPP_ */
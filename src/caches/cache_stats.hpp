@@ -0,0 +1,250 @@
+/*
+  Vladimir Feinberg
+  caches/cache_stats.hpp
+  2026-10-14
+
+  Statistics policies for caches: what a cache counts as it is used (hits,
+  misses, inserts, replacements, evictions, and optionally how long lookups
+  and evictions take), and a plain summary of those counts for reporting.
+*/
+
+#ifndef CACHES_CACHE_STATS_HPP_
+#define CACHES_CACHE_STATS_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+namespace caches {
+namespace stats {
+
+// Histograms bin by powers of two: bin 0 holds zeros, and bin i > 0 holds
+// samples in [2^(i-1), 2^i).
+constexpr int kBins = 65;
+
+// Bin of a histogram sample.
+inline int bin_of(uint64_t sample) {
+  int bin = 0;
+  while(sample) {
+    sample >>= 1;
+    ++bin;
+  }
+  return bin;
+}
+
+/*
+ * A summary is a snapshot of a cache's statistics, possibly summed over
+ * several shards or threads. Counts a policy doesn't keep are left 0.
+ */
+struct summary {
+  summary() : hits(0), misses(0), inserts(0), replacements(0), evictions(0),
+              eviction_ns(0), eviction_batches(), lookup_ns() {}
+  uint64_t hits, misses;
+  // Inserts of new keys, and insert() calls for keys already present.
+  uint64_t inserts, replacements;
+  // Items evicted, and total time spent evicting them.
+  uint64_t evictions, eviction_ns;
+  // Number of items evicted at a time.
+  uint64_t eviction_batches[kBins];
+  // Lookup latencies.
+  uint64_t lookup_ns[kBins];
+
+  uint64_t lookups() const { return hits + misses; }
+  // Fraction of lookups which hit, 0 if there were none.
+  double hit_rate() const {
+    return lookups() ? static_cast<double>(hits) / lookups() : 0;
+  }
+  summary& operator+=(const summary& other);
+};
+
+/*
+ * INPUT:
+ * const uint64_t (&bins)[kBins] - a histogram
+ * double q - quantile, in [0, 1]
+ * PRECONDITION:
+ * BEHAVIOR:
+ * RETURN:
+ * An upper bound on the q-th quantile of the histogram's samples: the
+ * (exclusive) upper end of the bin it falls in. 0 for an empty histogram.
+ */
+inline uint64_t quantile(const uint64_t (&bins)[kBins], double q) {
+  uint64_t total = 0;
+  for(int i = 0; i < kBins; ++i) total += bins[i];
+  if(!total) return 0;
+  uint64_t seen = 0;
+  for(int i = 0; i < kBins; ++i) {
+    seen += bins[i];
+    if(seen >= q * total)
+      return i == 0 ? 0 : i == kBins - 1 ? UINT64_MAX : uint64_t(1) << i;
+  }
+  return UINT64_MAX;
+}
+
+inline summary& summary::operator+=(const summary& other) {
+  hits += other.hits;
+  misses += other.misses;
+  inserts += other.inserts;
+  replacements += other.replacements;
+  evictions += other.evictions;
+  eviction_ns += other.eviction_ns;
+  for(int i = 0; i < kBins; ++i) {
+    eviction_batches[i] += other.eviction_batches[i];
+    lookup_ns[i] += other.lookup_ns[i];
+  }
+  return *this;
+}
+
+inline std::ostream& operator<<(std::ostream& o, const summary& s) {
+  o << "lookups " << s.lookups() << " (hit rate " << 100 * s.hit_rate()
+    << "%), inserts " << s.inserts << ", replacements " << s.replacements
+    << ", evictions " << s.evictions << " in " << s.eviction_ns << "ns";
+  if(s.lookup_ns[0] || quantile(s.lookup_ns, 1))
+    o << ", lookup p50 < " << quantile(s.lookup_ns, 0.5) << "ns, p99 < "
+      << quantile(s.lookup_ns, 0.99) << "ns";
+  return o;
+}
+
+// A counter. Shared counters may be added to by several threads at once,
+// and read while they are.
+template<bool Shared>
+class counter {
+ public:
+  counter() : val_(0) {}
+  void add(uint64_t n = 1) { val_ += n; }
+  uint64_t get() const { return val_; }
+  void reset() { val_ = 0; }
+ private:
+  uint64_t val_;
+};
+
+template<>
+class counter<true> {
+ public:
+  counter() : val_(0) {}
+  void add(uint64_t n = 1) { val_.fetch_add(n, std::memory_order_relaxed); }
+  uint64_t get() const { return val_.load(std::memory_order_relaxed); }
+  void reset() { val_.store(0, std::memory_order_relaxed); }
+ private:
+  std::atomic<uint64_t> val_;
+};
+
+// Measures elapsed time, if Timed; otherwise does (and costs) nothing.
+template<bool Timed>
+struct stopwatch {
+  stopwatch() : start(std::chrono::steady_clock::now()) {}
+  uint64_t elapsed_ns() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+  }
+  std::chrono::steady_clock::time_point start;
+};
+
+template<>
+struct stopwatch<false> {
+  uint64_t elapsed_ns() const { return 0; }
+};
+
+/*
+ * A statistics policy is what a cache notifies of its operations. Caches
+ * inherit from their policy (so an empty one takes no space), and call:
+ *
+ * stopwatch_type start() - before a lookup or an eviction
+ * on_hit(sw), on_miss(sw) - at the end of a lookup
+ * on_insert(), on_replace() - on insertion of a new or present key
+ * on_evict(sw, n) - after having evicted n items at once
+ * collect(summary& s) - adds the counts so far to s
+ * reset() - zeroes the counts
+ *
+ * All but reset() are const, since lookups are. Policies are not
+ * thread-safe unless their shared_type is themselves.
+ *
+ * none is the default: every call is empty and inlined, so a cache using it
+ * is exactly as if it kept no statistics.
+ */
+struct none {
+  typedef stopwatch<false> stopwatch_type;
+  typedef none shared_type;
+  static constexpr bool enabled = false;
+
+  static stopwatch_type start() { return stopwatch_type(); }
+  void on_hit(stopwatch_type) const {}
+  void on_miss(stopwatch_type) const {}
+  void on_insert() const {}
+  void on_replace() const {}
+  void on_evict(stopwatch_type, size_t) const {}
+  void collect(summary&) const {}
+  void reset() {}
+};
+
+/*
+ * Counts every operation, and if Timed, the time taken by each lookup and
+ * eviction (two clock reads apiece). If Shared, every count is a relaxed
+ * atomic, so that several threads may record at once.
+ */
+template<bool Timed, bool Shared = false>
+class basic {
+ public:
+  typedef stopwatch<Timed> stopwatch_type;
+  typedef basic<Timed, true> shared_type;
+  static constexpr bool enabled = true;
+
+  static stopwatch_type start() { return stopwatch_type(); }
+  void on_hit(stopwatch_type sw) const {
+    hits_.add();
+    if(Timed) lookup_ns_[bin_of(sw.elapsed_ns())].add();
+  }
+  void on_miss(stopwatch_type sw) const {
+    misses_.add();
+    if(Timed) lookup_ns_[bin_of(sw.elapsed_ns())].add();
+  }
+  void on_insert() const { inserts_.add(); }
+  void on_replace() const { replacements_.add(); }
+  void on_evict(stopwatch_type sw, size_t n) const {
+    evictions_.add(n);
+    eviction_batches_[bin_of(n)].add();
+    if(Timed) eviction_ns_.add(sw.elapsed_ns());
+  }
+  void collect(summary& s) const {
+    s.hits += hits_.get();
+    s.misses += misses_.get();
+    s.inserts += inserts_.get();
+    s.replacements += replacements_.get();
+    s.evictions += evictions_.get();
+    s.eviction_ns += eviction_ns_.get();
+    for(int i = 0; i < kBins; ++i) {
+      s.eviction_batches[i] += eviction_batches_[i].get();
+      s.lookup_ns[i] += lookup_ns_[i].get();
+    }
+  }
+  void reset() {
+    hits_.reset();
+    misses_.reset();
+    inserts_.reset();
+    replacements_.reset();
+    evictions_.reset();
+    eviction_ns_.reset();
+    for(int i = 0; i < kBins; ++i) {
+      eviction_batches_[i].reset();
+      lookup_ns_[i].reset();
+    }
+  }
+
+ private:
+  mutable counter<Shared> hits_, misses_, inserts_, replacements_,
+      evictions_, eviction_ns_;
+  mutable counter<Shared> eviction_batches_[kBins];
+  // Left at 0 unless Timed.
+  mutable counter<Shared> lookup_ns_[kBins];
+};
+
+// Counts operations.
+typedef basic<false> counting;
+// Counts operations and times lookups and evictions.
+typedef basic<true> timed;
+
+} // namespace stats
+} // namespace caches
+
+#endif /* CACHES_CACHE_STATS_HPP_ */
@@ -0,0 +1,164 @@
+/*
+  Vladimir Feinberg
+  caches/concurrent_heap_cache.hpp
+  2026-10-14
+
+  Defines concurrent_heap_cache, a thread-safe heap_cache made of
+  independently locked shards.
+*/
+
+#ifndef CACHES_CONCURRENT_HEAP_CACHE_HPP_
+#define CACHES_CONCURRENT_HEAP_CACHE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "caches/lfu_cache.hpp"
+#include "queues/ring_queue.hpp"
+#include "synchro/rwlock.hpp"
+#include "util/cache_line.hpp"
+#include "util/hash.hpp"
+#include "util/optional.hpp"
+#include "util/thread_index.hpp"
+
+namespace caches {
+namespace lfu {
+
+/*
+ * A concurrent_heap_cache hash-partitions keys across a fixed number of
+ * heap_cache shards, each behind its own reader-writer lock, so threads
+ * working on different shards never contend.
+ *
+ * Lookups only take their shard's lock shared. Instead of bumping the key's
+ * frequency in place (which needs the heap, and thus the exclusive lock),
+ * a lookup records the key in its shard's read buffer, a lock-free
+ * queues::ring_queue. The buffer is drained into the heap in one batch,
+ * under the exclusive lock, by whichever lookup finds it full (if it can
+ * take the lock without waiting), by every write to the shard, and by
+ * flush(). When the buffer is full and its shard busy the read is not
+ * counted: frequencies are approximate anyway, and hot keys are read often
+ * enough to be sampled.
+ *
+ * Since shards are modified concurrently, values are returned by copy, and
+ * this class does not implement the cache interface. Each shard holds at
+ * most ceil(max / shards) items, so the total may slightly exceed max.
+ *
+ * concurrent_heap_cache<Key, Value, Pred, Hash, Traits, Alloc, Lock, Stats>
+ * Key, Value, Pred, Hash, Traits, Alloc - as for heap_cache
+ * Lock - shard lock, with lock(), try_lock(), unlock(), and a read_only()
+ *        view whose lock()/unlock() take it shared (as synchro::locks::rw)
+ * Stats - statistics policy, as for heap_cache. Writes are counted by the
+ *         shards, under their locks. Hits and misses are counted in
+ *         per-thread slots (the first kStatSlots threads to look anything up
+ *         get their own, later ones share them), so that lookups sharing a
+ *         shard don't contend on its counters.
+ *
+ * This class is thread safe.
+ */
+template<typename Key, typename Value, typename Pred = std::equal_to<Key>,
+         typename Hash = std::hash<Key>, typename Traits = heap_cache_traits,
+         typename Alloc = std::allocator<Key>,
+         typename Lock = synchro::locks::rw, typename Stats = stats::none>
+class concurrent_heap_cache {
+ public:
+  typedef heap_cache<Key, Value, Pred, Hash, Traits, Alloc, Stats> shard_type;
+  typedef Key key_type;
+  typedef Value value_type;
+  typedef typename shard_type::key_cref key_cref;
+  typedef typename shard_type::kv_type kv_type;
+  typedef typename shard_type::size_type size_type;
+  typedef Hash hasher;
+
+  static constexpr size_t kDefaultShards = 16;
+  // Per-shard read buffer capacity.
+  static constexpr size_t kReadBuffer = 64;
+  // Per-thread lookup statistics slots, if Stats is enabled.
+  static constexpr size_t kStatSlots = 32;
+
+  /*
+   * INPUT:
+   * size_t max = -1 - maximum total size
+   * size_t shards = kDefaultShards - number of shards
+   * PRECONDITION:
+   * shards > 0
+   * BEHAVIOR:
+   * Generates an empty cache with specified max size.
+   */
+  explicit concurrent_heap_cache(size_t max = -1,
+                                 size_t shards = kDefaultShards);
+  concurrent_heap_cache(const concurrent_heap_cache&) = delete;
+  concurrent_heap_cache& operator=(const concurrent_heap_cache&) = delete;
+
+  // Snapshots under concurrent modification (shards are visited one by
+  // one).
+  bool empty() const;
+  size_type size() const;
+  size_type get_max_size() const { return max_size.load(); }
+  size_type shard_count() const { return shards.size(); }
+  // As heap_cache::insert().
+  bool insert(const kv_type& kv);
+  bool insert(kv_type&& kv);
+  bool contains(key_cref key) const;
+  /*
+   * INPUT:
+   * key_cref key
+   * PRECONDITION:
+   * BEHAVIOR:
+   * Counts a lookup of key (buffered, see above).
+   * RETURN:
+   * A copy of the value for key, or an invalid (unconstructed) optional if
+   * key is not currently in the cache.
+   */
+  util::optional<value_type> lookup(key_cref key) const;
+  void clear();
+  // As heap_cache::set_max_size(), spread over the shards.
+  void set_max_size(size_t max);
+  // Applies every buffered lookup to the shard heaps.
+  void flush() const;
+  // Sums every shard's and thread's statistics (snapshots, as for size()).
+  stats::summary get_stats() const;
+  void reset_stats();
+
+  static hasher hash_function() { return hashf; }
+
+ private:
+  struct shard {
+    explicit shard(size_t max) : cache(max), reads(kReadBuffer) {}
+    util::cache_pad<0> pad_;
+    mutable Lock lock;
+    // Modified only under the exclusive lock.
+    mutable shard_type cache;
+    // Keys looked up since the last drain.
+    mutable queues::ring_queue<key_type> reads;
+  };
+  struct stat_slot {
+    util::cache_pad<0> pad_;
+    typename Stats::shared_type stats;
+  };
+
+  static size_t shard_max(size_t max, size_t nshards);
+  shard& shard_for(key_cref key) const;
+  // Requires the shard's exclusive lock.
+  static void drain(shard& s);
+  // Calling thread's lookup statistics (requires Stats::enabled).
+  const typename Stats::shared_type& local_stats() const;
+  template<typename KV>
+  bool insert_impl(KV&& kv);
+
+  static hasher hashf;
+  std::atomic<size_type> max_size;
+  std::vector<std::unique_ptr<shard> > shards;
+  // kStatSlots of them, or none if Stats isn't enabled.
+  std::unique_ptr<stat_slot[]> stat_slots;
+};
+
+} // namespace lfu
+} // namespace caches
+
+#include "caches/concurrent_heap_cache.tpp"
+
+#endif /* CACHES_CONCURRENT_HEAP_CACHE_HPP_ */
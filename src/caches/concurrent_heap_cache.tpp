@@ -0,0 +1,223 @@
+/*
+ * Vladimir Feinberg
+ * 2026-10-14
+ * caches/concurrent_heap_cache.tpp
+ *
+ * Contains implementation of concurrent_heap_cache.hpp's methods.
+ */
+
+#include <mutex>
+
+#include <util/uassert.hpp>
+
+namespace caches {
+namespace lfu {
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename L, typename St>
+constexpr size_t concurrent_heap_cache<K,V,P,H,S,A,L,St>::kDefaultShards;
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename L, typename St>
+constexpr size_t concurrent_heap_cache<K,V,P,H,S,A,L,St>::kReadBuffer;
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename L, typename St>
+constexpr size_t concurrent_heap_cache<K,V,P,H,S,A,L,St>::kStatSlots;
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename L, typename St>
+size_t concurrent_heap_cache<K,V,P,H,S,A,L,St>::shard_max(size_t max,
+                                                      size_t nshards) {
+  // Round up, careful not to overflow the "unbounded" default.
+  return max / nshards + (max % nshards != 0);
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename L, typename St>
+concurrent_heap_cache<K,V,P,H,S,A,L,St>::concurrent_heap_cache(size_t max,
+                                                           size_t nshards) :
+    max_size(max) {
+  UASSERT(nshards > 0);
+  for(size_t i = 0; i < nshards; ++i)
+    shards.emplace_back(new shard(shard_max(max, nshards)));
+  if(St::enabled) stat_slots.reset(new stat_slot[kStatSlots]);
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename L, typename St>
+auto concurrent_heap_cache<K,V,P,H,S,A,L,St>::shard_for(key_cref key) const
+    -> shard& {
+  // The shards' hash maps use the same hash, so mix it before picking a
+  // shard (std::hash is the identity for integers), or every shard would
+  // only see keys from a few of its buckets.
+  return *shards[util::mix_hash(hashf(key)) % shards.size()];
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename L, typename St>
+void concurrent_heap_cache<K,V,P,H,S,A,L,St>::drain(shard& s) {
+  while(true) {
+    auto key = s.reads.try_dequeue();
+    if(!key.valid()) break;
+    // The key may have been evicted since it was read.
+    s.cache.bump(key.access());
+  }
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename L, typename St>
+auto concurrent_heap_cache<K,V,P,H,S,A,L,St>::local_stats() const
+    -> const typename St::shared_type& {
+  return stat_slots[util::thread_index() % kStatSlots].stats;
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename L, typename St>
+bool concurrent_heap_cache<K,V,P,H,S,A,L,St>::empty() const {
+  for(auto& s : shards) {
+    auto ro = s->lock.read_only();
+    std::lock_guard<decltype(ro)> lk(ro);
+    if(!s->cache.empty()) return false;
+  }
+  return true;
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename L, typename St>
+auto concurrent_heap_cache<K,V,P,H,S,A,L,St>::size() const -> size_type {
+  size_type total = 0;
+  for(auto& s : shards) {
+    auto ro = s->lock.read_only();
+    std::lock_guard<decltype(ro)> lk(ro);
+    total += s->cache.size();
+  }
+  return total;
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename L, typename St>
+template<typename KV>
+bool concurrent_heap_cache<K,V,P,H,S,A,L,St>::insert_impl(KV&& kv) {
+  auto& s = shard_for(kv.first);
+  std::lock_guard<L> lk(s.lock);
+  // Count pending reads first, so they weigh in on what gets evicted.
+  drain(s);
+  return s.cache.insert(std::forward<KV>(kv));
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename L, typename St>
+bool concurrent_heap_cache<K,V,P,H,S,A,L,St>::insert(const kv_type& kv) {
+  return insert_impl(kv);
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename L, typename St>
+bool concurrent_heap_cache<K,V,P,H,S,A,L,St>::insert(kv_type&& kv) {
+  return insert_impl(std::move(kv));
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename L, typename St>
+bool concurrent_heap_cache<K,V,P,H,S,A,L,St>::contains(key_cref key) const {
+  auto& s = shard_for(key);
+  auto ro = s.lock.read_only();
+  std::lock_guard<decltype(ro)> lk(ro);
+  return s.cache.contains(key);
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename L, typename St>
+auto concurrent_heap_cache<K,V,P,H,S,A,L,St>::lookup(key_cref key) const
+    -> util::optional<value_type> {
+  auto sw = St::start();
+  auto& s = shard_for(key);
+  util::optional<value_type> ret;
+  {
+    auto ro = s.lock.read_only();
+    std::lock_guard<decltype(ro)> lk(ro);
+    auto val = s.cache.peek(key);
+    if(!val) {
+      if(St::enabled) local_stats().on_miss(sw);
+      return ret;
+    }
+    ret.construct(*val);
+  }
+  if(St::enabled) local_stats().on_hit(sw);
+  if(s.reads.try_enqueue(key)) return ret;
+  // Buffer full: drain it if nobody else holds the shard, otherwise let
+  // this read go uncounted.
+  if(s.lock.try_lock()) {
+    std::lock_guard<L> lk(s.lock, std::adopt_lock);
+    drain(s);
+    s.cache.bump(key);
+  }
+  return ret;
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename L, typename St>
+void concurrent_heap_cache<K,V,P,H,S,A,L,St>::clear() {
+  for(auto& s : shards) {
+    std::lock_guard<L> lk(s->lock);
+    while(s->reads.try_dequeue().valid()) {}
+    s->cache.clear();
+  }
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename L, typename St>
+void concurrent_heap_cache<K,V,P,H,S,A,L,St>::set_max_size(size_t max) {
+  max_size.store(max);
+  auto per_shard = shard_max(max, shards.size());
+  for(auto& s : shards) {
+    std::lock_guard<L> lk(s->lock);
+    drain(*s);
+    s->cache.set_max_size(per_shard);
+  }
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename L, typename St>
+void concurrent_heap_cache<K,V,P,H,S,A,L,St>::flush() const {
+  for(auto& s : shards) {
+    std::lock_guard<L> lk(s->lock);
+    drain(*s);
+  }
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename L, typename St>
+stats::summary concurrent_heap_cache<K,V,P,H,S,A,L,St>::get_stats() const {
+  stats::summary total;
+  for(auto& s : shards) {
+    auto ro = s->lock.read_only();
+    std::lock_guard<decltype(ro)> lk(ro);
+    total += s->cache.get_stats();
+  }
+  if(St::enabled)
+    for(size_t i = 0; i < kStatSlots; ++i)
+      stat_slots[i].stats.collect(total);
+  return total;
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename L, typename St>
+void concurrent_heap_cache<K,V,P,H,S,A,L,St>::reset_stats() {
+  for(auto& s : shards) {
+    std::lock_guard<L> lk(s->lock);
+    s->cache.reset_stats();
+  }
+  if(St::enabled)
+    for(size_t i = 0; i < kStatSlots; ++i)
+      stat_slots[i].stats.reset();
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename L, typename St>
+typename concurrent_heap_cache<K,V,P,H,S,A,L,St>::hasher
+concurrent_heap_cache<K,V,P,H,S,A,L,St>::hashf {};
+
+} // namespace lfu
+} // namespace caches
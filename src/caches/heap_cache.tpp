@@ -6,167 +6,399 @@
  * Contains implementation of lfu_cache.hpp's heap_cache methods.
  */
 
+#include <algorithm>
+#include <limits>
+#include <new>
+#include <string>
+#include <utility>
+
+#include <util/mapped_file.hpp>
 #include <util/uassert.hpp>
 
 namespace caches {
 namespace lfu {
 
-template<typename K, typename V, typename P, typename H, typename S>
-auto heap_cache<K,V,P,H,S>::operator=(const heap_cache& other) -> heap_cache& {
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+constexpr typename heap_cache<K,V,P,H,S,A,St>::index_type
+heap_cache<K,V,P,H,S,A,St>::kNone;
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+constexpr unsigned heap_cache<K,V,P,H,S,A,St>::MAX_DIST;
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+auto heap_cache<K,V,P,H,S,A,St>::operator=(const heap_cache& other) -> heap_cache& {
   if(this == &other) return *this;
   clear();
   max_size = other.max_size;
   if(other.empty()) return *this;
+  // Same table size, so every item can go in the same slot.
+  slots = decltype(slots)(other.slots.size());
+  dists = other.dists;
   heap = other.heap;
-  keymap = other.keymap;
+  for(size_t i = 0; i < slots.size(); ++i) {
+    if(!dists[i]) continue;
+    new (&slots[i].storage) kv_type(other.slots[i].kv());
+    slots[i].count = other.slots[i].count;
+    slots[i].loc = other.slots[i].loc;
+  }
+  nitems = other.nitems;
   return *this;
 }
 
-template<typename K, typename V, typename P, typename H, typename S>
-auto heap_cache<K,V,P,H,S>::operator=(heap_cache&& other) -> heap_cache& {
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+auto heap_cache<K,V,P,H,S,A,St>::operator=(heap_cache&& other) -> heap_cache& {
   UASSERT(this != &other);
   clear();
   max_size = other.max_size;
+  slots = std::move(other.slots);
+  dists = std::move(other.dists);
   heap = std::move(other.heap);
-  keymap = std::move(other.keymap);
+  nitems = other.nitems;
+  other.slots.clear();
+  other.dists.clear();
+  other.heap.assign(1, kNone);
+  other.nitems = 0;
   return *this;
 }
 
-template<typename K, typename V, typename P, typename H, typename S>
-bool heap_cache<K,V,P,H,S>::insert(const kv_type& kv) {
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+template<typename KV>
+bool heap_cache<K,V,P,H,S,A,St>::insert_impl(KV&& kv) {
   _consistency_check();
   if(max_size == 0) return false;
-  auto itpair = keymap.emplace(std::piecewise_construct,
-                               std::tuple<key_type>(kv.first),
-                               std::tuple<value_type, size_t>(kv.second, heap.size()));
-  if(!itpair.second) return false;
-  auto it = itpair.first;
-  citem& item = it->second;
-  if(keymap.size() == max_size)
-  {
-    _del_back_full();
-    item.loc = heap.size();
+  auto hash = mix(kv.first);
+  if(find(kv.first, hash) != kNone) {
+    this->on_replace();
+    return false;
   }
-  heap.push_back(kv.first);
+  if(nitems && nitems + 1 >= max_size) _del_back_full();
+  // At most 3/4 full.
+  if((nitems + 1) * 4 > slots.size() * 3) grow(slots.size() + 1);
+  heap.push_back(kNone);
+  place(kv_type(std::forward<KV>(kv)), 0, heap.size() - 1, hash);
+  ++nitems;
+  this->on_insert();
   return true;
 }
 
-template<typename K, typename V, typename P, typename H, typename S>
-bool heap_cache<K,V,P,H,S>::insert(kv_type&& kv) {
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+bool heap_cache<K,V,P,H,S,A,St>::insert(const kv_type& kv) {
+  return insert_impl(kv);
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+bool heap_cache<K,V,P,H,S,A,St>::insert(kv_type&& kv) {
+  return insert_impl(std::move(kv));
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+auto heap_cache<K,V,P,H,S,A,St>::lookup(key_cref key) const -> value_type* {
   _consistency_check();
-  if(max_size == 0) return false;
-  auto itpair = keymap.emplace(std::piecewise_construct,
-                               std::forward_as_tuple<key_type>(std::forward<key_type>(kv.first)),
-                               std::forward_as_tuple<value_type, size_t>(std::forward<value_type>(kv.second),
-                                                                         heap.size()));
-  if(!itpair.second) return false;
-  auto it = itpair.first;
-  citem& item = it->second;
-  if(keymap.size() == max_size)
-  {
-    _del_back_full();
-    item.loc = heap.size();
+  auto sw = St::start();
+  auto slot = find(key, mix(key));
+  if(slot == kNone) {
+    this->on_miss(sw);
+    return nullptr;
   }
-  heap.push_back(it->first);
-  return true;
+  auto& c = slots[slot];
+  if(c.count != std::numeric_limits<count_type>::max()) ++c.count;
+  increase_key(slot);
+  this->on_hit(sw);
+  return &c.kv().second;
 }
 
-template<typename K, typename V, typename P, typename H, typename S>
-auto heap_cache<K,V,P,H,S>::lookup(key_cref key) const -> value_type* {
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+auto heap_cache<K,V,P,H,S,A,St>::peek(key_cref key) const -> const value_type* {
+  auto slot = find(key, mix(key));
+  if(slot == kNone) return nullptr;
+  return &slots[slot].kv().second;
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+bool heap_cache<K,V,P,H,S,A,St>::bump(key_cref key, count_type n) {
   _consistency_check();
-  auto it = keymap.find(key);
-  if(it == keymap.end()) return nullptr;
-  ++it->second.count;
-  increase_key(it->first);
-  return &it->second.val;
+  auto slot = find(key, mix(key));
+  if(slot == kNone) return false;
+  auto& c = slots[slot];
+  c.count += std::min<count_type>(
+      n, std::numeric_limits<count_type>::max() - c.count);
+  increase_key(slot);
+  return true;
 }
 
-template<typename K, typename V, typename P, typename H, typename S>
-void heap_cache<K,V,P,H,S>::clear() {
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+void heap_cache<K,V,P,H,S,A,St>::clear() {
   _consistency_check();
-  heap.clear();
-  keymap.clear();
-  heap.push_back(key_type{});
+  destroy_all();
+  std::fill(dists.begin(), dists.end(), 0);
+  heap.assign(1, kNone);
+  nitems = 0;
 }
 
-template<typename K, typename V, typename P, typename H, typename S>
-void heap_cache<K,V,P,H,S>::set_max_size(size_t max) {
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+void heap_cache<K,V,P,H,S,A,St>::set_max_size(size_t max) {
   _consistency_check();
   max_size = max;
-  if(max < heap.size()-1)
+  if(max < heap.size()-1) {
+    auto sw = St::start();
+    size_t before = nitems;
     while(heap.size() != max) // note +1 index, stop at max.
       _del_back();
+    this->on_evict(sw, before - nitems);
+  }
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+void heap_cache<K,V,P,H,S,A,St>::save(const std::string& path) const {
+  _consistency_check();
+  auto h = snapshot::make_header<key_type, value_type, count_type>(nitems);
+  util::file_replacer out(path);
+  out.write(&h, sizeof(h));
+  for(size_t i = 1; i <= nitems; ++i)
+    out.write(&slots[heap[i]].kv().first, sizeof(key_type));
+  for(size_t i = 1; i <= nitems; ++i)
+    out.write(&slots[heap[i]].kv().second, sizeof(value_type));
+  for(size_t i = 1; i <= nitems; ++i)
+    out.write(&slots[heap[i]].count, sizeof(count_type));
+  out.commit();
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+void heap_cache<K,V,P,H,S,A,St>::load(const std::string& path) {
+  util::mapped_file file(path);
+  snapshot::reader<key_type, value_type, count_type> in(file);
+  // A prefix of a heap is a heap.
+  size_t n = std::min<uint64_t>(in.items(), max_size);
+  clear();
+  if(n == 0) return;
+  try {
+    // At most 3/4 full, as for insert().
+    if(n * 4 > slots.size() * 3) grow(n * 4 / 3 + 1);
+    heap.resize(n + 1);
+    for(size_t i = 0; i < n; ++i) {
+      kv_type kv(in.key(i), in.value(i));
+      auto hash = mix(kv.first);
+      place(std::move(kv), in.count(i), i + 1, hash);
+    }
+  } catch(...) {
+    destroy_all();
+    std::fill(dists.begin(), dists.end(), 0);
+    heap.assign(1, kNone);
+    throw;
+  }
+  nitems = n;
+  _consistency_check();
 }
 
 // ---- helper methods
 
-template<typename K, typename V, typename P,
-         typename H, typename S>
-void heap_cache<K,V,P,H,S>::_del_back() {
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+uint64_t heap_cache<K,V,P,H,S,A,St>::mix(key_cref key) {
+  // std::hash is often the identity.
+  return util::mix_hash(hashf(key));
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+auto heap_cache<K,V,P,H,S,A,St>::home(uint64_t hash) const -> index_type {
+  // Maps the hash's top half onto [0, slots), which needn't be a power of
+  // two: a bounded cache sizes its table to fit exactly.
+  return static_cast<index_type>(((hash >> 32) * slots.size()) >> 32);
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+auto heap_cache<K,V,P,H,S,A,St>::find(key_cref key, uint64_t hash) const
+    -> index_type {
+  if(slots.empty()) return kNone;
+  index_type i = home(hash);
+  // Robin Hood: once we pass items closer to their home than key would
+  // be, key isn't there.
+  for(unsigned d = 1; dists[i] >= d; ++d) {
+    if(dists[i] == d && base_type::key_predicate(slots[i].kv().first, key))
+      return i;
+    if(++i == slots.size()) i = 0;
+  }
+  return kNone;
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+void heap_cache<K,V,P,H,S,A,St>::place(kv_type&& kv, count_type count,
+                                    index_type loc, uint64_t hash) {
+  index_type i = home(hash);
+  unsigned d = 1;
+  while(true) {
+    if(!dists[i]) {
+      new (&slots[i].storage) kv_type(std::move(kv));
+      slots[i].count = count;
+      slots[i].loc = loc;
+      dists[i] = d;
+      heap[loc] = i;
+      return;
+    }
+    if(dists[i] < d) {
+      // Take the slot from the richer item, and carry that one on.
+      auto& c = slots[i];
+      std::swap(kv, c.kv());
+      std::swap(count, c.count);
+      std::swap(loc, c.loc);
+      unsigned cd = dists[i];
+      dists[i] = d;
+      d = cd;
+      heap[c.loc] = i;
+    }
+    if(++i == slots.size()) i = 0;
+    if(++d > MAX_DIST) {
+      grow(slots.size() + 1);
+      place(std::move(kv), count, loc, mix(kv.first));
+      return;
+    }
+  }
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+void heap_cache<K,V,P,H,S,A,St>::erase_slot(index_type slot) {
+  slots[slot].kv().~kv_type();
+  index_type i = slot;
+  index_type j = i + 1 == slots.size() ? 0 : i + 1;
+  // Backward shift: pull following items displaced from their home one
+  // slot closer.
+  while(dists[j] > 1) {
+    new (&slots[i].storage) kv_type(std::move(slots[j].kv()));
+    slots[j].kv().~kv_type();
+    slots[i].count = slots[j].count;
+    slots[i].loc = slots[j].loc;
+    dists[i] = dists[j] - 1;
+    heap[slots[i].loc] = i;
+    i = j;
+    if(++j == slots.size()) j = 0;
+  }
+  dists[i] = 0;
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+void heap_cache<K,V,P,H,S,A,St>::grow(size_t min_slots) {
+  size_t n = std::max<size_t>(16, slots.size() * 2);
+  // A full bounded cache (at most max_size items) should be 3/4 full, not
+  // anywhere from 3/8.
+  size_t fit = max_size + max_size / 3 + 1;
+  if(max_size < (kNone / 8) * 7 && n > fit && fit >= min_slots) n = fit;
+  n = std::max(n, min_slots);
+  UASSERT(n < kNone) << "heap_cache table too large";
+  decltype(slots) old_slots(n);
+  decltype(dists) old_dists(n, 0);
+  slots.swap(old_slots);
+  dists.swap(old_dists);
+  for(size_t i = 0; i < old_slots.size(); ++i) {
+    if(!old_dists[i]) continue;
+    auto& c = old_slots[i];
+    place(std::move(c.kv()), c.count, c.loc, mix(c.kv().first));
+    c.kv().~kv_type();
+  }
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+void heap_cache<K,V,P,H,S,A,St>::destroy_all() {
+  for(size_t i = 0; i < slots.size(); ++i)
+    if(dists[i]) slots[i].kv().~kv_type();
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+void heap_cache<K,V,P,H,S,A,St>::_del_back() {
   UASSERT(heap.size() > 1);
-  keymap.erase(heap.back());
+  auto slot = heap.back();
   heap.pop_back();
+  erase_slot(slot);
+  --nitems;
 }
 
-template<typename K, typename V, typename P, typename H, typename S>
-void heap_cache<K,V,P,H,S>::_del_back_full() {
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+void heap_cache<K,V,P,H,S,A,St>::_del_back_full() {
+  auto sw = St::start();
+  size_t before = nitems;
   // below 4 it's not worth it
   if(max_size <= 4) _del_back();
   else
     for(size_t i = static_cast<size_t>(max_size*REFRESH_RATIO); i < max_size; ++i)
       _del_back();
+  this->on_evict(sw, before - nitems);
 }
 
 // swaps increased key until heap property is restored, returns
-template<typename K, typename V, typename P, typename H, typename S>
-void heap_cache<K,V,P,H,S>::increase_key(key_cref k) const {
-  auto& c = keymap.at(k);
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+void heap_cache<K,V,P,H,S,A,St>::increase_key(index_type slot) const {
+  auto& c = slots[slot];
   UASSERT(c.loc < heap.size());
   UASSERT(c.loc > 0);
   while(c.loc > 1) {
-    auto& parent = keymap.at(heap[c.loc/2]);
+    auto& parent = slots[heap[c.loc/2]];
     if(parent.count >= c.count) break;
     std::swap(heap[parent.loc], heap[c.loc]);
     std::swap(parent.loc, c.loc);
   }
 }
 
-template<typename K, typename V, typename P, typename H, typename S>
-void heap_cache<K,V,P,H,S>::_consistency_check() const {
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+void heap_cache<K,V,P,H,S,A,St>::_consistency_check() const {
   UASSERT(heap.size() >= 1);
   UASSERT(max_size >= heap.size()-1);
-  UASSERT(max_size >= keymap.size());
-  UASSERT(keymap.size() + 1 == heap.size());
-  UASSERT(base_type::key_predicate(heap[0], key_type{}));
+  UASSERT(max_size >= nitems);
+  UASSERT(nitems + 1 == heap.size());
+  UASSERT(slots.size() == dists.size());
 #ifdef HCACHE_CHECK
-  for(size_t i = keymap.size(); i > 1; --i)
+  for(size_t i = nitems; i > 1; --i)
   {
-    UASSERT(heap[i] != nullptr);
-    UASSERT(heap[i/2] != nullptr);
-    UASSERT(heap[i]->count <= heap[i/2]->count);
+    UASSERT(dists[heap[i]] && slots[heap[i]].loc == i);
+    UASSERT(slots[heap[i]].count <= slots[heap[i/2]].count);
   }
 #endif /* HCACHE_CHECK */
 }
 
-template<typename K, typename V, typename P, typename H, typename S>
-void heap_cache<K,V,P,H,S>::_print_cache(std::ostream& o) const {
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+void heap_cache<K,V,P,H,S,A,St>::_print_cache(std::ostream& o) const {
   _consistency_check();
   base_type::_print_cache(o);
   if(empty()) return;
-  for(size_t i = 0; i < (size_t) (log(keymap.size()-1)/log(2))+1; ++i)
+  for(size_t i = 0; i < (size_t) (log(nitems-1)/log(2))+1; ++i)
   {
     for(size_t j = pow(2, i); j <= pow(2, i+1)-1; ++j)
     {
-      if(j > keymap.size()) break;
-      o << '(' << heap[j] << "->" << keymap.at(heap[j]).val << ',';
-      o << keymap.at(heap[j]).count << ") ";
+      if(j > nitems) break;
+      const auto& c = slots[heap[j]];
+      o << '(' << c.kv().first << "->" << c.kv().second << ',';
+      o << c.count << ") ";
     }
     o << '\n';
   }
 }
 
-template<typename K, typename V, typename P, typename H, typename S>
-typename heap_cache<K,V,P,H,S>::hasher heap_cache<K,V,P,H,S>::hashf {};
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+typename heap_cache<K,V,P,H,S,A,St>::hasher heap_cache<K,V,P,H,S,A,St>::hashf {};
 
 } // namespace lfu
 } // namespace caches
@@ -13,11 +13,20 @@
 #define CACHES_LFU_CACHE_HPP_
 
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <iostream>
+#include <list>
+#include <memory>
+#include <string>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
 #include "caches/cache.hpp"
+#include "caches/cache_snapshot.hpp"
+#include "caches/cache_stats.hpp"
+#include "util/hash.hpp"
 
 namespace caches {
 
@@ -31,8 +40,9 @@ namespace caches {
 
 namespace lfu {
 
+// Counts saturate at the count type's maximum.
 struct heap_cache_traits {
-  typedef size_t count_type;
+  typedef uint32_t count_type;
 };
 
 /*
@@ -47,56 +57,95 @@ struct heap_cache_traits {
  *
  * Lookup needs to maintain the heap property, so it may be O(log n).
  *
- * heap_cache<Key, Value, Pred, Hash>
- * Key - key type - should be quick to copy (several are made)
- * Value - value type - type key maps to. Copied/moved once.
+ * Items are stored flat, in an open-addressing (Robin Hood) table, and the
+ * heap holds slot indices, so a lookup is one probe sequence and the heap
+ * is maintained without hashing. Inserting moves items around the table,
+ * so pointers returned by lookup() are only valid until the next insert().
+ *
+ * heap_cache<Key, Value, Pred, Hash, Traits, Alloc, Stats>
+ * Key - key type - moved around the table
+ * Value - value type - type key maps to, moved around the table
  * Pred - equal-to predicate for keys
  * Hash - hash for keys.
  * Traits - counting type trait
- *
- * Two copies of the key will be kept, one in the heap and one in the hash.
+ * Alloc - allocator, rebound for the table and the heap (e.g.,
+ *         util::pool_allocator<Key>)
+ * Stats - statistics policy (see cache_stats.hpp), by default none. Every
+ *         eviction batch, whether on insertion or from set_max_size(),
+ *         counts as one eviction of that many items. A cache's
+ *         statistics are not copied or moved along with its items.
  */
 template<typename Key, typename Value, typename Pred = std::equal_to<Key>,
-         typename Hash = std::hash<Key>, typename Traits = heap_cache_traits>
-class heap_cache : public cache<Key, Value, Pred> {
+         typename Hash = std::hash<Key>, typename Traits = heap_cache_traits,
+         typename Alloc = std::allocator<Key>, typename Stats = stats::none>
+class heap_cache : public cache<Key, Value, Pred>, protected Stats {
  public:
   // Public typedefs
   typedef cache<Key, Value, Pred> base_type;
   CACHE_TYPEDEFS
   typedef Hash hasher;
   typedef typename Traits::count_type count_type;
+  typedef Alloc allocator_type;
+  typedef Stats stats_type;
  protected:
-  // An item is a key-value pair, location in heap, and count
-  // Maintining all the information in one place allows two-way
-  // access between the heap and lookup map.
+  // Table slot or heap location
+  typedef uint32_t index_type;
+  static constexpr index_type kNone = static_cast<index_type>(-1);
+  // An item is a key-value pair, location in heap, and count, stored in
+  // its table slot. Maintining all the information in one place allows
+  // two-way access between the heap and the table.
   struct citem
   {
-    citem(value_type&& val, size_t loc) :
-        val(std::forward<value_type>(val)), loc(loc), count(0) {}
-    citem(const value_type& val, size_t loc) :
-        val(val), loc(loc), count(0) {}
-    citem(citem&& c) = default;
-    citem(const citem& c) = default;
-    mutable value_type val;
-    size_t loc;
-    typename Traits::count_type count;
+    kv_type& kv() {return *reinterpret_cast<kv_type*>(&storage);}
+    const kv_type& kv() const
+    {return *reinterpret_cast<const kv_type*>(&storage);}
+    // Constructed only if the slot is occupied.
+    typename std::aligned_storage<sizeof(kv_type),
+                                  alignof(kv_type)>::type storage;
+    count_type count;
+    index_type loc;
   };
-  // Increase citem to restore heap property
-  virtual void increase_key(key_cref k) const;
+  // Increase citem in slot to restore heap property
+  virtual void increase_key(index_type slot) const;
   // Pop back item from heap. Most likely to be recent, and infrequently
   // used.
   virtual void _del_back();
-  // Maintains mapping from key to citem
-  mutable std::unordered_map<key_type, citem, hasher, key_equal> keymap;
-  // Heap keeps a priority-queue like structure
-  mutable std::vector<key_type> heap;
+  // Slot holding key, or kNone
+  index_type find(key_cref key, uint64_t hash) const;
+  static uint64_t mix(key_cref key);
+  template<typename U>
+  using rebind_alloc =
+      typename std::allocator_traits<Alloc>::template rebind_alloc<U>;
+  // Open-addressing table of items, never resized in place (citem is only
+  // moved explicitly).
+  mutable std::vector<citem, rebind_alloc<citem> > slots;
+  // Probe distance plus one of each slot's item, 0 if empty.
+  std::vector<uint8_t, rebind_alloc<uint8_t> > dists;
+  // Heap keeps a priority-queue like structure of slots, from index 1
+  mutable std::vector<index_type, rebind_alloc<index_type> > heap;
  private:
   // REFRESH_RATIO is ratio of cache that remains on lookup-triggered refresh.
   static constexpr double REFRESH_RATIO = 0.5;
+  // Longest probe sequence before the table is grown.
+  static constexpr unsigned MAX_DIST = 255;
   // Hash function
   static hasher hashf;
   // Maximum size of cache.
-  count_type max_size;
+  size_type max_size;
+  // Number of items.
+  size_type nitems;
+  // Home slot of a hash.
+  index_type home(uint64_t hash) const;
+  // Robin Hood insertion of kv, with the given count and heap location.
+  void place(kv_type&& kv, count_type count, index_type loc, uint64_t hash);
+  // Removes the item in the slot, shifting back the ones after it.
+  void erase_slot(index_type slot);
+  // Grows the table, to at least min_slots.
+  void grow(size_t min_slots);
+  // Destroys every item.
+  void destroy_all();
+  template<typename KV>
+  bool insert_impl(KV&& kv);
   // Pop REFRESH_RATIO citems off
   void _del_back_full();
   // Check invariants
@@ -112,7 +161,7 @@ class heap_cache : public cache<Key, Value, Pred> {
    * Generates an empty heap_cache with specified max size.
    */
   heap_cache(size_t max = -1):
-      keymap(), heap(), max_size(max) {heap.push_back(Key());}
+      slots(), dists(), heap(1, kNone), max_size(max), nitems(0) {}
   // TODO input iterator range constructor
   /*
    * INPUT:
@@ -131,7 +180,7 @@ class heap_cache : public cache<Key, Value, Pred> {
    */
   heap_cache(heap_cache&& other) :
       heap_cache(1) {*this = std::forward<heap_cache>(other);}
-  virtual ~heap_cache() {}
+  virtual ~heap_cache() {destroy_all();}
 
   // Methods
   /*
@@ -152,21 +201,43 @@ class heap_cache : public cache<Key, Value, Pred> {
    * this != &other
    * BEHAVIOR:
    * Clears current members and moves over information from other
-   * to this. Other is put into an invalid state.
-   * Not noexcept because the class contains a member which has only
-   * a basic guarantee for exceptions (vector).
+   * to this. Other is left empty.
    * RETURN:
    * Reference to this.
    */
   heap_cache& operator=(heap_cache&& other);
   // See cache.h for documentation of virtual functions
-  virtual bool empty() const {return keymap.empty();}
-  virtual size_type size() const {return keymap.size();}
+  virtual bool empty() const {return nitems == 0;}
+  virtual size_type size() const {return nitems;}
   virtual size_type get_max_size() const {return max_size;}
   virtual bool insert(const kv_type& kv);
   virtual bool insert(kv_type&& kv);
-  virtual bool contains(key_cref key) const {return keymap.find(key) != keymap.end();}
+  virtual bool contains(key_cref key) const {return find(key, mix(key)) != kNone;}
   virtual value_type *lookup(key_cref key) const;
+  /*
+   * INPUT:
+   * key_cref key
+   * PRECONDITION:
+   * BEHAVIOR:
+   * Finds the value for key without counting a lookup. Does not modify
+   * the cache, so concurrent peek() calls are safe.
+   * RETURN:
+   * Pointer to associated value for key or nullptr if key is not
+   * mapped to a value currently in the cache.
+   */
+  const value_type *peek(key_cref key) const;
+  /*
+   * INPUT:
+   * key_cref key
+   * count_type n - number of lookups to count
+   * PRECONDITION:
+   * BEHAVIOR:
+   * Counts n lookups of key, as if by n lookup() calls, in one heap
+   * adjustment.
+   * RETURN:
+   * False if key is not in the cache.
+   */
+  bool bump(key_cref key, count_type n = 1);
   virtual void clear();
   /*
    * INPUT:
@@ -178,6 +249,48 @@ class heap_cache : public cache<Key, Value, Pred> {
    * new max size is smaller than current size.
    */
   virtual void set_max_size(size_t size);
+  /*
+   * INPUT:
+   * const std::string& path - file to write
+   * PRECONDITION:
+   * key_type and value_type are trivially copyable.
+   * BEHAVIOR:
+   * Writes every item and its count, in heap order, to a snapshot at path
+   * (see cache_snapshot.hpp). An existing file at path is only replaced
+   * once the snapshot is complete. Throws std::system_error if writing
+   * fails.
+   */
+  void save(const std::string& path) const;
+  /*
+   * INPUT:
+   * const std::string& path - snapshot to read
+   * PRECONDITION:
+   * As for save().
+   * BEHAVIOR:
+   * Replaces the cache's items with the snapshot's, counts included,
+   * keeping this cache's max size: if the snapshot holds more items, the
+   * ones an eviction would keep. The table and heap are built straight
+   * from the memory-mapped file, sized once, without inserts, sifting or
+   * evictions (none of which are counted in the statistics). Throws
+   * std::system_error if the file can't be read, or std::runtime_error if
+   * it isn't a snapshot for these types, leaving the cache unchanged; if
+   * building fails (out of memory), the cache is left empty.
+   */
+  void load(const std::string& path);
+  /*
+   * INPUT:
+   * PRECONDITION:
+   * BEHAVIOR:
+   * RETURN:
+   * Statistics counted so far, as per stats_type (all 0 for stats::none)
+   */
+  stats::summary get_stats() const {
+    stats::summary s;
+    this->collect(s);
+    return s;
+  }
+  // Zeroes the statistics.
+  void reset_stats() {this->reset();}
   /*
    * INPUT:
    * PRECONDITION:
@@ -191,11 +304,204 @@ class heap_cache : public cache<Key, Value, Pred> {
 // TODO exact_heap_cache (min ordered at top, always removes exactly
 // LFU)
 
-// TODO linked_cache (exact, best amortized, nonlocal)
+/*
+ * A linked_cache is an exact least frequently used container, with O(1)
+ * lookup, insertion and eviction (the design of Shah, Mitra and Matani,
+ * "An O(1) algorithm for implementing the LFU cache eviction scheme").
+ *
+ * Entries are kept in a list of frequency buckets, sorted by count, each
+ * holding the keys looked up that many times in insertion order. A lookup
+ * moves its key to the next bucket over (making it if needed), and an
+ * insertion into a full cache evicts exactly one item: the oldest one of
+ * the least frequently used.
+ *
+ * Unlike a heap_cache, eviction is exact and never removes more than one
+ * item at a time, at the cost of a few pointers per item and nonlocal
+ * (linked list) accesses.
+ *
+ * linked_cache<Key, Value, Pred, Hash, Traits, Alloc, Stats>
+ * Key, Value, Pred, Hash, Traits, Alloc, Stats - as for heap_cache (every
+ * eviction is of one item)
+ *
+ * Two copies of the key will be kept, one in the buckets and one in the
+ * hash.
+ */
+template<typename Key, typename Value, typename Pred = std::equal_to<Key>,
+         typename Hash = std::hash<Key>, typename Traits = heap_cache_traits,
+         typename Alloc = std::allocator<Key>, typename Stats = stats::none>
+class linked_cache : public cache<Key, Value, Pred>, protected Stats {
+ public:
+  // Public typedefs
+  typedef cache<Key, Value, Pred> base_type;
+  CACHE_TYPEDEFS
+  typedef Hash hasher;
+  typedef typename Traits::count_type count_type;
+  typedef Alloc allocator_type;
+  typedef Stats stats_type;
+ protected:
+  template<typename U>
+  using rebind_alloc =
+      typename std::allocator_traits<Alloc>::template rebind_alloc<U>;
+  typedef std::list<key_type, rebind_alloc<key_type> > key_list;
+  // All keys with the same lookup count, oldest first.
+  struct bucket
+  {
+    explicit bucket(count_type count) : count(count) {}
+    count_type count;
+    key_list keys;
+  };
+  typedef std::list<bucket, rebind_alloc<bucket> > bucket_list;
+  typedef typename bucket_list::iterator bucket_iterator;
+  // An item is a value and its key's place in the buckets.
+  struct citem
+  {
+    citem(value_type&& val, bucket_iterator freq) :
+        val(std::forward<value_type>(val)), freq(freq) {}
+    citem(const value_type& val, bucket_iterator freq) :
+        val(val), freq(freq) {}
+    mutable value_type val;
+    bucket_iterator freq;
+    typename key_list::iterator pos;
+  };
+  // Moves an item to the next bucket
+  void increase_key(citem& c) const;
+  // Evicts the least frequently used item
+  void _del_lfu();
+  // Maintains mapping from key to citem
+  mutable std::unordered_map<
+    key_type, citem, hasher, key_equal,
+    rebind_alloc<std::pair<const key_type, citem> > > keymap;
+  // Buckets in increasing count order, none empty
+  mutable bucket_list buckets;
+ private:
+  // Hash function
+  static hasher hashf;
+  // Maximum size of cache.
+  size_type max_size;
+  // Links a new item into the count 0 bucket
+  template<typename KV>
+  bool insert_impl(KV&& kv);
+  // Check invariants
+  void _consistency_check() const;
+  // Prints debug info
+  void _print_cache(std::ostream& o) const;
+ public:
+  // Constructors/Destructor
+  /*
+   * INPUT:
+   * size_t max = -1 - maximum initial size
+   * BEHAVIOR:
+   * Generates an empty linked_cache with specified max size.
+   */
+  linked_cache(size_t max = -1) : keymap(), buckets(), max_size(max) {}
+  /*
+   * INPUT:
+   * const linked_cache& other - linked cache to copy from
+   * BEHAVIOR:
+   * Makes a deep copy of other.
+   */
+  linked_cache(const linked_cache& other) :
+      linked_cache(1) {*this = other;}
+  /*
+   * INPUT:
+   * linked_cache&& other - linked cache to move from
+   * BEHAVIOR:
+   * Moves other's contents over. Not noexcept, see heap_cache.
+   */
+  linked_cache(linked_cache&& other) :
+      linked_cache(1) {*this = std::forward<linked_cache>(other);}
+  virtual ~linked_cache() {}
+
+  // Methods
+  /*
+   * INPUT:
+   * const linked_cache& other - linked cache to copy from
+   * PRECONDITION:
+   * BEHAVIOR:
+   * Deep copy of other is made, each key-value pair and associated
+   * lookup count is copied over.
+   * RETURN:
+   * Reference to this.
+   */
+  linked_cache& operator=(const linked_cache& other);
+  /*
+   * INPUT:
+   * linked_cache&& other - linked cache to move from
+   * PRECONDITION:
+   * this != &other
+   * BEHAVIOR:
+   * Clears current members and moves over information from other
+   * to this. Other is put into an invalid state.
+   * RETURN:
+   * Reference to this.
+   */
+  linked_cache& operator=(linked_cache&& other);
+  // See cache.h for documentation of virtual functions
+  virtual bool empty() const {return keymap.empty();}
+  virtual size_type size() const {return keymap.size();}
+  virtual size_type get_max_size() const {return max_size;}
+  virtual bool insert(const kv_type& kv);
+  virtual bool insert(kv_type&& kv);
+  virtual bool contains(key_cref key) const {return keymap.find(key) != keymap.end();}
+  virtual value_type *lookup(key_cref key) const;
+  virtual void clear();
+  /*
+   * INPUT:
+   * size_t size - new max size
+   * PRECONDITION:
+   * BEHAVIOR:
+   * Sets maximum size. Evicts least frequently used items until the
+   * cache fits.
+   */
+  virtual void set_max_size(size_t size);
+  /*
+   * INPUT:
+   * const std::string& path - file to write
+   * PRECONDITION:
+   * key_type and value_type are trivially copyable.
+   * BEHAVIOR:
+   * As heap_cache::save(), in decreasing count order (the reverse of
+   * eviction order).
+   */
+  void save(const std::string& path) const;
+  /*
+   * INPUT:
+   * const std::string& path - snapshot to read
+   * PRECONDITION:
+   * As for save().
+   * BEHAVIOR:
+   * As heap_cache::load(): rebuilds the buckets in one pass over the
+   * memory-mapped file. A heap_cache snapshot is sorted by count first.
+   */
+  void load(const std::string& path);
+  /*
+   * INPUT:
+   * PRECONDITION:
+   * BEHAVIOR:
+   * RETURN:
+   * Statistics counted so far, as per stats_type (all 0 for stats::none)
+   */
+  stats::summary get_stats() const {
+    stats::summary s;
+    this->collect(s);
+    return s;
+  }
+  // Zeroes the statistics.
+  void reset_stats() {this->reset();}
+  /*
+   * INPUT:
+   * PRECONDITION:
+   * BEHAVIOR:
+   * RETURN:
+   * Hashing function
+   */
+  static hasher hash_function() {return hashf;}
+};
 
 } // namespace lfu
 } // namespace caches
 
 #include "caches/heap_cache.tpp"
+#include "caches/linked_cache.tpp"
 
 #endif /* CACHES_LFU_CACHE_HPP_ */
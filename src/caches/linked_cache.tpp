@@ -0,0 +1,280 @@
+/*
+ * Vladimir Feinberg
+ * 2026-10-14
+ * caches/linked_cache.tpp
+ *
+ * Contains implementation of lfu_cache.hpp's linked_cache methods.
+ */
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <util/mapped_file.hpp>
+#include <util/uassert.hpp>
+
+namespace caches {
+namespace lfu {
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+auto linked_cache<K,V,P,H,S,A,St>::operator=(const linked_cache& other)
+    -> linked_cache& {
+  if(this == &other) return *this;
+  clear();
+  max_size = other.max_size;
+  // Iterators can't be copied over, so rebuild the buckets in order.
+  for(const auto& b : other.buckets) {
+    buckets.emplace_back(b.count);
+    auto freq = std::prev(buckets.end());
+    for(const auto& key : b.keys) {
+      auto it = keymap.emplace(std::piecewise_construct,
+                               std::forward_as_tuple(key),
+                               std::forward_as_tuple(other.keymap.at(key).val,
+                                                     freq)).first;
+      it->second.pos = freq->keys.insert(freq->keys.end(), key);
+    }
+  }
+  return *this;
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+auto linked_cache<K,V,P,H,S,A,St>::operator=(linked_cache&& other)
+    -> linked_cache& {
+  UASSERT(this != &other);
+  clear();
+  max_size = other.max_size;
+  // List iterators stay valid across a move.
+  buckets = std::move(other.buckets);
+  keymap = std::move(other.keymap);
+  return *this;
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+template<typename KV>
+bool linked_cache<K,V,P,H,S,A,St>::insert_impl(KV&& kv) {
+  _consistency_check();
+  auto found = keymap.find(kv.first);
+  if(found != keymap.end()) {
+    found->second.val = std::forward<KV>(kv).second;
+    this->on_replace();
+    return false;
+  }
+  if(max_size == 0) return false;
+  if(keymap.size() == max_size) {
+    auto sw = St::start();
+    _del_lfu();
+    this->on_evict(sw, 1);
+  }
+  if(buckets.empty() || buckets.front().count != 0)
+    buckets.emplace_front(0);
+  auto freq = buckets.begin();
+  auto pos = freq->keys.insert(freq->keys.end(), kv.first);
+  try {
+    auto it = keymap.emplace(std::piecewise_construct,
+                             std::forward_as_tuple(std::forward<KV>(kv).first),
+                             std::forward_as_tuple(
+                                 std::forward<KV>(kv).second, freq)).first;
+    it->second.pos = pos;
+  } catch(...) {
+    freq->keys.erase(pos);
+    if(freq->keys.empty()) buckets.erase(freq);
+    throw;
+  }
+  this->on_insert();
+  return true;
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+bool linked_cache<K,V,P,H,S,A,St>::insert(const kv_type& kv) {
+  return insert_impl(kv);
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+bool linked_cache<K,V,P,H,S,A,St>::insert(kv_type&& kv) {
+  return insert_impl(std::move(kv));
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+auto linked_cache<K,V,P,H,S,A,St>::lookup(key_cref key) const -> value_type* {
+  _consistency_check();
+  auto sw = St::start();
+  auto it = keymap.find(key);
+  if(it == keymap.end()) {
+    this->on_miss(sw);
+    return nullptr;
+  }
+  increase_key(it->second);
+  this->on_hit(sw);
+  return &it->second.val;
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+void linked_cache<K,V,P,H,S,A,St>::clear() {
+  _consistency_check();
+  keymap.clear();
+  buckets.clear();
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+void linked_cache<K,V,P,H,S,A,St>::set_max_size(size_t max) {
+  _consistency_check();
+  max_size = max;
+  while(keymap.size() > max_size) {
+    auto sw = St::start();
+    _del_lfu();
+    this->on_evict(sw, 1);
+  }
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+void linked_cache<K,V,P,H,S,A,St>::save(const std::string& path) const {
+  _consistency_check();
+  // Most frequent first, and most recent first among equals.
+  std::vector<std::pair<const key_type*, const citem*> > items;
+  items.reserve(keymap.size());
+  for(auto b = buckets.rbegin(); b != buckets.rend(); ++b)
+    for(auto key = b->keys.rbegin(); key != b->keys.rend(); ++key)
+      items.emplace_back(&*key, &keymap.find(*key)->second);
+  auto h = snapshot::make_header<key_type, value_type, count_type>(
+      items.size());
+  util::file_replacer out(path);
+  out.write(&h, sizeof(h));
+  for(const auto& it : items)
+    out.write(it.first, sizeof(key_type));
+  for(const auto& it : items)
+    out.write(&it.second->val, sizeof(value_type));
+  for(const auto& it : items)
+    out.write(&it.second->freq->count, sizeof(count_type));
+  out.commit();
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+void linked_cache<K,V,P,H,S,A,St>::load(const std::string& path) {
+  util::mapped_file file(path);
+  snapshot::reader<key_type, value_type, count_type> in(file);
+  size_t n = std::min<uint64_t>(in.items(), max_size);
+  // Items in decreasing count order. A heap_cache snapshot's prefix is
+  // still a heap, and needs sorting.
+  std::vector<size_t> order;
+  for(size_t i = 1; i < n; ++i) {
+    if(in.count(i - 1) >= in.count(i)) continue;
+    order.resize(n);
+    for(size_t j = 0; j < n; ++j) order[j] = j;
+    std::stable_sort(order.begin(), order.end(), [&in](size_t a, size_t b) {
+        return in.count(a) > in.count(b);
+      });
+    break;
+  }
+  clear();
+  try {
+    keymap.reserve(n);
+    for(size_t k = 0; k < n; ++k) {
+      size_t i = order.empty() ? k : order[k];
+      auto count = in.count(i);
+      if(buckets.empty() || buckets.front().count != count)
+        buckets.emplace_front(count);
+      auto freq = buckets.begin();
+      auto key = in.key(i);
+      auto pos = freq->keys.insert(freq->keys.begin(), key);
+      auto it = keymap.emplace(std::piecewise_construct,
+                               std::forward_as_tuple(key),
+                               std::forward_as_tuple(in.value(i), freq)).first;
+      it->second.pos = pos;
+    }
+  } catch(...) {
+    keymap.clear();
+    buckets.clear();
+    throw;
+  }
+  _consistency_check();
+}
+
+// ---- helper methods
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+void linked_cache<K,V,P,H,S,A,St>::increase_key(citem& c) const {
+  auto cur = c.freq;
+  // Saturated: just the most recent of the most frequent.
+  if(cur->count == std::numeric_limits<count_type>::max()) {
+    cur->keys.splice(cur->keys.end(), cur->keys, c.pos);
+    return;
+  }
+  auto next = std::next(cur);
+  count_type count = cur->count + 1;
+  if(next == buckets.end() || next->count != count) {
+    // Alone in its bucket: the bucket can just be renumbered.
+    if(cur->keys.size() == 1) {
+      cur->count = count;
+      return;
+    }
+    next = buckets.emplace(next, count);
+  }
+  next->keys.splice(next->keys.end(), cur->keys, c.pos);
+  c.freq = next;
+  if(cur->keys.empty()) buckets.erase(cur);
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+void linked_cache<K,V,P,H,S,A,St>::_del_lfu() {
+  UASSERT(!buckets.empty());
+  auto freq = buckets.begin();
+  keymap.erase(freq->keys.front());
+  freq->keys.pop_front();
+  if(freq->keys.empty()) buckets.erase(freq);
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+void linked_cache<K,V,P,H,S,A,St>::_consistency_check() const {
+  UASSERT(max_size >= keymap.size());
+  UASSERT(keymap.empty() == buckets.empty());
+#ifdef HCACHE_CHECK
+  size_t total = 0;
+  for(auto it = buckets.begin(); it != buckets.end(); ++it)
+  {
+    UASSERT(!it->keys.empty());
+    UASSERT(std::next(it) == buckets.end() ||
+            it->count < std::next(it)->count);
+    for(const auto& key : it->keys)
+      UASSERT(keymap.at(key).freq == it);
+    total += it->keys.size();
+  }
+  UASSERT(total == keymap.size());
+#endif /* HCACHE_CHECK */
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+void linked_cache<K,V,P,H,S,A,St>::_print_cache(std::ostream& o) const {
+  _consistency_check();
+  base_type::_print_cache(o);
+  for(const auto& b : buckets)
+  {
+    o << b.count << ':';
+    for(const auto& key : b.keys)
+      o << " (" << key << "->" << keymap.at(key).val << ')';
+    o << '\n';
+  }
+}
+
+template<typename K, typename V, typename P, typename H, typename S,
+         typename A, typename St>
+typename linked_cache<K,V,P,H,S,A,St>::hasher linked_cache<K,V,P,H,S,A,St>::hashf {};
+
+} // namespace lfu
+} // namespace caches
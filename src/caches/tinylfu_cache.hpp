@@ -0,0 +1,236 @@
+/*
+  Vladimir Feinberg
+  caches/tinylfu_cache.hpp
+  2026-10-14
+
+  Defines tinylfu_cache, a cache with W-TinyLFU eviction: a small LRU
+  window in front of a segmented LRU, with admission to the latter
+  decided by a frequency sketch that also remembers evicted keys.
+*/
+
+#ifndef CACHES_TINYLFU_CACHE_HPP_
+#define CACHES_TINYLFU_CACHE_HPP_
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "caches/cache.hpp"
+#include "util/hash.hpp"
+
+namespace caches {
+
+/*
+ * A frequency_sketch is a count-min sketch of 4-bit counters, packed 16 to
+ * a word: 4 rows of a power-of-two width covering the expected number of
+ * distinct keys, so it takes about 2 bytes per key.
+ *
+ * Increments are conservative (only the smallest of a key's 4 counters are
+ * bumped), and once the number of increments reaches 10 times the width
+ * every counter is halved, so old popularity fades.
+ *
+ * Takes hashes rather than keys; they should be well mixed.
+ */
+class frequency_sketch {
+ public:
+  static constexpr unsigned kMaxCount = 15;
+
+  // Sized for 'capacity' distinct keys.
+  explicit frequency_sketch(size_t capacity = 0);
+  // Regrows (and clears) the sketch if it is too small for 'capacity'.
+  void ensure_capacity(size_t capacity);
+  // Estimated count, at most kMaxCount.
+  unsigned frequency(uint64_t hash) const;
+  void increment(uint64_t hash);
+  void clear();
+
+ private:
+  static constexpr int kRows = 4;
+  // Index of hash's counter in the given row.
+  size_t index(uint64_t hash, int row) const;
+  unsigned counter(size_t idx) const;
+  // Halves every counter.
+  void age();
+
+  std::vector<uint64_t> table_;
+  int width_bits_;
+  size_t additions_;
+  size_t sample_size_;
+};
+
+/*
+ * A tinylfu_cache is a fixed-capacity cache whose eviction policy combines
+ * recency and frequency (Einziger, Friedman and Manes, "TinyLFU: A Highly
+ * Efficient Cache Admission Policy").
+ *
+ * New items enter an LRU window holding 1% of the capacity. Items pushed
+ * out of the window are candidates for the main area, a segmented LRU
+ * whose protected segment (80%) holds items hit while in its probation
+ * segment. A candidate is only admitted if the sketch estimates it to be
+ * more popular than the main area's next victim; otherwise it is the one
+ * evicted. Every insert and lookup, hit or miss, counts towards its key's
+ * estimate, so keys which come back after being evicted are remembered.
+ *
+ * This keeps a burst of one-time keys (a scan) from flushing out the
+ * working set: they can get through the window, but not past the
+ * frequently used items of the main area.
+ *
+ * Items live in chunks of intrusively (index) linked nodes, found through
+ * an open-addressed table of 8-byte tagged indices, so beyond the key and
+ * value an item costs 9 bytes of links, 11-21 bytes of table, and 2 bytes
+ * of sketch; all operations are O(1) (expected).
+ *
+ * tinylfu_cache<Key, Value, Pred, Hash>
+ * Key - key type
+ * Value - value type - type key maps to
+ * Pred - equal-to predicate for keys
+ * Hash - hash for keys
+ */
+template<typename Key, typename Value, typename Pred = std::equal_to<Key>,
+         typename Hash = std::hash<Key> >
+class tinylfu_cache : public cache<Key, Value, Pred> {
+ public:
+  // Public typedefs
+  typedef cache<Key, Value, Pred> base_type;
+  typedef typename base_type::key_type key_type;
+  typedef typename base_type::value_type value_type;
+  typedef typename base_type::key_equal key_equal;
+  typedef typename base_type::kv_type kv_type;
+  typedef typename base_type::key_cref key_cref;
+  typedef typename base_type::size_type size_type;
+  typedef Hash hasher;
+
+  // Constructors/Destructor
+  /*
+   * INPUT:
+   * size_t max = -1 - maximum initial size
+   * BEHAVIOR:
+   * Generates an empty tinylfu_cache with specified max size.
+   */
+  tinylfu_cache(size_t max = -1);
+  /*
+   * INPUT:
+   * const tinylfu_cache& other - cache to copy from
+   * BEHAVIOR:
+   * Makes a deep copy of other, including its frequency estimates.
+   */
+  tinylfu_cache(const tinylfu_cache& other) :
+      tinylfu_cache(1) {*this = other;}
+  /*
+   * INPUT:
+   * tinylfu_cache&& other - cache to move from
+   * BEHAVIOR:
+   * Moves other's contents over, leaving it empty.
+   */
+  tinylfu_cache(tinylfu_cache&& other) :
+      tinylfu_cache(1) {*this = std::move(other);}
+  virtual ~tinylfu_cache();
+
+  // Methods
+  tinylfu_cache& operator=(const tinylfu_cache& other);
+  tinylfu_cache& operator=(tinylfu_cache&& other);
+  // See cache.h for documentation of virtual functions
+  virtual bool empty() const {return size_ == 0;}
+  virtual size_type size() const {return size_;}
+  virtual size_type get_max_size() const {return max_size;}
+  virtual bool insert(const kv_type& kv);
+  virtual bool insert(kv_type&& kv);
+  virtual bool contains(key_cref key) const {return find(key, mix(key)) != kNil;}
+  virtual value_type *lookup(key_cref key) const;
+  virtual void clear();
+  /*
+   * INPUT:
+   * size_t size - new max size
+   * PRECONDITION:
+   * BEHAVIOR:
+   * Sets maximum size, resizing the window and main areas. May evict
+   * items if the new max size is smaller than the current size.
+   */
+  virtual void set_max_size(size_t size);
+  /*
+   * INPUT:
+   * PRECONDITION:
+   * BEHAVIOR:
+   * RETURN:
+   * Hashing function
+   */
+  static hasher hash_function() {return hashf;}
+
+ private:
+  typedef uint32_t index_type;
+  static constexpr index_type kNil = static_cast<index_type>(-1);
+  static constexpr int kChunkBits = 8;
+  static constexpr size_t kChunkSize = size_t(1) << kChunkBits;
+
+  enum region : uint8_t { kFree, kWindow, kProbation, kProtected };
+  struct node {
+    node() : where(kFree) {}
+    typename std::aligned_storage<sizeof(kv_type),
+                                  alignof(kv_type)>::type storage;
+    index_type prev, next;
+    region where;
+    kv_type& kv() {return *reinterpret_cast<kv_type*>(&storage);}
+  };
+  // A table entry, tagged with the low half of the key's hash so probes
+  // and shifts rarely need to touch the nodes.
+  struct slot {
+    slot() : tag(0), idx(kNil) {}
+    slot(uint64_t hash, index_type idx) :
+        tag(static_cast<uint32_t>(hash)), idx(idx) {}
+    uint32_t tag;
+    index_type idx;
+  };
+  // An LRU list of nodes, least recent at the head.
+  struct lru_list {
+    lru_list() : head(kNil), tail(kNil), size(0) {}
+    index_type head, tail;
+    size_t size;
+  };
+
+  static uint64_t mix(key_cref key);
+  node& at(index_type idx) const;
+  lru_list& list_of(region r) const;
+  void unlink(index_type idx) const;
+  void push_back(index_type idx, region r) const;
+  // Table slot of key, or of the empty slot where it would go.
+  size_t probe(key_cref key, uint64_t hash) const;
+  index_type find(key_cref key, uint64_t hash) const;
+  // Makes a node for kv and links it at the back of the window.
+  template<typename KV>
+  void add(KV&& kv, uint64_t hash);
+  void remove(index_type idx);
+  void grow_table();
+  // Moves a hit node up, as per its region.
+  void on_hit(index_type idx) const;
+  // Pushes window overflow into main, evicting to size.
+  void evict();
+  void resize_regions();
+  template<typename KV>
+  bool insert_impl(KV&& kv);
+  // Prints debug info
+  void _print_cache(std::ostream& o) const;
+
+  // Hash function
+  static hasher hashf;
+  // Maximum size of cache.
+  size_type max_size;
+  size_type size_;
+  size_t window_max_, protected_max_;
+  mutable frequency_sketch sketch_;
+  mutable lru_list window_, probation_, protected_;
+  mutable std::vector<std::unique_ptr<node[]> > chunks_;
+  // Nodes ever allocated, and the head of the freed ones (linked by next).
+  index_type allocated_, free_;
+  // Power-of-two sized, with kNil for empty slots.
+  std::vector<slot> table_;
+};
+
+} // namespace caches
+
+#include "caches/tinylfu_cache.tpp"
+
+#endif /* CACHES_TINYLFU_CACHE_HPP_ */
@@ -0,0 +1,414 @@
+/*
+ * Vladimir Feinberg
+ * 2026-10-14
+ * caches/tinylfu_cache.tpp
+ *
+ * Contains implementation of tinylfu_cache.hpp's frequency_sketch and
+ * tinylfu_cache methods.
+ */
+
+#include <algorithm>
+#include <new>
+
+#include <util/uassert.hpp>
+
+namespace caches {
+
+// ---- frequency_sketch
+
+inline frequency_sketch::frequency_sketch(size_t capacity) :
+    width_bits_(0), additions_(0), sample_size_(0) {
+  ensure_capacity(capacity);
+}
+
+inline void frequency_sketch::ensure_capacity(size_t capacity) {
+  // At least one word per row.
+  int bits = 4;
+  while(bits < 32 && (size_t(1) << bits) < capacity) ++bits;
+  if(!table_.empty() && bits <= width_bits_) return;
+  width_bits_ = bits;
+  table_.assign((size_t(kRows) << bits) / 16, 0);
+  sample_size_ = size_t(10) << bits;
+  additions_ = 0;
+}
+
+inline size_t frequency_sketch::index(uint64_t hash, int row) const {
+  // Multiply-shift, with a different odd multiplier per row.
+  static const uint64_t seeds[kRows] = {
+    0x9e3779b97f4a7c15ull, 0xc2b2ae3d27d4eb4full,
+    0x165667b19e3779f9ull, 0xd6e8feb86659fd93ull
+  };
+  return (size_t(row) << width_bits_) +
+      static_cast<size_t>((hash * seeds[row]) >> (64 - width_bits_));
+}
+
+inline unsigned frequency_sketch::counter(size_t idx) const {
+  return (table_[idx / 16] >> (idx % 16 * 4)) & 0xf;
+}
+
+inline unsigned frequency_sketch::frequency(uint64_t hash) const {
+  unsigned min = kMaxCount;
+  for(int row = 0; row < kRows; ++row) {
+    unsigned c = counter(index(hash, row));
+    if(c < min) min = c;
+  }
+  return min;
+}
+
+inline void frequency_sketch::increment(uint64_t hash) {
+  size_t idx[kRows];
+  unsigned min = kMaxCount;
+  for(int row = 0; row < kRows; ++row) {
+    idx[row] = index(hash, row);
+    unsigned c = counter(idx[row]);
+    if(c < min) min = c;
+  }
+  if(min == kMaxCount) return;
+  for(int row = 0; row < kRows; ++row)
+    if(counter(idx[row]) == min)
+      table_[idx[row] / 16] += uint64_t(1) << (idx[row] % 16 * 4);
+  if(++additions_ >= sample_size_) age();
+}
+
+inline void frequency_sketch::clear() {
+  std::fill(table_.begin(), table_.end(), 0);
+  additions_ = 0;
+}
+
+inline void frequency_sketch::age() {
+  for(auto& word : table_)
+    word = (word >> 1) & 0x7777777777777777ull;
+  additions_ /= 2;
+}
+
+// ---- tinylfu_cache
+
+template<typename K, typename V, typename P, typename H>
+constexpr typename tinylfu_cache<K,V,P,H>::index_type
+tinylfu_cache<K,V,P,H>::kNil;
+
+template<typename K, typename V, typename P, typename H>
+constexpr int tinylfu_cache<K,V,P,H>::kChunkBits;
+
+template<typename K, typename V, typename P, typename H>
+constexpr size_t tinylfu_cache<K,V,P,H>::kChunkSize;
+
+template<typename K, typename V, typename P, typename H>
+tinylfu_cache<K,V,P,H>::tinylfu_cache(size_t max) :
+    max_size(max), size_(0),
+    // Grown along with the cache, up to max.
+    sketch_(std::min<size_t>(max, kChunkSize)),
+    allocated_(0), free_(kNil), table_(16) {
+  resize_regions();
+}
+
+template<typename K, typename V, typename P, typename H>
+tinylfu_cache<K,V,P,H>::~tinylfu_cache() {
+  for(index_type i = 0; i < allocated_; ++i)
+    if(at(i).where != kFree) at(i).kv().~kv_type();
+}
+
+template<typename K, typename V, typename P, typename H>
+auto tinylfu_cache<K,V,P,H>::operator=(const tinylfu_cache& other)
+    -> tinylfu_cache& {
+  if(this == &other) return *this;
+  clear();
+  max_size = other.max_size;
+  resize_regions();
+  sketch_ = other.sketch_;
+  // Rebuild each region in the same order.
+  for(auto r : {kWindow, kProbation, kProtected}) {
+    for(auto i = other.list_of(r).head; i != kNil; i = other.at(i).next) {
+      const kv_type& kv = other.at(i).kv();
+      add(kv, mix(kv.first));
+      auto idx = window_.tail;
+      unlink(idx);
+      push_back(idx, r);
+    }
+  }
+  return *this;
+}
+
+template<typename K, typename V, typename P, typename H>
+auto tinylfu_cache<K,V,P,H>::operator=(tinylfu_cache&& other)
+    -> tinylfu_cache& {
+  UASSERT(this != &other);
+  clear();
+  max_size = other.max_size;
+  size_ = other.size_;
+  window_max_ = other.window_max_;
+  protected_max_ = other.protected_max_;
+  sketch_ = std::move(other.sketch_);
+  window_ = other.window_;
+  probation_ = other.probation_;
+  protected_ = other.protected_;
+  chunks_ = std::move(other.chunks_);
+  allocated_ = other.allocated_;
+  free_ = other.free_;
+  table_ = std::move(other.table_);
+  // Leave other empty, but usable.
+  other.size_ = 0;
+  other.sketch_ = frequency_sketch(std::min<size_t>(other.max_size,
+                                                    kChunkSize));
+  other.window_ = other.probation_ = other.protected_ = lru_list();
+  other.chunks_.clear();
+  other.allocated_ = 0;
+  other.free_ = kNil;
+  other.table_.assign(16, slot());
+  return *this;
+}
+
+template<typename K, typename V, typename P, typename H>
+template<typename KV>
+bool tinylfu_cache<K,V,P,H>::insert_impl(KV&& kv) {
+  auto hash = mix(kv.first);
+  sketch_.increment(hash);
+  auto idx = find(kv.first, hash);
+  if(idx != kNil) {
+    at(idx).kv().second = std::forward<KV>(kv).second;
+    on_hit(idx);
+    return false;
+  }
+  if(max_size == 0) return false;
+  add(std::forward<KV>(kv), hash);
+  evict();
+  return true;
+}
+
+template<typename K, typename V, typename P, typename H>
+bool tinylfu_cache<K,V,P,H>::insert(const kv_type& kv) {
+  return insert_impl(kv);
+}
+
+template<typename K, typename V, typename P, typename H>
+bool tinylfu_cache<K,V,P,H>::insert(kv_type&& kv) {
+  return insert_impl(std::move(kv));
+}
+
+template<typename K, typename V, typename P, typename H>
+auto tinylfu_cache<K,V,P,H>::lookup(key_cref key) const -> value_type* {
+  auto hash = mix(key);
+  // Misses count too: that's what makes a returning key admissible.
+  sketch_.increment(hash);
+  auto idx = find(key, hash);
+  if(idx == kNil) return nullptr;
+  on_hit(idx);
+  return &at(idx).kv().second;
+}
+
+template<typename K, typename V, typename P, typename H>
+void tinylfu_cache<K,V,P,H>::clear() {
+  for(index_type i = 0; i < allocated_; ++i)
+    if(at(i).where != kFree) {
+      at(i).kv().~kv_type();
+      at(i).where = kFree;
+    }
+  // Chunks are kept for reuse.
+  allocated_ = 0;
+  free_ = kNil;
+  size_ = 0;
+  window_ = probation_ = protected_ = lru_list();
+  std::fill(table_.begin(), table_.end(), slot());
+  sketch_.clear();
+}
+
+template<typename K, typename V, typename P, typename H>
+void tinylfu_cache<K,V,P,H>::set_max_size(size_t max) {
+  max_size = max;
+  resize_regions();
+  while(protected_.size > protected_max_) {
+    auto idx = protected_.head;
+    unlink(idx);
+    push_back(idx, kProbation);
+  }
+  evict();
+  while(size_ > max_size)
+    remove(probation_.head != kNil ? probation_.head : protected_.head);
+}
+
+// ---- helper methods
+
+template<typename K, typename V, typename P, typename H>
+uint64_t tinylfu_cache<K,V,P,H>::mix(key_cref key) {
+  // std::hash is often the identity.
+  return util::mix_hash(hashf(key));
+}
+
+template<typename K, typename V, typename P, typename H>
+auto tinylfu_cache<K,V,P,H>::at(index_type idx) const -> node& {
+  return chunks_[idx >> kChunkBits][idx & (kChunkSize - 1)];
+}
+
+template<typename K, typename V, typename P, typename H>
+auto tinylfu_cache<K,V,P,H>::list_of(region r) const -> lru_list& {
+  UASSERT(r != kFree);
+  return r == kWindow ? window_ : r == kProbation ? probation_ : protected_;
+}
+
+template<typename K, typename V, typename P, typename H>
+void tinylfu_cache<K,V,P,H>::unlink(index_type idx) const {
+  node& n = at(idx);
+  lru_list& l = list_of(n.where);
+  if(n.prev != kNil) at(n.prev).next = n.next;
+  else l.head = n.next;
+  if(n.next != kNil) at(n.next).prev = n.prev;
+  else l.tail = n.prev;
+  --l.size;
+}
+
+template<typename K, typename V, typename P, typename H>
+void tinylfu_cache<K,V,P,H>::push_back(index_type idx, region r) const {
+  node& n = at(idx);
+  lru_list& l = list_of(r);
+  n.where = r;
+  n.prev = l.tail;
+  n.next = kNil;
+  if(l.tail != kNil) at(l.tail).next = idx;
+  else l.head = idx;
+  l.tail = idx;
+  ++l.size;
+}
+
+template<typename K, typename V, typename P, typename H>
+size_t tinylfu_cache<K,V,P,H>::probe(key_cref key, uint64_t hash) const {
+  size_t mask = table_.size() - 1;
+  auto tag = static_cast<uint32_t>(hash);
+  size_t i = hash & mask;
+  while(table_[i].idx != kNil &&
+        (table_[i].tag != tag ||
+         !base_type::key_predicate(at(table_[i].idx).kv().first, key)))
+    i = (i + 1) & mask;
+  return i;
+}
+
+template<typename K, typename V, typename P, typename H>
+auto tinylfu_cache<K,V,P,H>::find(key_cref key, uint64_t hash) const
+    -> index_type {
+  return table_[probe(key, hash)].idx;
+}
+
+template<typename K, typename V, typename P, typename H>
+template<typename KV>
+void tinylfu_cache<K,V,P,H>::add(KV&& kv, uint64_t hash) {
+  // Keep the table at most 3/4 full.
+  if((size_ + 1) * 4 > table_.size() * 3) grow_table();
+  sketch_.ensure_capacity(size_ + 1);
+  index_type idx;
+  if(free_ != kNil) {
+    idx = free_;
+    new (&at(idx).storage) kv_type(std::forward<KV>(kv));
+    free_ = at(idx).next;
+  } else {
+    UASSERT(allocated_ != kNil) << "tinylfu_cache full";
+    if((allocated_ & (kChunkSize - 1)) == 0 &&
+       chunks_.size() == (allocated_ >> kChunkBits))
+      chunks_.emplace_back(new node[kChunkSize]);
+    idx = allocated_;
+    new (&at(idx).storage) kv_type(std::forward<KV>(kv));
+    ++allocated_;
+  }
+  push_back(idx, kWindow);
+  table_[probe(at(idx).kv().first, hash)] = slot(hash, idx);
+  ++size_;
+}
+
+template<typename K, typename V, typename P, typename H>
+void tinylfu_cache<K,V,P,H>::remove(index_type idx) {
+  node& n = at(idx);
+  size_t mask = table_.size() - 1;
+  size_t i = probe(n.kv().first, mix(n.kv().first));
+  UASSERT(table_[i].idx == idx);
+  // Backward shift deletion: pull later entries of the run into the hole
+  // unless that would put them before their home slot. The tag holds
+  // enough of the hash to find the home (the table has < 2^32 slots).
+  for(size_t j = (i + 1) & mask; table_[j].idx != kNil; j = (j + 1) & mask) {
+    size_t home = table_[j].tag & mask;
+    bool stays = i < j ? (i < home && home <= j) : (i < home || home <= j);
+    if(stays) continue;
+    table_[i] = table_[j];
+    i = j;
+  }
+  table_[i] = slot();
+  unlink(idx);
+  n.kv().~kv_type();
+  n.where = kFree;
+  n.next = free_;
+  free_ = idx;
+  --size_;
+}
+
+template<typename K, typename V, typename P, typename H>
+void tinylfu_cache<K,V,P,H>::grow_table() {
+  std::vector<slot> old(table_.size() * 2);
+  table_.swap(old);
+  size_t mask = table_.size() - 1;
+  for(const auto& s : old) {
+    if(s.idx == kNil) continue;
+    // Past 2^32 slots, the tag no longer gives the home.
+    size_t i = (mask >> 32 ? mix(at(s.idx).kv().first) : s.tag) & mask;
+    while(table_[i].idx != kNil) i = (i + 1) & mask;
+    table_[i] = s;
+  }
+}
+
+template<typename K, typename V, typename P, typename H>
+void tinylfu_cache<K,V,P,H>::on_hit(index_type idx) const {
+  auto where = at(idx).where;
+  unlink(idx);
+  if(where == kWindow) {
+    push_back(idx, kWindow);
+    return;
+  }
+  push_back(idx, kProtected);
+  // A hit in probation promotes, possibly demoting protected's LRU.
+  while(protected_.size > protected_max_) {
+    auto demoted = protected_.head;
+    unlink(demoted);
+    push_back(demoted, kProbation);
+  }
+}
+
+template<typename K, typename V, typename P, typename H>
+void tinylfu_cache<K,V,P,H>::evict() {
+  size_t main_max = max_size - window_max_;
+  while(window_.size > window_max_) {
+    auto candidate = window_.head;
+    unlink(candidate);
+    push_back(candidate, kProbation);
+    if(probation_.size + protected_.size <= main_max) continue;
+    auto victim = probation_.head;
+    if(victim == candidate) victim = protected_.head;
+    if(victim == kNil) {
+      remove(candidate);
+      continue;
+    }
+    // Ties go to the resident: a one-time key shouldn't displace one.
+    auto cfreq = sketch_.frequency(mix(at(candidate).kv().first));
+    auto vfreq = sketch_.frequency(mix(at(victim).kv().first));
+    remove(cfreq > vfreq ? victim : candidate);
+  }
+}
+
+template<typename K, typename V, typename P, typename H>
+void tinylfu_cache<K,V,P,H>::resize_regions() {
+  window_max_ = max_size == 0 ? 0 : std::max<size_t>(1, max_size / 100);
+  size_t main_max = max_size - window_max_;
+  protected_max_ = main_max - main_max / 5;
+}
+
+template<typename K, typename V, typename P, typename H>
+void tinylfu_cache<K,V,P,H>::_print_cache(std::ostream& o) const {
+  base_type::_print_cache(o);
+  static const char* names[] = {"", "window", "probation", "protected"};
+  for(auto r : {kWindow, kProbation, kProtected}) {
+    o << names[r] << ':';
+    for(auto i = list_of(r).head; i != kNil; i = at(i).next)
+      o << " (" << at(i).kv().first << "->" << at(i).kv().second << ')';
+    o << '\n';
+  }
+}
+
+template<typename K, typename V, typename P, typename H>
+typename tinylfu_cache<K,V,P,H>::hasher tinylfu_cache<K,V,P,H>::hashf {};
+
+} // namespace caches
@@ -0,0 +1,233 @@
+/*
+* Vladimir Feinberg
+* fibheap/dary_heap.hpp
+* 2026-10-14
+*
+* Declares an implicit d-ary heap with decrease-key, with the same
+* interface as fibheap. Values live in one array, so a d-ary heap does no
+* allocation per element and its sifts stay within a few cache lines.
+*/
+
+#ifndef FIBHEAP_DARY_HEAP_HPP_
+#define FIBHEAP_DARY_HEAP_HPP_
+
+// As in fibheap.hpp: thorough (full traversal) invariant checking in debug
+// mode.
+#ifndef FIB_CHECK
+#ifndef NDEBUG
+#define FIB_CHECK 1
+#else
+#define FIB_CHECK 0
+#endif
+#endif /* FIB_CHECK */
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+/*
+ * dary_heap is an array-backed priority queue in which each node has D
+ * children: the children of the value at index i are at D*i+1 to D*i+D.
+ * With D = 4, a node's children usually share a cache line, and the tree
+ * is half as deep as a binary heap's, which makes up for comparing with
+ * more children on the way down.
+ *
+ * Push and decrease-key sift up (O(log_D n)), and pop sifts down
+ * (O(D log_D n)). Values are moved, never swapped, along the sift path.
+ *
+ * Keys are stable handles: small integers indexing a table of array
+ * positions, which is updated as values move. A key stays valid until its
+ * value is popped, after which it may be handed out again.
+ *
+ * Allows for duplicates
+ *
+ * dary_heap<T, Compare, D, Alloc>
+ * T - type being contained in the queue
+ * Compare - comparison functor
+ * D - number of children per node, at least 2
+ * Alloc - allocator, rebound for the value array and the key table
+ */
+template<typename T, typename Compare = std::less<T>, size_t D = 4,
+         typename Alloc = std::allocator<T> >
+class dary_heap {
+  static_assert(D >= 2, "a d-ary heap needs at least 2 children per node");
+ public:
+  // Public typedefs
+  typedef Compare comparator_type;
+  typedef Alloc allocator_type;
+  typedef T value_type;
+  typedef size_t key_type;
+
+ private:
+  struct entry {
+    template<typename... Args>
+    entry(key_type key, Args&&... args) :
+        val(std::forward<Args>(args)...), key(key) {}
+    T val;
+    key_type key;
+  };
+
+  template<typename U>
+  using rebind_alloc =
+      typename std::allocator_traits<Alloc>::template rebind_alloc<U>;
+
+  // Marks the end of the free key list.
+  static constexpr key_type kNoKey = static_cast<key_type>(-1);
+
+  // The heap, root first.
+  std::vector<entry, rebind_alloc<entry> > heap;
+  // Position of each live key's value; for free keys, the next free key.
+  std::vector<size_t, rebind_alloc<size_t> > where;
+  // Most recently freed key.
+  key_type free_keys;
+  // Comparison operator
+  Compare comp;
+
+  // Takes a free key, or makes a new one.
+  key_type _new_key();
+  // Moves the value at i up until the heap property holds.
+  void _sift_up(size_t i);
+  // Moves the value at i down until the heap property holds.
+  void _sift_down(size_t i);
+  // Check invariants
+  void _consistency_check() const;
+  // Print debug info to ostream
+  void _print_dary_heap(std::ostream& o) const;
+ public:
+  // Constructors/Destructor
+  /*
+   * INPUT:
+   * const comparator_type& comp - comparison functor, uses default
+   *              constructor for default value
+   * const allocator_type& alloc - allocator (rebound), uses default
+   *              constructor for default value
+   * BEHAVIOR:
+   * Generates an empty heap.
+   */
+  explicit dary_heap(const comparator_type& comp = comparator_type(),
+                     const allocator_type& alloc = allocator_type()) :
+      heap(alloc), where(alloc), free_keys(kNoKey), comp(comp) {}
+  // Copies and moves keep keys valid (for the copy, as keys of the copy).
+  dary_heap(const dary_heap&) = default;
+  dary_heap(dary_heap&&) = default;
+  dary_heap& operator=(const dary_heap&) = default;
+  dary_heap& operator=(dary_heap&&) = default;
+
+  // Methods
+  /*
+   * INPUT:
+   * PRECONDITION:
+   * BEHAVIOR:
+   * RETURN:
+   * Whether empty
+   */
+  inline bool empty() const {return heap.empty();}
+  /*
+   * INPUT:
+   * PRECONDITION:
+   * BEHAVIOR:
+   * RETURN:
+   * Size
+   */
+  inline size_t size() const {return heap.size();}
+  /*
+   * INPUT:
+   * PRECONDITION:
+   * !empty()
+   * BEHAVIOR:
+   * RETURN:
+   * const reference to minimum element
+   */
+  inline const value_type& top() const {return heap.front().val;}
+  /*
+   * INPUT:
+   * const value_type& p - value pushed into heap
+   * PRECONDITION:
+   * BEHAVIOR:
+   * Adds value to heap.
+   * RETURN:
+   * Key associated with pushed item. Key remains valid until the
+   * value is popped.
+   */
+  key_type push(const value_type& p) {return emplace(p);}
+  /*
+   * INPUT:
+   * Args&&... args - arguments for generating value_type
+   * PRECONDITION:
+   * BEHAVIOR:
+   * Adds generated value to heap.
+   * RETURN:
+   * Key associated with pushed item. Key remains valid until the
+   * value is popped.
+   */
+  template<typename... Args>
+  key_type emplace(Args&&... args);
+  /*
+   * INPUT:
+   * key_type k - key of value to decrease
+   * const value_type& v - new value for associated key
+   * PRECONDITION:
+   * v is smaller than or equal to key's value.
+   * BEHAVIOR:
+   * Decreases key value and increases its priority.
+   * Key maintains validity to new value.
+   * RETURN:
+   */
+  void decrease_key(key_type k, const value_type& v);
+  /*
+   * INPUT:
+   * key_type k - key of value to decrease
+   * value_type&& v - rvalue ref to new value for associated key
+   * PRECONDITION:
+   * v is smaller than or equal to key's value.
+   * BEHAVIOR:
+   * Decreases key value and increases its priority.
+   * Key maintains validity to new value.
+   * RETURN:
+   */
+  void decrease_key(key_type k, value_type&& v);
+  /*
+   * INPUT:
+   * PRECONDITION:
+   * BEHAVIOR:
+   * Clears heap. Invalidates all keys.
+   * RETURN:
+   */
+  void clear();
+  /*
+   * INPUT:
+   * PRECONDITION:
+   * !empty()
+   * BEHAVIOR:
+   * Pops minimum value off heap.
+   * RETURN:
+   * Invalidated key.
+   */
+  key_type pop();
+
+  template<typename T2, typename C2, size_t D2, typename A2>
+  friend std::ostream& operator<<(std::ostream&,
+                                  const dary_heap<T2, C2, D2, A2>&);
+};
+
+/*
+ * INPUT:
+ * std::ostream& o - ostream to print to
+ * const dary_heap<T,C,D,A>& h - heap to print
+ * PRECONDITION:
+ * BEHAVIOR:
+ * Prints heap to stream
+ * RETURN:
+ * Original ostream
+ */
+template<typename T, typename C, size_t D, typename A>
+std::ostream& operator<<(std::ostream& o, const dary_heap<T, C, D, A>& h) {
+  h._print_dary_heap(o);
+  return o;
+}
+
+#include "fibheap/dary_heap.tpp"
+
+#endif /* FIBHEAP_DARY_HEAP_HPP_ */
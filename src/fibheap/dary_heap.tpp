@@ -0,0 +1,162 @@
+/*
+ * Vladimir Feinberg
+ * 2026-10-14
+ * fibheap/dary_heap.tpp
+ *
+ * Contains implementation of dary_heap.hpp methods.
+ */
+
+#include <utility>
+
+#include "util/uassert.hpp"
+
+template<typename T, typename C, size_t D, typename A>
+constexpr typename dary_heap<T,C,D,A>::key_type dary_heap<T,C,D,A>::kNoKey;
+
+template<typename T, typename C, size_t D, typename A>
+template<typename... Args>
+auto dary_heap<T,C,D,A>::emplace(Args&&... args) -> key_type {
+  _consistency_check();
+  key_type key = _new_key();
+  try {
+    heap.emplace_back(key, std::forward<Args>(args)...);
+  } catch (...) {
+    where[key] = free_keys;
+    free_keys = key;
+    throw;
+  }
+  where[key] = heap.size() - 1;
+  _sift_up(heap.size() - 1);
+  return key;
+}
+
+template<typename T, typename C, size_t D, typename A>
+void dary_heap<T,C,D,A>::decrease_key(key_type key, const value_type& val) {
+  decrease_key(key, value_type(val));
+}
+
+template<typename T, typename C, size_t D, typename A>
+void dary_heap<T,C,D,A>::decrease_key(key_type key, value_type&& val) {
+  _consistency_check();
+  UASSERT(key < where.size() && where[key] < heap.size() &&
+          heap[where[key]].key == key) << "invalid key " << key;
+  size_t i = where[key];
+  UASSERT(!comp(heap[i].val, val));
+  heap[i].val = std::move(val);
+  _sift_up(i);
+}
+
+template<typename T, typename C, size_t D, typename A>
+void dary_heap<T,C,D,A>::clear() {
+  _consistency_check();
+  heap.clear();
+  where.clear();
+  free_keys = kNoKey;
+}
+
+template<typename T, typename C, size_t D, typename A>
+auto dary_heap<T,C,D,A>::pop() -> key_type {
+  _consistency_check();
+  UASSERT(!empty());
+  key_type key = heap.front().key;
+  where[key] = free_keys;
+  free_keys = key;
+  if(heap.size() > 1) {
+    heap.front() = std::move(heap.back());
+    heap.pop_back();
+    where[heap.front().key] = 0;
+    _sift_down(0);
+  } else {
+    heap.pop_back();
+  }
+  return key;
+}
+
+// ---- helper methods
+
+template<typename T, typename C, size_t D, typename A>
+auto dary_heap<T,C,D,A>::_new_key() -> key_type {
+  if(free_keys == kNoKey) {
+    where.push_back(kNoKey);
+    return where.size() - 1;
+  }
+  key_type key = free_keys;
+  free_keys = where[key];
+  return key;
+}
+
+template<typename T, typename C, size_t D, typename A>
+void dary_heap<T,C,D,A>::_sift_up(size_t i) {
+  if(i == 0) return;
+  size_t parent = (i - 1) / D;
+  if(!comp(heap[i].val, heap[parent].val)) return;
+  // Carry the value up through a hole.
+  entry moving = std::move(heap[i]);
+  do {
+    heap[i] = std::move(heap[parent]);
+    where[heap[i].key] = i;
+    i = parent;
+    parent = (i - 1) / D;
+  } while(i > 0 && comp(moving.val, heap[parent].val));
+  heap[i] = std::move(moving);
+  where[heap[i].key] = i;
+}
+
+template<typename T, typename C, size_t D, typename A>
+void dary_heap<T,C,D,A>::_sift_down(size_t i) {
+  const size_t n = heap.size();
+  if(D * i + 1 >= n) return;
+  entry moving = std::move(heap[i]);
+  while(true) {
+    size_t first = D * i + 1;
+    if(first >= n) break;
+    size_t last = first + D < n ? first + D : n;
+    size_t best = first;
+    for(size_t c = first + 1; c < last; ++c)
+      if(comp(heap[c].val, heap[best].val)) best = c;
+    if(!comp(heap[best].val, moving.val)) break;
+    heap[i] = std::move(heap[best]);
+    where[heap[i].key] = i;
+    i = best;
+  }
+  heap[i] = std::move(moving);
+  where[heap[i].key] = i;
+}
+
+/*
+ * legal state:
+ * every value is no less than its parent
+ * every value's key maps back to its position
+ * there are as many free keys as keys not in the heap
+ */
+template<typename T, typename C, size_t D, typename A>
+void dary_heap<T,C,D,A>::_consistency_check() const {
+  UASSERT(heap.size() <= where.size());
+#if FIB_CHECK
+  for(size_t i = 0; i < heap.size(); ++i) {
+    UASSERT(heap[i].key < where.size() && where[heap[i].key] == i);
+    UASSERT(i == 0 || !comp(heap[i].val, heap[(i - 1) / D].val));
+  }
+  size_t free = 0;
+  for(key_type k = free_keys; k != kNoKey; k = where[k]) {
+    UASSERT(k < where.size());
+    UASSERT(++free <= where.size() - heap.size()) << "free key cycle";
+  }
+  UASSERT(free == where.size() - heap.size());
+#endif /* FIB_CHECK */
+}
+
+template<typename T, typename C, size_t D, typename A>
+void dary_heap<T,C,D,A>::_print_dary_heap(std::ostream& o) const {
+  _consistency_check();
+  o << D << "-ary heap @ " << this << ", size " << heap.size();
+  if(!empty()) o << ", top " << top();
+  o << '\n';
+  // One line per depth.
+  for(size_t begin = 0, width = 1; begin < heap.size();
+      begin += width, width *= D) {
+    for(size_t i = begin; i < begin + width && i < heap.size(); ++i)
+      o << heap[i].val << ' ';
+    o << '\n';
+  }
+}
@@ -4,21 +4,58 @@
  * fibheap-test.cpp
  * 2014-09-08
  *
- * Defines tests for fibheap
+ * Defines tests for fibheap, pairing_heap and dary_heap. Pass "bench" to
+ * compare them with std::priority_queue on Dijkstra's algorithm.
  */
 
 #include "fibheap/fibheap.hpp"
 
 #include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <future>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <queue>
 #include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "fibheap/dary_heap.hpp"
+#include "fibheap/multiqueue.hpp"
+#include "fibheap/pairing_heap.hpp"
+#include "util/bench.hpp"
+#include "util/node_pool.hpp"
 
 using namespace std;
 
 const int SEED = 0;
 minstd_rand0 gen(SEED);
 
-int main() {
+// randomized push, decrease-key and pop test against a reference
+template<typename Heap>
+void heap_test(const string& name, int reps);
+
+// fibheap merge, erase, get_value and in-place decrease-key tests
+void fibheap_ops_test(int reps);
+
+// multiqueue ordering and concurrency tests
+void multiqueue_test(int reps);
+
+// Dijkstra's algorithm with each heap, and concurrent queue scaling
+void bench();
+
+int main(int argc, char** argv) {
+  if(argc > 1 && strcmp(argv[1], "bench") == 0) {
+    bench();
+    return 0;
+  }
   cout << "Fibheap test" << endl;
   fibheap<int> f;
   cout << "Add 0..9 in ascending order" << endl;
@@ -147,5 +184,456 @@ int main() {
   while(!moved.empty())
     moved.pop();
   cout << "...completed" << endl;
+  cout << "Pool-allocated heap: push, copy, decrease, drain" << endl;
+  {
+    fibheap<int, std::less<int>, util::pool_allocator<int> > pooled;
+    vector<fibheap<int>::key_type> keys;
+    for(int i = 0; i < STRESS_REPS; ++i)
+      keys.push_back(pooled.push(static_cast<int>(gen() % STRESS_REPS)));
+    auto copy = pooled;
+    pooled.decrease_key(keys.back(), -1);
+    UASSERT(pooled.top() == -1);
+    UASSERT(copy.size() == pooled.size());
+    for(auto* heap : {&pooled, &copy}) {
+      int last = -1;
+      while(!heap->empty()) {
+        UASSERT(last <= heap->top());
+        last = heap->top();
+        heap->pop();
+      }
+    }
+  }
+  cout << "...completed" << endl;
+  fibheap_ops_test(STRESS_REPS);
+  heap_test<fibheap<int> >("fibheap", STRESS_REPS);
+  heap_test<pairing_heap<int> >("pairing_heap", STRESS_REPS);
+  heap_test<pairing_heap<int, less<int>, util::pool_allocator<int> > >(
+      "pooled pairing_heap", STRESS_REPS);
+  heap_test<dary_heap<int> >("4-ary dary_heap", STRESS_REPS);
+  heap_test<dary_heap<int, less<int>, 2> >("binary dary_heap", STRESS_REPS);
+  heap_test<dary_heap<int, less<int>, 3> >("3-ary dary_heap", STRESS_REPS);
+  multiqueue_test(STRESS_REPS);
   return 0;
 }
+
+template<typename Heap>
+void heap_test(const string& name, int reps) {
+  typedef typename Heap::key_type key_type;
+  cout << "Randomized test for " << name << "..." << endl;
+  Heap h;
+  // Live values by key, and ordered by value.
+  map<key_type, int> vals;
+  set<pair<int, key_type> > order;
+  vector<key_type> keys;
+  auto check_pop = [&]() {
+    UASSERT(h.top() == order.begin()->first);
+    int top = h.top();
+    key_type k = h.pop();
+    UASSERT(order.erase(make_pair(top, k)) == 1)
+        << "popped key's value isn't " << top;
+    vals.erase(k);
+    for(auto& key : keys)
+      if(key == k) {
+        key = keys.back();
+        keys.pop_back();
+        break;
+      }
+  };
+  for(int i = 0; i < reps; ++i) {
+    UASSERT(h.size() == vals.size());
+    unsigned op = gen() % 8;
+    if(op < 3 || h.empty()) {
+      // With some duplicate values.
+      int val = static_cast<int>(gen() % (reps / 4 + 1));
+      key_type k = h.push(val);
+      UASSERT(vals.emplace(k, val).second) << "live key handed out again";
+      order.emplace(val, k);
+      keys.push_back(k);
+    } else if(op < 6) {
+      key_type k = keys[gen() % keys.size()];
+      int before = vals[k], after = before - 1 - static_cast<int>(gen() % 50);
+      h.decrease_key(k, after);
+      order.erase(make_pair(before, k));
+      order.emplace(after, k);
+      vals[k] = after;
+    } else {
+      check_pop();
+    }
+  }
+  auto copy = h;
+  UASSERT(copy.size() == h.size());
+  for(int last = INT32_MIN; !copy.empty(); copy.pop()) {
+    UASSERT(last <= copy.top());
+    last = copy.top();
+  }
+  auto moved = std::move(h);
+  h = std::move(moved);
+  while(!h.empty()) check_pop();
+  UASSERT(order.empty());
+  for(int i = 0; i < 10; ++i) h.push(i);
+  cout << h << endl;
+  h.clear();
+  UASSERT(h.empty() && h.size() == 0);
+  h.push(1);
+  UASSERT(h.top() == 1);
+  cout << "...completed" << endl;
+}
+
+namespace {
+
+// A value which may only be moved, never copied.
+struct big {
+  explicit big(int pri) : pri(pri), payload(100, pri) {}
+  big(const big&) = delete;
+  big& operator=(const big&) = delete;
+  bool operator<(const big& other) const {return pri < other.pri;}
+  int pri;
+  vector<int> payload;
+};
+
+} // anonymous namespace
+
+void fibheap_ops_test(int reps) {
+  cout << "Merge two heaps" << endl;
+  {
+    fibheap<int> evens, odds;
+    vector<fibheap<int>::key_type> odd_keys;
+    for(int i = 0; i < 100; i += 2) evens.push(i);
+    for(int i = 1; i < 100; i += 2) odd_keys.push_back(odds.push(i));
+    evens.pop(); // consolidate, so some roots have children
+    evens.merge(std::move(odds));
+    UASSERT(odds.empty() && odds.size() == 0);
+    UASSERT(evens.size() == 99 && evens.top() == 1);
+    // Keys of the merged heap are keys of this one.
+    UASSERT(evens.get_value(odd_keys[10]) == 21);
+    evens.decrease_key(odd_keys[10], -1);
+    UASSERT(evens.top() == -1);
+    UASSERT(evens.pop() == odd_keys[10]);
+    fibheap<int> empty;
+    empty.merge(std::move(evens));
+    empty.merge(fibheap<int>());
+    int last = 0;
+    for(size_t n = 97; !empty.empty(); --n) {
+      UASSERT(last < empty.top());
+      last = empty.top();
+      empty.pop();
+      UASSERT(empty.size() == n);
+    }
+  }
+  cout << "...completed" << endl;
+  cout << "Erase arbitrary keys" << endl;
+  {
+    fibheap<int> f;
+    vector<fibheap<int>::key_type> keys;
+    for(int i = 0; i < reps; ++i) keys.push_back(f.push(i));
+    set<int> live;
+    for(int i = 0; i < reps; ++i) live.insert(i);
+    // Pops build trees, so erases cut from all levels.
+    for(int i = 0; i < 10; ++i) {
+      live.erase(f.top());
+      f.pop();
+    }
+    for(int i = 0; i < reps / 2; ++i) {
+      int val = static_cast<int>(gen() % reps);
+      if(!live.count(val)) continue;
+      UASSERT(f.get_value(keys[val]) == val);
+      UASSERT(f.erase(keys[val]) == keys[val]);
+      live.erase(val);
+      UASSERT(f.size() == live.size());
+      UASSERT(f.empty() || f.top() == *live.begin());
+    }
+    for(int val : live) {
+      UASSERT(f.top() == val);
+      f.pop();
+    }
+    UASSERT(f.empty());
+  }
+  cout << "...completed" << endl;
+  cout << "Decrease-key in place on uncopyable values" << endl;
+  {
+    fibheap<big> f;
+    vector<fibheap<big>::key_type> keys;
+    for(int i = 0; i < 100; ++i) keys.push_back(f.emplace(100 + i));
+    f.pop();
+    for(int i = 99; i > 0; i -= 3)
+      f.decrease_key(keys[i], [i](big& b) {
+          b.pri = -i;
+          b.payload.clear();
+        });
+    UASSERT(f.top().pri == -99 && f.top().payload.empty());
+    f.erase(keys[99]);
+    UASSERT(f.top().pri == -96);
+    fibheap<big> other;
+    other.emplace(-1000);
+    f.merge(std::move(other));
+    int last = -1001;
+    while(!f.empty()) {
+      UASSERT(last < f.top().pri);
+      last = f.top().pri;
+      f.pop();
+    }
+  }
+  cout << "...completed" << endl;
+}
+
+void multiqueue_test(int reps) {
+  cout << "Single-heap multiqueue is exact" << endl;
+  {
+    multiqueue<int> q(1);
+    multiset<int> ref;
+    for(int i = 0; i < reps; ++i) {
+      int val = static_cast<int>(gen() % reps);
+      q.push(val);
+      ref.insert(val);
+    }
+    UASSERT(q.size() == ref.size());
+    for(int val : ref) {
+      auto popped = q.try_pop();
+      UASSERT(popped.valid() && popped.access() == val);
+    }
+    UASSERT(q.empty() && !q.try_pop().valid());
+  }
+  cout << "...completed" << endl;
+  cout << "Relaxed order, sequentially" << endl;
+  {
+    static const size_t kHeaps = 8;
+    // Ranks are found by walking a set, quadratic in n.
+    const int n = min(reps, 5000);
+    multiqueue<int, less<int>, pairing_heap<int> > q(kHeaps);
+    for(int i = 0; i < n; ++i) q.push(i);
+    // Values are distinct, so the rank of a popped value among those left
+    // is how many smaller ones are still in.
+    set<int> left;
+    for(int i = 0; i < n; ++i) left.insert(i);
+    double total_rank = 0;
+    while(!left.empty()) {
+      auto popped = q.try_pop();
+      UASSERT(popped.valid());
+      auto it = left.find(popped.access());
+      UASSERT(it != left.end()) << "popped " << popped.access() << " twice";
+      total_rank += distance(left.begin(), it);
+      left.erase(it);
+    }
+    UASSERT(!q.try_pop().valid());
+    double mean_rank = total_rank / n;
+    UASSERT(mean_rank < kHeaps) << "mean rank " << mean_rank;
+    cout << "mean rank error " << mean_rank << " with " << kHeaps
+         << " heaps" << endl;
+  }
+  cout << "...completed" << endl;
+  cout << "Concurrent pushes and pops" << endl;
+  {
+    static const int kThreads = 4;
+    const int per_thread = reps * 10;
+    multiqueue<int> q(2 * kThreads);
+    vector<future<vector<int> > > popped;
+    vector<future<void> > pushed;
+    for(int t = 0; t < kThreads; ++t) {
+      pushed.push_back(async(launch::async, [&q, t, per_thread]() {
+            for(int i = 0; i < per_thread; ++i)
+              q.push(t * per_thread + i);
+          }));
+      popped.push_back(async(launch::async, [&q, per_thread]() {
+            vector<int> got;
+            while(got.size() < static_cast<size_t>(per_thread)) {
+              auto val = q.try_pop();
+              if(val.valid()) got.push_back(val.access());
+              else this_thread::yield();
+            }
+            return got;
+          }));
+    }
+    for(auto& f : pushed) f.get();
+    vector<bool> seen(kThreads * per_thread, false);
+    for(auto& f : popped)
+      for(int val : f.get()) {
+        UASSERT(!seen[val]) << val << " popped twice";
+        seen[val] = true;
+      }
+    UASSERT(q.empty());
+  }
+  cout << "...completed" << endl;
+}
+
+namespace {
+
+// Adjacency lists: (target, weight) out of each vertex.
+typedef vector<vector<pair<uint32_t, uint32_t> > > graph;
+
+graph random_graph(uint32_t n, uint32_t degree, minstd_rand0& gen) {
+  graph g(n);
+  for(uint32_t v = 0; v < n; ++v)
+    for(uint32_t e = 0; e < degree; ++e)
+      g[v].emplace_back(gen() % n, 1 + gen() % 1000);
+  return g;
+}
+
+typedef pair<uint64_t, uint32_t> dist_vertex;
+
+struct op_counts {
+  op_counts() : pushes(0), decreases(0), pops(0) {}
+  size_t pushes, decreases, pops;
+};
+
+// Dijkstra's algorithm from vertex 0 with a decrease-key heap.
+template<typename Heap>
+vector<uint64_t> dijkstra(const graph& g, op_counts& ops) {
+  static const uint64_t kInf = UINT64_MAX;
+  vector<uint64_t> dist(g.size(), kInf);
+  vector<typename Heap::key_type> keys(g.size());
+  vector<bool> queued(g.size(), false);
+  Heap h;
+  dist[0] = 0;
+  keys[0] = h.push(dist_vertex(0, 0));
+  queued[0] = true;
+  ++ops.pushes;
+  while(!h.empty()) {
+    uint32_t v = h.top().second;
+    h.pop();
+    queued[v] = false;
+    ++ops.pops;
+    for(const auto& e : g[v]) {
+      uint64_t d = dist[v] + e.second;
+      if(d >= dist[e.first]) continue;
+      if(queued[e.first]) {
+        h.decrease_key(keys[e.first], dist_vertex(d, e.first));
+        ++ops.decreases;
+      } else {
+        // Never reinserted: a popped vertex's distance is final.
+        keys[e.first] = h.push(dist_vertex(d, e.first));
+        queued[e.first] = true;
+        ++ops.pushes;
+      }
+      dist[e.first] = d;
+    }
+  }
+  return dist;
+}
+
+// Dijkstra's algorithm with std::priority_queue, which can't decrease
+// keys: improved vertices are pushed again, and stale entries skipped.
+vector<uint64_t> dijkstra_lazy(const graph& g, op_counts& ops) {
+  static const uint64_t kInf = UINT64_MAX;
+  vector<uint64_t> dist(g.size(), kInf);
+  priority_queue<dist_vertex, vector<dist_vertex>, greater<dist_vertex> > q;
+  dist[0] = 0;
+  q.push(dist_vertex(0, 0));
+  ++ops.pushes;
+  while(!q.empty()) {
+    auto top = q.top();
+    q.pop();
+    ++ops.pops;
+    if(top.first != dist[top.second]) continue;
+    for(const auto& e : g[top.second]) {
+      uint64_t d = top.first + e.second;
+      if(d >= dist[e.first]) continue;
+      dist[e.first] = d;
+      q.push(dist_vertex(d, e.first));
+      ++ops.pushes;
+    }
+  }
+  return dist;
+}
+
+template<typename F>
+void run(util::bench::suite& suite, const string& name, F f,
+         const vector<uint64_t>& expected) {
+  op_counts ops;
+  vector<uint64_t> dist;
+  suite.run_fixed(name, [&]() { ops = op_counts(); },
+                  [&]() { dist = f(ops); });
+  UASSERT(dist == expected) << name << " got different distances";
+  suite.log() << "    " << ops.pushes << " pushes, " << ops.decreases
+              << " decreases, " << ops.pops << " pops" << endl;
+}
+
+// A sequential heap behind one mutex, as a baseline for multiqueue.
+template<typename Heap>
+class locked_heap {
+ public:
+  explicit locked_heap(size_t) {}
+  void push(int val) {
+    lock_guard<mutex> lk(m);
+    h.push(val);
+  }
+  util::optional<int> try_pop() {
+    util::optional<int> ret;
+    lock_guard<mutex> lk(m);
+    if(h.empty()) return ret;
+    ret.construct(h.top());
+    h.pop();
+    return ret;
+  }
+ private:
+  mutex m;
+  Heap h;
+};
+
+int nthreads() {
+  int viastd = thread::hardware_concurrency();
+  if (!viastd) viastd = 8;
+  return max(viastd, 2);
+}
+
+// Each thread alternates pushes of random values with pops, on a queue
+// prefilled with as many values as it will see operations.
+template<typename Queue>
+void bench_concurrent(util::bench::suite& suite, const string& name,
+                      int threads) {
+  static const int kOps = 2000000;
+  suite.run_manual(name + ", " + to_string(threads) + " threads", [&]() {
+      Queue q(2 * threads);
+      minstd_rand0 fill(SEED);
+      for(int i = 0; i < kOps; ++i) q.push(static_cast<int>(fill() >> 1));
+      return util::bench::time_threads(threads, [&q, threads](int t) {
+          minstd_rand0 local(t);
+          for(int i = 0; i < kOps / threads / 2; ++i) {
+            q.push(static_cast<int>(local() >> 1));
+            UASSERT(q.try_pop().valid());
+          }
+        });
+    }, kOps / threads / 2 * 2 * threads);
+}
+
+} // anonymous namespace
+
+void bench() {
+  typedef util::pool_allocator<dist_vertex> pool;
+  const pair<uint32_t, uint32_t> shapes[] = {
+    {1000, 8}, {100000, 4}, {100000, 32}, {1000000, 8}};
+  for(const auto& shape : shapes) {
+    auto g = random_graph(shape.first, shape.second, gen);
+    util::bench::suite suite(
+        "Priority queue benchmark: Dijkstra on a random graph, " +
+        to_string(shape.first) + " vertices, " + to_string(shape.second) +
+        " edges each");
+    op_counts ignored;
+    auto expected = dijkstra_lazy(g, ignored);
+    run(suite, "std::priority_queue", [&](op_counts& ops) {
+        return dijkstra_lazy(g, ops);}, expected);
+    run(suite, "fibheap", [&](op_counts& ops) {
+        return dijkstra<fibheap<dist_vertex> >(g, ops);}, expected);
+    run(suite, "pooled fibheap", [&](op_counts& ops) {
+        return dijkstra<fibheap<dist_vertex, less<dist_vertex>, pool> >(
+            g, ops);}, expected);
+    run(suite, "pairing_heap", [&](op_counts& ops) {
+        return dijkstra<pairing_heap<dist_vertex> >(g, ops);}, expected);
+    run(suite, "pooled pairing_heap", [&](op_counts& ops) {
+        return dijkstra<pairing_heap<dist_vertex, less<dist_vertex>,
+                                     pool> >(g, ops);}, expected);
+    run(suite, "binary dary_heap", [&](op_counts& ops) {
+        return dijkstra<dary_heap<dist_vertex, less<dist_vertex>, 2> >(
+            g, ops);}, expected);
+    run(suite, "4-ary dary_heap", [&](op_counts& ops) {
+        return dijkstra<dary_heap<dist_vertex> >(g, ops);}, expected);
+  }
+  util::bench::suite suite("Concurrent priority queues, 2M pushes and pops");
+  for(int threads = 1; threads <= 2 * nthreads(); threads *= 2) {
+    bench_concurrent<locked_heap<dary_heap<int> > >(
+        suite, "locked dary_heap", threads);
+    bench_concurrent<locked_heap<fibheap<int> > >(
+        suite, "locked fibheap", threads);
+    bench_concurrent<multiqueue<int> >(suite, "multiqueue (2/thread)",
+                                       threads);
+  }
+}
@@ -24,20 +24,18 @@
 #include <cmath>
 #include <cstddef>
 #include <list>
+#include <memory>
 #include <ostream>
 #include <queue>
+#include <type_traits>
 #include <unordered_set>
 #include <vector>
 
 // TODO document
 
-// TODO const value_type& get_value(const key_type& k)
-// TODO decrease-key to take in std::function(void(value_type&))
 // TODO decrease-key copy old value and check? ifdef ...?
-// TODO merge
 // TODO iterator, ordered_iterator (in vector key table version v2)
 // TODO copying (v2)
-// TODO delete any key, not min
 
 /*
  * fibheap is a priority queue that allows for constant-time merge,
@@ -57,11 +55,14 @@
  *
  * Allows for duplicates
  *
- * fibheap<T, Compare>
+ * fibheap<T, Compare, Alloc>
  * T - type being contained in the queue
  * Compare - comparison functor
+ * Alloc - allocator, rebound to allocate nodes one at a time (e.g.,
+ *         util::pool_allocator<T>)
  */
-template<typename T, typename Compare = std::less<T> >
+template<typename T, typename Compare = std::less<T>,
+         typename Alloc = std::allocator<T> >
 class fibheap {
 private:
   // Use list container to ensure pointers
@@ -96,12 +97,18 @@ private:
     size_t num_children;
   };
 
+  typedef typename std::allocator_traits<Alloc>::template
+      rebind_alloc<node> node_alloc;
+  typedef std::allocator_traits<node_alloc> node_traits;
+
   // Min node, always on top level, acts as a root/head.
   node *min;
   // Current size
   size_t _size;
   // Comparison operator
   Compare comp;
+  // Node allocator
+  node_alloc alloc;
 
   // Cycles through roots and joins nodes of equal degree
   std::pair<bool, node*> _join_nodes(std::vector<node*>& trees, node *n);
@@ -113,10 +120,20 @@ private:
   static void _rl_splice(node *main, node *insert);
   // Splice completely under new tree
   static void _rlt_splice(node *parent, node *child);
+  // Moves a node whose value decreased to the top level (unless it is a
+  // root already), and makes it min if it is smallest.
+  void _after_decrease(node *n);
+  // Cuts a non-root node and its marked ancestors to the top level
+  void _cascading_cut(node *n);
+  // Allocate and construct a node
+  template<typename... Args>
+  node* _new_node(Args&&... args);
+  // Destroy and deallocate a node
+  void _free_node(node *n);
   // Recursively delete subtree n
-  static void _delete_subtree(node* n);
+  void _delete_subtree(node* n);
   // Deep copy of subtree from n into cpy (does not copy roots)
-  static void _copy_subtree(node *cpy, const node *n);
+  void _copy_subtree(node *cpy, const node *n);
   // Inserts new node at top level, checking min.
   inline void _insert_new_node(node *added);
   // Check invariants
@@ -134,6 +151,7 @@ private:
  public:
   // Public typedefs
   typedef Compare comparator_type;
+  typedef Alloc allocator_type;
   typedef T value_type;
   typedef const void* key_type;
 
@@ -142,11 +160,14 @@ private:
    * INPUT:
    * const comparator_type& comp - comparison functor, uses default
    *              constructor for default value
+   * const allocator_type& alloc - node allocator (rebound), uses default
+   *              constructor for default value
    * BEHAVIOR:
    * Generates an empty fibonacci heap.
    */
-  explicit fibheap(const comparator_type& comp = comparator_type()) :
-      min(nullptr), _size(0), comp(comp) {}
+  explicit fibheap(const comparator_type& comp = comparator_type(),
+                   const allocator_type& alloc = allocator_type()) :
+      min(nullptr), _size(0), comp(comp), alloc(alloc) {}
   /*
    * INPUT:
    * InputIterator first - first input iterator
@@ -166,7 +187,7 @@ private:
    * Generates a deep-copy of the fibheap.
    */
   fibheap(const fibheap& other) :
-      fibheap(comparator_type()) {*this = other;}
+      fibheap(comparator_type(), other.alloc) {*this = other;}
   /*
    * INPUT:
    * fibheap&& other - rvalue ref to fibheap
@@ -174,8 +195,8 @@ private:
    * Moves data from other fibheap to this one.
    */
   fibheap(fibheap&& other) noexcept :
-  fibheap(comparator_type())
-  {*this = std::forward<fibheap<T, Compare> >(other);}
+  fibheap(comparator_type(), other.alloc)
+  {*this = std::forward<fibheap<T, Compare, Alloc> >(other);}
   /*
    * BEHAVIOR:
    * Deallocates all used memory.
@@ -276,6 +297,55 @@ private:
    * RETURN:
    */
   void decrease_key(key_type k, value_type&& v);
+  /*
+   * INPUT:
+   * key_type k - key of value to decrease
+   * Mutator&& mutator - functor called with a value_type& to modify
+   * PRECONDITION:
+   * mutator does not make key's value larger.
+   * BEHAVIOR:
+   * Modifies key's value in place (it is not copied or moved), and
+   * increases its priority.
+   * Key maintains validity to new value.
+   * RETURN:
+   */
+  template<typename Mutator, typename = typename std::enable_if<
+             !std::is_convertible<Mutator, value_type>::value>::type>
+  void decrease_key(key_type k, Mutator&& mutator);
+  /*
+   * INPUT:
+   * key_type k - key of value to remove
+   * PRECONDITION:
+   * BEHAVIOR:
+   * Removes key's value, as if its value were decreased below all
+   * others and then popped. Nothing is compared or copied.
+   * RETURN:
+   * Invalidated key.
+   */
+  key_type erase(key_type k);
+  /*
+   * INPUT:
+   * key_type k - key of a value in the heap
+   * PRECONDITION:
+   * BEHAVIOR:
+   * RETURN:
+   * const reference to key's value, valid until the value is popped
+   */
+  const value_type& get_value(key_type k) const {
+    return static_cast<const node*>(k)->val;
+  }
+  /*
+   * INPUT:
+   * fibheap&& other - heap to take all values from
+   * PRECONDITION:
+   * this != &other, and both allocators compare equal
+   * BEHAVIOR:
+   * Moves every value of other into this in O(1), by splicing root lists.
+   * No values are copied or moved, and other's keys become keys of this.
+   * Other is left empty.
+   * RETURN:
+   */
+  void merge(fibheap&& other);
   /*
    * INPUT:
    * PRECONDITION:
@@ -295,8 +365,8 @@ private:
   key_type pop();
 
   // TODO SEE IF FRIENDSHIP CAN BE REDUCED
-  template<typename T2, typename C2>
-  friend std::ostream& operator<<(std::ostream&, const fibheap<T2, C2>&);
+  template<typename T2, typename C2, typename A2>
+  friend std::ostream& operator<<(std::ostream&, const fibheap<T2, C2, A2>&);
 };
 
 /*
@@ -309,8 +379,8 @@ private:
  * RETURN:
  * Original ostream
  */
-template<typename T, typename C>
-std::ostream& operator<<(std::ostream& o, const fibheap<T, C>& f) {
+template<typename T, typename C, typename A>
+std::ostream& operator<<(std::ostream& o, const fibheap<T, C, A>& f) {
   f._print_fibheap(o);
   return o;
 }
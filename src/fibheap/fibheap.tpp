@@ -8,34 +8,34 @@
 
 #include "util/uassert.hpp"
 
-template<typename T, typename C>
+template<typename T, typename C, typename A>
 template<typename InputIterator>
-fibheap<T,C>::fibheap(InputIterator first, InputIterator last,
+fibheap<T,C,A>::fibheap(InputIterator first, InputIterator last,
                       const C& comp) :
     min(nullptr), _size(0), comp(comp) {
   for(InputIterator i = first; i != last; ++i)
     push(i);
 }
 
-template<typename T, typename C>
-fibheap<T,C>::~fibheap() {
+template<typename T, typename C, typename A>
+fibheap<T,C,A>::~fibheap() {
   clear();
 }
 
-template<typename T, typename C>
-fibheap<T,C>& fibheap<T,C>::operator=(const fibheap<T,C>& other) {
+template<typename T, typename C, typename A>
+fibheap<T,C,A>& fibheap<T,C,A>::operator=(const fibheap<T,C,A>& other) {
   if(this == &other) return *this;
   clear();
   comp = other.comp;
   if(other.empty()) return *this;
   _size = other._size;
-  min = new node(other.min->val);
+  min = _new_node(other.min->val);
   _copy_subtree(min, other.min);
   const node *traverse = other.min->right;
   node *n = min;
   while(traverse != other.min)
   {
-    n->right = new node(traverse->val);
+    n->right = _new_node(traverse->val);
     n->right->left = n;
     n = n->right;
     _copy_subtree(n, traverse);
@@ -46,25 +46,26 @@ fibheap<T,C>& fibheap<T,C>::operator=(const fibheap<T,C>& other) {
   return *this;
 }
 
-template<typename T, typename C>
-fibheap<T,C>& fibheap<T,C>::operator=(fibheap<T,C>&& other) {
+template<typename T, typename C, typename A>
+fibheap<T,C,A>& fibheap<T,C,A>::operator=(fibheap<T,C,A>&& other) {
   clear();
   min = other.min;
   _size = other._size;
   comp = std::move(other.comp);
+  alloc = other.alloc; // no nodes of ours left to free with the old one.
   other.min = nullptr;
   other._size = 0;
   return *this;
 }
 
 // size is nonzero
-template<typename T, typename C>
-constexpr size_t fibheap<T,C>::approx_childnum(size_t size) {
+template<typename T, typename C, typename A>
+constexpr size_t fibheap<T,C,A>::approx_childnum(size_t size) {
   return size < 2? size : (size_t) log((double) size)/log(PHI);
 }
 
-template<typename T, typename C>
-void fibheap<T,C>::_print_fibheap(std::ostream& o) const {
+template<typename T, typename C, typename A>
+void fibheap<T,C,A>::_print_fibheap(std::ostream& o) const {
   _consistency_check();
   o << "Fibheap @ " << this << ", size " << _size;
   if(!empty()) o << ", top " << top();
@@ -111,89 +112,91 @@ void fibheap<T,C>::_print_fibheap(std::ostream& o) const {
   o << '\n';
 }
 
-template<typename T, typename C>
-typename fibheap<T,C>::key_type fibheap<T,C>::push(const value_type& p) {
+template<typename T, typename C, typename A>
+typename fibheap<T,C,A>::key_type fibheap<T,C,A>::push(const value_type& p) {
   _consistency_check();
-  node *added = new node(p);
+  node *added = _new_node(p);
   ++_size;
   _insert_new_node(added);
   return static_cast<key_type>(added);
 }
 
-template<typename T, typename C>
+template<typename T, typename C, typename A>
 template<typename... Args>
-auto fibheap<T,C>::emplace(Args&&... args) -> key_type {
+auto fibheap<T,C,A>::emplace(Args&&... args) -> key_type {
   _consistency_check();
-  node *added = new node(std::forward<Args>(args)...);
+  node *added = _new_node(std::forward<Args>(args)...);
   ++_size;
   _insert_new_node(added);
   return static_cast<key_type>(added);
 }
 
 // keeps key the same
-template<typename T, typename C>
-void fibheap<T,C>::decrease_key(key_type key, const value_type& val) {
+template<typename T, typename C, typename A>
+void fibheap<T,C,A>::decrease_key(key_type key, const value_type& val) {
   UASSERT(key != nullptr);
   _consistency_check();
   node* changed = static_cast<node*>(const_cast<void*>(key));
   UASSERT(comp(val, changed->val));
   changed->val = val;
-  changed->marked = false;
-  if(changed->up != nullptr)
-  {
-    node *n = changed->up;
-    _rlt_cut(changed);
-    _rl_splice(min, changed);
-    while(n->up != nullptr)
-    {
-      if(!n->marked)
-      {
-        n->marked = true;
-        break;
-      }
-      n->marked = false;
-      node *tmp = n->up;
-      _rlt_cut(n);
-      _rl_splice(min, n);
-      n = tmp;
-    }
-  }
-  if(comp(changed->val, min->val))
-    min = changed;
+  _after_decrease(changed);
 }
 
-template<typename T, typename C>
-void fibheap<T,C>::decrease_key(key_type key, value_type&& val) {
+template<typename T, typename C, typename A>
+void fibheap<T,C,A>::decrease_key(key_type key, value_type&& val) {
   UASSERT(key != nullptr);
   _consistency_check();
   node* changed = static_cast<node*>(const_cast<void*>(key));
   changed->val = std::forward<value_type>(val);
-  changed->marked = false;
-  if(changed->up != nullptr)
+  _after_decrease(changed);
+}
+
+template<typename T, typename C, typename A>
+template<typename Mutator, typename>
+void fibheap<T,C,A>::decrease_key(key_type key, Mutator&& mutator) {
+  UASSERT(key != nullptr);
+  _consistency_check();
+  node* changed = static_cast<node*>(const_cast<void*>(key));
+  std::forward<Mutator>(mutator)(changed->val);
+  _after_decrease(changed);
+}
+
+template<typename T, typename C, typename A>
+auto fibheap<T,C,A>::erase(key_type key) -> key_type {
+  UASSERT(key != nullptr);
+  _consistency_check();
+  node* erased = static_cast<node*>(const_cast<void*>(key));
+  if(erased != min)
   {
-    node *n = changed->up;
-    _rlt_cut(changed);
-    _rl_splice(min, changed);
-    while(n->up != nullptr)
-    {
-      if(!n->marked)
-      {
-        n->marked = true;
-        break;
-      }
-      n->marked = false;
-      node *tmp = n->up;
-      _rlt_cut(n);
-      _rl_splice(min, n);
-      n = tmp;
-    }
+    // As if decreased to minus infinity: cut to the top, and take min.
+    erased->marked = false;
+    if(erased->up != nullptr) _cascading_cut(erased);
+    min = erased;
   }
-  if(comp(changed->val, min->val))
-    min = changed;
+  return pop();
+}
+
+template<typename T, typename C, typename A>
+void fibheap<T,C,A>::merge(fibheap&& other) {
+  UASSERT(this != &other);
+  UASSERT(alloc == other.alloc) << "nodes can't be freed by this heap";
+  _consistency_check();
+  other._consistency_check();
+  if(other.empty()) return;
+  if(empty()) min = other.min;
+  else
+  {
+    _rl_splice(min, other.min);
+    if(comp(other.min->val, min->val))
+      min = other.min;
+  }
+  _size += other._size;
+  other.min = nullptr;
+  other._size = 0;
 }
 
-template<typename T, typename C>
-void fibheap<T,C>::clear() {
+template<typename T, typename C, typename A>
+void fibheap<T,C,A>::clear() {
   _consistency_check();
   if(empty()) return;
   node *del = min;
@@ -202,15 +205,15 @@ void fibheap<T,C>::clear() {
     _delete_subtree(del);
     node *tmp = del;
     del = del->right;
-    delete tmp;
+    _free_node(tmp);
   }
   while(del != min);
   _size = 0;
   min = nullptr;
 }
 
-template<typename T, typename C>
-auto fibheap<T,C>::pop() -> key_type {
+template<typename T, typename C, typename A>
+auto fibheap<T,C,A>::pop() -> key_type {
   _consistency_check();
   // 0 nodes
   if(empty()) return nullptr;
@@ -226,28 +229,31 @@ auto fibheap<T,C>::pop() -> key_type {
       _rl_splice(top, min->down);
   }
   // delete min, note min->down children up == min still
-  delete min;
+  _free_node(min);
   min = top;
   if (top == nullptr) return key; // now empty
   // Go through roots (which must costartntain new min). Also minimize # of roots.
   std::vector<node*> trees(approx_childnum(_size));
   top->up = nullptr;
   top->marked = false;
-  for (node* i = top->right; i != top; i = i->right) {
+  size_t roots = 1;
+  for (node* i = top->right; i != top; i = i->right, ++roots) {
     // consistency
     i->up = nullptr;
     i->marked = false;
   }
-  while(true)
+  while(roots--)
   {
+    // Joining may move top under a root visited earlier, so the next root
+    // to visit has to be taken beforehand. Unvisited roots are never
+    // joined, so it stays in the ring.
+    node *next_root = top->right;
     auto next = _join_nodes(trees, top);
     if(next.first) top = next.second;
     if(comp(top->val, min->val))
       min = top;
     else if(!comp(min->val, top->val)) min = top; // need to keep min on top
-    top = top->right;
-    if(trees.size() > top->num_children && trees[top->num_children] == top)
-      break;
+    top = next_root;
   }
   return key;
 }
@@ -261,8 +267,8 @@ auto fibheap<T,C>::pop() -> key_type {
  *      right of n1->up or n1->down).
  * all nodes are circularly linked
  */
-template<typename T, typename C>
-void fibheap<T,C>::_consistency_check() const {
+template<typename T, typename C, typename A>
+void fibheap<T,C,A>::_consistency_check() const {
   if(_size == 0)
   {
     UASSERT(min == nullptr);
@@ -282,8 +288,8 @@ void fibheap<T,C>::_consistency_check() const {
 // the set so that later on lower levels are not linked to higher ones.
 // also checks for parent consistency. Returns num children.
 #if FIB_CHECK
-template<typename T, typename C>
-size_t fibheap<T,C>::_tree_check(const node *root,
+template<typename T, typename C, typename A>
+size_t fibheap<T,C,A>::_tree_check(const node *root,
                                  std::unordered_set<const node*>& s) {
   if(root == nullptr) return 0;
   const node *n = root;
@@ -309,16 +315,16 @@ size_t fibheap<T,C>::_tree_check(const node *root,
 }
 #endif /* FIB_CHECK */
 
-template<typename T, typename C>
-void fibheap<T,C>::_rl_cut(node *n) {
+template<typename T, typename C, typename A>
+void fibheap<T,C,A>::_rl_cut(node *n) {
   UASSERT(n != nullptr);
   n->right->left = n->left;
   n->left->right = n->right;
   n->left = n->right = n;
 }
 
-template<typename T, typename C>
-void fibheap<T,C>::_rlt_cut(node *n) {
+template<typename T, typename C, typename A>
+void fibheap<T,C,A>::_rlt_cut(node *n) {
   UASSERT(n != nullptr);
   UASSERT(n->up != nullptr);
   node *next = n->right;
@@ -329,8 +335,8 @@ void fibheap<T,C>::_rlt_cut(node *n) {
   n->up = nullptr;
 }
 
-template<typename T, typename C>
-void fibheap<T,C>::_rl_splice(node *main, node *insert) {
+template<typename T, typename C, typename A>
+void fibheap<T,C,A>::_rl_splice(node *main, node *insert) {
   UASSERT(main != nullptr);
   UASSERT(insert != nullptr);
   node *r_main = main->right, *r_ins = insert->left;
@@ -344,8 +350,8 @@ void fibheap<T,C>::_rl_splice(node *main, node *insert) {
 
 // indep of min
 // returns whether need to re-cycle, and the top-level processed node
-template<typename T, typename C>
-auto fibheap<T,C>::_join_nodes(std::vector<node*>& trees, node *n) -> std::pair<bool, node*> {
+template<typename T, typename C, typename A>
+auto fibheap<T,C,A>::_join_nodes(std::vector<node*>& trees, node *n) -> std::pair<bool, node*> {
   while(n->num_children >= trees.size())
     trees.push_back(nullptr);
   node *&same_deg = trees[n->num_children];
@@ -371,9 +377,40 @@ auto fibheap<T,C>::_join_nodes(std::vector<node*>& trees, node *n) -> std::pair<
   return std::make_pair(true, _join_nodes(trees, parent).second);
 }
 
+template<typename T, typename C, typename A>
+void fibheap<T,C,A>::_after_decrease(node *changed) {
+  changed->marked = false;
+  if(changed->up != nullptr) _cascading_cut(changed);
+  if(comp(changed->val, min->val))
+    min = changed;
+}
+
+// cuts n (not top level) to the top level, along with the marked
+// ancestors above it, marking the first unmarked one.
+template<typename T, typename C, typename A>
+void fibheap<T,C,A>::_cascading_cut(node *changed) {
+  UASSERT(changed->up != nullptr);
+  node *n = changed->up;
+  _rlt_cut(changed);
+  _rl_splice(min, changed);
+  while(n->up != nullptr)
+  {
+    if(!n->marked)
+    {
+      n->marked = true;
+      break;
+    }
+    n->marked = false;
+    node *tmp = n->up;
+    _rlt_cut(n);
+    _rl_splice(min, n);
+    n = tmp;
+  }
+}
+
 // child should be _rlt_cut
-template<typename T, typename C>
-void fibheap<T,C>::_rlt_splice(node *parent, node *child) {
+template<typename T, typename C, typename A>
+void fibheap<T,C,A>::_rlt_splice(node *parent, node *child) {
   UASSERT(parent != nullptr);
   UASSERT(child != nullptr);
   ++parent->num_children;
@@ -382,8 +419,8 @@ void fibheap<T,C>::_rlt_splice(node *parent, node *child) {
   child->up = parent;
 }
 
-template<typename T, typename C>
-void fibheap<T,C>::_delete_subtree(node *n) {
+template<typename T, typename C, typename A>
+void fibheap<T,C,A>::_delete_subtree(node *n) {
   UASSERT(n != nullptr);
   if(n->down == nullptr) return;
   node *del = n->down;
@@ -392,16 +429,16 @@ void fibheap<T,C>::_delete_subtree(node *n) {
     _delete_subtree(del);
     node *tmp = del;
     del = del->right;
-    delete tmp;
+    _free_node(tmp);
   } while(del != n->down);
 }
 
-template<typename T, typename C>
-void fibheap<T,C>::_copy_subtree(node *cpy, const node *n) {
+template<typename T, typename C, typename A>
+void fibheap<T,C,A>::_copy_subtree(node *cpy, const node *n) {
   UASSERT(cpy != nullptr);
   UASSERT(n != nullptr);
   if(n->down == nullptr) return;
-  cpy->down = new node(n->down->val);
+  cpy->down = _new_node(n->down->val);
   cpy->down->up = cpy;
   ++cpy->num_children;
   _copy_subtree(cpy->down, n->down);
@@ -409,7 +446,7 @@ void fibheap<T,C>::_copy_subtree(node *cpy, const node *n) {
   node *childcpy = cpy->down;
   while(traverse != n->down)
   {
-    childcpy->right = new node(traverse->val);
+    childcpy->right = _new_node(traverse->val);
     ++cpy->num_children;
     childcpy->right->left = childcpy;
     childcpy = childcpy->right;
@@ -421,8 +458,27 @@ void fibheap<T,C>::_copy_subtree(node *cpy, const node *n) {
   cpy->down->left = childcpy;
 }
 
-template<typename T, typename C>
-void fibheap<T,C>::_insert_new_node(node *added) {
+template<typename T, typename C, typename A>
+template<typename... Args>
+auto fibheap<T,C,A>::_new_node(Args&&... args) -> node* {
+  node *n = node_traits::allocate(alloc, 1);
+  try {
+    node_traits::construct(alloc, n, std::forward<Args>(args)...);
+  } catch (...) {
+    node_traits::deallocate(alloc, n, 1);
+    throw;
+  }
+  return n;
+}
+
+template<typename T, typename C, typename A>
+void fibheap<T,C,A>::_free_node(node *n) {
+  node_traits::destroy(alloc, n);
+  node_traits::deallocate(alloc, n, 1);
+}
+
+template<typename T, typename C, typename A>
+void fibheap<T,C,A>::_insert_new_node(node *added) {
   if(min == nullptr) min = added;
   else
   {
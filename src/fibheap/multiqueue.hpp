@@ -0,0 +1,134 @@
+/*
+* Vladimir Feinberg
+* fibheap/multiqueue.hpp
+* 2026-10-14
+*
+* Declares multiqueue, a concurrent priority queue with relaxed ordering,
+* made of many independently locked sequential heaps.
+*/
+
+#ifndef FIBHEAP_MULTIQUEUE_HPP_
+#define FIBHEAP_MULTIQUEUE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "fibheap/dary_heap.hpp"
+#include "util/cache_line.hpp"
+#include "util/optional.hpp"
+
+/*
+ * A multiqueue is a concurrent priority queue after Rihani, Sanders and
+ * Dementiev ("MultiQueues: Simple Relaxed Concurrent Priority Queues"):
+ * c*P sequential heaps, each behind its own lock, for P threads.
+ *
+ * push() locks a random heap (another random one if that lock is taken)
+ * and pushes there. try_pop() try-locks two random heaps, and pops the
+ * smaller of their tops. Neither ever waits behind a held lock while
+ * another heap could do, so threads rarely contend.
+ *
+ * The ordering is relaxed: a pop returns one of the smallest values, not
+ * necessarily the smallest. Since every pop picks the better of two
+ * random heads, the rank of a popped value among those present is on the
+ * order of the number of heaps (expected O(c*P)), and values do not
+ * starve. With a single heap, a multiqueue is an exact (locked) priority
+ * queue.
+ *
+ * multiqueue<T, Compare, Heap, Lock>
+ * T - type being contained in the queue
+ * Compare - comparison functor
+ * Heap - sequential heap with fibheap's push(), top(), pop() and empty()
+ *        (e.g., fibheap<T, Compare> or pairing_heap<T, Compare>)
+ * Lock - heap lock, with lock(), try_lock() and unlock()
+ *
+ * This class is thread safe.
+ */
+template<typename T, typename Compare = std::less<T>,
+         typename Heap = dary_heap<T, Compare>,
+         typename Lock = std::mutex>
+class multiqueue {
+ public:
+  // Public typedefs
+  typedef Compare comparator_type;
+  typedef T value_type;
+  typedef Heap heap_type;
+
+  // Heaps per thread, by default.
+  static constexpr size_t kHeapsPerThread = 2;
+
+  /*
+   * INPUT:
+   * size_t heaps = 0 - number of heaps, by default kHeapsPerThread per
+   *              hardware thread
+   * const comparator_type& comp - comparison functor
+   * BEHAVIOR:
+   * Generates an empty queue.
+   */
+  explicit multiqueue(size_t heaps = 0,
+                      const comparator_type& comp = comparator_type());
+  multiqueue(const multiqueue&) = delete;
+  multiqueue& operator=(const multiqueue&) = delete;
+
+  // Snapshots under concurrent modification.
+  bool empty() const;
+  size_t size() const;
+  size_t heap_count() const {return heaps.size();}
+  /*
+   * INPUT:
+   * const value_type& val - value pushed into the queue
+   * PRECONDITION:
+   * BEHAVIOR:
+   * Adds value to a random heap.
+   * RETURN:
+   */
+  void push(const value_type& val);
+  void push(value_type&& val);
+  /*
+   * INPUT:
+   * PRECONDITION:
+   * BEHAVIOR:
+   * Removes one of the smallest values (see above). Only fails if every
+   * heap was seen empty.
+   * RETURN:
+   * The removed value, or an invalid (unconstructed) optional if the queue
+   * was empty.
+   */
+  util::optional<value_type> try_pop();
+
+ private:
+  struct sub_heap {
+    explicit sub_heap(const comparator_type& comp) : heap(comp), size(0) {}
+    util::cache_pad<0> pad_;
+    Lock lock;
+    // Guarded by lock.
+    Heap heap;
+    // Written under lock, read without it to skip empty heaps.
+    std::atomic<size_t> size;
+  };
+
+  // Tries to lock a heap at random this many times before waiting for one.
+  static constexpr int kPushTries = 4;
+  // Pairs of random heaps tried before looking through every heap.
+  static constexpr int kPopTries = 4;
+
+  // Random heap index, from a per-thread generator.
+  size_t random_heap() const;
+  // Locks a random heap.
+  sub_heap& lock_random();
+  // Pops the top of a locked, nonempty heap into ret.
+  static void pop_locked(sub_heap& h, util::optional<value_type>& ret);
+  template<typename V>
+  void push_impl(V&& val);
+
+  Compare comp;
+  std::vector<std::unique_ptr<sub_heap> > heaps;
+};
+
+#include "fibheap/multiqueue.tpp"
+
+#endif /* FIBHEAP_MULTIQUEUE_HPP_ */
@@ -0,0 +1,148 @@
+/*
+ * Vladimir Feinberg
+ * 2026-10-14
+ * fibheap/multiqueue.tpp
+ *
+ * Contains implementation of multiqueue.hpp methods.
+ */
+
+#include <thread>
+#include <utility>
+
+#include "util/uassert.hpp"
+
+template<typename T, typename C, typename H, typename L>
+constexpr size_t multiqueue<T,C,H,L>::kHeapsPerThread;
+
+template<typename T, typename C, typename H, typename L>
+constexpr int multiqueue<T,C,H,L>::kPushTries;
+
+template<typename T, typename C, typename H, typename L>
+constexpr int multiqueue<T,C,H,L>::kPopTries;
+
+template<typename T, typename C, typename H, typename L>
+multiqueue<T,C,H,L>::multiqueue(size_t nheaps, const C& comp) : comp(comp) {
+  if(nheaps == 0) {
+    size_t hw = std::thread::hardware_concurrency();
+    nheaps = kHeapsPerThread * (hw ? hw : 8);
+  }
+  for(size_t i = 0; i < nheaps; ++i)
+    heaps.emplace_back(new sub_heap(comp));
+}
+
+template<typename T, typename C, typename H, typename L>
+bool multiqueue<T,C,H,L>::empty() const {
+  for(auto& h : heaps)
+    if(h->size.load(std::memory_order_relaxed)) return false;
+  return true;
+}
+
+template<typename T, typename C, typename H, typename L>
+size_t multiqueue<T,C,H,L>::size() const {
+  size_t total = 0;
+  for(auto& h : heaps)
+    total += h->size.load(std::memory_order_relaxed);
+  return total;
+}
+
+template<typename T, typename C, typename H, typename L>
+void multiqueue<T,C,H,L>::push(const value_type& val) {
+  push_impl(val);
+}
+
+template<typename T, typename C, typename H, typename L>
+void multiqueue<T,C,H,L>::push(value_type&& val) {
+  push_impl(std::move(val));
+}
+
+template<typename T, typename C, typename H, typename L>
+template<typename V>
+void multiqueue<T,C,H,L>::push_impl(V&& val) {
+  auto& h = lock_random();
+  std::lock_guard<L> lk(h.lock, std::adopt_lock);
+  h.heap.push(std::forward<V>(val));
+  h.size.store(h.size.load(std::memory_order_relaxed) + 1,
+               std::memory_order_relaxed);
+}
+
+template<typename T, typename C, typename H, typename L>
+auto multiqueue<T,C,H,L>::try_pop() -> util::optional<value_type> {
+  util::optional<value_type> ret;
+  if(heaps.size() > 1) {
+    for(int i = 0; i < kPopTries; ++i) {
+      sub_heap *a = heaps[random_heap()].get(), *b = heaps[random_heap()].get();
+      if(a == b) continue;
+      // Skip empty and busy heaps, rather than waiting on them.
+      bool has_a = a->size.load(std::memory_order_relaxed) && a->lock.try_lock();
+      bool has_b = b->size.load(std::memory_order_relaxed) && b->lock.try_lock();
+      if(has_a && a->heap.empty()) {
+        a->lock.unlock();
+        has_a = false;
+      }
+      if(has_b && b->heap.empty()) {
+        b->lock.unlock();
+        has_b = false;
+      }
+      if(!has_a && !has_b) continue;
+      if(has_a && has_b) {
+        // Keep the better head in a.
+        if(comp(b->heap.top(), a->heap.top())) std::swap(a, b);
+        b->lock.unlock();
+      } else if(has_b) {
+        a = b;
+      }
+      std::lock_guard<L> lk(a->lock, std::adopt_lock);
+      pop_locked(*a, ret);
+      return ret;
+    }
+  }
+  // Unlucky or nearly empty: look at every heap, starting at a random one.
+  size_t start = random_heap();
+  for(size_t i = 0; i < heaps.size(); ++i) {
+    auto& h = *heaps[(start + i) % heaps.size()];
+    if(!h.size.load(std::memory_order_relaxed)) continue;
+    std::lock_guard<L> lk(h.lock);
+    if(h.heap.empty()) continue;
+    pop_locked(h, ret);
+    return ret;
+  }
+  return ret;
+}
+
+// ---- helper methods
+
+template<typename T, typename C, typename H, typename L>
+size_t multiqueue<T,C,H,L>::random_heap() const {
+  // xorshift64*, seeded by the generator's own (per-thread) address.
+  static thread_local uint64_t state = 0;
+  if(!state)
+    state = (reinterpret_cast<uintptr_t>(&state) | 1) * 0x9e3779b97f4a7c15ull;
+  state ^= state >> 12;
+  state ^= state << 25;
+  state ^= state >> 27;
+  uint64_t r = (state * 0x2545f4914f6cdd1dull) >> 32;
+  return static_cast<size_t>((r * heaps.size()) >> 32);
+}
+
+template<typename T, typename C, typename H, typename L>
+auto multiqueue<T,C,H,L>::lock_random() -> sub_heap& {
+  for(int i = 0; i < kPushTries; ++i) {
+    auto& h = *heaps[random_heap()];
+    if(h.lock.try_lock()) return h;
+  }
+  auto& h = *heaps[random_heap()];
+  h.lock.lock();
+  return h;
+}
+
+template<typename T, typename C, typename H, typename L>
+void multiqueue<T,C,H,L>::pop_locked(sub_heap& h,
+                                     util::optional<value_type>& ret) {
+  UASSERT(!h.heap.empty());
+  // Copied: the heaps only give const access, and check their order (top
+  // included) in debug builds.
+  ret.construct(h.heap.top());
+  h.heap.pop();
+  h.size.store(h.size.load(std::memory_order_relaxed) - 1,
+               std::memory_order_relaxed);
+}
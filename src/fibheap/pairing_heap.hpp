@@ -0,0 +1,276 @@
+/*
+* Vladimir Feinberg
+* fibheap/pairing_heap.hpp
+* 2026-10-14
+*
+* Declares a pairing heap, a decrease-key priority queue with the same
+* interface as fibheap. Pairing heaps have the same amortized bounds as
+* Fibonacci heaps in practice, but with three pointers per node and a much
+* simpler restructuring on pop, so they are several times faster.
+*/
+
+#ifndef FIBHEAP_PAIRING_HEAP_HPP_
+#define FIBHEAP_PAIRING_HEAP_HPP_
+
+// As in fibheap.hpp: thorough (full traversal) invariant checking in debug
+// mode.
+#ifndef FIB_CHECK
+#ifndef NDEBUG
+#define FIB_CHECK 1
+#else
+#define FIB_CHECK 0
+#endif
+#endif /* FIB_CHECK */
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <ostream>
+
+/*
+ * pairing_heap is a priority queue with constant-time insert and
+ * decrease-key, and amortized logarithmic pop (Fredman, Sedgewick, Sleator
+ * and Tarjan, "The pairing heap: a new form of self-adjusting heap").
+ *
+ * The heap is one heap-ordered tree, each node holding a pointer to its
+ * first child, next sibling and previous sibling (or parent, for a first
+ * child). Inserting or decreasing a key links it with the root, and
+ * popping merges the root's children pairwise, left to right, and then
+ * the pairs right to left.
+ *
+ * As with fibheap, push returns a key which stays valid until its value
+ * is popped, to be passed to decrease_key.
+ *
+ * Allows for duplicates
+ *
+ * pairing_heap<T, Compare, Alloc>
+ * T - type being contained in the queue
+ * Compare - comparison functor
+ * Alloc - allocator, rebound to allocate nodes one at a time (e.g.,
+ *         util::pool_allocator<T>)
+ */
+template<typename T, typename Compare = std::less<T>,
+         typename Alloc = std::allocator<T> >
+class pairing_heap {
+ private:
+  struct node {
+    template<typename... Args>
+    node(Args&&... args) :
+        val(std::forward<Args>(args)...), child(nullptr), next(nullptr),
+        prev(nullptr) {}
+
+    node(const node&) = delete;
+    node& operator=(const node&) = delete;
+
+    T val;
+    // prev is the parent of a first child, and null for the root.
+    node *child, *next, *prev;
+  };
+
+  typedef typename std::allocator_traits<Alloc>::template
+      rebind_alloc<node> node_alloc;
+  typedef std::allocator_traits<node_alloc> node_traits;
+
+  // Min node, the root of the tree.
+  node *root;
+  // Current size
+  size_t _size;
+  // Comparison operator
+  Compare comp;
+  // Node allocator
+  node_alloc alloc;
+
+  // Links two roots, returning the new (detached) one.
+  node* _link(node *a, node *b);
+  // Merges a sibling list, two-pass, returning the new root.
+  node* _merge_pairs(node *first);
+  // Detaches n (not the root) and its subtree from its parent.
+  static void _cut(node *n);
+  // Allocate and construct a node
+  template<typename... Args>
+  node* _new_node(Args&&... args);
+  // Destroy and deallocate a node
+  void _free_node(node *n);
+  // Check invariants
+  void _consistency_check() const;
+  // Print debug info to ostream
+  void _print_pairing_heap(std::ostream& o) const;
+ public:
+  // Public typedefs
+  typedef Compare comparator_type;
+  typedef Alloc allocator_type;
+  typedef T value_type;
+  typedef const void* key_type;
+
+  // Constructors/Destructor
+  /*
+   * INPUT:
+   * const comparator_type& comp - comparison functor, uses default
+   *              constructor for default value
+   * const allocator_type& alloc - node allocator (rebound), uses default
+   *              constructor for default value
+   * BEHAVIOR:
+   * Generates an empty pairing heap.
+   */
+  explicit pairing_heap(const comparator_type& comp = comparator_type(),
+                        const allocator_type& alloc = allocator_type()) :
+      root(nullptr), _size(0), comp(comp), alloc(alloc) {}
+  /*
+   * INPUT:
+   * const pairing_heap& other - pairing_heap to copy from
+   * BEHAVIOR:
+   * Generates a deep-copy of the heap. Keys of other are not keys of the
+   * copy.
+   */
+  pairing_heap(const pairing_heap& other) :
+      pairing_heap(other.comp, other.alloc) {*this = other;}
+  /*
+   * INPUT:
+   * pairing_heap&& other - rvalue ref to pairing_heap
+   * BEHAVIOR:
+   * Moves data from other heap to this one. Keys stay valid.
+   */
+  pairing_heap(pairing_heap&& other) noexcept :
+      pairing_heap(other.comp, other.alloc) {*this = std::move(other);}
+  /*
+   * BEHAVIOR:
+   * Deallocates all used memory.
+   */
+  ~pairing_heap() {clear();}
+
+  // Methods
+  /*
+   * INPUT:
+   * const pairing_heap& other - pairing_heap to copy
+   * PRECONDITION:
+   * BEHAVIOR:
+   * Performs a deep copy.
+   * RETURN:
+   * *this
+   */
+  pairing_heap& operator=(const pairing_heap& other);
+  /*
+   * INPUT:
+   * pairing_heap&& other
+   * PRECONDITION:
+   * this != &other
+   * BEHAVIOR:
+   * Performs a move, leaving other empty.
+   * RETURN:
+   * *this
+   */
+  pairing_heap& operator=(pairing_heap&& other);
+  /*
+   * INPUT:
+   * PRECONDITION:
+   * BEHAVIOR:
+   * RETURN:
+   * Whether empty
+   */
+  inline bool empty() const {return root == nullptr;}
+  /*
+   * INPUT:
+   * PRECONDITION:
+   * BEHAVIOR:
+   * RETURN:
+   * Size
+   */
+  inline size_t size() const {return _size;}
+  /*
+   * INPUT:
+   * PRECONDITION:
+   * !empty()
+   * BEHAVIOR:
+   * RETURN:
+   * const reference to minimum element
+   */
+  inline const value_type& top() const {return root->val;}
+  /*
+   * INPUT:
+   * const value_type& p - value pushed into heap
+   * PRECONDITION:
+   * BEHAVIOR:
+   * Adds value to heap.
+   * RETURN:
+   * Key associated with pushed item. Key remains valid until the
+   * value is popped.
+   */
+  key_type push(const value_type& p) {return emplace(p);}
+  /*
+   * INPUT:
+   * Args&&... args - arguments for generating value_type
+   * PRECONDITION:
+   * BEHAVIOR:
+   * Adds generated value to heap.
+   * RETURN:
+   * Key associated with pushed item. Key remains valid until the
+   * value is popped.
+   */
+  template<typename... Args>
+  key_type emplace(Args&&... args);
+  /*
+   * INPUT:
+   * key_type k - key of value to decrease
+   * const value_type& v - new value for associated key
+   * PRECONDITION:
+   * v is smaller than or equal to key's value.
+   * BEHAVIOR:
+   * Decreases key value and increases its priority.
+   * Key maintains validity to new value.
+   * RETURN:
+   */
+  void decrease_key(key_type k, const value_type& v);
+  /*
+   * INPUT:
+   * key_type k - key of value to decrease
+   * value_type&& v - rvalue ref to new value for associated key
+   * PRECONDITION:
+   * v is smaller than or equal to key's value.
+   * BEHAVIOR:
+   * Decreases key value and increases its priority.
+   * Key maintains validity to new value.
+   * RETURN:
+   */
+  void decrease_key(key_type k, value_type&& v);
+  /*
+   * INPUT:
+   * PRECONDITION:
+   * BEHAVIOR:
+   * Clears heap. Invalidates all keys.
+   * RETURN:
+   */
+  void clear();
+  /*
+   * INPUT:
+   * PRECONDITION:
+   * BEHAVIOR:
+   * Pops minimum value off heap.
+   * RETURN:
+   * Invalidated key, or nullptr if the heap was empty.
+   */
+  key_type pop();
+
+  template<typename T2, typename C2, typename A2>
+  friend std::ostream& operator<<(std::ostream&,
+                                  const pairing_heap<T2, C2, A2>&);
+};
+
+/*
+ * INPUT:
+ * std::ostream& o - ostream to print to
+ * const pairing_heap<T,C,A>& h - heap to print
+ * PRECONDITION:
+ * BEHAVIOR:
+ * Prints heap to stream
+ * RETURN:
+ * Original ostream
+ */
+template<typename T, typename C, typename A>
+std::ostream& operator<<(std::ostream& o, const pairing_heap<T, C, A>& h) {
+  h._print_pairing_heap(o);
+  return o;
+}
+
+#include "fibheap/pairing_heap.tpp"
+
+#endif /* FIBHEAP_PAIRING_HEAP_HPP_ */
@@ -0,0 +1,232 @@
+/*
+ * Vladimir Feinberg
+ * 2026-10-14
+ * fibheap/pairing_heap.tpp
+ *
+ * Contains implementation of pairing_heap.hpp methods.
+ */
+
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "util/uassert.hpp"
+
+template<typename T, typename C, typename A>
+auto pairing_heap<T,C,A>::operator=(const pairing_heap& other)
+    -> pairing_heap& {
+  if(this == &other) return *this;
+  clear();
+  comp = other.comp;
+  // Trees may be as deep as they are large, so walk them with a stack.
+  // Pushes are O(1), and need not keep the shape.
+  std::vector<const node*> todo;
+  if(other.root) todo.push_back(other.root);
+  while(!todo.empty()) {
+    const node *n = todo.back();
+    todo.pop_back();
+    push(n->val);
+    for(const node *c = n->child; c; c = c->next)
+      todo.push_back(c);
+  }
+  return *this;
+}
+
+template<typename T, typename C, typename A>
+auto pairing_heap<T,C,A>::operator=(pairing_heap&& other) -> pairing_heap& {
+  UASSERT(this != &other);
+  clear();
+  root = other.root;
+  _size = other._size;
+  comp = std::move(other.comp);
+  alloc = other.alloc; // no nodes of ours left to free with the old one.
+  other.root = nullptr;
+  other._size = 0;
+  return *this;
+}
+
+template<typename T, typename C, typename A>
+template<typename... Args>
+auto pairing_heap<T,C,A>::emplace(Args&&... args) -> key_type {
+  _consistency_check();
+  node *added = _new_node(std::forward<Args>(args)...);
+  ++_size;
+  root = root ? _link(root, added) : added;
+  return static_cast<key_type>(added);
+}
+
+template<typename T, typename C, typename A>
+void pairing_heap<T,C,A>::decrease_key(key_type key, const value_type& val) {
+  decrease_key(key, value_type(val));
+}
+
+template<typename T, typename C, typename A>
+void pairing_heap<T,C,A>::decrease_key(key_type key, value_type&& val) {
+  UASSERT(key != nullptr);
+  _consistency_check();
+  node *changed = static_cast<node*>(const_cast<void*>(key));
+  UASSERT(!comp(changed->val, val));
+  changed->val = std::move(val);
+  if(changed == root) return;
+  _cut(changed);
+  root = _link(root, changed);
+}
+
+template<typename T, typename C, typename A>
+void pairing_heap<T,C,A>::clear() {
+  _consistency_check();
+  // Flattens the tree into one list (through next) as it goes.
+  node *todo = root;
+  while(todo) {
+    node *n = todo;
+    todo = n->next;
+    if(n->child) {
+      node *last = n->child;
+      while(last->next) last = last->next;
+      last->next = todo;
+      todo = n->child;
+    }
+    _free_node(n);
+  }
+  root = nullptr;
+  _size = 0;
+}
+
+template<typename T, typename C, typename A>
+auto pairing_heap<T,C,A>::pop() -> key_type {
+  _consistency_check();
+  if(empty()) return nullptr;
+  node *old = root;
+  key_type key = static_cast<key_type>(old);
+  root = old->child ? _merge_pairs(old->child) : nullptr;
+  --_size;
+  _free_node(old);
+  return key;
+}
+
+// ---- helper methods
+
+template<typename T, typename C, typename A>
+auto pairing_heap<T,C,A>::_link(node *a, node *b) -> node* {
+  // Ties go to a, the older root.
+  if(comp(b->val, a->val)) std::swap(a, b);
+  b->prev = a;
+  b->next = a->child;
+  if(a->child) a->child->prev = b;
+  a->child = b;
+  a->next = a->prev = nullptr;
+  return a;
+}
+
+template<typename T, typename C, typename A>
+auto pairing_heap<T,C,A>::_merge_pairs(node *first) -> node* {
+  // First pass, left to right: link siblings in pairs, keeping the
+  // results in a list (through next) in reverse order.
+  node *pairs = nullptr;
+  while(first) {
+    node *a = first, *b = a->next;
+    if(!b) {
+      a->next = pairs;
+      pairs = a;
+      break;
+    }
+    first = b->next;
+    node *linked = _link(a, b);
+    linked->next = pairs;
+    pairs = linked;
+  }
+  // Second pass, right to left: link each pair into the last one.
+  node *merged = pairs;
+  pairs = pairs->next;
+  while(pairs) {
+    node *next = pairs->next;
+    merged = _link(merged, pairs);
+    pairs = next;
+  }
+  merged->next = merged->prev = nullptr;
+  return merged;
+}
+
+template<typename T, typename C, typename A>
+void pairing_heap<T,C,A>::_cut(node *n) {
+  UASSERT(n->prev != nullptr);
+  if(n->prev->child == n) n->prev->child = n->next;
+  else n->prev->next = n->next;
+  if(n->next) n->next->prev = n->prev;
+  n->next = n->prev = nullptr;
+}
+
+template<typename T, typename C, typename A>
+template<typename... Args>
+auto pairing_heap<T,C,A>::_new_node(Args&&... args) -> node* {
+  node *n = node_traits::allocate(alloc, 1);
+  try {
+    node_traits::construct(alloc, n, std::forward<Args>(args)...);
+  } catch (...) {
+    node_traits::deallocate(alloc, n, 1);
+    throw;
+  }
+  return n;
+}
+
+template<typename T, typename C, typename A>
+void pairing_heap<T,C,A>::_free_node(node *n) {
+  node_traits::destroy(alloc, n);
+  node_traits::deallocate(alloc, n, 1);
+}
+
+/*
+ * legal state:
+ * root == nullptr iff _size == 0
+ * root has no siblings or parent
+ * every child is no less than its parent, and links back to it (first
+ *      child) or its previous sibling
+ * size is consistent
+ */
+template<typename T, typename C, typename A>
+void pairing_heap<T,C,A>::_consistency_check() const {
+  UASSERT((root == nullptr) == (_size == 0));
+  if(!root) return;
+  UASSERT(root->next == nullptr && root->prev == nullptr);
+#if FIB_CHECK
+  std::unordered_set<const node*> seen;
+  std::vector<const node*> todo(1, root);
+  while(!todo.empty()) {
+    const node *n = todo.back();
+    todo.pop_back();
+    UASSERT(seen.insert(n).second);
+    const node *prev = n;
+    for(const node *c = n->child; c; prev = c, c = c->next) {
+      UASSERT(c->prev == prev);
+      UASSERT(!comp(c->val, n->val));
+      todo.push_back(c);
+    }
+  }
+  UASSERT(seen.size() == _size);
+#endif /* FIB_CHECK */
+}
+
+template<typename T, typename C, typename A>
+void pairing_heap<T,C,A>::_print_pairing_heap(std::ostream& o) const {
+  _consistency_check();
+  o << "Pairing heap @ " << this << ", size " << _size;
+  if(!empty()) o << ", top " << top();
+  o << '\n';
+  if(empty()) return;
+  // One line per depth, each node followed by its parent.
+  std::vector<std::pair<const node*, const node*> > level, next;
+  level.emplace_back(root, nullptr);
+  while(!level.empty()) {
+    for(const auto& np : level) {
+      o << np.first->val << '(';
+      if(np.second == nullptr) o << '-';
+      else o << np.second->val;
+      o << ") ";
+      for(const node *c = np.first->child; c; c = c->next)
+        next.emplace_back(c, np.first);
+    }
+    o << '\n';
+    level.swap(next);
+    next.clear();
+  }
+}
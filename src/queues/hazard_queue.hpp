@@ -4,7 +4,8 @@
  * 2015-01-30
  *
  * Lock free FIFO queue, satisfies the MPMC problem.
- * Implemented with hazard pointers.
+ * Implemented with hazard pointers, or any other reclamation policy
+ * from synchro/reclamation.hpp.
  *
  * This queue was my own invention, but it was influenced by
  * the advice in The Art of Multiprocessor Programming.
@@ -14,51 +15,109 @@
 #define QUEUES_HAZARD_QUEUE_HPP_
 
 #include <atomic>
+#include <chrono>
+#include <cstddef>
 #include <memory>
 #include <ostream>
 
 #include "queues/queue.hpp"
+#include "queues/queue_stats.hpp"
+#include "queues/wait_strategy.hpp"
+#include "synchro/reclamation.hpp"
 #include "util/atomic_optional.hpp"
+#include "util/cache_line.hpp"
+#include "util/node_pool.hpp"
 #include "util/optional.hpp"
 
 namespace queues {
 
-template<typename T>
+template<typename T, typename Reclaimer = synchro::hazard_reclaimer,
+         typename Wait = yield_wait, typename Stats = stats::none>
 class hazard_queue;
 
-template<typename T>
-std::ostream& operator<<(std::ostream&, const hazard_queue<T>&);
+template<typename T, typename R, typename W, typename S>
+std::ostream& operator<<(std::ostream&, const hazard_queue<T, R, W, S>&);
 
 // T does not have to be synchronized; this class will provide the needed
 // memory bariers for it to be always accessed in a linearized manner.
 //
 // The queue will never block on enqueue operations. The queue
 // will block dequeing threads if empty. "try" methods never block.
-template<typename T>
+//
+// Reclaimer decides how dequeued nodes are kept alive for threads still
+// reading them. The default, synchro::hazard_reclaimer, bounds the garbage
+// held back by a stalled thread; synchro::epoch_reclaimer is cheaper per
+// operation when critical sections are short.
+//
+// Wait is the blocking strategy for dequeue() and dequeue_until(), see
+// queues/wait_strategy.hpp. The default yield_wait spins; park_wait puts
+// idle consumers to sleep.
+//
+// Stats is the instrumentation policy, see queues/queue_stats.hpp. The
+// default, stats::none, compiles to nothing.
+template<typename T, typename Reclaimer, typename Wait, typename Stats>
 class hazard_queue : public queue<T> {
  private:
-  struct node {
+  typedef typename Reclaimer::region region;
+  template<typename U>
+  using guard = typename Reclaimer::template guard<U>;
+
+  // Nodes come from (and are retired back to) a util::node_pool.
+  struct node : util::pooled<node>, Stats::stamp {
     node() : next_(nullptr) {}
     node(T&& val) : next_(nullptr), val_(std::forward<T>(val)) {}
+    template<typename... Args>
+    explicit node(util::in_place_t, Args&&... args) :
+        next_(nullptr), val_(util::in_place, std::forward<Args>(args)...) {}
 
     std::atomic<node*> next_;
     util::atomic_optional<T> val_;
   };
 
-  // We will rely on hazard pointers to avoid ABA problem.
+  // We will rely on the reclaimer (hazard pointers by default) to avoid ABA
+  // problem.
+  //
+  // Dequeuers write the head side and enqueuers the tail side, so each
+  // side gets its own cache line (see util/cache_line.hpp). The versions
+  // below are needed for empty().
+  typedef util::cache_pad<sizeof(std::atomic<node*>) +
+                          sizeof(std::atomic<size_t>)> side_pad;
+  util::cache_pad<0> pad0_;
   std::atomic<node*> head_;
-  // TODO: potential optimization, store in different cache lines
+  std::atomic<size_t> remove_version_; // number dequeued
+  side_pad pad1_;
   std::atomic<node*> tail_;
-
-  // Below versioning needed for empty()
   std::atomic<size_t> insert_version_; // number enqueued
-  std::atomic<size_t> remove_version_; // number dequeued
+  side_pad pad2_;
+  Wait wait_;
+  Stats stats_;
 
-  void enqueue(node* n) noexcept;
+  // Publishes the privately linked chain [first ... last] of count nodes.
+  void publish(node* first, node* last, std::size_t count) noexcept;
+  void publish(node* n) noexcept {
+    stats_.on_enqueue(*n);
+    publish(n, n, 1);
+  }
+  // Claims the head item for the caller, returning its node (null if
+  // empty), which 'hazard_head' and the caller's region keep alive. The
+  // item's value is the caller's to move out and destroy.
+  node* claim(guard<node>& hazard_head);
+  // Destroys a claimed node's moved-from value.
+  void consumed(node* n) {
+    n->val_.get()->~T();
+    remove_version_.fetch_add(1, std::memory_order_relaxed);
+    stats_.on_dequeue(*n);
+  }
+  // Schedules deletion of a claimed node.
+  void retire(node* n) {
+    auto mark = stats_.before_retire();
+    Reclaimer::schedule_deletion(n);
+    stats_.after_retire(mark);
+  }
 
  public:
   hazard_queue() :
-    insert_version_(0), remove_version_(0) {
+    remove_version_(0), insert_version_(0) {
     node* n = new node;
     std::atomic_store_explicit(&tail_, n, std::memory_order_relaxed);
     std::atomic_store_explicit(&head_, n, std::memory_order_relaxed);
@@ -70,12 +129,37 @@ class hazard_queue : public queue<T> {
   virtual bool empty() const;
   // Strong guarantee for enqueues
   // Only construction of T or new node will throw.
-  virtual void enqueue(T t) { enqueue(new node(std::move(t))); }
-  virtual void try_enqueue(T t) { enqueue(std::move(t)); }
+  virtual void enqueue(T t) { publish(new node(std::move(t))); }
+  // Constructs the item in its node from args, with no intermediate T to
+  // move from. Enqueueing a T itself still goes to the overload above,
+  // which wins the tie.
+  template<typename... Args>
+  void enqueue(Args&&... args) {
+    publish(new node(util::in_place, std::forward<Args>(args)...));
+  }
+  // Unbounded, so try_enqueue() always succeeds.
+  virtual bool try_enqueue(T t) { enqueue(std::move(t)); return true; }
   // Strong guarantee for dequeue - only move can throw
   // In addition, empty_error may be thrown for try_dequeue()
   virtual T dequeue();
   virtual util::optional<T> try_dequeue();
+  // Move-assign the item straight from its node into 'out', instead of
+  // going through a util::optional (which dequeue() above moves out of
+  // once more). 'out' is left alone if try_dequeue() returns false. Same
+  // guarantees otherwise.
+  void dequeue(T& out);
+  bool try_dequeue(T& out);
+  virtual util::optional<T> dequeue_until(
+      std::chrono::steady_clock::time_point deadline);
+  // Bulk enqueues link the batch privately and publish it with one tail CAS.
+  // Bulk dequeues claim a run of nodes with one head CAS. Same exception
+  // guarantees as their single-item counterparts.
+  virtual void enqueue_bulk(T* first, T* last);
+  virtual std::size_t try_dequeue_bulk(T* out, std::size_t max);
+  // Sums every thread's statistics so far (all 0 with stats::none). May be
+  // called while the queue is in use.
+  stats::summary get_stats() const;
+  void reset_stats() { stats_.reset(); }
   // For debugging. Prints [head ... tail]. Requires external locking
   // so that no operations occur on the queue.
   friend std::ostream& operator<< <>(std::ostream&, const hazard_queue&);
@@ -10,13 +10,16 @@
 //
 // See notes in shared_queue.tpp. This queue works the same way, but relies
 // on hazard pointers to avoid the ABA problem (a lockfree approach).
+//
+// Every operation holds a Reclaimer region, and every node it touches is
+// held by a Reclaimer guard. For hazard pointers the guards do the work; for
+// epochs the region does, and a guard is just a local pointer.
 
-#include "synchro/hazard.hpp"
 
 namespace queues {
 
-template<typename T>
-bool hazard_queue<T>::is_lock_free() const {
+template<typename T, typename R, typename W, typename S>
+bool hazard_queue<T, R, W, S>::is_lock_free() const {
   return std::atomic_is_lock_free(&head_)
       && std::atomic_is_lock_free(&tail_)
       && std::atomic_is_lock_free(&insert_version_)
@@ -24,8 +27,8 @@ bool hazard_queue<T>::is_lock_free() const {
   // TODO: include hazard pointers' is lock free value here.
 }
 
-template<typename T>
-bool hazard_queue<T>::empty() const {
+template<typename T, typename R, typename W, typename S>
+bool hazard_queue<T, R, W, S>::empty() const {
   // Give a "conservative" estimate, likely to say empty() is true,
   // to prevent eager wakeups and contention, by reading insert version first.
   auto enq = insert_version_.load(std::memory_order_relaxed);
@@ -34,53 +37,84 @@ bool hazard_queue<T>::empty() const {
   return enq == deq;
 }
 
-template<typename T>
-void hazard_queue<T>::enqueue(node* n) noexcept {
-  synchro::hazard_ptr<node> hazard_tail;
-  hazard_tail.acquire(tail_);
+template<typename T, typename R, typename W, typename S>
+void hazard_queue<T, R, W, S>::publish(node* first, node* last,
+                                       std::size_t count) noexcept {
+  region r;
+  guard<node> hazard_tail;
+  stats_.on_reacquire(hazard_tail.acquire(tail_));
   node* newnext = nullptr;
 
   while (!std::atomic_compare_exchange_weak_explicit(
-             &hazard_tail->next_, &newnext, n, std::memory_order_release,
+             &hazard_tail->next_, &newnext, first, std::memory_order_release,
              std::memory_order_relaxed)) {
+    stats_.on_tail_retry();
     auto oldtail = hazard_tail.get();
     // Important for progress - other threads help move the tail forward.
     std::atomic_compare_exchange_weak_explicit(&tail_, &oldtail, newnext,
                                                std::memory_order_relaxed,
                                                std::memory_order_relaxed);
-    hazard_tail.acquire(tail_);
+    stats_.on_reacquire(hazard_tail.acquire(tail_));
     newnext = nullptr;
   }
 
   // Make sure that by the time we are finished enqueuing, a dequeuer
-  // is able to remove the head.
+  // is able to remove the head. For a chain, if the CAS fails it's because
+  // another enqueuer is helping - it will walk the tail one node at a time
+  // through the rest of the chain before it can link its own node.
   auto oldtail = hazard_tail.get();
   std::atomic_compare_exchange_strong_explicit(
-      &tail_, &oldtail, n, std::memory_order_relaxed, std::memory_order_relaxed);
+      &tail_, &oldtail, last, std::memory_order_relaxed,
+      std::memory_order_relaxed);
 
-  insert_version_.fetch_add(1, std::memory_order_relaxed);
+  insert_version_.fetch_add(count, std::memory_order_relaxed);
+  wait_.notify(count);
 }
 
-template<typename T>
-util::optional<T> hazard_queue<T>::try_dequeue()
-{
+template<typename T, typename R, typename W, typename S>
+void hazard_queue<T, R, W, S>::enqueue_bulk(T* first, T* last) {
+  if (first == last) return;
+  // Link the chain privately, no one else can see it until it's published.
+  node* chain_first = new node(std::move(*first));
+  node* chain_last = chain_first;
+  std::size_t count = 1;
+  try {
+    for (++first; first != last; ++first, ++count) {
+      node* n = new node(std::move(*first));
+      chain_last->next_.store(n, std::memory_order_relaxed);
+      chain_last = n;
+    }
+  } catch (...) {
+    for (auto prev = chain_first; prev;) {
+      auto next = prev->next_.load(std::memory_order_relaxed);
+      delete prev;
+      prev = next;
+    }
+    throw;
+  }
+  for (auto n = chain_first; n;
+       n = n->next_.load(std::memory_order_relaxed))
+    stats_.on_enqueue(*n);
+  publish(chain_first, chain_last, count);
+}
+
+template<typename T, typename R, typename W, typename S>
+auto hazard_queue<T, R, W, S>::claim(guard<node>& hazard_head) -> node* {
   // TODO: optimization for dequeue() - only take one hazard_head,
   // spin on that one, instead of making a new one each time.
-  synchro::hazard_ptr<node> hazard_head;
-
   // Cycle until we can "claim" a node for the dequeuer, with the oldhead
   // variable pointing to it.
   while (true) {
-    hazard_head.acquire(head_);
+    stats_.on_reacquire(hazard_head.acquire(head_));
 
     // We can't go ahead of tail, even if we see head->next != nullptr, because
     // enqueuers rely on that node's validity.
     auto oldtail = std::atomic_load_explicit(&tail_, std::memory_order_relaxed);
     if (hazard_head.get() == oldtail) {
       if (hazard_head->val_.valid() && hazard_head->val_.invalidate())
-        break;
+        return hazard_head.get();
       // If head == tail and head is invalid, then we're empty.
-      return {};
+      return nullptr;
     }
 
     auto newhead = std::atomic_load_explicit(&hazard_head->next_,
@@ -89,7 +123,7 @@ util::optional<T> hazard_queue<T>::try_dequeue()
     // got in right after the if (oldhead == oldtail) returned false
     // above. In order to avoid swapping in the null head, we need to
     // restart the dequeuing process from the top
-    if (!newhead) return {};
+    if (!newhead) return nullptr;
 
     auto oldhead = hazard_head.get();
     if (std::atomic_compare_exchange_weak_explicit(
@@ -98,47 +132,174 @@ util::optional<T> hazard_queue<T>::try_dequeue()
       // We have claimed oldhead successfully.
       // Recall hazard_head == oldhead, so we can schedule deletion
       // now (we're safe to use the pointer until we get out of scope).
-      synchro::hazard_ptr<node>::schedule_deletion(hazard_head.get());
+      retire(hazard_head.get());
 
       // The head could still be invalid.
       // If we had a successful CAS but oldhead is invalid, then this
       // is the case where we were waiting on a head == tail case
       // but tail moved, so we moved head forward to a valid node
       // as well. Just restart dequeue() loop in this case.
-      if (oldhead->val_.valid())
-        break;
+      //
+      // A dequeuer that saw head == tail before we moved the head may
+      // still be about to invalidate() it, so the value goes to whoever
+      // invalidates it first, as in try_dequeue_bulk().
+      if (oldhead->val_.invalidate())
+        return oldhead;
+    } else {
+      stats_.on_head_retry();
     }
   }
+}
 
-  // NOTE: we do not schedule deletion here; only the thread that
-  // successfully CAS-es the head off (guaranteed to just be one)
-  // may schedule the deletion. Notice two break statements above
-  // lead to two paths that end up here.
+// NOTE: the dequeues below do not schedule deletion; only the thread that
+// successfully CAS-es the head off (guaranteed to just be one) may
+// schedule the deletion, which claim() did if it was us.
 
-  remove_version_.fetch_add(1, std::memory_order_relaxed);
+template<typename T, typename R, typename W, typename S>
+util::optional<T> hazard_queue<T, R, W, S>::try_dequeue()
+{
+  region r;
+  guard<node> hazard_head;
+  auto n = claim(hazard_head);
+  if (!n) return {};
+  util::optional<T> ret(std::move(*n->val_.get()));
+  consumed(n);
+  return ret;
+}
 
-  return {std::move(*hazard_head->val_.get())};
+template<typename T, typename R, typename W, typename S>
+bool hazard_queue<T, R, W, S>::try_dequeue(T& out)
+{
+  region r;
+  guard<node> hazard_head;
+  auto n = claim(hazard_head);
+  if (!n) return false;
+  out = std::move(*n->val_.get());
+  consumed(n);
+  return true;
 }
 
-// TODO: optimization: do manual RVO on the optional by inlining?
-//----- The above will also let us get rid of using the ::optional, which
-// may provide further improvements.
-template<typename T>
-T hazard_queue<T>::dequeue() {
-  util::optional<T> opt;
+template<typename T, typename R, typename W, typename S>
+std::size_t hazard_queue<T, R, W, S>::try_dequeue_bulk(T* out, std::size_t max) {
+  if (max == 0) return 0;
+  region r;
+  guard<node> hazard_head, hazard_walk;
+  std::size_t claimed;
+  node* oldhead;
+
+  // Cycle until we claim the run [oldhead, newhead) with one head CAS.
   while (true) {
-    opt = try_dequeue();
-    if (opt.valid())
+    stats_.on_reacquire(hazard_head.acquire(head_));
+    oldhead = hazard_head.get();
+
+    auto oldtail = std::atomic_load_explicit(&tail_, std::memory_order_relaxed);
+    if (oldhead == oldtail) {
+      // Single-item case, identical to try_dequeue().
+      if (!oldhead->val_.invalidate()) return 0;
+      out[0] = std::move(*oldhead->val_.get());
+      oldhead->val_.get()->~T();
+      remove_version_.fetch_add(1, std::memory_order_relaxed);
+      stats_.on_dequeue(*oldhead);
+      return 1;
+    }
+
+    // Walk forward from the head, never claiming the tail node. Each node
+    // is protected before we read its 'next_'; it's only safe to use once
+    // we know the head hasn't moved (so the node could not be retired).
+    node* walk = oldhead;
+    claimed = 1;
+    bool restart = false;
+    while (claimed < max) {
+      auto next = std::atomic_load_explicit(&walk->next_,
+                                            std::memory_order_acquire);
+      if (!next || next == oldtail) break;
+      hazard_walk.acquire(next);
+      if (std::atomic_load_explicit(&head_, std::memory_order_relaxed)
+          != oldhead) {
+        restart = true;
+        break;
+      }
+      walk = next;
+      ++claimed;
+    }
+    if (restart) {
+      stats_.on_reacquire(1);
+      continue;
+    }
+
+    auto newhead = std::atomic_load_explicit(&walk->next_,
+                                             std::memory_order_acquire);
+    // See try_dequeue() for why this may happen.
+    if (!newhead) return 0;
+
+    if (std::atomic_compare_exchange_weak_explicit(
+            &head_, &oldhead, newhead, std::memory_order_release,
+            std::memory_order_relaxed))
       break;
-    std::this_thread::yield();
+    stats_.on_head_retry();
   }
+
+  // The run is ours now; no one else may schedule its deletion, so we can
+  // read it freely before we do. Only the first node may have been
+  // invalidated (by a single-item dequeuer that saw head == tail), and
+  // invalidate() settles which of us gets the value.
+  std::size_t n = 0;
+  node* i = oldhead;
+  for (std::size_t j = 0; j < claimed; ++j) {
+    auto next = std::atomic_load_explicit(&i->next_, std::memory_order_relaxed);
+    if (i->val_.invalidate()) {
+      out[n++] = std::move(*i->val_.get());
+      i->val_.get()->~T();
+      stats_.on_dequeue(*i);
+    }
+    retire(i);
+    i = next;
+  }
+
+  // Everything claimed was invalid only if we claimed just an invalid
+  // head; try the next one.
+  if (n == 0) return try_dequeue_bulk(out, max);
+
+  remove_version_.fetch_add(n, std::memory_order_relaxed);
+  return n;
+}
+
+template<typename T, typename R, typename W, typename S>
+T hazard_queue<T, R, W, S>::dequeue() {
+  auto opt = wait_.wait([this]() { return try_dequeue(); });
   return std::move(opt.access());
 }
 
+namespace internal {
+// What a wait strategy needs of an attempt's result.
+struct dequeued {
+  bool ok;
+  bool valid() const { return ok; }
+};
+} // namespace internal
+
+template<typename T, typename R, typename W, typename S>
+void hazard_queue<T, R, W, S>::dequeue(T& out) {
+  wait_.wait([this, &out]() { return internal::dequeued{try_dequeue(out)}; });
+}
+
+template<typename T, typename R, typename W, typename S>
+util::optional<T> hazard_queue<T, R, W, S>::dequeue_until(
+    std::chrono::steady_clock::time_point deadline) {
+  return wait_.wait_until([this]() { return try_dequeue(); }, deadline);
+}
+
+template<typename T, typename R, typename W, typename S>
+stats::summary hazard_queue<T, R, W, S>::get_stats() const {
+  stats::summary total;
+  stats_.collect(total);
+  return total;
+}
+
 // As is the normal assumption, the queue should not be in use
 // by other threads.
-template<typename T>
-hazard_queue<T>::~hazard_queue() {
+template<typename T, typename R, typename W, typename S>
+hazard_queue<T, R, W, S>::~hazard_queue() {
   for (auto prev = head_.load(std::memory_order_acquire); prev;) {
     auto next = prev->next_.load(std::memory_order_acquire);
     delete prev;
@@ -148,8 +309,8 @@ hazard_queue<T>::~hazard_queue() {
 
 // Requires dequeuers are not operating on the queue (thus, no need for
 // hazard pointers).
-template<typename T>
-std::ostream& operator<<(std::ostream& o, const hazard_queue<T>& q) {
+template<typename T, typename R, typename W, typename S>
+std::ostream& operator<<(std::ostream& o, const hazard_queue<T, R, W, S>& q) {
   auto tail = std::atomic_load_explicit(&q.tail_, std::memory_order_relaxed);
   auto head = std::atomic_load_explicit(&q.head_, std::memory_order_acquire);
 
@@ -10,25 +10,38 @@
 #include <atomic>
 #include <chrono>
 #include <cstring>
+#include <functional>
 #include <future>
 #include <iostream>
 #include <iomanip>
+#include <memory>
+#include <numeric>
 #include <string>
 #include <sstream>
+#include <stdexcept>
 #include <thread>
 #include <vector>
 
+#include <sched.h>
+
 #ifdef HAVE_BOOST
 #include <boost/lockfree/queue.hpp>
 #endif /* HAVE_BOOST */
 
+#include "util/bench.hpp"
 #include "util/line_wrap.hpp"
-#include "util/timer.hpp"
+#include "util/topology.hpp"
 #include "util/uassert.hpp"
 #include "util/util.hpp"
 #include "queues/queue.hpp"
 #include "queues/shared_queue.hpp"
 #include "queues/hazard_queue.hpp"
+#include "queues/mpsc_queue.hpp"
+#include "queues/numa_queue.hpp"
+#include "queues/ring_queue.hpp"
+#include "queues/spsc_queue.hpp"
+#include "queues/ws_deque.hpp"
+#include "synchro/epoch.hpp"
 
 using namespace std;
 using namespace util;
@@ -41,13 +54,93 @@ template<template<typename> class T>
 void test_multithreaded();
 
 template<template<typename> class T>
-void bench_queue();
+void test_bulk_multithreaded();
+
+void test_bounded();
+
+void test_ws_deque();
+
+template<template<typename> class T>
+void test_single_consumer(int nenq);
+
+template<template<typename> class T>
+void test_timed();
+
+template<template<typename> class T>
+void test_parked();
+
+void test_histogram();
+
+void test_numa();
+
+template<template<typename> class T>
+void test_in_place();
+
+template<template<typename> class T>
+void test_exactly_once();
+
+template<template<typename> class T>
+void test_bulk_throw();
+
+template<template<typename> class T>
+void test_instrumented(bool hazards);
+
+template<template<typename> class T>
+void bench_queue(bench::suite& suite);
+
+template<template<typename> class T>
+void bench_bulk(bench::suite& suite);
+template<template<typename> class T>
+void bench_scaling(bench::suite& suite);
+template<template<typename> class T>
+void bench_single_consumer(bench::suite& suite, bool multi_producer);
+template<template<typename> class T>
+void bench_instrumented(bench::suite& suite);
+template<template<typename> class T>
+void bench_numa(bench::suite& suite, const string& name);
+template<template<typename> class T>
+void bench_strings(bench::suite& suite);
+
+int nthreads();
+
+static const int kBenchItemsPerEnqueuer = 100000;
+
+// Template template parameters can't bind to hazard_queue or shared_queue
+// directly (they have defaulted policy parameters), so name each policy.
+template<typename T>
+using sp_queue = shared_queue<T>;
+template<typename T>
+using hp_queue = hazard_queue<T, synchro::hazard_reclaimer>;
+template<typename T>
+using epoch_queue = hazard_queue<T, synchro::epoch_reclaimer>;
+template<typename T>
+using sp_park_queue = shared_queue<T, park_wait>;
+template<typename T>
+using hp_park_queue = hazard_queue<T, synchro::hazard_reclaimer, park_wait>;
+template<typename T>
+using sp_sampled_queue = shared_queue<T, yield_wait, stats::sampled>;
+template<typename T>
+using hp_sampled_queue =
+    hazard_queue<T, synchro::hazard_reclaimer, yield_wait, stats::sampled>;
+template<typename T>
+using hp_numa_queue = numa_queue<T>;
+template<typename T>
+using hp_numa_park_queue = numa_queue<T, hazard_queue<T>, park_wait>;
+
+// The enqueue-only phase of the benchmark never dequeues, so a bounded
+// queue has to be able to hold all of it at once.
+template<typename T>
+class bench_ring_queue : public ring_queue<T> {
+ public:
+  bench_ring_queue() : ring_queue<T>(nthreads() * kBenchItemsPerEnqueuer) {}
+};
 
 #ifdef HAVE_BOOST
 template<typename T>
 class boost_queue {
  public:
-  boost_queue() {}
+  // Newer boost requires an initial node count for the unbounded queue.
+  boost_queue() : impl(128) {}
   void enqueue(T t) {
     impl.push(t);
   }
@@ -77,31 +170,200 @@ int main(int argc, char** argv) {
 
     cout << "\nShared Queue" << endl;
     cout << "  Unit testing:" << endl;
-    unit_test<shared_queue>();
+    unit_test<sp_queue>();
     cout << "  Multithreaded test:" << endl;
-    test_multithreaded<shared_queue>();
+    test_multithreaded<sp_queue>();
+    cout << "  Bulk multithreaded test:" << endl;
+    test_bulk_multithreaded<sp_queue>();
 
-    cout << "\nHazard Queue" << endl;
+    cout << "\nHazard Queue (hazard pointers)" << endl;
     cout << "  Unit testing:" << endl;
-    unit_test<hazard_queue>();
+    unit_test<hp_queue>();
     cout << "  Multithreaded test:" << endl;
-    test_multithreaded<hazard_queue>();
+    test_multithreaded<hp_queue>();
+    cout << "  Bulk multithreaded test:" << endl;
+    test_bulk_multithreaded<hp_queue>();
+
+    cout << "\nHazard Queue (epochs)" << endl;
+    cout << "  Unit testing:" << endl;
+    unit_test<epoch_queue>();
+    cout << "  Multithreaded test:" << endl;
+    test_multithreaded<epoch_queue>();
+    cout << "  Bulk multithreaded test:" << endl;
+    test_bulk_multithreaded<epoch_queue>();
+
+    cout << "\nShared Queue (parking)" << endl;
+    cout << "  Unit testing:" << endl;
+    unit_test<sp_park_queue>();
+    cout << "  Multithreaded test:" << endl;
+    test_multithreaded<sp_park_queue>();
+    cout << "  Timed dequeue test:" << endl;
+    test_timed<sp_park_queue>();
+    cout << "  Parked consumers test:" << endl;
+    test_parked<sp_park_queue>();
+
+    cout << "\nHazard Queue (hazard pointers, parking)" << endl;
+    cout << "  Unit testing:" << endl;
+    unit_test<hp_park_queue>();
+    cout << "  Multithreaded test:" << endl;
+    test_multithreaded<hp_park_queue>();
+    cout << "  Bulk multithreaded test:" << endl;
+    test_bulk_multithreaded<hp_park_queue>();
+    cout << "  Timed dequeue test:" << endl;
+    test_timed<hp_park_queue>();
+    cout << "  Parked consumers test:" << endl;
+    test_parked<hp_park_queue>();
+
+    cout << "\nHazard Queue throwing bulk enqueue:" << endl;
+    test_bulk_throw<hp_queue>();
+
+    cout << "\nHazard Queue (yield) timed dequeue test:" << endl;
+    test_timed<hp_queue>();
+
+    cout << "\nDequeue exactly once" << endl;
+    cout << "  Shared Queue:" << endl;
+    test_exactly_once<sp_queue>();
+    cout << "  Shared Queue (parking):" << endl;
+    test_exactly_once<sp_park_queue>();
+    cout << "  Hazard Queue (hazard pointers):" << endl;
+    test_exactly_once<hp_queue>();
+    cout << "  Hazard Queue (epochs):" << endl;
+    test_exactly_once<epoch_queue>();
+
+    cout << "\nHazard Queue in-place enqueue and dequeue" << endl;
+    cout << "  Hazard pointers:" << endl;
+    test_in_place<hp_queue>();
+    cout << "  Epochs:" << endl;
+    test_in_place<epoch_queue>();
+    cout << "  Hazard pointers, parking:" << endl;
+    test_in_place<hp_park_queue>();
+
+    cout << "\nInstrumentation" << endl;
+    cout << "  Histogram bins:" << endl;
+    test_histogram();
+    cout << "  Shared Queue:" << endl;
+    unit_test<sp_sampled_queue>();
+    test_instrumented<sp_sampled_queue>(false);
+    cout << "  Hazard Queue (hazard pointers):" << endl;
+    unit_test<hp_sampled_queue>();
+    test_instrumented<hp_sampled_queue>(true);
+
+    cout << "\nRing Queue" << endl;
+    cout << "  Unit testing:" << endl;
+    unit_test<ring_queue>();
+    cout << "  Bounded testing:" << endl;
+    test_bounded();
+    cout << "  Multithreaded test:" << endl;
+    test_multithreaded<ring_queue>();
+    cout << "  Bulk multithreaded test:" << endl;
+    test_bulk_multithreaded<ring_queue>();
+
+    cout << "\nSPSC Queue" << endl;
+    cout << "  Unit testing:" << endl;
+    unit_test<spsc_queue>();
+    cout << "  1:1 test:" << endl;
+    test_single_consumer<spsc_queue>(1);
+
+    cout << "\nMPSC Queue" << endl;
+    cout << "  Unit testing:" << endl;
+    unit_test<mpsc_queue>();
+    cout << "  1:1 test:" << endl;
+    test_single_consumer<mpsc_queue>(1);
+    cout << "  N:1 test:" << endl;
+    test_single_consumer<mpsc_queue>(max(nthreads() - 1, 2));
+    cout << "  Throwing bulk enqueue:" << endl;
+    test_bulk_throw<mpsc_queue>();
+
+    cout << "\nWork-stealing Deque" << endl;
+    test_ws_deque();
+
+    cout << "\nNUMA Queue (hazard pointers)" << endl;
+    cout << "  Simulated nodes:" << endl;
+    test_numa();
+    cout << "  Timed dequeue test:" << endl;
+    test_timed<hp_numa_queue>();
+    cout << "  Parked consumers test:" << endl;
+    test_parked<hp_numa_park_queue>();
 
   } else {
-    cout << "MPMC Queue Benchmark" << endl;
+    string layout = util::kPadCacheLines ? "padded" : "packed";
+    auto title = [&layout](const string& queue) {
+      return "MPMC Queue Benchmark, " + queue + " (" + layout +
+          " cache-line layout)";
+    };
 
 #ifdef HAVE_BOOST
     if (boost) {
-      cout << "\nBoost Queue" << endl;
-      bench_queue<boost_queue>();
+      util::bench::suite suite(title("Boost Queue"));
+      bench_queue<boost_queue>(suite);
     }
 #endif /* HAVE_BOOST */
 
-    cout << "\nShared Queue" << endl;
-    bench_queue<shared_queue>();
+    {
+      util::bench::suite suite(title("Shared Queue"));
+      bench_queue<sp_queue>(suite);
+      bench_bulk<sp_queue>(suite);
+      bench_scaling<sp_queue>(suite);
+      bench_instrumented<sp_sampled_queue>(suite);
+    }
+    {
+      util::bench::suite suite(title("Hazard Queue (hazard pointers)"));
+      bench_queue<hp_queue>(suite);
+      bench_bulk<hp_queue>(suite);
+      bench_scaling<hp_queue>(suite);
+      bench_instrumented<hp_sampled_queue>(suite);
+      bench_strings<hp_queue>(suite);
+    }
+    {
+      util::bench::suite suite(title("Hazard Queue (epochs)"));
+      bench_queue<epoch_queue>(suite);
+      bench_bulk<epoch_queue>(suite);
+      bench_scaling<epoch_queue>(suite);
+    }
+    {
+      util::bench::suite suite(
+          title("Hazard Queue (hazard pointers, parking)"));
+      bench_queue<hp_park_queue>(suite);
+      bench_scaling<hp_park_queue>(suite);
+    }
+    {
+      util::bench::suite suite(title("NUMA Queue (hazard pointers)"));
+      bench_queue<hp_numa_queue>(suite);
+      bench_scaling<hp_numa_queue>(suite);
+    }
+    {
+      util::bench::suite suite(title("Hazard Queue vs NUMA Queue, pinned"));
+      if (util::topology::system().nodes() == 1)
+        suite.log() << "    (one NUMA node: every run pins all threads to it)"
+                    << endl;
+      bench_numa<hp_queue>(suite, "hazard_queue");
+      bench_numa<hp_numa_queue>(suite, "numa_queue");
+    }
+    {
+      util::bench::suite suite(title("Ring Queue"));
+      bench_queue<bench_ring_queue>(suite);
+      bench_bulk<bench_ring_queue>(suite);
+      bench_scaling<bench_ring_queue>(suite);
+    }
 
-    cout << "\nHazard Queue" << endl;
-    bench_queue<hazard_queue>();
+    // Single-consumer configurations
+    {
+      util::bench::suite suite(title("SPSC Queue, single consumer"));
+      bench_single_consumer<spsc_queue>(suite, false);
+    }
+    {
+      util::bench::suite suite(title("MPSC Queue, single consumer"));
+      bench_single_consumer<mpsc_queue>(suite, true);
+    }
+    {
+      util::bench::suite suite(
+          title("Hazard Queue (hazard pointers), single consumer"));
+      bench_single_consumer<hp_queue>(suite, true);
+    }
+    {
+      util::bench::suite suite(title("Ring Queue, single consumer"));
+      bench_single_consumer<bench_ring_queue>(suite, true);
+    }
   }
   return 0;
 }
@@ -162,6 +424,46 @@ void unit_test() {
       << ("\n\t[t = " + as_string(t));
   UASSERT(t.empty());
   complete();
+  start("Bulk insert 0..9");
+  vector<int> batch(10);
+  iota(batch.begin(), batch.end(), 0);
+  t.enqueue_bulk(batch.data(), batch.data() + batch.size());
+  UASSERT(same(t, {0, 1, 2, 3, 4, 5, 6, 7, 8, 9}))
+      << ("\n\t[t = " + as_string(t));
+  complete();
+  start("Bulk remove 0..9");
+  int out[10];
+  UASSERT(t.try_dequeue_bulk(out, 0) == 0);
+  size_t got = t.try_dequeue_bulk(out, 4);
+  UASSERT(got > 0 && got <= 4) << "dequeued " << got;
+  // Bulk dequeues may return fewer than asked for, keep going until empty.
+  while (got < 10) {
+    auto n = t.try_dequeue_bulk(out + got, 10 - got);
+    UASSERT(n > 0) << "queue empty after " << got << " bulk dequeues";
+    got += n;
+  }
+  for (int i = 0; i < 10; ++i)
+    UASSERT(out[i] == i) << "queue not FIFO (bulk), " << out[i] << " at " << i;
+  UASSERT(t.try_dequeue_bulk(out, 10) == 0);
+  UASSERT(same(t, {})) << ("\n\t[t = " + as_string(t));
+  UASSERT(t.empty());
+  complete();
+  start("Mixed single/bulk");
+  t.enqueue(0);
+  t.enqueue_bulk(batch.data() + 1, batch.data() + 5);
+  t.enqueue(5);
+  UASSERT(same(t, {0, 1, 2, 3, 4, 5})) << ("\n\t[t = " + as_string(t));
+  UASSERT(t.dequeue() == 0);
+  got = 0;
+  while (got < 5) {
+    auto n = t.try_dequeue_bulk(out + got, 5 - got);
+    UASSERT(n > 0) << "queue empty after " << got << " bulk dequeues";
+    got += n;
+  }
+  for (int i = 0; i < 5; ++i)
+    UASSERT(out[i] == i + 1) << "queue not FIFO (mixed)";
+  UASSERT(t.empty());
+  complete();
   start("Non-empty delete (valgrind)");
   {
     T<int> t;
@@ -173,7 +475,638 @@ void unit_test() {
   complete("...........Success!");
 }
 
+void test_bounded() {
+  ring_queue<int> t(3);
+  start("Capacity rounds to power of 2");
+  UASSERT(t.capacity() == 4) << "capacity " << t.capacity();
+  UASSERT(t.empty() && !t.full());
+  complete();
+  start("try_enqueue fails when full");
+  for (int i = 0; i < 4; ++i)
+    UASSERT(t.try_enqueue(i)) << "could not enqueue " << i;
+  UASSERT(t.full());
+  UASSERT(!t.try_enqueue(4));
+  UASSERT(same(t, {0, 1, 2, 3})) << ("\n\t[t = " + as_string(t));
+  complete();
+  start("Wrap around after dequeue");
+  UASSERT(t.dequeue() == 0);
+  UASSERT(!t.full());
+  UASSERT(t.try_enqueue(4));
+  UASSERT(!t.try_enqueue(5));
+  UASSERT(same(t, {1, 2, 3, 4})) << ("\n\t[t = " + as_string(t));
+  for (int i = 1; i < 5; ++i)
+    UASSERT(t.dequeue() == i) << "queue not FIFO after wrap";
+  UASSERT(t.empty());
+  UASSERT(!t.try_dequeue().valid());
+  complete();
+  start("");
+  complete("...........Success!");
+}
+
+void test_ws_deque() {
+  ws_deque<int> d(2);
+  start("Owner pops LIFO, thieves steal FIFO");
+  UASSERT(d.empty());
+  UASSERT(!d.pop().valid() && !d.steal().valid());
+  for (int i = 0; i < 4; ++i) d.push(i);
+  UASSERT(d.size() == 4) << "size " << d.size();
+  UASSERT(d.steal().access() == 0);
+  UASSERT(d.pop().access() == 3);
+  UASSERT(d.steal().access() == 1);
+  UASSERT(d.pop().access() == 2);
+  UASSERT(d.empty() && !d.pop().valid());
+  complete();
+  start("Grows past initial capacity");
+  for (int i = 0; i < 1000; ++i) d.push(i);
+  for (int i = 999; i >= 0; --i)
+    UASSERT(d.pop().access() == i) << "lost " << i << " across growth";
+  complete();
+  static const int kItems = 200000;
+  static const int kThieves = max(nthreads() - 1, 2);
+  start("Each item taken once under stealing");
+  vector<atomic<int> > taken(kItems);
+  for (auto& t : taken) t.store(0);
+  atomic<bool> done(false);
+  vector<future<void> > thieves;
+  for (int i = 0; i < kThieves; ++i)
+    thieves.push_back(async(launch::async, [&]() {
+          while (true) {
+            auto opt = d.steal();
+            if (opt.valid()) taken[opt.access()].fetch_add(1);
+            else if (done.load()) break;
+          }
+        }));
+  // The owner alternates bursts of pushes with pops, so it races the
+  // thieves for the last item regularly.
+  for (int i = 0; i < kItems; ) {
+    for (int j = 0; j < 64 && i < kItems; ++j) d.push(i++);
+    for (int j = 0; j < 16; ++j) {
+      auto opt = d.pop();
+      if (opt.valid()) taken[opt.access()].fetch_add(1);
+    }
+  }
+  while (true) {
+    auto opt = d.pop();
+    if (!opt.valid()) break;
+    taken[opt.access()].fetch_add(1);
+  }
+  done.store(true);
+  for (auto& fut : thieves) fut.get();
+  for (int i = 0; i < kItems; ++i)
+    UASSERT(taken[i].load() == 1) << "item " << i << " taken " << taken[i];
+  UASSERT(d.empty());
+  complete();
+  start("");
+  complete("...........Success!");
+}
+
+// nenq producers, one consumer: every producer's items must come out in
+// the order it enqueued them, half of them through the bulk methods.
+template<template<typename> class T>
+void test_single_consumer(int nenq) {
+  static const int kPerEnqueuer = 100000, kBatch = 37;
+  T<pair<int, int> > t;
+  start("Per-producer FIFO, " + to_string(nenq) + " producer(s)");
+  vector<future<void> > futs;
+  for (int p = 0; p < nenq; ++p)
+    futs.push_back(async(launch::async, [&t, p]() {
+          vector<pair<int, int> > batch;
+          for (int i = 0; i < kPerEnqueuer; ) {
+            if ((i / kBatch) % 2) {
+              t.enqueue(make_pair(p, i++));
+              continue;
+            }
+            batch.clear();
+            for (int j = 0; j < kBatch && i < kPerEnqueuer; ++j)
+              batch.push_back(make_pair(p, i++));
+            t.enqueue_bulk(batch.data(), batch.data() + batch.size());
+          }
+        }));
+  vector<int> next(nenq, 0);
+  vector<pair<int, int> > out(kBatch);
+  for (int got = 0; got < nenq * kPerEnqueuer; ) {
+    size_t n = 1;
+    if (got % 2) out[0] = t.dequeue();
+    else n = t.try_dequeue_bulk(out.data(), out.size());
+    for (size_t i = 0; i < n; ++i) {
+      auto p = out[i].first;
+      UASSERT(out[i].second == next[p])
+          << "producer " << p << " item " << out[i].second
+          << " out of order, expected " << next[p];
+      ++next[p];
+    }
+    got += n;
+  }
+  for (auto& fut : futs) fut.get();
+  UASSERT(t.empty());
+  UASSERT(!t.try_dequeue().valid());
+  complete();
+  start("");
+  complete("...........Success!");
+}
+
+template<template<typename> class T>
+void test_timed() {
+  T<int> t;
+  start("Times out when empty");
+  auto before = chrono::steady_clock::now();
+  auto opt = t.dequeue_for(chrono::milliseconds(20));
+  auto waited = chrono::steady_clock::now() - before;
+  UASSERT(!opt.valid());
+  UASSERT(waited >= chrono::milliseconds(20))
+      << "returned after "
+      << chrono::duration_cast<chrono::microseconds>(waited).count() << "us";
+  complete();
+  start("Returns immediately if non-empty");
+  t.enqueue(1);
+  opt = t.dequeue_for(chrono::seconds(0));
+  UASSERT(opt.valid() && opt.access() == 1);
+  complete();
+  start("Woken by a later enqueue");
+  auto producer = async(launch::async, [&]() {
+      this_thread::sleep_for(chrono::milliseconds(20));
+      t.enqueue(2);
+    });
+  opt = t.dequeue_for(chrono::seconds(30));
+  UASSERT(opt.valid() && opt.access() == 2);
+  producer.get();
+  UASSERT(t.empty());
+  complete();
+  start("");
+  complete("...........Success!");
+}
+
+// Consumers that are (most likely) asleep by the time items show up must
+// all be woken, one round at a time, without lost wake-ups.
+template<template<typename> class T>
+void test_parked() {
+  static const int kConsumers = 4, kRounds = 200;
+  T<int> t;
+  atomic<int> received(0);
+  start("Sleeping consumers drain every round");
+  vector<future<void> > futs;
+  for (int i = 0; i < kConsumers; ++i)
+    futs.push_back(async(launch::async, [&]() {
+          for (int j = 0; j < kRounds; ++j) {
+            t.dequeue();
+            received.fetch_add(1, std::memory_order_relaxed);
+          }
+        }));
+  for (int j = 0; j < kRounds; ++j) {
+    if (j % 50 == 0) this_thread::sleep_for(chrono::milliseconds(5));
+    for (int i = 0; i < kConsumers; ++i) t.enqueue(i);
+  }
+  for (auto& fut : futs) fut.get();
+  UASSERT(received.load() == kConsumers * kRounds);
+  UASSERT(t.empty());
+  complete();
+
+  // Single enqueues wake one consumer each, so a lost wake-up would leave
+  // an item behind a parked consumer.
+  start("Single enqueues wake parked consumers");
+  static const int kSingles = 10;
+  received = 0;
+  futs.clear();
+  for (int i = 0; i < kConsumers; ++i)
+    futs.push_back(async(launch::async, [&]() {
+          for (int j = 0; j < kSingles; ++j) {
+            t.dequeue();
+            received.fetch_add(1, std::memory_order_relaxed);
+          }
+        }));
+  for (int j = 0; j < kConsumers * kSingles; ++j) {
+    this_thread::sleep_for(chrono::milliseconds(1));
+    t.enqueue(j);
+  }
+  for (auto& fut : futs) fut.get();
+  UASSERT(received.load() == kConsumers * kSingles);
+  complete();
+
+  start("Bulk enqueues wake every parked consumer");
+  futs.clear();
+  for (int i = 0; i < kConsumers; ++i)
+    futs.push_back(async(launch::async, [&]() { t.dequeue(); }));
+  this_thread::sleep_for(chrono::milliseconds(5));
+  vector<int> batch(kConsumers, 0);
+  t.enqueue_bulk(batch.data(), batch.data() + batch.size());
+  for (auto& fut : futs) fut.get();
+  UASSERT(t.empty());
+  complete();
+  start("");
+  complete("...........Success!");
+}
+
+void test_histogram() {
+  start("Bins are ordered and within 12.5%");
+  int last = -1;
+  for (uint64_t v = 0; v < (uint64_t(1) << 20); v = v < 64 ? v + 1 : v * 9 / 8) {
+    int bin = stats::bin_of(v);
+    UASSERT(bin >= last && bin < stats::kBins) << v << " in bin " << bin;
+    UASSERT(v < stats::bin_end(bin)) << v << " past bin " << bin;
+    UASSERT(bin == 0 || stats::bin_end(bin - 1) <= v)
+        << v << " before bin " << bin;
+    UASSERT(stats::bin_end(bin) - 1 <= v + v / 8) << v << " in bin " << bin;
+    last = bin;
+  }
+  UASSERT(stats::bin_of(UINT64_MAX) == stats::kBins - 1);
+  complete();
+  start("Quantiles");
+  uint64_t bins[stats::kBins] = {};
+  UASSERT(stats::quantile(bins, 0.5) == 0);
+  for (int i = 1; i <= 100; ++i) ++bins[stats::bin_of(i * 1000)];
+  UASSERT(stats::samples(bins) == 100);
+  auto p50 = stats::quantile(bins, 0.5), p99 = stats::quantile(bins, 0.99);
+  UASSERT(50000 < p50 && p50 <= 50000 + 50000 / 8) << "p50 " << p50;
+  UASSERT(99000 < p99 && p99 <= 99000 + 99000 / 8) << "p99 " << p99;
+  complete();
+  start("");
+  complete("...........Success!");
+}
+
+// Every item counted once, latency sampled, and with hazards, retired
+// nodes scanned; then the same under contention.
+template<template<typename> class T>
+void test_instrumented(bool hazards) {
+  static const int kItems = 64 * 100, kThreads = 4, kBatch = 10;
+  T<int> t;
+  start("Single-threaded counts");
+  for (int i = 0; i < kItems / 2; ++i) t.enqueue(i);
+  vector<int> batch(kBatch);
+  for (int i = kItems / 2; i < kItems; i += kBatch)
+    t.enqueue_bulk(batch.data(), batch.data() + kBatch);
+  for (int i = 0; i < kItems / 2; ++i) t.dequeue();
+  int out[kBatch];
+  for (int got = kItems / 2; got < kItems; )
+    got += t.try_dequeue_bulk(out, kBatch);
+  auto s = t.get_stats();
+  UASSERT(s.enqueues == kItems && s.dequeues == kItems)
+      << s.enqueues << " enqueues, " << s.dequeues << " dequeues";
+  // Weak CASes may still fail spuriously, so retries needn't be 0.
+  UASSERT(s.reacquires == 0) << s;
+  UASSERT(stats::samples(s.latency_ns) == kItems / 64) << s;
+  if (hazards) UASSERT(s.scans > 0 && s.reclaimed > 0) << s;
+  else UASSERT(s.scans == 0) << s;
+  complete();
+  start("Reset");
+  t.reset_stats();
+  s = t.get_stats();
+  UASSERT(s.enqueues == 0 && s.dequeues == 0 && s.scans == 0 &&
+          stats::samples(s.latency_ns) == 0) << s;
+  complete();
+  start("Concurrent counts");
+  vector<future<void> > futs;
+  for (int i = 0; i < 2 * kThreads; ++i)
+    futs.push_back(async(launch::async, [&t, i]() {
+          for (int j = 0; j < kItems; ++j) {
+            if (i % 2) t.enqueue(j);
+            else t.dequeue();
+          }
+        }));
+  for (auto& fut : futs) fut.get();
+  s = t.get_stats();
+  UASSERT(s.enqueues == kThreads * kItems && s.dequeues == kThreads * kItems)
+      << s;
+  UASSERT(stats::samples(s.latency_ns) == kThreads * kItems / 64) << s;
+  UASSERT(t.empty());
+  complete();
+  start("");
+  complete("...........Success!");
+}
+
 // reads in [.., .., .., ..] format
+// Counts its constructions, copies, moves and destructions.
+struct tracked {
+  static atomic<int> live, copies, moves;
+  static void reset() { live = copies = moves = 0; }
+
+  tracked() : val(-1) { ++live; }
+  tracked(int a, int b) : val(a + b) { ++live; }
+  tracked(const tracked& other) : val(other.val) { ++live; ++copies; }
+  tracked(tracked&& other) : val(other.val) { ++live; ++moves; }
+  tracked& operator=(const tracked& other) {
+    val = other.val;
+    ++copies;
+    return *this;
+  }
+  tracked& operator=(tracked&& other) {
+    val = other.val;
+    ++moves;
+    return *this;
+  }
+  ~tracked() { --live; }
+  int val;
+};
+atomic<int> tracked::live(0), tracked::copies(0), tracked::moves(0);
+
+template<template<typename> class T>
+void test_in_place() {
+  start("Emplaced items are built in their nodes");
+  tracked::reset();
+  {
+    T<tracked> t;
+    for (int i = 0; i < 10; ++i) t.enqueue(i, 1);
+    UASSERT(tracked::live == 10) << tracked::live;
+    UASSERT(tracked::moves == 0 && tracked::copies == 0)
+        << tracked::moves << " moves, " << tracked::copies << " copies";
+  }
+  UASSERT(tracked::live == 0) << "leaked " << tracked::live;
+  complete();
+
+  start("Dequeues move into the caller's T");
+  tracked::reset();
+  {
+    T<tracked> t;
+    tracked out;
+    UASSERT(!t.try_dequeue(out));
+    UASSERT(out.val == -1) << "changed by a failed try_dequeue()";
+    for (int i = 0; i < 10; ++i) t.enqueue(i, 0);
+    for (int i = 0; i < 10; i += 2) {
+      UASSERT(t.try_dequeue(out) && out.val == i) << out.val;
+      t.dequeue(out);
+      UASSERT(out.val == i + 1) << out.val;
+    }
+    UASSERT(tracked::moves == 10 && tracked::copies == 0)
+        << tracked::moves << " moves, " << tracked::copies << " copies";
+    // Only 'out', the values left the nodes with them.
+    UASSERT(tracked::live == 1) << tracked::live;
+    UASSERT(t.empty());
+  }
+  UASSERT(tracked::live == 0) << "leaked " << tracked::live;
+  complete();
+
+  start("Move-only items");
+  {
+    T<unique_ptr<string> > t;
+    t.enqueue(new string("in place"));
+    t.enqueue(unique_ptr<string>(new string("moved")));
+    unique_ptr<string> out;
+    UASSERT(t.try_dequeue(out) && *out == "in place");
+    UASSERT(*t.dequeue() == "moved");
+  }
+  complete();
+
+  start("Each item dequeued once, by reference");
+  {
+    static const int kThreads = 4, kPerThread = 20000;
+    T<string> t;
+    vector<atomic<int> > seen(kThreads * kPerThread);
+    for (auto& x : seen) x = 0;
+    vector<future<void> > futs;
+    for (int i = 0; i < 2 * kThreads; ++i)
+      futs.push_back(async(launch::async, [&, i]() {
+            if (i < kThreads) {
+              // Long enough to live on the heap.
+              for (int j = i * kPerThread; j < (i + 1) * kPerThread; ++j)
+                t.enqueue(to_string(j) + string(32, '.'));
+              return;
+            }
+            string out;
+            for (int j = 0; j < kPerThread; ++j) {
+              if (j % 2) t.dequeue(out);
+              else while (!t.try_dequeue(out)) this_thread::yield();
+              seen[stoi(out)]++;
+            }
+          }));
+    for (auto& f : futs) f.get();
+    for (size_t j = 0; j < seen.size(); ++j)
+      UASSERT(seen[j] == 1) << j << " dequeued " << seen[j] << " times";
+    UASSERT(t.empty());
+  }
+  complete();
+  start("");
+  complete("...........Success!");
+}
+
+template<template<typename> class T>
+void test_exactly_once() {
+  start("Dequeued values are destroyed");
+  tracked::reset();
+  {
+    T<tracked> t;
+    // Through the head == tail path...
+    t.enqueue(tracked(1, 0));
+    UASSERT(t.try_dequeue().access().val == 1);
+    // ...and through the head CAS path.
+    for (int i = 0; i < 10; ++i) t.enqueue(tracked(i, 0));
+    for (int i = 0; i < 5; ++i) UASSERT(t.dequeue().val == i);
+    tracked out[3];
+    UASSERT(t.try_dequeue_bulk(out, 3) == 3 && out[2].val == 7)
+        << out[2].val;
+    // Only 'out', and the two values still queued.
+    UASSERT(tracked::live == 5) << tracked::live;
+  }
+  // shared_queue's atomic pointers drop their references to the nodes
+  // only once the epoch advances.
+  for (int i = 0; i < 3; ++i) synchro::epoch_domain::collect();
+  UASSERT(tracked::live == 0) << "leaked " << tracked::live;
+  complete();
+
+  start("Each item dequeued once");
+  {
+    static const int kThreads = 4, kPerThread = 20000, kBatch = 3;
+    T<string> t;
+    vector<atomic<int> > seen(kThreads * kPerThread);
+    for (auto& x : seen) x = 0;
+    atomic<int> left(kThreads * kPerThread);
+    vector<future<void> > futs;
+    for (int i = 0; i < 2 * kThreads; ++i)
+      futs.push_back(async(launch::async, [&, i]() {
+            if (i < kThreads) {
+              // Long enough to live on the heap.
+              for (int j = i * kPerThread; j < (i + 1) * kPerThread; ++j)
+                t.enqueue(to_string(j) + string(32, '.'));
+              return;
+            }
+            // Single and bulk dequeues race each other on a queue that is
+            // mostly one item long, so its head == tail paths are hit.
+            string out[kBatch];
+            for (int j = 0; left > 0; ++j) {
+              size_t n = 0;
+              if (j % 2) {
+                auto opt = t.try_dequeue();
+                if (opt.valid()) out[n++] = move(opt.access());
+              } else {
+                n = t.try_dequeue_bulk(out, kBatch);
+              }
+              if (!n) this_thread::yield();
+              left -= n;
+              for (size_t k = 0; k < n; ++k) seen[stoi(out[k])]++;
+            }
+          }));
+    for (auto& f : futs) f.get();
+    for (size_t j = 0; j < seen.size(); ++j)
+      UASSERT(seen[j] == 1) << j << " dequeued " << seen[j] << " times";
+    UASSERT(t.empty());
+  }
+  complete();
+  start("");
+  complete("...........Success!");
+}
+
+// Throws from its move constructor once 'moves_left' runs out.
+struct fragile : tracked {
+  static int moves_left;
+  explicit fragile(int val) : tracked(val, 0) {}
+  fragile(fragile&& other) : tracked(move(other)) {
+    if (--moves_left < 0) throw runtime_error("fragile");
+  }
+  fragile& operator=(fragile&& other) = default;
+};
+int fragile::moves_left = 0;
+
+template<template<typename> class T>
+void test_bulk_throw() {
+  start("Partial chain is freed");
+  tracked::reset();
+  {
+    T<fragile> t;
+    vector<fragile> items;
+    items.reserve(10);
+    for (int i = 0; i < 10; ++i) items.emplace_back(i);
+    fragile::moves_left = 4;
+    bool threw = false;
+    try {
+      t.enqueue_bulk(items.data(), items.data() + items.size());
+    } catch (const runtime_error&) {
+      threw = true;
+    }
+    UASSERT(threw);
+    UASSERT(t.empty());
+    // Only the moved-from items left in 'items'.
+    UASSERT(tracked::live == 10) << tracked::live;
+  }
+  UASSERT(tracked::live == 0) << "leaked " << tracked::live;
+  complete();
+  start("");
+  complete("...........Success!");
+}
+
+// Cpus the process may run on, for topologies that pretend they're on
+// different nodes.
+vector<int> allowed_cpus() {
+  cpu_set_t set;
+  vector<int> cpus;
+  if (sched_getaffinity(0, sizeof(set), &set) == 0)
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+      if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+  if (cpus.empty()) cpus.push_back(0);
+  return cpus;
+}
+
+// Real multi-node machines are rare in testing, so these run on simulated
+// nodes that share every cpu, telling threads apart by what they were
+// pinned to.
+void test_numa() {
+  auto cpus = allowed_cpus();
+  util::topology two({cpus, cpus});
+
+  start("Local items first, then stolen ones");
+  {
+    numa_queue<int> t(two);
+    UASSERT(t.nodes() == 2);
+    UASSERT(t.empty());
+    for (int i = 0; i < 5; ++i) {
+      t.enqueue_on(0, i);
+      t.enqueue_on(1, 100 + i);
+    }
+    UASSERT(!t.empty());
+    for (int i = 0; i < 5; ++i) {
+      auto opt = t.try_dequeue_from(1);
+      UASSERT(opt.valid() && opt.access() == 100 + i) << "local item " << i;
+    }
+    // Node 1 is empty now, so it steals node 0's in order.
+    for (int i = 0; i < 5; ++i) {
+      auto opt = t.try_dequeue_from(1);
+      UASSERT(opt.valid() && opt.access() == i) << "stolen item " << i;
+    }
+    UASSERT(!t.try_dequeue_from(0).valid());
+    UASSERT(t.empty());
+  }
+  complete();
+
+  start("Steals from the nearest node first");
+  {
+    util::topology three({cpus, cpus, cpus},
+                         {{10, 30, 20}, {30, 10, 20}, {20, 20, 10}});
+    UASSERT(three.remote_order(0) == vector<int>({2, 1}));
+    UASSERT(three.remote_order(2) == vector<int>({0, 1}));
+    numa_queue<int> t(three);
+    t.enqueue_on(1, 1);
+    t.enqueue_on(2, 2);
+    UASSERT(t.try_dequeue_from(0).access() == 2);
+    UASSERT(t.try_dequeue_from(0).access() == 1);
+  }
+  complete();
+
+  start("Pinned threads use their node");
+  {
+    numa_queue<int> t(two);
+    async(launch::async, [&]() {
+        util::pin_to_node(two, 1);
+        UASSERT(util::current_node(two) == 1);
+        t.enqueue(7);
+        vector<int> batch = {8, 9};
+        t.enqueue_bulk(batch.data(), batch.data() + batch.size());
+      }).get();
+    // Stolen by node 0, in order.
+    UASSERT(t.try_dequeue_from(0).access() == 7);
+    int out[3];
+    size_t got = 0;
+    while (size_t n = t.try_dequeue_bulk(out + got, 3 - got)) got += n;
+    UASSERT(got == 2) << "bulk steal took " << got;
+    UASSERT(out[0] == 8 && out[1] == 9);
+    UASSERT(t.empty());
+  }
+  complete();
+
+  start("Producers and consumers on both nodes");
+  {
+    static const int kThreads = 4, kPerProducer = 50000;
+    numa_queue<pair<int, int> > t(two);
+    atomic<int> remaining(kThreads * kPerProducer);
+    // Each consumer checks that every producer's items reach it in order:
+    // a producer stays on its node, and every node's queue is FIFO.
+    vector<future<vector<int> > > futs;
+    for (int i = 0; i < 2 * kThreads; ++i)
+      futs.push_back(async(launch::async, [&, i]() {
+            util::pin_to_node(two, i % 2);
+            vector<int> seen(kThreads, 0);
+            if (i < kThreads) {
+              for (int j = 0; j < kPerProducer; ++j)
+                t.enqueue(make_pair(i, j));
+              return seen;
+            }
+            vector<int> last(kThreads, -1);
+            while (remaining.load(memory_order_relaxed) > 0) {
+              auto opt = t.try_dequeue();
+              if (!opt.valid()) {
+                this_thread::yield();
+                continue;
+              }
+              remaining.fetch_sub(1, memory_order_relaxed);
+              int p = opt.access().first, j = opt.access().second;
+              UASSERT(j > last[p]) << "producer " << p << " item " << j
+                                   << " after " << last[p];
+              last[p] = j;
+              ++seen[p];
+            }
+            return seen;
+          }));
+    vector<int> total(kThreads, 0);
+    for (auto& fut : futs) {
+      auto seen = fut.get();
+      for (int p = 0; p < kThreads; ++p) total[p] += seen[p];
+    }
+    for (int p = 0; p < kThreads; ++p)
+      UASSERT(total[p] == kPerProducer) << "producer " << p << ": "
+                                        << total[p];
+    UASSERT(t.empty());
+  }
+  complete();
+  start("");
+  complete("...........Success!");
+}
+
 vector<int> read_strvec(string s) {
   replace(s.begin(), s.end(), ',', ' ');
   s.pop_back();
@@ -414,161 +1347,343 @@ void test_multithreaded() {
   complete("...........Success!");
 }
 
-// returns 8 by default.
-int nthreads() {
-  int viastd = thread::hardware_concurrency();
-  if (!viastd) viastd = 8;
-  return viastd;
-}
-
-
-template<template<typename> class T>
-void bench_mpmc(int nitmes, int nenq, int ndeq);
-
 template<template<typename> class T>
-void bench_queue() {
-  // Basically, repeat the multithreaded test but without
-  // correctness.
-
-  static const int kNumEnqueuers = nthreads();
-  static const int kItemsPerEnqueuer = 100000;
-  cout << "  Enqueues (" << kNumEnqueuers << "x"
-       << kItemsPerEnqueuer << "): ";
-  cout.flush();
+void test_bulk_multithreaded() {
+  static const int kNumEnqueuers = 4;
+  static const int kNumDequeuers = 4;
+  static const int kItemsPerEnqueuer = 2000;
+  static const int kBatch = 64;
+  static const int kMaxDequeue = 50;
+  static const int kTotal = kNumEnqueuers * kItemsPerEnqueuer;
+  cout << "  Testing bulk enqueues (batch " << kBatch << ") and bulk "
+       << "dequeues (max " << kMaxDequeue << "),\n"
+       << "    " << kNumEnqueuers << " enqueuers x " << kItemsPerEnqueuer
+       << " items, " << kNumDequeuers << " dequeuers" << endl;
+  start("Bulk enqueue/dequeue");
 
-  atomic<int> cdl(kNumEnqueuers + 1); // todo replace with a countdown latch
   T<int> testq;
-  UASSERT(testq.empty());
-  vector<future<void> > futs;
+  atomic<int> cdl(kNumEnqueuers + kNumDequeuers);
+  atomic<int> remaining(kTotal);
 
+  vector<future<void> > efuts;
   for (int i = 0; i < kNumEnqueuers; ++i)
-    futs.push_back(async(launch::async, [&](int idx) {
+    efuts.push_back(async(launch::async, [&](int idx) {
           --cdl;
           while (cdl.load())
             this_thread::sleep_for(chrono::milliseconds(5));
+
           int start, end;
           tie(start, end) = interval(idx, kItemsPerEnqueuer);
-          for (int i = start; i < end; ++i)
-            testq.enqueue(i);
+          vector<int> batch;
+          for (int j = start; j < end; j += kBatch) {
+            batch.resize(min(kBatch, end - j));
+            iota(batch.begin(), batch.end(), j);
+            testq.enqueue_bulk(batch.data(), batch.data() + batch.size());
+          }
         }, i));
 
-  TIME_BLOCK(chrono::milliseconds, "") {
-    --cdl;
-    for (auto& fut : futs)
-      fut.get();
-  }
-
-  static const int kNumDequeuers = kNumEnqueuers;
-  static const int kItemsPerDequeuer = kItemsPerEnqueuer;
-  cout << "  Dequeues (" << kNumEnqueuers << "x"
-       << kItemsPerEnqueuer << "): ";
-  cout.flush();
-
-  vector<future<void> > dfuts;
-  cdl.store(kNumDequeuers + 1);
+  vector<future<vector<int> > > dfuts;
   for (int i = 0; i < kNumDequeuers; ++i)
     dfuts.push_back(async(launch::async, [&]() {
           --cdl;
           while (cdl.load())
             this_thread::sleep_for(chrono::milliseconds(5));
 
-          for (int j = 0; j < kItemsPerDequeuer; ++j)
-            testq.dequeue();
+          int latest[kNumEnqueuers];
+          fill(latest, latest + kNumEnqueuers, -1);
+          vector<int> seen;
+          int out[kMaxDequeue];
+          while (remaining.load(std::memory_order_relaxed) > 0) {
+            auto n = testq.try_dequeue_bulk(out, kMaxDequeue);
+            if (!n) {
+              this_thread::yield();
+              continue;
+            }
+            remaining.fetch_sub(n, std::memory_order_relaxed);
+            for (size_t j = 0; j < n; ++j) {
+              int val = out[j];
+              int enqueuer = val / kItemsPerEnqueuer;
+              UASSERT(val >= 0 && enqueuer < kNumEnqueuers) << "Value " << val
+                  << " could not have been enqueued";
+              UASSERT(latest[enqueuer] < val) << "Expected fifo order, saw "
+                  << latest[enqueuer] << " before " << val;
+              latest[enqueuer] = val;
+              seen.push_back(val);
+            }
+          }
+          return seen;
         }));
 
-  TIME_BLOCK(chrono::milliseconds, "") {
-    cdl--;
-    for (auto& fut : dfuts)
-      fut.get();
+  for (auto& fut : efuts)
+    fut.get();
+  vector<int> all;
+  for (auto& fut : dfuts) {
+    auto seen = fut.get();
+    all.insert(all.end(), seen.begin(), seen.end());
   }
-
+  sort(all.begin(), all.end());
+  UASSERT(all.size() == static_cast<size_t>(kTotal))
+      << "dequeued " << all.size() << " of " << kTotal;
+  for (int i = 0; i < kTotal; ++i)
+    UASSERT(all[i] == i) << "missing or duplicate value near " << i;
   UASSERT(testq.empty());
+  complete("...complete");
 
-  static const int kItems = 1000000;
+  start("");
+  complete("...........Success!");
+}
+
+// returns 8 by default, and at least 2 (the mixed benchmarks need at least
+// one enqueuer and one dequeuer).
+int nthreads() {
+  int viastd = thread::hardware_concurrency();
+  if (!viastd) viastd = 8;
+  return max(viastd, 2);
+}
+
+
+template<template<typename> class T>
+void bench_mpmc(bench::suite& suite, const string& name, int nitems,
+                int nenq, int ndeq);
+
+template<template<typename> class T>
+void bench_queue(bench::suite& suite) {
+  // Basically, repeat the multithreaded test but without
+  // correctness.
+
+  static const int kNumEnqueuers = nthreads();
+  static const int kItemsPerEnqueuer = kBenchItemsPerEnqueuer;
+  static const int kItems = kNumEnqueuers * kItemsPerEnqueuer;
+  auto enqueue_all = [](T<int>& testq) {
+    return bench::time_threads(kNumEnqueuers, [&testq](int idx) {
+        int start, end;
+        tie(start, end) = interval(idx, kItemsPerEnqueuer);
+        for (int i = start; i < end; ++i)
+          testq.enqueue(i);
+      });
+  };
+  string config = to_string(kNumEnqueuers) + "x" +
+      to_string(kItemsPerEnqueuer);
+
+  suite.run_manual("Enqueues (" + config + ")", [&]() {
+      T<int> testq;
+      UASSERT(testq.empty());
+      return enqueue_all(testq);
+    }, kItems);
+
+  static const int kNumDequeuers = kNumEnqueuers;
+  static const int kItemsPerDequeuer = kItemsPerEnqueuer;
+  suite.run_manual("Dequeues (" + config + ")", [&]() {
+      T<int> testq;
+      enqueue_all(testq);
+      auto time = bench::time_threads(kNumDequeuers, [&testq](int) {
+          for (int j = 0; j < kItemsPerDequeuer; ++j)
+            testq.dequeue();
+        });
+      UASSERT(testq.empty());
+      return time;
+    }, kItems);
+
+  static const int kMixedItems = 1000000;
 
   static const int kEqualWeightEnqueuers = nthreads() / 2;
   static const int kEqualWeightDequeuers = kEqualWeightEnqueuers;
 
-  cout << "  Fair mpmc (~" << kItems << " items, "
-       << kEqualWeightEnqueuers << " enq, "
-       << kEqualWeightDequeuers << " deq): ";
-  cout.flush();
-
-  bench_mpmc<T>(kItems, kEqualWeightEnqueuers, kEqualWeightDequeuers);
+  bench_mpmc<T>(suite, "Fair mpmc", kMixedItems, kEqualWeightEnqueuers,
+                kEqualWeightDequeuers);
 
   static const int kEWDequeuers =
       (nthreads() / 3 == 0) ? 1 : nthreads() / 3;
   static const int kEWEnqueuers =
       nthreads() - kEWDequeuers;
 
-  cout << "  Enqueue-weighted mpmc (~" << kItems << " items, "
-       << kEWEnqueuers << " enq, " << kEWDequeuers << " deq): ";
-  cout.flush();
-
-  bench_mpmc<T>(kItems, kEWEnqueuers, kEWDequeuers);
+  bench_mpmc<T>(suite, "Enqueue-weighted mpmc", kMixedItems, kEWEnqueuers,
+                kEWDequeuers);
 
   static const int kDWEnqueuers =
       (nthreads() / 3 == 0) ? 1 : nthreads() / 3;
   static const int kDWDequeuers =
       nthreads() - kDWEnqueuers;
 
-  cout << "  Dequeue-weighted mpmc (~" << kItems << " items, "
-       << kDWEnqueuers << " enq, " << kDWDequeuers << " deq): ";
-  cout.flush();
-
-  bench_mpmc<T>(kItems, kDWEnqueuers, kDWDequeuers);
+  bench_mpmc<T>(suite, "Dequeue-weighted mpmc", kMixedItems, kDWEnqueuers,
+                kDWDequeuers);
 }
 
-template<template<typename> class T>
-void bench_mpmc(int nitems, int nenq, int ndeq) {
-  T<int> testq;
+// Names a mixed run "name (nenq enq, ndeq deq)".
+string mixed_name(const string& name, int nenq, int ndeq) {
+  return name + " (" + to_string(nenq) + " enq, " + to_string(ndeq) +
+      " deq)";
+}
 
-  atomic<int> cdl;
-  cdl.store(nenq + ndeq + 1);
+// nenq threads enqueue nitems between them while ndeq threads dequeue
+// them, on an empty queue.
+// on_start, if given, runs first on each thread, with its index (timed,
+// but once per thread).
+template<typename Q>
+bench::clock::duration run_mpmc(Q& testq, int nitems, int nenq, int ndeq,
+                                const function<void(int)>& on_start = {}) {
+  const int kPerEnqueuer = nitems / nenq;
+  atomic<int> unfinished_enqueuers(nenq);
+  return bench::time_threads(nenq + ndeq, [&](int idx) {
+      if (on_start) on_start(idx);
+      if (idx >= nenq) {
+        while (unfinished_enqueuers.load(std::memory_order_relaxed))
+          testq.dequeue();
+        return;
+      }
+      int start, end;
+      tie(start, end) = interval(idx, kPerEnqueuer);
+      for (int j = start; j < end; ++j)
+        testq.enqueue(j);
+      int last =
+          unfinished_enqueuers.fetch_sub(1, std::memory_order_relaxed);
+
+      if (last == 1) {
+        // Extra items needed so dequeuers don't block on dequeue()
+        // after last enqueue() (may divide unevenly)
+        for (int j = 0; j < ndeq; ++j)
+          testq.enqueue(j);
+      }
+    });
+}
 
-  atomic<int> unfinished_enqueuers;
-  unfinished_enqueuers.store(nenq, std::memory_order_relaxed);
+template<template<typename> class T>
+void bench_mpmc(bench::suite& suite, const string& name, int nitems,
+                int nenq, int ndeq) {
+  suite.run_manual(mixed_name(name, nenq, ndeq), [&]() {
+      T<int> testq;
+      return run_mpmc(testq, nitems, nenq, ndeq);
+    }, nitems / nenq * nenq);
+}
 
-  vector<future<void> > efuts;
+template<template<typename> class T>
+void bench_bulk_mpmc(bench::suite& suite, int nitems, int batch, int nenq,
+                     int ndeq) {
   const int kPerEnqueuer = nitems / nenq;
-  for (int i = 0; i < nenq; ++i)
-    efuts.push_back(async(launch::async, [&](int idx) {
-          --cdl;
-          while (cdl.load())
-            this_thread::sleep_for(chrono::milliseconds(5));
-
+  auto name = mixed_name("Bulk mpmc, batch " + to_string(batch), nenq, ndeq);
+  suite.run_manual(name, [&]() {
+      T<int> testq;
+      atomic<int> remaining(kPerEnqueuer * nenq);
+      return bench::time_threads(nenq + ndeq, [&](int idx) {
+          vector<int> items(batch);
+          if (idx >= nenq) {
+            while (remaining.load(std::memory_order_relaxed) > 0) {
+              auto n = testq.try_dequeue_bulk(items.data(), batch);
+              if (n) remaining.fetch_sub(n, std::memory_order_relaxed);
+              else std::this_thread::yield();
+            }
+            return;
+          }
           int start, end;
           tie(start, end) = interval(idx, kPerEnqueuer);
-          for (int j = start; j < end; ++j)
-            testq.enqueue(j);
-          int last =
-              unfinished_enqueuers.fetch_sub(1, std::memory_order_relaxed);
-
-          if (last == 1) {
-            // Extra items needed so dequeuers don't block on dequeue()
-            // after last enqueue() (may divide unevenly)
-            for (int j = 0; j < ndeq; ++j)
-              testq.enqueue(j);
+          for (int j = start; j < end; j += batch) {
+            auto n = min(batch, end - j);
+            iota(items.begin(), items.begin() + n, j);
+            testq.enqueue_bulk(items.data(), items.data() + n);
           }
-        }, i));
+        });
+    }, kPerEnqueuer * nenq);
+}
 
-  vector<future<void> > dfuts;
-  for (int i = 0; i < ndeq; ++i)
-    dfuts.push_back(async(launch::async, [&]() {
-          --cdl;
-          while (cdl.load())
-            this_thread::sleep_for(chrono::milliseconds(5));
+template<template<typename> class T>
+void bench_bulk(bench::suite& suite) {
+  static const int kItems = 1000000;
+  static const int kEnqueuers = nthreads() / 2;
+  static const int kDequeuers = nthreads() - kEnqueuers;
+  for (int batch : {1, 64, 512})
+    bench_bulk_mpmc<T>(suite, kItems, batch, kEnqueuers, kDequeuers);
+}
 
-          while (unfinished_enqueuers.load(std::memory_order_relaxed))
-            testq.dequeue();
-        }));
+// Fair mpmc at increasing thread counts, to compare contention behavior
+// across layouts (build with -DPADDING=0 for the packed one).
+template<template<typename> class T>
+void bench_scaling(bench::suite& suite) {
+  static const int kItems = 1000000;
+  for (int threads = 2; threads <= 2 * nthreads(); threads *= 2)
+    bench_mpmc<T>(suite, "Scaling mpmc", kItems, threads / 2, threads / 2);
+}
 
+// 1:1, and N:1 at increasing producer counts if multi_producer.
+template<template<typename> class T>
+void bench_single_consumer(bench::suite& suite, bool multi_producer) {
+  static const int kItems = 1000000;
+  bench_mpmc<T>(suite, "1:1", kItems, 1, 1);
+  if (!multi_producer) return;
+  for (int enq = 2; enq <= nthreads(); enq *= 2)
+    bench_mpmc<T>(suite, to_string(enq) + ":1", kItems, enq, 1);
+}
 
-  TIME_BLOCK(chrono::milliseconds, "") {
-    --cdl;
-    for (auto& fut : efuts)
-      fut.get();
-    for (auto& fut : dfuts)
-      fut.get();
-  }
+// Fair mpmc with an instrumented queue: the run's time shows what the
+// instrumentation costs, and its statistics, summed over the trials, where
+// the time goes.
+template<template<typename> class T>
+void bench_instrumented(bench::suite& suite) {
+  static const int kItems = 1000000;
+  int nenq = nthreads() / 2, ndeq = nthreads() - nenq;
+  stats::summary total;
+  suite.run_manual(mixed_name("Fair mpmc, instrumented", nenq, ndeq), [&]() {
+      T<int> testq;
+      auto time = run_mpmc(testq, kItems, nenq, ndeq);
+      total += testq.get_stats();
+      return time;
+    }, kItems / nenq * nenq);
+  suite.log() << "    " << total << endl;
+}
+
+// Fair mpmc with every thread pinned: spread round robin over the nodes,
+// then with all producers on the first node and all consumers on the last
+// (cross-socket), where a single queue's head and tail lines bounce across
+// the interconnect on every operation.
+template<template<typename> class T>
+void bench_numa(bench::suite& suite, const string& name) {
+  static const int kItems = 1000000;
+  auto& topo = util::topology::system();
+  int nenq = nthreads() / 2, ndeq = nthreads() - nenq;
+  auto run = [&](const string& config, function<int(int)> node_of_thread) {
+    suite.run_manual(mixed_name(name + ", " + config, nenq, ndeq), [&]() {
+        T<int> testq;
+        return run_mpmc(testq, kItems, nenq, ndeq, [&](int idx) {
+            util::pin_to_node(topo, node_of_thread(idx));
+          });
+      }, kItems / nenq * nenq);
+  };
+  run("spread", [&](int idx) { return idx % topo.nodes(); });
+  run("cross-socket", [&](int idx) {
+      return idx < nenq ? 0 : topo.nodes() - 1;
+    });
+}
+
+// One thread moving heap-allocated strings through the queue, to show
+// what each extra move of the item costs: enqueue() of a built string
+// against building it in its node, and try_dequeue() through an optional
+// against into a reused string.
+template<template<typename> class T>
+void bench_strings(bench::suite& suite) {
+  static const int kItems = 1000000;
+  static const size_t kLength = 64;
+  unique_ptr<T<string> > q;
+  auto make = [&]() { q.reset(new T<string>); };
+  auto fill = [&]() {
+    make();
+    for (int i = 0; i < kItems; ++i) q->enqueue(kLength, 'x');
+  };
+  suite.run_fixed("Strings, enqueue(string)", make, [&]() {
+      for (int i = 0; i < kItems; ++i) q->enqueue(string(kLength, 'x'));
+    }, kItems);
+  suite.run_fixed("Strings, enqueue(args...) in place", make, [&]() {
+      for (int i = 0; i < kItems; ++i) q->enqueue(kLength, 'x');
+    }, kItems);
+  size_t total = 0;
+  suite.run_fixed("Strings, try_dequeue() to optional", fill, [&]() {
+      while (true) {
+        auto opt = q->try_dequeue();
+        if (!opt.valid()) break;
+        total += opt.access().size();
+      }
+    }, kItems);
+  suite.run_fixed("Strings, try_dequeue(string&)", fill, [&]() {
+      string out;
+      while (q->try_dequeue(out)) total += out.size();
+    }, kItems);
+  UASSERT(total > 0);
 }
@@ -0,0 +1,94 @@
+/*
+ * Vladimir Feinberg
+ * queues/mpsc_queue.hpp
+ * 2026-10-14
+ *
+ * Unbounded FIFO queue for many producers and a single consumer.
+ * Enqueues are one atomic exchange (wait-free). The consumer is the only
+ * thread that ever dereferences a node after it is linked, so nodes are
+ * freed directly, with no hazard pointers or epochs.
+ *
+ * The algorithm is Dmitry Vyukov's intrusive MPSC node-based queue:
+ * http://www.1024cores.net/home/lock-free-algorithms/queues/intrusive-mpsc-node-based-queue
+ */
+
+#ifndef QUEUES_MPSC_QUEUE_HPP_
+#define QUEUES_MPSC_QUEUE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <ostream>
+
+#include "queues/queue.hpp"
+#include "util/cache_line.hpp"
+#include "util/node_pool.hpp"
+#include "util/optional.hpp"
+
+namespace queues {
+
+template<typename T>
+class mpsc_queue;
+
+template<typename T>
+std::ostream& operator<<(std::ostream&, const mpsc_queue<T>&);
+
+// T does not have to be synchronized; this class will provide the needed
+// memory bariers for it to be always accessed in a linearized manner.
+//
+// Any number of threads may enqueue, but only one thread at a time may
+// dequeue. The queue will never block on enqueue operations, and will block
+// the consumer if empty. "try" methods never block.
+//
+// An enqueuer that was preempted between its exchange and linking its node
+// hides the items enqueued after it until it resumes, so try_dequeue() can
+// briefly fail while empty() is false.
+template<typename T>
+class mpsc_queue : public queue<T> {
+ private:
+  struct node : util::pooled<node> {
+    node() : next_(nullptr) {}
+    node(T&& val) : next_(nullptr), val_(std::forward<T>(val)) {}
+
+    std::atomic<node*> next_;
+    util::optional<T> val_;
+  };
+
+  // Links [first, last] (already chained) after the current tail.
+  void link(node* first, node* last);
+
+  // head_ is the consumer's stub, whose successor holds the oldest item;
+  // tail_ is the newest node, swapped by every enqueue.
+  util::cache_pad<0> pad0_;
+  std::atomic<node*> tail_;
+  util::cache_pad<sizeof(std::atomic<node*>)> pad1_;
+  std::atomic<node*> head_;
+  util::cache_pad<sizeof(std::atomic<node*>)> pad2_;
+
+ public:
+  mpsc_queue();
+  virtual ~mpsc_queue();
+  mpsc_queue(const mpsc_queue&) = delete;
+  mpsc_queue& operator=(const mpsc_queue&) = delete;
+  // Observers - never full; empty() is a snapshot and may be called by
+  // any thread.
+  virtual bool full() const { return false; }
+  virtual bool empty() const;
+  // Producer side.
+  virtual void enqueue(T t);
+  virtual bool try_enqueue(T t) { enqueue(std::move(t)); return true; }
+  // Links the whole range with one exchange; other producers' items can't
+  // interleave with it.
+  virtual void enqueue_bulk(T* first, T* last);
+  // Consumer side.
+  virtual T dequeue();
+  virtual util::optional<T> try_dequeue();
+  // For debugging. Prints [head ... tail]. Requires that the consumer is
+  // not running; items whose enqueue has not finished linking are left out.
+  friend std::ostream& operator<< <>(std::ostream&, const mpsc_queue&);
+};
+
+} // namespace queues
+
+#include "queues/mpsc_queue.tpp"
+
+#endif /* QUEUES_MPSC_QUEUE_HPP_ */
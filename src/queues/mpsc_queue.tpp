@@ -0,0 +1,122 @@
+/*
+   Vladimir Feinberg
+   queues/mpsc_queue.tpp
+   2026-10-14
+
+   mpsc_queue implementation.
+ */
+
+// Implementation details:
+//
+// The list always holds a stub node at head_, which carries no value. An
+// enqueuer swaps its node into tail_ and then stores it into the previous
+// tail's next_ (release). The consumer moves the value out of head_->next_
+// (acquire), makes that node the new stub and frees the old one.
+//
+// The old stub is safe to free: the only producer that ever touched it is
+// the one that linked its successor, which it did as its last access, and
+// the consumer saw that store before getting here.
+
+#include <thread>
+#include <utility>
+
+namespace queues {
+
+template<typename T>
+mpsc_queue<T>::mpsc_queue() {
+  auto stub = new node();
+  tail_.store(stub, std::memory_order_relaxed);
+  head_.store(stub, std::memory_order_relaxed);
+}
+
+// As is the normal assumption, the queue should not be in use
+// by other threads.
+template<typename T>
+mpsc_queue<T>::~mpsc_queue() {
+  auto n = head_.load(std::memory_order_relaxed);
+  while (n) {
+    auto next = n->next_.load(std::memory_order_relaxed);
+    delete n;
+    n = next;
+  }
+}
+
+template<typename T>
+bool mpsc_queue<T>::empty() const {
+  // Pointer comparison only - head_ may be freed under a non-consumer.
+  auto tail = tail_.load(std::memory_order_acquire);
+  return tail == head_.load(std::memory_order_relaxed);
+}
+
+template<typename T>
+void mpsc_queue<T>::link(node* first, node* last) {
+  auto prev = tail_.exchange(last, std::memory_order_acq_rel);
+  prev->next_.store(first, std::memory_order_release);
+}
+
+template<typename T>
+void mpsc_queue<T>::enqueue(T t) {
+  auto n = new node(std::move(t));
+  link(n, n);
+}
+
+template<typename T>
+void mpsc_queue<T>::enqueue_bulk(T* first, T* last) {
+  if (first == last) return;
+  auto chain = new node(std::move(*first));
+  auto end = chain;
+  try {
+    for (++first; first != last; ++first) {
+      auto n = new node(std::move(*first));
+      end->next_.store(n, std::memory_order_relaxed);
+      end = n;
+    }
+  } catch (...) {
+    for (auto prev = chain; prev;) {
+      auto next = prev->next_.load(std::memory_order_relaxed);
+      delete prev;
+      prev = next;
+    }
+    throw;
+  }
+  link(chain, end);
+}
+
+template<typename T>
+util::optional<T> mpsc_queue<T>::try_dequeue() {
+  auto stub = head_.load(std::memory_order_relaxed);
+  auto next = stub->next_.load(std::memory_order_acquire);
+  if (!next) return {};
+  util::optional<T> ret(std::move(next->val_.access()));
+  next->val_.destruct();
+  head_.store(next, std::memory_order_relaxed);
+  delete stub;
+  return ret;
+}
+
+template<typename T>
+T mpsc_queue<T>::dequeue() {
+  util::optional<T> opt;
+  while (true) {
+    opt = try_dequeue();
+    if (opt.valid())
+      break;
+    std::this_thread::yield();
+  }
+  return std::move(opt.access());
+}
+
+template<typename T>
+std::ostream& operator<<(std::ostream& o, const mpsc_queue<T>& q) {
+  o << "[";
+  auto n = q.head_.load(std::memory_order_relaxed)
+      ->next_.load(std::memory_order_acquire);
+  for (bool first = true; n; first = false) {
+    if (!first) o << ", ";
+    o << n->val_.access();
+    n = n->next_.load(std::memory_order_acquire);
+  }
+  return o << "]";
+}
+
+} // namespace queues
@@ -0,0 +1,97 @@
+/*
+ * Vladimir Feinberg
+ * queues/numa_queue.hpp
+ * 2026-10-15
+ *
+ * NUMA-aware MPMC queue: one sub-queue per memory node, so that threads
+ * on different sockets don't fight over one head and tail.
+ */
+
+#ifndef QUEUES_NUMA_QUEUE_HPP_
+#define QUEUES_NUMA_QUEUE_HPP_
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+#include "queues/hazard_queue.hpp"
+#include "queues/queue.hpp"
+#include "queues/wait_strategy.hpp"
+#include "util/optional.hpp"
+#include "util/topology.hpp"
+
+namespace queues {
+
+// Enqueuers add to the sub-queue of the node they run on (see
+// util::current_node(), and util::pin_to_node() to fix it). Dequeuers take
+// from their own node's sub-queue first and steal from the others, nearest
+// first, only when it is empty, so while every node has work, no cache
+// line crosses the interconnect.
+//
+// Each sub-queue is allocated and constructed by a thread pinned to its
+// node, on pages of its own, so that the kernel's first-touch policy
+// places its head, tail and first node in that node's memory. Enqueued
+// items' nodes come from the enqueuing thread, which is local too.
+//
+// The price is ordering: items are FIFO per node, not overall, so two
+// items enqueued on different nodes may come out in either order. Items
+// from one thread come out in order as long as it stays on its node.
+//
+// Sub is the per-node queue, a default-constructible queue<T>; Wait is the
+// blocking strategy for dequeue() and dequeue_until(), see
+// queues/wait_strategy.hpp. The sub-queues' own blocking methods are
+// never used.
+//
+// This class is thread safe.
+template<typename T, typename Sub = hazard_queue<T>,
+         typename Wait = yield_wait>
+class numa_queue : public queue<T> {
+ public:
+  // The topology is copied. Throws whatever constructing a Sub throws.
+  explicit numa_queue(const util::topology& topo = util::topology::system());
+  virtual ~numa_queue();
+  numa_queue(const numa_queue&) = delete;
+  numa_queue& operator=(const numa_queue&) = delete;
+
+  int nodes() const { return topo_.nodes(); }
+  // Observers - empty() is true only if every sub-queue looked empty.
+  virtual bool full() const { return false; }
+  virtual bool empty() const;
+  virtual void enqueue(T t) { enqueue_on(node(), std::move(t)); }
+  virtual bool try_enqueue(T t) { enqueue(std::move(t)); return true; }
+  virtual T dequeue();
+  virtual util::optional<T> try_dequeue() { return try_dequeue_from(node()); }
+  virtual util::optional<T> dequeue_until(
+      std::chrono::steady_clock::time_point deadline);
+  // Bulk methods work on the calling thread's node the same way, a batch
+  // going to (or coming from) one sub-queue.
+  virtual void enqueue_bulk(T* first, T* last);
+  virtual std::size_t try_dequeue_bulk(T* out, std::size_t max);
+
+  // As if called from a thread on 'node'.
+  void enqueue_on(int node, T t);
+  util::optional<T> try_dequeue_from(int node);
+
+ private:
+  // Each on its own pages.
+  struct local {
+    explicit local(std::vector<int> order) : steal_order(std::move(order)) {}
+    Sub queue;
+    const std::vector<int> steal_order;
+  };
+
+  // The calling thread's node, in range even if the thread was pinned
+  // with a different topology.
+  int node() const { return util::current_node(topo_) % topo_.nodes(); }
+  static local* make_local(const util::topology& topo, int node);
+
+  const util::topology topo_;
+  std::vector<local*> locals_;
+  Wait wait_;
+};
+
+} // namespace queues
+
+#include "queues/numa_queue.tpp"
+
+#endif /* QUEUES_NUMA_QUEUE_HPP_ */
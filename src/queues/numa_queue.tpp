@@ -0,0 +1,121 @@
+/*
+ * Vladimir Feinberg
+ * queues/numa_queue.tpp
+ * 2026-10-15
+ *
+ * numa_queue implementation.
+ */
+
+#include <cstdlib>
+#include <future>
+#include <new>
+#include <system_error>
+#include <utility>
+
+#include <unistd.h>
+
+namespace queues {
+
+template<typename T, typename Sub, typename Wait>
+auto numa_queue<T, Sub, Wait>::make_local(const util::topology& topo,
+                                          int node) -> local* {
+  std::size_t page = sysconf(_SC_PAGESIZE);
+  std::size_t size = (sizeof(local) + page - 1) / page * page;
+  void* mem;
+  if (posix_memalign(&mem, page, size)) throw std::bad_alloc();
+  try {
+    return new (mem) local(topo.remote_order(node));
+  } catch (...) {
+    free(mem);
+    throw;
+  }
+}
+
+template<typename T, typename Sub, typename Wait>
+numa_queue<T, Sub, Wait>::numa_queue(const util::topology& topo) :
+    topo_(topo) {
+  try {
+    for (int i = 0; i < topo_.nodes(); ++i) {
+      if (topo_.nodes() == 1) {
+        locals_.push_back(make_local(topo_, i));
+        continue;
+      }
+      // First touch from the node itself. If the process may not run
+      // there, the memory just goes wherever the kernel puts it.
+      locals_.push_back(std::async(std::launch::async, [this, i]() {
+            try {
+              util::pin_to_node(topo_, i);
+            } catch (const std::system_error&) {}
+            return make_local(topo_, i);
+          }).get());
+    }
+  } catch (...) {
+    for (auto l : locals_) {
+      l->~local();
+      free(l);
+    }
+    throw;
+  }
+}
+
+template<typename T, typename Sub, typename Wait>
+numa_queue<T, Sub, Wait>::~numa_queue() {
+  for (auto l : locals_) {
+    l->~local();
+    free(l);
+  }
+}
+
+template<typename T, typename Sub, typename Wait>
+bool numa_queue<T, Sub, Wait>::empty() const {
+  for (auto l : locals_)
+    if (!l->queue.empty()) return false;
+  return true;
+}
+
+template<typename T, typename Sub, typename Wait>
+void numa_queue<T, Sub, Wait>::enqueue_on(int node, T t) {
+  locals_[node]->queue.enqueue(std::move(t));
+  wait_.notify();
+}
+
+template<typename T, typename Sub, typename Wait>
+util::optional<T> numa_queue<T, Sub, Wait>::try_dequeue_from(int node) {
+  auto l = locals_[node];
+  auto opt = l->queue.try_dequeue();
+  for (auto it = l->steal_order.begin();
+       !opt.valid() && it != l->steal_order.end(); ++it)
+    opt = locals_[*it]->queue.try_dequeue();
+  return opt;
+}
+
+template<typename T, typename Sub, typename Wait>
+T numa_queue<T, Sub, Wait>::dequeue() {
+  auto opt = wait_.wait([this]() { return try_dequeue(); });
+  return std::move(opt.access());
+}
+
+template<typename T, typename Sub, typename Wait>
+util::optional<T> numa_queue<T, Sub, Wait>::dequeue_until(
+    std::chrono::steady_clock::time_point deadline) {
+  return wait_.wait_until([this]() { return try_dequeue(); }, deadline);
+}
+
+template<typename T, typename Sub, typename Wait>
+void numa_queue<T, Sub, Wait>::enqueue_bulk(T* first, T* last) {
+  locals_[node()]->queue.enqueue_bulk(first, last);
+  wait_.notify(last - first);
+}
+
+template<typename T, typename Sub, typename Wait>
+std::size_t numa_queue<T, Sub, Wait>::try_dequeue_bulk(T* out,
+                                                       std::size_t max) {
+  auto l = locals_[node()];
+  auto n = l->queue.try_dequeue_bulk(out, max);
+  for (auto it = l->steal_order.begin(); !n && it != l->steal_order.end();
+       ++it)
+    n = locals_[*it]->queue.try_dequeue_bulk(out, max);
+  return n;
+}
+
+} // namespace queues
@@ -9,6 +9,11 @@
 #ifndef QUEUES_QUEUE_HPP_
 #define QUEUES_QUEUE_HPP_
 
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <utility>
+
 #include "util/optional.hpp"
 
 namespace queues {
@@ -27,8 +32,43 @@ class queue {
   virtual T dequeue() = 0;
   // "try" methods don't block - enqueue returns false if full and
   // dequeue returns an invalid (unconstructed) optional if empty.
-  virtual void try_enqueue(T) = 0;
+  virtual bool try_enqueue(T) = 0;
   virtual util::optional<T> try_dequeue() = 0;
+  // Timed dequeues wait like dequeue() but give up at the deadline, or
+  // after the timeout, returning an invalid optional. The default polls
+  // try_dequeue().
+  virtual util::optional<T> dequeue_until(
+      std::chrono::steady_clock::time_point deadline) {
+    while (true) {
+      auto opt = try_dequeue();
+      if (opt.valid() || std::chrono::steady_clock::now() >= deadline)
+        return opt;
+      std::this_thread::yield();
+    }
+  }
+  template<typename Rep, typename Period>
+  util::optional<T> dequeue_for(
+      const std::chrono::duration<Rep, Period>& timeout) {
+    return dequeue_until(std::chrono::steady_clock::now() + timeout);
+  }
+  // Bulk methods work on contiguous ranges so that they can be overriden.
+  // enqueue_bulk moves all of [first, last) into the queue, in order, with
+  // the same blocking behavior as enqueue. try_dequeue_bulk moves up to max
+  // items into out[0], out[1], ... and returns how many it dequeued (0 if
+  // empty), without blocking. The defaults just loop over the single-item
+  // methods.
+  virtual void enqueue_bulk(T* first, T* last) {
+    for (; first != last; ++first) enqueue(std::move(*first));
+  }
+  virtual std::size_t try_dequeue_bulk(T* out, std::size_t max) {
+    std::size_t n = 0;
+    for (; n < max; ++n) {
+      auto opt = try_dequeue();
+      if (!opt.valid()) break;
+      out[n] = std::move(opt.access());
+    }
+    return n;
+  }
 };
 
 } // namespace queues
@@ -0,0 +1,308 @@
+/*
+  Vladimir Feinberg
+  queues/queue_stats.hpp
+  2026-10-15
+
+  Instrumentation policies for the linked lockfree queues (see
+  queues/hazard_queue.hpp, queues/shared_queue.hpp): how often their CAS
+  loops retry, how often hazard pointers have to be re-published, how much
+  time goes to hazard pointer scans, and sampled enqueue-to-dequeue
+  latency, kept per thread and merged into a summary on demand.
+*/
+
+#ifndef QUEUES_QUEUE_STATS_HPP_
+#define QUEUES_QUEUE_STATS_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+
+#include "synchro/hazard.hpp"
+#include "util/cache_line.hpp"
+#include "util/thread_index.hpp"
+
+namespace queues {
+namespace stats {
+
+// Histograms are HDR-style: each power of two is split into 2^kSubBits
+// linear bins, so a bin's width is at most 1/2^kSubBits of its values
+// (12.5%). Values under 2^kSubBits get a bin each, and values of 2^kMaxBits
+// nanoseconds (about 18 minutes) and up share the last one.
+constexpr int kSubBits = 3;
+constexpr int kMaxBits = 40;
+constexpr int kBins = (kMaxBits - kSubBits + 1) << kSubBits;
+
+// Bin of a histogram sample.
+inline int bin_of(uint64_t sample) {
+  if(sample >> kMaxBits) sample = (uint64_t(1) << kMaxBits) - 1;
+  if(sample < (1u << kSubBits)) return static_cast<int>(sample);
+  int shift = 63 - __builtin_clzll(sample) - kSubBits;
+  return ((shift + 1) << kSubBits) +
+      static_cast<int>(sample >> shift) - (1 << kSubBits);
+}
+
+// Smallest sample that falls in bin i + 1, i.e., the exclusive upper end
+// of bin i.
+inline uint64_t bin_end(int bin) {
+  if(bin < (1 << kSubBits)) return bin + 1;
+  int shift = (bin >> kSubBits) - 1;
+  uint64_t mantissa = (bin & ((1 << kSubBits) - 1)) + (1 << kSubBits);
+  return (mantissa + 1) << shift;
+}
+
+/*
+ * A summary is a snapshot of a queue's statistics, summed over every
+ * thread that used it. Counts a policy doesn't keep are left 0.
+ */
+struct summary {
+  summary() : enqueues(0), dequeues(0), head_retries(0), tail_retries(0),
+              reacquires(0), scans(0), reclaimed(0), scan_ns(),
+              latency_ns() {}
+  // Items enqueued and dequeued.
+  uint64_t enqueues, dequeues;
+  // Failed CASes in the dequeue (head_) and enqueue (tail_) loops, each
+  // of which sends the thread around its loop again.
+  uint64_t head_retries, tail_retries;
+  // Hazard pointers published again because the node they were meant to
+  // protect moved before they were validated.
+  uint64_t reacquires;
+  // Hazard pointer scans run while retiring the queue's nodes, and the
+  // pointers (of any structure) they freed.
+  uint64_t scans, reclaimed;
+  // Scan durations.
+  uint64_t scan_ns[kBins];
+  // Time from enqueue to dequeue of sampled items.
+  uint64_t latency_ns[kBins];
+
+  summary& operator+=(const summary& other);
+};
+
+/*
+ * INPUT:
+ * const uint64_t (&bins)[kBins] - a histogram
+ * double q - quantile, in [0, 1]
+ * PRECONDITION:
+ * BEHAVIOR:
+ * RETURN:
+ * An upper bound on the q-th quantile of the histogram's samples: the
+ * (exclusive) upper end of the bin it falls in. 0 for an empty histogram.
+ */
+inline uint64_t quantile(const uint64_t (&bins)[kBins], double q) {
+  uint64_t total = 0;
+  for(int i = 0; i < kBins; ++i) total += bins[i];
+  if(!total) return 0;
+  uint64_t seen = 0;
+  for(int i = 0; i < kBins; ++i) {
+    seen += bins[i];
+    if(seen >= q * total && seen) return bin_end(i);
+  }
+  return bin_end(kBins - 1);
+}
+
+// Number of samples in a histogram.
+inline uint64_t samples(const uint64_t (&bins)[kBins]) {
+  uint64_t total = 0;
+  for(int i = 0; i < kBins; ++i) total += bins[i];
+  return total;
+}
+
+inline summary& summary::operator+=(const summary& other) {
+  enqueues += other.enqueues;
+  dequeues += other.dequeues;
+  head_retries += other.head_retries;
+  tail_retries += other.tail_retries;
+  reacquires += other.reacquires;
+  scans += other.scans;
+  reclaimed += other.reclaimed;
+  for(int i = 0; i < kBins; ++i) {
+    scan_ns[i] += other.scan_ns[i];
+    latency_ns[i] += other.latency_ns[i];
+  }
+  return *this;
+}
+
+inline std::ostream& operator<<(std::ostream& o, const summary& s) {
+  o << "enqueues " << s.enqueues << ", dequeues " << s.dequeues
+    << ", head retries " << s.head_retries << ", tail retries "
+    << s.tail_retries << ", reacquires " << s.reacquires << ", scans "
+    << s.scans << " (" << s.reclaimed << " freed";
+  if(s.scans)
+    o << ", p50 < " << quantile(s.scan_ns, 0.5) << "ns, max < "
+      << quantile(s.scan_ns, 1) << "ns";
+  o << ")";
+  if(samples(s.latency_ns))
+    o << ", latency p50 < " << quantile(s.latency_ns, 0.5) << "ns, p99 < "
+      << quantile(s.latency_ns, 0.99) << "ns, p99.9 < "
+      << quantile(s.latency_ns, 0.999) << "ns ("
+      << samples(s.latency_ns) << " samples)";
+  return o;
+}
+
+/*
+ * An instrumentation policy is what a queue notifies of its operations.
+ * Queues hold one, derive their nodes from its stamp (so an empty one
+ * takes no space), and call:
+ *
+ * on_enqueue(stamp&) - for each item, before its node is published
+ * on_dequeue(const stamp&) - for each item, once its node is claimed
+ * on_head_retry(), on_tail_retry() - after a failed head or tail CAS
+ * on_reacquire(n) - after a guard had to be re-published n times
+ * scan_mark before_retire(), after_retire(scan_mark) - around each
+ *   node's schedule_deletion(), which may run a hazard pointer scan
+ * collect(summary& s) - adds the counts so far to s
+ * reset() - zeroes the counts
+ *
+ * All may be called from any number of threads at once.
+ *
+ * none is the default: every call is empty and inlined, so a queue using
+ * it is exactly as if it weren't instrumented.
+ */
+struct none {
+  struct stamp {};
+  struct scan_mark {};
+  static constexpr bool enabled = false;
+
+  void on_enqueue(stamp&) {}
+  void on_dequeue(const stamp&) {}
+  void on_head_retry() {}
+  void on_tail_retry() {}
+  void on_reacquire(std::size_t) {}
+  static scan_mark before_retire() { return scan_mark(); }
+  void after_retire(scan_mark) {}
+  void collect(summary&) const {}
+  void reset() {}
+};
+
+/*
+ * Counts every event in per-thread slots (the first kSlots threads to use
+ * a queue get their own, later ones share them), so that recording never
+ * contends with other threads. If SamplePeriod isn't 0, timestamps one in
+ * SamplePeriod enqueues of each thread and records how long those items
+ * take to be dequeued (a clock read at either end). Either way, the stamp
+ * makes each node 8 bytes larger.
+ *
+ * Scans are only seen by hazard_queue with the hazard_reclaimer.
+ */
+template<unsigned SamplePeriod>
+class instrumented {
+  typedef std::chrono::steady_clock clock;
+
+ public:
+  // Sampled enqueue time, in nanoseconds since the clock's epoch, or 0.
+  struct stamp {
+    uint64_t enqueued_ns = 0;
+  };
+  typedef synchro::hazard_scan_stats scan_mark;
+  static constexpr bool enabled = true;
+  static constexpr std::size_t kSlots = 32;
+
+  instrumented() : slots_(new slot[kSlots]) {}
+
+  void on_enqueue(stamp& s) {
+    auto& sl = local();
+    add(sl.enqueues);
+    if(!SamplePeriod) return;
+    auto tick = sl.tick.load(std::memory_order_relaxed) + 1;
+    sl.tick.store(tick, std::memory_order_relaxed);
+    if(tick % SamplePeriod == 0) s.enqueued_ns = now_ns();
+  }
+  void on_dequeue(const stamp& s) {
+    auto& sl = local();
+    add(sl.dequeues);
+    if(SamplePeriod && s.enqueued_ns) {
+      auto now = now_ns();
+      add(sl.latency_ns[bin_of(now > s.enqueued_ns ?
+                               now - s.enqueued_ns : 0)]);
+    }
+  }
+  void on_head_retry() { add(local().head_retries); }
+  void on_tail_retry() { add(local().tail_retries); }
+  void on_reacquire(std::size_t n) { if(n) add(local().reacquires, n); }
+  static scan_mark before_retire() {
+    return synchro::thread_hazard_scan_stats();
+  }
+  void after_retire(scan_mark before) {
+    auto after = synchro::thread_hazard_scan_stats();
+    if(after.scans == before.scans) return;
+    auto& sl = local();
+    add(sl.scans, after.scans - before.scans);
+    add(sl.reclaimed, after.reclaimed - before.reclaimed);
+    add(sl.scan_ns[bin_of(after.scan_ns - before.scan_ns)]);
+  }
+  void collect(summary& s) const {
+    for(std::size_t i = 0; i < kSlots; ++i) {
+      auto& sl = slots_[i];
+      s.enqueues += sl.enqueues.load(std::memory_order_relaxed);
+      s.dequeues += sl.dequeues.load(std::memory_order_relaxed);
+      s.head_retries += sl.head_retries.load(std::memory_order_relaxed);
+      s.tail_retries += sl.tail_retries.load(std::memory_order_relaxed);
+      s.reacquires += sl.reacquires.load(std::memory_order_relaxed);
+      s.scans += sl.scans.load(std::memory_order_relaxed);
+      s.reclaimed += sl.reclaimed.load(std::memory_order_relaxed);
+      for(int j = 0; j < kBins; ++j) {
+        s.scan_ns[j] += sl.scan_ns[j].load(std::memory_order_relaxed);
+        s.latency_ns[j] += sl.latency_ns[j].load(std::memory_order_relaxed);
+      }
+    }
+  }
+  void reset() {
+    for(std::size_t i = 0; i < kSlots; ++i) {
+      auto& sl = slots_[i];
+      for(auto c : {&sl.enqueues, &sl.dequeues, &sl.head_retries,
+                    &sl.tail_retries, &sl.reacquires, &sl.scans,
+                    &sl.reclaimed})
+        c->store(0, std::memory_order_relaxed);
+      for(int j = 0; j < kBins; ++j) {
+        sl.scan_ns[j].store(0, std::memory_order_relaxed);
+        sl.latency_ns[j].store(0, std::memory_order_relaxed);
+      }
+    }
+  }
+
+ private:
+  // Counters are only atomic because threads past the first kSlots share
+  // slots, and collect() may run at any time; with a slot to itself, a
+  // thread's relaxed increments stay in its own cache.
+  typedef std::atomic<uint64_t> counter;
+  struct slot {
+    slot() : enqueues(0), dequeues(0), head_retries(0), tail_retries(0),
+             reacquires(0), scans(0), reclaimed(0), tick(0) {
+      for(int j = 0; j < kBins; ++j) {
+        scan_ns[j].store(0, std::memory_order_relaxed);
+        latency_ns[j].store(0, std::memory_order_relaxed);
+      }
+    }
+    util::cache_pad<0> pad_;
+    counter enqueues, dequeues, head_retries, tail_retries, reacquires,
+        scans, reclaimed;
+    counter scan_ns[kBins];
+    counter latency_ns[kBins];
+    // Enqueues through the slot. Not incremented atomically: when the slot
+    // is shared, lost ticks only perturb the sampling.
+    std::atomic<unsigned> tick;
+  };
+
+  static void add(counter& c, uint64_t n = 1) {
+    c.fetch_add(n, std::memory_order_relaxed);
+  }
+  static uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        clock::now().time_since_epoch()).count();
+  }
+  slot& local() const { return slots_[util::thread_index() % kSlots]; }
+
+  std::unique_ptr<slot[]> slots_;
+};
+
+// Counts retries, reacquires and scans.
+typedef instrumented<0> counting;
+// Also samples the latency of one in 64 items per enqueuing thread.
+typedef instrumented<64> sampled;
+
+} // namespace stats
+} // namespace queues
+
+#endif /* QUEUES_QUEUE_STATS_HPP_ */
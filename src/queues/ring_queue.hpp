@@ -0,0 +1,97 @@
+/*
+ * Vladimir Feinberg
+ * queues/ring_queue.hpp
+ * 2026-10-14
+ *
+ * Bounded lock free FIFO queue, satisfies the MPMC problem.
+ * Implemented over a fixed array of slots with per-slot sequence
+ * numbers, so no allocation happens after construction.
+ *
+ * The algorithm is Dmitry Vyukov's bounded MPMC queue:
+ * http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+ */
+
+#ifndef QUEUES_RING_QUEUE_HPP_
+#define QUEUES_RING_QUEUE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <ostream>
+
+#include "queues/queue.hpp"
+#include "util/cache_line.hpp"
+#include "util/optional.hpp"
+
+namespace queues {
+
+template<typename T>
+class ring_queue;
+
+template<typename T>
+std::ostream& operator<<(std::ostream&, const ring_queue<T>&);
+
+// T does not have to be synchronized; this class will provide the needed
+// memory bariers for it to be always accessed in a linearized manner.
+//
+// The queue holds at most capacity() items, where the capacity is the
+// requested size rounded up to a power of two. enqueue() blocks while the
+// queue is full and dequeue() blocks while it is empty. "try" methods never
+// block.
+//
+// T's move constructor should not throw: once a slot is claimed by an
+// enqueuer or dequeuer it cannot be handed back to the queue.
+template<typename T>
+class ring_queue : public queue<T> {
+ private:
+  struct slot {
+    std::atomic<std::size_t> seq_;
+    alignas(T) char store_[sizeof(T)];
+    T* get() { return reinterpret_cast<T*>(store_); }
+    const T* get() const { return reinterpret_cast<const T*>(store_); }
+  };
+
+  static std::size_t round_capacity(std::size_t requested);
+
+  // Moves from t only on success.
+  bool push(T& t);
+
+  // Read-only after construction, shared by all threads.
+  const std::size_t mask_;
+  const std::unique_ptr<slot[]> slots_;
+  // Enqueuers and dequeuers each hammer their own counter, so keep the two
+  // off of each other's (and the read-only members') cache lines.
+  util::cache_pad<0> pad0_;
+  std::atomic<std::size_t> enqueue_pos_;
+  util::cache_pad<sizeof(std::atomic<std::size_t>)> pad1_;
+  std::atomic<std::size_t> dequeue_pos_;
+  util::cache_pad<sizeof(std::atomic<std::size_t>)> pad2_;
+
+ public:
+  static constexpr std::size_t kDefaultCapacity = 1 << 16;
+  // Capacity is rounded up to the nearest power of two (at least 2).
+  explicit ring_queue(std::size_t capacity = kDefaultCapacity);
+  virtual ~ring_queue();
+  ring_queue(const ring_queue&) = delete;
+  ring_queue& operator=(const ring_queue&) = delete;
+  // Observers - full() and empty() are only snapshots under contention.
+  bool is_lock_free() const;
+  std::size_t capacity() const { return mask_ + 1; }
+  virtual bool full() const;
+  virtual bool empty() const;
+  // Strong guarantee for enqueues. try_enqueue() returns false if full.
+  virtual void enqueue(T t);
+  virtual bool try_enqueue(T t) { return push(t); }
+  virtual T dequeue();
+  virtual util::optional<T> try_dequeue();
+  // For debugging. Prints [head ... tail]. Requires external locking
+  // so that no dequeue operations occur on the queue; in-flight enqueues
+  // are skipped.
+  friend std::ostream& operator<< <>(std::ostream&, const ring_queue&);
+};
+
+} // namespace queues
+
+#include "queues/ring_queue.tpp"
+
+#endif /* QUEUES_RING_QUEUE_HPP_ */
@@ -0,0 +1,171 @@
+/*
+   Vladimir Feinberg
+   queues/ring_queue.tpp
+   2026-10-14
+
+   ring_queue implementation.
+ */
+
+// Implementation details:
+//
+// Every slot carries a sequence number. For the slot at index (pos & mask),
+//   seq == pos         - the slot is free for the enqueuer that claims pos
+//   seq == pos + 1     - the slot holds the value enqueued at pos, and is
+//                        ready for the dequeuer that claims pos
+//   seq == pos + cap   - the value was dequeued, the slot is free for the
+//                        enqueuer that claims pos + cap (the next lap).
+// Enqueuers claim a position by CAS-ing enqueue_pos_ forward, dequeuers do
+// the same on dequeue_pos_. The claimed position is exclusive to the
+// claiming thread, so construction/destruction of T needs no further
+// synchronization than the release store of the new sequence number (which
+// the other side acquires before touching the slot).
+//
+// Comparing seq against pos with a signed difference tells a thread whether
+// the slot is ready (0), still held by the previous lap (< 0, so the queue is
+// full/empty), or already taken by another thread (> 0, reload the position).
+
+#include <thread>
+#include <utility>
+
+namespace queues {
+
+template<typename T>
+constexpr std::size_t ring_queue<T>::kDefaultCapacity;
+
+template<typename T>
+std::size_t ring_queue<T>::round_capacity(std::size_t requested) {
+  std::size_t cap = 2;
+  while (cap < requested) cap <<= 1;
+  return cap;
+}
+
+template<typename T>
+ring_queue<T>::ring_queue(std::size_t capacity) :
+    mask_(round_capacity(capacity) - 1),
+    slots_(new slot[mask_ + 1]),
+    enqueue_pos_(0), dequeue_pos_(0) {
+  for (std::size_t i = 0; i <= mask_; ++i)
+    slots_[i].seq_.store(i, std::memory_order_relaxed);
+}
+
+// As is the normal assumption, the queue should not be in use
+// by other threads.
+template<typename T>
+ring_queue<T>::~ring_queue() {
+  auto end = enqueue_pos_.load(std::memory_order_relaxed);
+  for (auto i = dequeue_pos_.load(std::memory_order_relaxed); i != end; ++i)
+    slots_[i & mask_].get()->~T();
+}
+
+template<typename T>
+bool ring_queue<T>::is_lock_free() const {
+  return enqueue_pos_.is_lock_free() && dequeue_pos_.is_lock_free();
+}
+
+template<typename T>
+bool ring_queue<T>::full() const {
+  // Read dequeue position first so the estimate is conservative (can only
+  // say "full" if it really was at some point).
+  auto deq = dequeue_pos_.load(std::memory_order_relaxed);
+  auto enq = enqueue_pos_.load(std::memory_order_relaxed);
+  return enq - deq >= capacity();
+}
+
+template<typename T>
+bool ring_queue<T>::empty() const {
+  // Same "conservative" estimate as the other queues - read insert version
+  // first.
+  auto enq = enqueue_pos_.load(std::memory_order_relaxed);
+  auto deq = dequeue_pos_.load(std::memory_order_relaxed);
+  return enq == deq;
+}
+
+template<typename T>
+bool ring_queue<T>::push(T& t) {
+  slot* s;
+  auto pos = enqueue_pos_.load(std::memory_order_relaxed);
+  while (true) {
+    s = &slots_[pos & mask_];
+    auto seq = s->seq_.load(std::memory_order_acquire);
+    auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+    if (diff == 0) {
+      if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                             std::memory_order_relaxed,
+                                             std::memory_order_relaxed))
+        break;
+    } else if (diff < 0) {
+      return false; // previous lap's value not dequeued yet, full.
+    } else {
+      pos = enqueue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+
+  new (s->get()) T(std::move(t));
+  s->seq_.store(pos + 1, std::memory_order_release);
+  return true;
+}
+
+template<typename T>
+void ring_queue<T>::enqueue(T t) {
+  while (!push(t))
+    std::this_thread::yield();
+}
+
+template<typename T>
+util::optional<T> ring_queue<T>::try_dequeue() {
+  slot* s;
+  auto pos = dequeue_pos_.load(std::memory_order_relaxed);
+  while (true) {
+    s = &slots_[pos & mask_];
+    auto seq = s->seq_.load(std::memory_order_acquire);
+    auto diff = static_cast<std::ptrdiff_t>(seq - (pos + 1));
+    if (diff == 0) {
+      if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                             std::memory_order_relaxed,
+                                             std::memory_order_relaxed))
+        break;
+    } else if (diff < 0) {
+      return {}; // slot not yet filled this lap, empty.
+    } else {
+      pos = dequeue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+
+  util::optional<T> ret(std::move(*s->get()));
+  s->get()->~T();
+  s->seq_.store(pos + mask_ + 1, std::memory_order_release);
+  return ret;
+}
+
+template<typename T>
+T ring_queue<T>::dequeue() {
+  util::optional<T> opt;
+  while (true) {
+    opt = try_dequeue();
+    if (opt.valid())
+      break;
+    std::this_thread::yield();
+  }
+  return std::move(opt.access());
+}
+
+// Requires dequeuers are not operating on the queue. Slots which are
+// claimed but not yet published by an enqueuer are skipped.
+template<typename T>
+std::ostream& operator<<(std::ostream& o, const ring_queue<T>& q) {
+  auto head = q.dequeue_pos_.load(std::memory_order_relaxed);
+  auto tail = q.enqueue_pos_.load(std::memory_order_relaxed);
+
+  o << "[";
+  bool first = true;
+  for (auto i = head; i != tail; ++i) {
+    const auto& s = q.slots_[i & q.mask_];
+    if (s.seq_.load(std::memory_order_acquire) != i + 1) continue;
+    if (!first) o << ", ";
+    o << *s.get();
+    first = false;
+  }
+  return o << "]";
+}
+
+} // namespace queues
@@ -17,40 +17,60 @@
 #define QUEUES_SHARED_QUEUE_HPP_
 
 #include <atomic>
+#include <chrono>
+#include <cstddef>
 #include <memory>
 #include <ostream>
 
 #include "synchro/atomic_shared.hpp"
+#include "synchro/epoch.hpp"
 #include "queues/queue.hpp"
+#include "queues/queue_stats.hpp"
+#include "queues/wait_strategy.hpp"
 #include "util/atomic_optional.hpp"
+#include "util/cache_line.hpp"
+#include "util/node_pool.hpp"
 #include "util/optional.hpp"
 
 namespace queues {
 
-template<typename T>
+template<typename T, typename Wait = yield_wait,
+         typename Stats = stats::none>
 class shared_queue;
 
-template<typename T>
-std::ostream& operator<<(std::ostream&, const shared_queue<T>&);
+template<typename T, typename W, typename S>
+std::ostream& operator<<(std::ostream&, const shared_queue<T, W, S>&);
 
 // T does not have to be synchronized; this class will provide the needed
 // memory bariers for it to be always accessed in a linearized manner.
 //
 // The queue will never block on enqueue operations. The queue
 // will block dequeing threads if empty. "try" methods never block.
-template<typename T>
+//
+// Wait is the blocking strategy for dequeue() and dequeue_until(), see
+// queues/wait_strategy.hpp.
+//
+// Stats is the instrumentation policy, see queues/queue_stats.hpp. Nodes
+// are reclaimed by reference counts, so there are no reacquires or scans
+// to count.
+template<typename T, typename Wait, typename Stats>
 class shared_queue : public queue<T> {
  private:
-  struct node {
-    node() : delete_self(true) {}
-    node(T&& val) : val(std::forward<T>(val)), delete_self(true) {}
+  // Nodes come from (and are released back to) a util::node_pool.
+  struct node : util::pooled<node>, Stats::stamp {
+    node() : unlink_next(nullptr) {}
+    node(T&& val) : val(std::forward<T>(val)), unlink_next(nullptr) {}
 
     synchro::atomic_shared_ptr<node> next;
     util::atomic_optional<T> val;
 
-    // Ugly hack for deletion, see ~shared_queue() for details.
-    bool delete_self;
-    static void deleter(node* self) { if (self->delete_self) delete self; }
+    // Deleting a node drops its reference to the next one, which may delete
+    // that node, and so on down a chain that something else (e.g., a
+    // reference retired by atomic_shared_ptr) had kept alive. The shared_ptr
+    // deleter unrolls that recursion: a nested deletion is pushed onto a
+    // per-thread list that the outermost one works through.
+    node* unlink_next;
+    static void deleter(node* self);
   };
 
   // Shared pointer at the head to avoid ABA problem -
@@ -61,19 +81,34 @@ class shared_queue : public queue<T> {
   // I know in some sense using this is sort-of like cheating
   // and I might as well use Java, but this at least lets me get
   // a correct implementation down (before moving on to hazard pointers).
+  //
+  // Dequeuers write the head side and enqueuers the tail side, so each
+  // side gets its own cache line (see util/cache_line.hpp). The versions
+  // below are needed for empty().
+  typedef util::cache_pad<sizeof(synchro::atomic_shared_ptr<node>) +
+                          sizeof(std::atomic<size_t>)> side_pad;
+  util::cache_pad<0> pad0_;
   synchro::atomic_shared_ptr<node> head_;
-  // TODO: potential optimization, store in different cache lines
+  std::atomic<size_t> remove_version_; // number dequeued
+  side_pad pad1_;
   synchro::atomic_shared_ptr<node> tail_;
-
-  // Below versioning needed for empty()
   std::atomic<size_t> insert_version_; // number enqueued
-  std::atomic<size_t> remove_version_; // number dequeued
-
-  void enqueue(node* n) noexcept;
+  side_pad pad2_;
+  Wait wait_;
+  Stats stats_;
+
+  // Publishes the privately linked chain [first ... last] of count nodes.
+  void enqueue(std::shared_ptr<node> first, std::shared_ptr<node> last,
+               std::size_t count) noexcept;
+  void enqueue(node* raw_n) noexcept {
+    stats_.on_enqueue(*raw_n);
+    std::shared_ptr<node> n(raw_n, node::deleter);
+    enqueue(n, n, 1);
+  }
 
  public:
   shared_queue() :
-    insert_version_(0), remove_version_(0) {
+    remove_version_(0), insert_version_(0) {
     node* n = new node;
     std::shared_ptr<node> sptr(n, node::deleter);
     std::atomic_store_explicit(&tail_, sptr, std::memory_order_relaxed);
@@ -87,11 +122,23 @@ class shared_queue : public queue<T> {
   // Strong guarantee for enqueues
   // Only construction of T or new node will throw.
   virtual void enqueue(T t) { enqueue(new node(std::move(t))); }
-  virtual void try_enqueue(T t) { enqueue(std::move(t)); }
+  // Unbounded, so try_enqueue() always succeeds.
+  virtual bool try_enqueue(T t) { enqueue(std::move(t)); return true; }
   // Strong guarantee for dequeue - only move can throw
   // In addition, empty_error may be thrown for try_dequeue()
   virtual T dequeue();
   virtual util::optional<T> try_dequeue();
+  virtual util::optional<T> dequeue_until(
+      std::chrono::steady_clock::time_point deadline);
+  // Bulk enqueues link the batch privately and publish it with one tail CAS.
+  // Bulk dequeues claim a run of nodes with one head CAS. Same exception
+  // guarantees as their single-item counterparts.
+  virtual void enqueue_bulk(T* first, T* last);
+  virtual std::size_t try_dequeue_bulk(T* out, std::size_t max);
+  // Sums every thread's statistics so far (all 0 with stats::none). May be
+  // called while the queue is in use.
+  stats::summary get_stats() const;
+  void reset_stats() { stats_.reset(); }
   // For debugging. Prints [head ... tail]. Requires external locking
   // so that no operations occur on the queue.
   friend std::ostream& operator<< <>(std::ostream&, const shared_queue&);
@@ -71,16 +71,16 @@
 
 namespace queues {
 
-template<typename T>
-bool shared_queue<T>::is_lock_free() const {
+template<typename T, typename W, typename S>
+bool shared_queue<T, W, S>::is_lock_free() const {
   return std::atomic_is_lock_free(&head_)
       && std::atomic_is_lock_free(&tail_)
       && std::atomic_is_lock_free(&insert_version_)
       && std::atomic_is_lock_free(&remove_version_);
 }
 
-template<typename T>
-bool shared_queue<T>::empty() const {
+template<typename T, typename W, typename S>
+bool shared_queue<T, W, S>::empty() const {
   // Give a "conservative" estimate, likely to say empty() is true,
   // to prevent eager wakeups and contention, by reading insert version first.
   auto enq = insert_version_.load(std::memory_order_relaxed);
@@ -89,18 +89,24 @@ bool shared_queue<T>::empty() const {
   return enq == deq;
 }
 
-template<typename T>
-void shared_queue<T>::enqueue(node* raw_n) noexcept {
+template<typename T, typename W, typename S>
+void shared_queue<T, W, S>::enqueue(std::shared_ptr<node> n,
+                              std::shared_ptr<node> last,
+                              std::size_t count) noexcept {
+  // Every atomic_shared_ptr access below would otherwise enter its own
+  // epoch critical section; nested ones are free.
+  synchro::epoch_guard guard;
   // oldtail ABA would occur here, but we take care to make sure it's a shared
   // pointer.
   auto oldtail = std::atomic_load_explicit(&tail_, std::memory_order_relaxed);
-  std::shared_ptr<node> newnext, n(raw_n, node::deleter);
+  std::shared_ptr<node> newnext;
 
   // Require release semantics on node->next pointer - see documentation above
   // Set head->next to n if it is still null
   while (!std::atomic_compare_exchange_weak_explicit(
              &oldtail->next, &newnext, n, std::memory_order_release,
              std::memory_order_relaxed)) {
+    stats_.on_tail_retry();
     // Validity of newnext in the commented CAS below is guaranteed
     // if the CAS succeeds b/c it meant that right before the CAS the tail
     // was still oldtail, so its next could not have been deleted.
@@ -112,16 +118,40 @@ void shared_queue<T>::enqueue(node* raw_n) noexcept {
   }
 
   // Make sure that by the time we are finished enqueuing, a dequeuer
-  // is able to remove the head.
+  // is able to remove the head. If this fails for a chain, the helping
+  // enqueuer walks the tail through the rest of it (see hazard_queue.tpp).
   std::atomic_compare_exchange_strong_explicit(
-      &tail_, &oldtail, n, std::memory_order_relaxed, std::memory_order_relaxed);
+      &tail_, &oldtail, last, std::memory_order_relaxed,
+      std::memory_order_relaxed);
 
-  insert_version_.fetch_add(1, std::memory_order_relaxed);
+  insert_version_.fetch_add(count, std::memory_order_relaxed);
+  wait_.notify(count);
 }
 
-template<typename T>
-util::optional<T> shared_queue<T>::try_dequeue()
+template<typename T, typename W, typename S>
+void shared_queue<T, W, S>::enqueue_bulk(T* first, T* last) {
+  if (first == last) return;
+  // Link the chain privately, no one else can see it until it's published.
+  // The nodes own each other, so an exception cleans up the partial chain.
+  std::shared_ptr<node> chain_first(new node(std::move(*first)),
+                                    node::deleter);
+  stats_.on_enqueue(*chain_first);
+  auto chain_last = chain_first;
+  std::size_t count = 1;
+  for (++first; first != last; ++first, ++count) {
+    std::shared_ptr<node> n(new node(std::move(*first)), node::deleter);
+    stats_.on_enqueue(*n);
+    std::atomic_store_explicit(&chain_last->next, n,
+                               std::memory_order_relaxed);
+    chain_last = std::move(n);
+  }
+  enqueue(std::move(chain_first), std::move(chain_last), count);
+}
+
+template<typename T, typename W, typename S>
+util::optional<T> shared_queue<T, W, S>::try_dequeue()
 {
+  synchro::epoch_guard guard; // see enqueue()
   // Require acquire semantics on tail->next - see documentation above
   // ABA is avoided by using shared pointers - if a local
   // pointer is the same as one in the atomic tail register,
@@ -155,79 +185,143 @@ util::optional<T> shared_queue<T>::try_dequeue()
             std::memory_order_relaxed)) {
       // We have claimed oldhead successfully, but it could be invalid
       // (if the queue was empty and one insert occured)
-      if (oldhead->val.valid())
-        break;
       // If we had a successful CAS but oldhead is invalid, then this
       // is the case where we were waiting on a head == tail case
       // but tail moved, so we moved head forward to a valid node
       // as well. Just restart dequeue() loop in this case.
+      //
+      // A dequeuer that saw head == tail before we moved the head may
+      // still be about to invalidate() it, so the value goes to whoever
+      // invalidates it first, as in try_dequeue_bulk().
+      if (oldhead->val.invalidate())
+        break;
+    } else {
+      stats_.on_head_retry();
     }
   }
 
   remove_version_.fetch_add(1, std::memory_order_relaxed);
+  stats_.on_dequeue(*oldhead);
 
-  return {std::move(*oldhead->val.get())};
+  // The optional was invalidated, so the node won't destroy the value.
+  util::optional<T> ret(std::move(*oldhead->val.get()));
+  oldhead->val.get()->~T();
+  return ret;
 }
 
-// TODO optimization: do manual RVO on the optional by inlining?
-template<typename T>
-T shared_queue<T>::dequeue() {
-  util::optional<T> opt;
+template<typename T, typename W, typename S>
+std::size_t shared_queue<T, W, S>::try_dequeue_bulk(T* out, std::size_t max) {
+  if (max == 0) return 0;
+  synchro::epoch_guard guard; // see enqueue()
+  auto oldhead = std::atomic_load_explicit(&head_, std::memory_order_acquire);
+  std::size_t claimed;
+
+  // Cycle until we claim the run [oldhead, newhead) with one head CAS. Our
+  // local shared pointers keep every node we walk over alive.
   while (true) {
-    opt = try_dequeue();
-    if (opt.valid())
+    auto oldtail = std::atomic_load_explicit(&tail_, std::memory_order_relaxed);
+    if (oldhead.get() == oldtail.get()) {
+      // Single-item case, identical to try_dequeue().
+      if (!oldhead->val.invalidate()) return 0;
+      out[0] = std::move(*oldhead->val.get());
+      oldhead->val.get()->~T();
+      remove_version_.fetch_add(1, std::memory_order_relaxed);
+      stats_.on_dequeue(*oldhead);
+      return 1;
+    }
+
+    // Never claim the tail node.
+    auto walk = oldhead;
+    claimed = 1;
+    while (claimed < max) {
+      auto next = std::atomic_load_explicit(&walk->next,
+                                            std::memory_order_acquire);
+      if (!next || next.get() == oldtail.get()) break;
+      walk = std::move(next);
+      ++claimed;
+    }
+
+    auto newhead = std::atomic_load_explicit(&walk->next,
+                                             std::memory_order_acquire);
+    // See try_dequeue() for why this may happen.
+    if (!newhead) return 0;
+
+    if (std::atomic_compare_exchange_weak_explicit(
+            &head_, &oldhead, newhead, std::memory_order_release,
+            std::memory_order_relaxed))
       break;
-    std::this_thread::yield();
+    stats_.on_head_retry();
   }
-  return std::move(opt.access());
+
+  // The run is ours now. Only its first node may have been invalidated (by
+  // a single-item dequeuer that saw head == tail), and invalidate() settles
+  // which of us gets the value.
+  std::size_t n = 0;
+  auto i = oldhead.get();
+  for (std::size_t j = 0; j < claimed; ++j) {
+    if (i->val.invalidate()) {
+      out[n++] = std::move(*i->val.get());
+      i->val.get()->~T();
+      stats_.on_dequeue(*i);
+    }
+    i = std::atomic_load_explicit(&i->next, std::memory_order_relaxed).get();
+  }
+
+  // Everything claimed was invalid only if we claimed just an invalid
+  // head; try the next one.
+  if (n == 0) return try_dequeue_bulk(out, max);
+
+  remove_version_.fetch_add(n, std::memory_order_relaxed);
+  return n;
 }
 
-// As is the normal assumption, the queue should not be in use
-// by other threads.
-template<typename T>
-shared_queue<T>::~shared_queue() {
-  // Manually run through the list to avoid blowing the stack
-  // with destructor calls.
-  //
-  // To destroy manually, we can't invoke the regular shared pointer
-  // destructor since that would recursively delete the rest of the
-  // list, and thus we have to rely on a custom deletion function.
-  //
-  // Usually, the node deletes itself (i.e., during normal queue operation
-  // in its lifetime). However, during destruction we disable for the reasons
-  // above.
-  //
-  // We also take care to clear out shared pointers to nodes, so that we're
-  // not left with the local variable 'i' being the second-to-last
-  // shared owner of the node (we want it to be exactly the last one).
+// TODO optimization: do manual RVO on the optional by inlining?
+template<typename T, typename W, typename S>
+T shared_queue<T, W, S>::dequeue() {
+  auto opt = wait_.wait([this]() { return try_dequeue(); });
+  return std::move(opt.access());
+}
 
-  auto oldhead = std::atomic_load_explicit(&head_, std::memory_order_acquire);
-  auto start = std::atomic_load_explicit(&oldhead->next,
-                                         std::memory_order_acquire);
-  std::atomic_store_explicit(&oldhead->next, std::shared_ptr<node>(),
-                             std::memory_order_relaxed);
-  auto oldtail = std::atomic_load_explicit(&tail_, std::memory_order_relaxed);
-  for (auto i = start; i != oldtail && i != nullptr;) {
-    start.reset();
-    auto to_delete = i.get();
-    to_delete->delete_self = false;
+template<typename T, typename W, typename S>
+util::optional<T> shared_queue<T, W, S>::dequeue_until(
+    std::chrono::steady_clock::time_point deadline) {
+  return wait_.wait_until([this]() { return try_dequeue(); }, deadline);
+}
 
-    // Note deleter called below in assignement; (*i)::operator().
-    i = std::atomic_load_explicit(&i->next, std::memory_order_acquire);
+template<typename T, typename W, typename S>
+stats::summary shared_queue<T, W, S>::get_stats() const {
+  stats::summary total;
+  stats_.collect(total);
+  return total;
+}
 
-    std::atomic_store_explicit(&to_delete->next, std::shared_ptr<node>(),
-                               std::memory_order_relaxed);
-    delete to_delete;
+template<typename T, typename W, typename S>
+void shared_queue<T, W, S>::node::deleter(node* self) {
+  // Trivially destructible, so both are usable during thread and static
+  // destruction.
+  static thread_local node* pending = nullptr;
+  static thread_local bool unlinking = false;
+  self->unlink_next = pending;
+  pending = self;
+  if (unlinking) return;
+  unlinking = true;
+  while (pending) {
+    auto n = pending;
+    pending = n->unlink_next;
+    delete n;
   }
-
-  // Let the queue's shared_ptrs take care of their own memory.
-  oldhead->delete_self = true;
-  oldtail->delete_self = true;
+  unlinking = false;
 }
 
+// As is the normal assumption, the queue should not be in use
+// by other threads. The members' destructors release the list, and
+// node::deleter() keeps that from recursing down it.
+template<typename T, typename W, typename S>
+shared_queue<T, W, S>::~shared_queue() {}
+
 // Requires dequeuers are not operating on the queue.
-template<typename T>
-std::ostream& operator<<(std::ostream& o, const shared_queue<T>& q) {
+template<typename T, typename W, typename S>
+std::ostream& operator<<(std::ostream& o, const shared_queue<T, W, S>& q) {
   auto tail = std::atomic_load_explicit(&q.tail_, std::memory_order_relaxed);
   auto head = std::atomic_load_explicit(&q.head_, std::memory_order_acquire);
 
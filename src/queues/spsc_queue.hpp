@@ -0,0 +1,100 @@
+/*
+ * Vladimir Feinberg
+ * queues/spsc_queue.hpp
+ * 2026-10-14
+ *
+ * Bounded wait-free FIFO queue for exactly one producer and one consumer.
+ * Implemented over a fixed ring of slots; each side publishes its own index
+ * and keeps a cached copy of the other side's, so it only touches the
+ * other side's cache line when the cached copy says full/empty.
+ */
+
+#ifndef QUEUES_SPSC_QUEUE_HPP_
+#define QUEUES_SPSC_QUEUE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <ostream>
+
+#include "queues/queue.hpp"
+#include "util/cache_line.hpp"
+#include "util/optional.hpp"
+
+namespace queues {
+
+template<typename T>
+class spsc_queue;
+
+template<typename T>
+std::ostream& operator<<(std::ostream&, const spsc_queue<T>&);
+
+// T does not have to be synchronized; this class will provide the needed
+// memory bariers for it to be always accessed in a linearized manner.
+//
+// Only one thread at a time may enqueue, and only one thread at a time may
+// dequeue (they may be different threads). The "try" methods are
+// wait-free. enqueue() blocks while the queue is full, dequeue() while it
+// is empty.
+//
+// The queue holds at most capacity() items, the requested size rounded up
+// to a power of two. T's move constructor should not throw.
+template<typename T>
+class spsc_queue : public queue<T> {
+ private:
+  struct slot {
+    alignas(T) char store_[sizeof(T)];
+    T* get() { return reinterpret_cast<T*>(store_); }
+    const T* get() const { return reinterpret_cast<const T*>(store_); }
+  };
+
+  static std::size_t round_capacity(std::size_t requested);
+
+  // Moves from t only on success.
+  bool push(T& t);
+
+  // Read-only after construction.
+  const std::size_t mask_;
+  const std::unique_ptr<slot[]> slots_;
+  // Producer line: its index, and its last look at the consumer's.
+  util::cache_pad<0> pad0_;
+  std::atomic<std::size_t> tail_;
+  std::size_t cached_head_;
+  util::cache_pad<sizeof(std::atomic<std::size_t>) +
+                  sizeof(std::size_t)> pad1_;
+  // Consumer line, the mirror image.
+  std::atomic<std::size_t> head_;
+  std::size_t cached_tail_;
+  util::cache_pad<sizeof(std::atomic<std::size_t>) +
+                  sizeof(std::size_t)> pad2_;
+
+ public:
+  static constexpr std::size_t kDefaultCapacity = 1 << 16;
+  // Capacity is rounded up to the nearest power of two (at least 2).
+  explicit spsc_queue(std::size_t capacity = kDefaultCapacity);
+  virtual ~spsc_queue();
+  spsc_queue(const spsc_queue&) = delete;
+  spsc_queue& operator=(const spsc_queue&) = delete;
+  // Observers - snapshots if the other side is running.
+  std::size_t capacity() const { return mask_ + 1; }
+  virtual bool full() const;
+  virtual bool empty() const;
+  // Producer side.
+  virtual void enqueue(T t);
+  virtual bool try_enqueue(T t) { return push(t); }
+  // Publishes the whole range at once (or as much as fits, while full).
+  virtual void enqueue_bulk(T* first, T* last);
+  // Consumer side.
+  virtual T dequeue();
+  virtual util::optional<T> try_dequeue();
+  virtual std::size_t try_dequeue_bulk(T* out, std::size_t max);
+  // For debugging. Prints [head ... tail]. Requires that the consumer is
+  // not running.
+  friend std::ostream& operator<< <>(std::ostream&, const spsc_queue&);
+};
+
+} // namespace queues
+
+#include "queues/spsc_queue.tpp"
+
+#endif /* QUEUES_SPSC_QUEUE_HPP_ */
@@ -0,0 +1,159 @@
+/*
+   Vladimir Feinberg
+   queues/spsc_queue.tpp
+   2026-10-14
+
+   spsc_queue implementation.
+ */
+
+// Implementation details:
+//
+// Items live in [head_, tail_) (indices grow forever, slots are taken mod
+// capacity). The producer constructs into slot tail_ and then release-
+// stores tail_ + 1; the consumer acquires tail_ before reading the slot.
+// Symmetrically, the consumer destroys slot head_ before release-storing
+// head_ + 1, and the producer acquires head_ before reusing the slot.
+//
+// Each side re-reads the other's index only when its cached copy claims the
+// queue is full (producer) or empty (consumer), so in steady state neither
+// side loads the other's cache line per item.
+
+#include <algorithm>
+#include <thread>
+#include <utility>
+
+namespace queues {
+
+template<typename T>
+constexpr std::size_t spsc_queue<T>::kDefaultCapacity;
+
+template<typename T>
+std::size_t spsc_queue<T>::round_capacity(std::size_t requested) {
+  std::size_t cap = 2;
+  while (cap < requested) cap <<= 1;
+  return cap;
+}
+
+template<typename T>
+spsc_queue<T>::spsc_queue(std::size_t capacity) :
+    mask_(round_capacity(capacity) - 1),
+    slots_(new slot[mask_ + 1]),
+    tail_(0), cached_head_(0), head_(0), cached_tail_(0) {}
+
+// As is the normal assumption, the queue should not be in use
+// by other threads.
+template<typename T>
+spsc_queue<T>::~spsc_queue() {
+  auto end = tail_.load(std::memory_order_relaxed);
+  for (auto i = head_.load(std::memory_order_relaxed); i != end; ++i)
+    slots_[i & mask_].get()->~T();
+}
+
+template<typename T>
+bool spsc_queue<T>::full() const {
+  auto head = head_.load(std::memory_order_relaxed);
+  auto tail = tail_.load(std::memory_order_relaxed);
+  return tail - head >= capacity();
+}
+
+template<typename T>
+bool spsc_queue<T>::empty() const {
+  auto tail = tail_.load(std::memory_order_relaxed);
+  auto head = head_.load(std::memory_order_relaxed);
+  return tail == head;
+}
+
+template<typename T>
+bool spsc_queue<T>::push(T& t) {
+  auto tail = tail_.load(std::memory_order_relaxed);
+  if (tail - cached_head_ == capacity()) {
+    cached_head_ = head_.load(std::memory_order_acquire);
+    if (tail - cached_head_ == capacity()) return false;
+  }
+  new (slots_[tail & mask_].get()) T(std::move(t));
+  tail_.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
+template<typename T>
+void spsc_queue<T>::enqueue(T t) {
+  while (!push(t))
+    std::this_thread::yield();
+}
+
+template<typename T>
+void spsc_queue<T>::enqueue_bulk(T* first, T* last) {
+  auto tail = tail_.load(std::memory_order_relaxed);
+  while (first != last) {
+    auto room = capacity() - (tail - cached_head_);
+    if (!room) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      room = capacity() - (tail - cached_head_);
+      if (!room) {
+        std::this_thread::yield();
+        continue;
+      }
+    }
+    auto n = std::min<std::size_t>(room, last - first);
+    for (std::size_t i = 0; i < n; ++i, ++first)
+      new (slots_[(tail + i) & mask_].get()) T(std::move(*first));
+    tail += n;
+    tail_.store(tail, std::memory_order_release);
+  }
+}
+
+template<typename T>
+util::optional<T> spsc_queue<T>::try_dequeue() {
+  auto head = head_.load(std::memory_order_relaxed);
+  if (head == cached_tail_) {
+    cached_tail_ = tail_.load(std::memory_order_acquire);
+    if (head == cached_tail_) return {};
+  }
+  auto s = slots_[head & mask_].get();
+  util::optional<T> ret(std::move(*s));
+  s->~T();
+  head_.store(head + 1, std::memory_order_release);
+  return ret;
+}
+
+template<typename T>
+std::size_t spsc_queue<T>::try_dequeue_bulk(T* out, std::size_t max) {
+  auto head = head_.load(std::memory_order_relaxed);
+  if (cached_tail_ - head < max)
+    cached_tail_ = tail_.load(std::memory_order_acquire);
+  auto n = std::min<std::size_t>(cached_tail_ - head, max);
+  for (std::size_t i = 0; i < n; ++i) {
+    auto s = slots_[(head + i) & mask_].get();
+    out[i] = std::move(*s);
+    s->~T();
+  }
+  if (n) head_.store(head + n, std::memory_order_release);
+  return n;
+}
+
+template<typename T>
+T spsc_queue<T>::dequeue() {
+  util::optional<T> opt;
+  while (true) {
+    opt = try_dequeue();
+    if (opt.valid())
+      break;
+    std::this_thread::yield();
+  }
+  return std::move(opt.access());
+}
+
+template<typename T>
+std::ostream& operator<<(std::ostream& o, const spsc_queue<T>& q) {
+  auto head = q.head_.load(std::memory_order_relaxed);
+  auto tail = q.tail_.load(std::memory_order_acquire);
+
+  o << "[";
+  for (auto i = head; i != tail; ++i) {
+    if (i != head) o << ", ";
+    o << *q.slots_[i & q.mask_].get();
+  }
+  return o << "]";
+}
+
+} // namespace queues
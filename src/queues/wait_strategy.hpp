@@ -0,0 +1,120 @@
+/*
+  Vladimir Feinberg
+  queues/wait_strategy.hpp
+  2026-10-14
+
+  Waiting strategies for the blocking dequeues of unbounded queues (see
+  queues/hazard_queue.hpp, queues/shared_queue.hpp).
+
+  A strategy W provides:
+
+    W::notify(count)    - called by enqueuers after publishing 'count'
+                          items (1 by default). Should be (nearly) free
+                          when there are no waiters.
+    W::wait(attempt)    - calls 'attempt', which returns a util::optional,
+                          until it produces a value, and returns it.
+    W::wait_until(attempt, deadline)
+                        - same, but returns an invalid optional once the
+                          deadline (of std::chrono::steady_clock) passes.
+
+  yield_wait retries in a loop with std::this_thread::yield(), which keeps
+  latency low but burns a core per idle consumer. park_wait spins for a
+  little, then sleeps on a synchro::eventcount until an enqueue happens.
+*/
+
+#ifndef QUEUES_WAIT_STRATEGY_HPP_
+#define QUEUES_WAIT_STRATEGY_HPP_
+
+#include <chrono>
+#include <cstddef>
+#include <thread>
+
+#include "synchro/eventcount.hpp"
+
+namespace queues {
+
+struct yield_wait {
+  typedef std::chrono::steady_clock clock;
+
+  void notify(std::size_t = 1) {}
+
+  template<typename Attempt>
+  auto wait(Attempt attempt) -> decltype(attempt()) {
+    while (true) {
+      auto opt = attempt();
+      if (opt.valid()) return opt;
+      std::this_thread::yield();
+    }
+  }
+
+  template<typename Attempt>
+  auto wait_until(Attempt attempt, clock::time_point deadline)
+      -> decltype(attempt()) {
+    while (true) {
+      auto opt = attempt();
+      if (opt.valid() || clock::now() >= deadline) return opt;
+      std::this_thread::yield();
+    }
+  }
+};
+
+class park_wait {
+ public:
+  typedef std::chrono::steady_clock clock;
+  // Attempts made before the first park, to ride out short gaps between
+  // enqueues without a sleep and wake-up.
+  static const int kSpins = 64;
+
+  park_wait() {}
+
+  // With nobody parked, a fence and a load. A single item wakes a single
+  // consumer; waking them all would have all but one park again.
+  void notify(std::size_t count = 1) {
+    if (count == 1) ec_.notify_one();
+    else ec_.notify_all();
+  }
+
+  template<typename Attempt>
+  auto wait(Attempt attempt) -> decltype(attempt()) {
+    return wait_impl(attempt, false, clock::time_point());
+  }
+
+  template<typename Attempt>
+  auto wait_until(Attempt attempt, clock::time_point deadline)
+      -> decltype(attempt()) {
+    return wait_impl(attempt, true, deadline);
+  }
+
+ private:
+  template<typename Attempt>
+  auto wait_impl(Attempt& attempt, bool timed, clock::time_point deadline)
+      -> decltype(attempt()) {
+    for (int i = 0; i < kSpins; ++i) {
+      auto opt = attempt();
+      if (opt.valid()) return opt;
+    }
+    while (true) {
+      auto key = ec_.prepare_wait();
+      // Re-check once registered, see synchro/eventcount.hpp.
+      auto opt = attempt();
+      if (opt.valid()) {
+        ec_.cancel_wait();
+        return opt;
+      }
+      if (!timed) {
+        ec_.wait(key);
+      } else if (!ec_.wait_until(key, deadline)) {
+        return attempt();
+      }
+      // Woken by an enqueue, but another dequeuer may have beaten us to it.
+      opt = attempt();
+      if (opt.valid()) return opt;
+    }
+  }
+
+  synchro::eventcount ec_;
+};
+
+} // namespace queues
+
+#endif /* QUEUES_WAIT_STRATEGY_HPP_ */
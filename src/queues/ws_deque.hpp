@@ -0,0 +1,89 @@
+/*
+ * Vladimir Feinberg
+ * queues/ws_deque.hpp
+ * 2026-10-14
+ *
+ * Work-stealing deque: one owner thread pushes and pops at the bottom
+ * (LIFO), any number of thieves steal from the top (FIFO). Unbounded,
+ * over a growable circular array.
+ *
+ * The algorithm is the Chase-Lev deque, with the C11 memory orderings from
+ * Le, Pop, Cohen, Zappa Nardelli, "Correct and Efficient Work-Stealing for
+ * Weak Memory Models" (PPoPP 2013).
+ */
+
+#ifndef QUEUES_WS_DEQUE_HPP_
+#define QUEUES_WS_DEQUE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "util/cache_line.hpp"
+#include "util/optional.hpp"
+
+namespace queues {
+
+// T must be trivially copyable (it is stored in std::atomic slots), so
+// this is meant for pointers to tasks, indices, and the like.
+//
+// push() and pop() may only be called by the owning thread; steal() and
+// the observers by any thread.
+template<typename T>
+class ws_deque {
+ private:
+  struct ring {
+    explicit ring(std::size_t cap);
+    std::size_t mask() const { return cap_ - 1; }
+    T get(std::int64_t i) const {
+      return slots_[i & mask()].load(std::memory_order_relaxed);
+    }
+    void put(std::int64_t i, T t) {
+      slots_[i & mask()].store(t, std::memory_order_relaxed);
+    }
+    // Copy of [top, bottom) into a ring twice the size.
+    ring* grow(std::int64_t top, std::int64_t bottom) const;
+
+    const std::size_t cap_;
+    std::unique_ptr<std::atomic<T>[]> slots_;
+  };
+
+  void grow(std::int64_t top, std::int64_t bottom);
+
+  // Thieves CAS top_, the owner writes bottom_: keep them on separate lines.
+  util::cache_pad<0> pad0_;
+  std::atomic<std::int64_t> top_;
+  util::cache_pad<sizeof(std::atomic<std::int64_t>)> pad1_;
+  std::atomic<std::int64_t> bottom_;
+  std::atomic<ring*> ring_;
+  // Rings outgrown by the owner. A thief may still be reading one, so they
+  // are kept until the deque dies (they at most double the footprint).
+  std::vector<std::unique_ptr<ring> > retired_;
+
+ public:
+  static constexpr std::size_t kDefaultCapacity = 64;
+  // Capacity is rounded up to the nearest power of two.
+  explicit ws_deque(std::size_t capacity = kDefaultCapacity);
+  ~ws_deque();
+  ws_deque(const ws_deque&) = delete;
+  ws_deque& operator=(const ws_deque&) = delete;
+
+  // Owner only.
+  void push(T t);
+  util::optional<T> pop();
+  // Any thread. Fails if the deque is empty or another thread won the race
+  // for the top item.
+  util::optional<T> steal();
+
+  // Snapshots under contention.
+  std::size_t size() const;
+  bool empty() const { return size() == 0; }
+};
+
+} // namespace queues
+
+#include "queues/ws_deque.tpp"
+
+#endif /* QUEUES_WS_DEQUE_HPP_ */
@@ -0,0 +1,126 @@
+/*
+   Vladimir Feinberg
+   queues/ws_deque.tpp
+   2026-10-14
+
+   ws_deque implementation.
+ */
+
+// Implementation details:
+//
+// Items live in [top_, bottom_). The owner pushes by writing the slot at
+// bottom_ and then publishing bottom_ + 1 (release). pop() speculatively
+// takes bottom_ - 1 and then, after a seq_cst fence, reads top_: if the
+// item was not the last one no thief can reach it; if it was, owner and
+// thieves race with a CAS on top_. steal() reads top_, fences, reads
+// bottom_, then claims the top item with the same CAS.
+//
+// Indices only grow, so the CAS on top_ has no ABA problem. The owner is the
+// only one to replace ring_; a thief that loaded the old ring reads a stale
+// but still valid copy of the slot it claims, since the owner never
+// overwrites slots in [top_, bottom_) without growing.
+
+#include <algorithm>
+
+namespace queues {
+
+template<typename T>
+constexpr std::size_t ws_deque<T>::kDefaultCapacity;
+
+template<typename T>
+ws_deque<T>::ring::ring(std::size_t cap) :
+    cap_(cap), slots_(new std::atomic<T>[cap]) {}
+
+template<typename T>
+typename ws_deque<T>::ring*
+ws_deque<T>::ring::grow(std::int64_t top, std::int64_t bottom) const {
+  auto bigger = new ring(2 * cap_);
+  for (auto i = top; i != bottom; ++i)
+    bigger->put(i, get(i));
+  return bigger;
+}
+
+template<typename T>
+ws_deque<T>::ws_deque(std::size_t capacity) :
+    top_(0), bottom_(0), ring_(nullptr) {
+  std::size_t cap = 1;
+  while (cap < capacity) cap <<= 1;
+  ring_.store(new ring(cap), std::memory_order_relaxed);
+}
+
+template<typename T>
+ws_deque<T>::~ws_deque() {
+  delete ring_.load(std::memory_order_relaxed);
+}
+
+template<typename T>
+void ws_deque<T>::grow(std::int64_t top, std::int64_t bottom) {
+  auto old = ring_.load(std::memory_order_relaxed);
+  ring_.store(old->grow(top, bottom), std::memory_order_release);
+  retired_.emplace_back(old);
+}
+
+template<typename T>
+void ws_deque<T>::push(T t) {
+  auto b = bottom_.load(std::memory_order_relaxed);
+  auto top = top_.load(std::memory_order_acquire);
+  auto r = ring_.load(std::memory_order_relaxed);
+  if (b - top > static_cast<std::int64_t>(r->mask())) {
+    grow(top, b);
+    r = ring_.load(std::memory_order_relaxed);
+  }
+  r->put(b, t);
+  std::atomic_thread_fence(std::memory_order_release);
+  bottom_.store(b + 1, std::memory_order_relaxed);
+}
+
+template<typename T>
+util::optional<T> ws_deque<T>::pop() {
+  auto b = bottom_.load(std::memory_order_relaxed) - 1;
+  auto r = ring_.load(std::memory_order_relaxed);
+  bottom_.store(b, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  auto top = top_.load(std::memory_order_relaxed);
+  util::optional<T> opt;
+  if (top <= b) {
+    if (top == b) {
+      // Last item: race the thieves for it.
+      if (top_.compare_exchange_strong(top, top + 1,
+                                       std::memory_order_seq_cst,
+                                       std::memory_order_relaxed))
+        opt = r->get(b);
+      bottom_.store(b + 1, std::memory_order_relaxed);
+    } else {
+      opt = r->get(b);
+    }
+  } else {
+    bottom_.store(b + 1, std::memory_order_relaxed);
+  }
+  return opt;
+}
+
+template<typename T>
+util::optional<T> ws_deque<T>::steal() {
+  auto top = top_.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  auto b = bottom_.load(std::memory_order_acquire);
+  util::optional<T> opt;
+  if (top < b) {
+    // Read before the CAS: once top_ moves the owner may reuse the slot.
+    T t = ring_.load(std::memory_order_acquire)->get(top);
+    if (top_.compare_exchange_strong(top, top + 1,
+                                     std::memory_order_seq_cst,
+                                     std::memory_order_relaxed))
+      opt = t;
+  }
+  return opt;
+}
+
+template<typename T>
+std::size_t ws_deque<T>::size() const {
+  auto b = bottom_.load(std::memory_order_relaxed);
+  auto top = top_.load(std::memory_order_relaxed);
+  return static_cast<std::size_t>(std::max<std::int64_t>(b - top, 0));
+}
+
+} // namespace queues
@@ -0,0 +1,214 @@
+/*
+  Vladimir Feinberg
+  synchro/asp-test.cpp
+  2026-10-14
+
+  Atomic shared pointer test. Pass "bench" to compare it with libstdc++'s
+  std::atomic_* on a plain std::shared_ptr.
+*/
+
+#include "synchro/atomic_shared.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "synchro/epoch.hpp"
+#include "util/bench.hpp"
+#include "util/uassert.hpp"
+
+using namespace std;
+using namespace synchro;
+
+namespace {
+
+// Tracks how many instances are alive, and poisons itself on deletion so
+// readers notice a premature free.
+struct counted {
+  static const int kMagic = 0x5eed;
+  explicit counted(int v = 0) : magic(kMagic), val(v) {
+    live.fetch_add(1, std::memory_order_relaxed);
+  }
+  ~counted() {
+    magic = 0;
+    live.fetch_sub(1, std::memory_order_relaxed);
+  }
+  volatile int magic;
+  int val;
+  static std::atomic<int> live;
+};
+std::atomic<int> counted::live(0);
+
+// Replaced values are released lazily, by epoch reclamation.
+void collect_all() {
+  for (int i = 0; i < 4; ++i) epoch_domain::collect();
+}
+
+// Plain shared_ptr through the standard library's atomic overloads.
+template<typename T>
+struct std_slot {
+  explicit std_slot(shared_ptr<T> p) : ptr(move(p)) {}
+  shared_ptr<T> load() const {
+    return atomic_load_explicit(&ptr, memory_order_acquire);
+  }
+  void store(shared_ptr<T> p) {
+    atomic_store_explicit(&ptr, move(p), memory_order_release);
+  }
+  shared_ptr<T> ptr;
+};
+
+template<typename T>
+struct asp_slot {
+  explicit asp_slot(shared_ptr<T> p) : ptr(move(p)) {}
+  shared_ptr<T> load() const { return ptr.load(memory_order_acquire); }
+  void store(shared_ptr<T> p) { ptr.store(move(p), memory_order_release); }
+  atomic_shared_ptr<T> ptr;
+};
+
+// nthreads hammer one slot; every 'store_every'-th operation is a store.
+template<template<typename> class Slot>
+void bench_slot(util::bench::suite& suite, const string& name, int nthreads,
+                int store_every) {
+  static const int kOps = 1000000;
+  auto a = make_shared<int>(1), b = make_shared<int>(2);
+  std::atomic<long> sink(0);
+  string config = " (" + to_string(nthreads) + " threads, 1 in " +
+      to_string(store_every) + " stores)";
+  suite.run_manual(name + config, [&]() {
+      Slot<int> slot(a);
+      return util::bench::time_threads(nthreads, [&](int) {
+          long local = 0;
+          for (int i = 0; i < kOps / nthreads; ++i) {
+            if (i % store_every == 0) slot.store(i % 2 ? a : b);
+            else local += *slot.load();
+          }
+          sink.fetch_add(local);
+        });
+    }, kOps / nthreads * nthreads);
+}
+
+void bench() {
+  util::bench::suite suite("Atomic shared pointer benchmark");
+  int hw = max(static_cast<int>(thread::hardware_concurrency()), 1);
+  for (int store_every : {100, 2}) {
+    for (int threads = 1; threads <= 2 * hw; threads *= 2) {
+      bench_slot<std_slot>(suite, "std::atomic_* on shared_ptr", threads,
+                           store_every);
+      bench_slot<asp_slot>(suite, "atomic_shared_ptr", threads,
+                           store_every);
+    }
+  }
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+  if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+    bench();
+    return 0;
+  }
+
+  cout << "Atomic shared pointer testing." << endl;
+
+  cout << "=====> Testing basic sequential execution" << endl;
+  {
+    atomic_shared_ptr<counted> p;
+    UASSERT(atomic_is_lock_free(&p));
+    UASSERT(!atomic_load_explicit(&p, memory_order_relaxed));
+    auto one = make_shared<counted>(1);
+    atomic_store_explicit(&p, one, memory_order_release);
+    auto got = atomic_load_explicit(&p, memory_order_acquire);
+    UASSERT(got == one && got->val == 1);
+    UASSERT(one.use_count() == 3) << "use count " << one.use_count();
+    auto old = atomic_exchange_explicit(&p, make_shared<counted>(2),
+                                        memory_order_acq_rel);
+    UASSERT(old == one);
+    UASSERT(p.load()->val == 2);
+    got.reset();
+    old.reset();
+    one.reset();
+    collect_all();
+    UASSERT(counted::live.load() == 1)
+        << counted::live.load() << " alive after exchange";
+  }
+  UASSERT(counted::live.load() == 0)
+      << counted::live.load() << " alive after destruction";
+  cout << "...... Complete!" << endl;
+
+  cout << "=====> Testing compare and exchange" << endl;
+  {
+    auto one = make_shared<counted>(1), two = make_shared<counted>(2);
+    atomic_shared_ptr<counted> p(one);
+    auto expected = two;
+    UASSERT(!atomic_compare_exchange_strong_explicit(
+        &p, &expected, two, memory_order_acq_rel, memory_order_acquire));
+    UASSERT(expected == one) << "failed CAS did not load current value";
+    UASSERT(atomic_compare_exchange_strong_explicit(
+        &p, &expected, two, memory_order_acq_rel, memory_order_acquire));
+    UASSERT(p.load() == two);
+    // Same pointer, different owner: not equivalent.
+    shared_ptr<counted> alias(shared_ptr<counted>(), two.get());
+    UASSERT(!p.compare_exchange_strong(alias, nullptr, memory_order_seq_cst,
+                                       memory_order_seq_cst));
+    UASSERT(alias == two && !alias.owner_before(two) &&
+            !two.owner_before(alias));
+    // Empty to empty.
+    shared_ptr<counted> empty;
+    atomic_shared_ptr<counted> q;
+    UASSERT(q.compare_exchange_strong(empty, one, memory_order_seq_cst,
+                                      memory_order_seq_cst));
+    UASSERT(q.load() == one);
+    one.reset();
+    two.reset();
+    expected.reset();
+    alias.reset();
+  }
+  collect_all();
+  UASSERT(counted::live.load() == 0)
+      << counted::live.load() << " alive after CAS test";
+  cout << "...... Complete!" << endl;
+
+  cout << "=====> Testing concurrent loads, stores and CAS" << endl;
+  {
+    static const int kThreads = 4, kIters = 20000;
+    atomic_shared_ptr<counted> p(make_shared<counted>(0));
+    std::atomic<int> increments(0);
+    vector<future<void> > futs;
+    for (int t = 0; t < kThreads; ++t)
+      futs.push_back(async(launch::async, [&, t]() {
+            for (int i = 0; i < kIters; ++i) {
+              auto cur = p.load();
+              UASSERT(cur->magic == counted::kMagic)
+                  << "loaded a freed value";
+              // Half the threads count up by CAS, so no increment may be
+              // lost; the other half just churn loads.
+              if (t % 2) continue;
+              auto next = make_shared<counted>(cur->val + 1);
+              while (!p.compare_exchange_weak(cur, next,
+                                              memory_order_acq_rel,
+                                              memory_order_acquire)) {
+                UASSERT(cur->magic == counted::kMagic)
+                    << "CAS loaded a freed value";
+                next = make_shared<counted>(cur->val + 1);
+              }
+              increments.fetch_add(1, memory_order_relaxed);
+            }
+          }));
+    for (auto& f : futs) f.get();
+    UASSERT(p.load()->val == increments.load())
+        << "value " << p.load()->val << ", " << increments.load()
+        << " increments";
+  }
+  collect_all();
+  UASSERT(counted::live.load() == 0)
+      << counted::live.load() << " alive after stress test";
+  cout << "...... Complete!" << endl;
+
+  return 0;
+}
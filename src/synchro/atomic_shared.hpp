@@ -3,62 +3,121 @@
   2014-09-08
   synchro/atomic_shared.hpp
 
-  Atomic operations on shared pointers themselves are unfortuantely not
-  supported by libstdc++, even though they are by libc++. This header
-  provides a temporary compatibility resolution for the problem, which
-  can safely be used in a libstd=libc++ enviornment because it decays
-  to the defualt behavior (using template magic, of course).
-
-  After this file is included, the atomic_shared_ptr will support all
-  standard shared_ptr operations, both the nonatomic member functions
-  and the atomic overloads that are declared in this header.
+  Lock-free atomic shared pointer. libstdc++ implements the std::atomic_*
+  overloads for shared_ptr with a pool of mutexes (and before gcc 5 not at
+  all), so every load or store of a shared pointer takes a lock.
+
+  atomic_shared_ptr<T> holds a std::shared_ptr<T> and supports the
+  std::atomic_*_explicit overloads declared below, as well as the
+  equivalent member functions (the interface of C++20's
+  std::atomic<std::shared_ptr<T>>). Loads and stores hand out and take in
+  plain std::shared_ptr<T> values.
 */
 
 #ifndef SYNCHRO_ATOMIC_SHARED_HPP_
 #define SYNCHRO_ATOMIC_SHARED_HPP_
 
+#include <atomic>
 #include <memory>
 
-#include "synchro/atomic_shared.tpp"
+#include "util/node_pool.hpp"
 
 namespace synchro {
 
-// Use this class just like a shared_ptr<T>. Obviously, shared_ptr<T> doesn't
-// have a virtual destructor, so don't rely on a polymorphic delete!
-// Don't rely on the fact that an atomic_shared_ptr extends shared_ptr at all.
-// TODO implement this with composition eventually...
+// The value lives in an immutable, heap-allocated holder, and the
+// atomic_shared_ptr itself is a single atomic pointer to the current holder
+// (nullptr for an empty shared_ptr). A load copies the shared_ptr out of
+// the holder inside an epoch critical section (synchro/epoch.hpp); a store
+// swaps in a new holder and retires the old one to the epoch domain, which
+// releases the old reference once no loader can still be copying it.
+//
+// So a load is a guard, an acquire load and a reference count increment,
+// a store one allocation (from a util::node_pool) plus an exchange, and no
+// operation takes a lock. The catch is that a replaced value's reference is
+// dropped late, at the next epoch reclamation.
+//
+// Copying or moving an atomic_shared_ptr is not supported; destroying one
+// requires that no other thread uses it.
 template<class T>
-using atomic_shared_ptr = _synchro_atomic_shared_internal::selected<T>;
+class atomic_shared_ptr {
+ public:
+  atomic_shared_ptr() noexcept : holder_(nullptr) {}
+  atomic_shared_ptr(std::shared_ptr<T> desired);
+  ~atomic_shared_ptr();
+  atomic_shared_ptr(const atomic_shared_ptr&) = delete;
+  atomic_shared_ptr& operator=(const atomic_shared_ptr&) = delete;
+
+  bool is_lock_free() const noexcept { return holder_.is_lock_free(); }
+
+  // Loads are at least acquire and stores at least release, whatever order
+  // is requested (the holder has to be published); seq_cst is honored.
+  std::shared_ptr<T> load(
+      std::memory_order mo = std::memory_order_seq_cst) const;
+  void store(std::shared_ptr<T> desired,
+             std::memory_order mo = std::memory_order_seq_cst);
+  std::shared_ptr<T> exchange(std::shared_ptr<T> desired,
+                              std::memory_order mo = std::memory_order_seq_cst);
+  // Succeeds if the current value is equivalent to 'expected' (same
+  // pointer and same ownership), otherwise loads the current value into
+  // 'expected'. The weak version may fail spuriously.
+  bool compare_exchange_strong(std::shared_ptr<T>& expected,
+                               std::shared_ptr<T> desired,
+                               std::memory_order success,
+                               std::memory_order failure);
+  bool compare_exchange_weak(std::shared_ptr<T>& expected,
+                             std::shared_ptr<T> desired,
+                             std::memory_order success,
+                             std::memory_order failure);
+
+ private:
+  struct holder : util::pooled<holder> {
+    explicit holder(std::shared_ptr<T>&& p) : ptr(std::move(p)) {}
+    const std::shared_ptr<T> ptr;
+  };
+
+  static holder* make_holder(std::shared_ptr<T>&& p);
+  static std::shared_ptr<T> value(const holder* h);
+  static bool equivalent(const holder* h, const std::shared_ptr<T>& p);
+  static void retire(holder* h);
+  bool compare_exchange(std::shared_ptr<T>& expected,
+                        std::shared_ptr<T>& desired, bool weak,
+                        std::memory_order success, std::memory_order failure);
+
+  std::atomic<holder*> holder_;
+};
 
 } // namespace synchro
 
 // Note there are no operations which work with two different
-// atomic_shared_ptrs - this could easily cause deadlock if you're not
-// careful anyway.
+// atomic_shared_ptrs.
+namespace std {
+
 template<class T>
-bool std::atomic_is_lock_free(const synchro::atomic_shared_ptr<T>* p);
+bool atomic_is_lock_free(const synchro::atomic_shared_ptr<T>* p);
 template<class T>
-std::shared_ptr<T> std::atomic_load_explicit(
+std::shared_ptr<T> atomic_load_explicit(
     const synchro::atomic_shared_ptr<T>* p, std::memory_order mo);
 template<class T>
-void std::atomic_store_explicit(
+void atomic_store_explicit(
     synchro::atomic_shared_ptr<T>* p, std::shared_ptr<T> r,
     std::memory_order mo);
 template<class T>
-std::shared_ptr<T> std::atomic_exchange_explicit(
+std::shared_ptr<T> atomic_exchange_explicit(
     synchro::atomic_shared_ptr<T>* p, std::shared_ptr<T> r,
     std::memory_order mo);
 template<class T>
-bool std::atomic_compare_exchange_strong_explicit(
+bool atomic_compare_exchange_strong_explicit(
     synchro::atomic_shared_ptr<T>* p, std::shared_ptr<T>* expected,
     std::shared_ptr<T> desired, std::memory_order success,
     std::memory_order failure);
 template<class T>
-bool std::atomic_compare_exchange_weak_explicit(
+bool atomic_compare_exchange_weak_explicit(
     synchro::atomic_shared_ptr<T>* p, std::shared_ptr<T>* expected,
     std::shared_ptr<T> desired, std::memory_order success,
     std::memory_order failure);
 
+} // namespace std
+
 /* TODO support defaults
 
 template< class T >
@@ -85,4 +144,6 @@ bool atomic_compare_exchange_strong( std::shared_ptr<T>* p,
                                      std::shared_ptr<T> desired);
 */
 
+#include "synchro/atomic_shared.tpp"
+
 #endif /* SYNCHRO_ATOMIC_SHARED_HPP_*/
@@ -0,0 +1,61 @@
+/*
+  Vladimir Feinberg
+  synchro/barrier-test.cpp
+  2026-10-15
+
+  Cyclic barrier unit test.
+*/
+
+#include "synchro/cyclic_barrier.hpp"
+
+#include <atomic>
+#include <future>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "util/uassert.hpp"
+
+using namespace std;
+using namespace synchro;
+
+// Each phase, every thread writes its slot (plainly) and arrives. After the
+// barrier every thread must see all slots written, the completion must have
+// run exactly once, and exactly one thread must have been last.
+void test_phases(int nthreads, int phases) {
+  cyclic_barrier barrier(nthreads);
+  UASSERT(barrier.parties() == nthreads);
+  UASSERT(barrier.phase() == 0);
+  vector<int> slots(nthreads, -1);
+  int completions = 0;
+  atomic<int> lasts(0);
+  vector<future<void> > futs;
+  for (int t = 0; t < nthreads; ++t)
+    futs.push_back(async(launch::async, [&, t]() {
+          minstd_rand gen(t);
+          for (int p = 0; p < phases; ++p) {
+            slots[t] = p;
+            if (gen() % 4 == 0) this_thread::yield();
+            if (barrier.arrive_and_wait([&] { ++completions; }))
+              lasts.fetch_add(1);
+            for (int s : slots) UASSERT(s == p) << s << " in phase " << p;
+            UASSERT(completions == p + 1);
+            // Nobody writes their slot again before everyone has checked.
+            if (barrier.arrive_and_wait()) lasts.fetch_add(1);
+          }
+        }));
+  for (auto& f : futs) f.get();
+  UASSERT(lasts.load() == 2 * phases);
+  UASSERT(barrier.phase() == static_cast<cyclic_barrier::phase_type>(
+      2 * phases));
+}
+
+int main() {
+  cout << "Cyclic barrier testing." << endl;
+  test_phases(1, 100);
+  test_phases(4, 2000);
+  // Oversubscribed, so that waiters sleep.
+  test_phases(4 * max(1u, thread::hardware_concurrency()), 200);
+  cout << "Success!" << endl;
+}
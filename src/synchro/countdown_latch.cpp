@@ -8,8 +8,7 @@
 
 #include "synchro/countdown_latch.hpp"
 
-#include <condition_variable>
-#include <mutex>
+#include <atomic>
 
 #include <util/uassert.hpp>
 
@@ -21,35 +20,33 @@ countdown_latch::countdown_latch(int wait) :
   UASSERT(wait > 0);
 }
 
-countdown_latch::~countdown_latch() {
-  // no need to acquire the lock - it's the user's fault if they
-  // are giving access across threads to a destructing object.
-  ready_.notify_all();
-}
-
 void countdown_latch::down() {
-  // notice the two fetches here - this is why we need a lock
-  bool broadcast = false;
-  {
-    lock_guard<mutex> lk(lock_);
-    if (unready_count_ == 0) return;
-    UASSERT(unready_count_ > 0);
-    broadcast = !--unready_count_;
-  }
-  // Broadcast-after-unlock is OK here since it's the user's responsibility to
-  // reset the countdown latch in a synchronized manner, so we can expect there
-  // will be no "intercepting" threads who call wait() at this moment.
-  if (broadcast)
+  // A compare-and-swap rather than a decrement, so the count stops at 0.
+  // Each down() releases, so that the waiters' acquire of 0 sees what every
+  // counting thread did before counting down.
+  int count = unready_count_.load(memory_order_relaxed);
+  do {
+    if (count == 0) return;
+    UASSERT(count > 0);
+  } while (!unready_count_.compare_exchange_weak(count, count - 1,
+                                                 memory_order_acq_rel,
+                                                 memory_order_relaxed));
+  if (count == 1)
     ready_.notify_all();
 }
 
 void countdown_latch::wait() {
-  unique_lock<mutex> lk(lock_);
-  ready_.wait(lk, [this] { return unready_count_ == 0; });
+  while (unready_count_.load(memory_order_acquire)) {
+    auto key = ready_.prepare_wait();
+    if (!unready_count_.load(memory_order_acquire)) {
+      ready_.cancel_wait();
+      return;
+    }
+    ready_.wait(key);
+  }
 }
 
 void countdown_latch::reset(int wait) {
   UASSERT(wait > 0);
-  lock_guard<mutex> lk(lock_);
-  unready_count_ = wait;
+  unready_count_.store(wait, memory_order_relaxed);
 }
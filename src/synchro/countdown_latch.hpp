@@ -9,8 +9,9 @@
 #ifndef SYNCHRO_COUNTDOWN_LATCH_HPP_
 #define SYNCHRO_COUNTDOWN_LATCH_HPP_
 
-#include <condition_variable>
-#include <mutex>
+#include <atomic>
+
+#include "synchro/eventcount.hpp"
 
 namespace synchro {
 
@@ -19,19 +20,24 @@ namespace synchro {
 // unready count is nonzero, all threads inside wait() are blocked.
 // As soon as the last thread calls down(), all blocked threads are released.
 //
+// The count is a single atomic: down() is one compare-and-swap, and only
+// the down() that reaches zero goes near a lock, and only if some thread
+// is blocked in wait() (see synchro/eventcount.hpp). wait() on a latch
+// that is already open is a load.
+//
 // This class is thread safe.
 class countdown_latch {
  public:
   countdown_latch(int wait); // requires wait > 0
-  ~countdown_latch(); // releases all waiting threads.
+  countdown_latch(const countdown_latch&) = delete;
+  countdown_latch& operator=(const countdown_latch&) = delete;
   void down(); // does nothing if count is at 0
   void wait();
   // Reset presumes there are no wait()-ing threads.
   void reset(int wait);
  private:
-  std::mutex lock_;
-  int unready_count_;
-  std::condition_variable ready_;
+  std::atomic<int> unready_count_;
+  eventcount ready_;
 };
 
 } // namespace synchro
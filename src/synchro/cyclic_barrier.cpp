@@ -0,0 +1,49 @@
+/*
+  Vladimir Feinberg
+  synchro/cyclic_barrier.cpp
+  2026-10-15
+
+  Implements the cyclic barrier class.
+*/
+
+#include "synchro/cyclic_barrier.hpp"
+
+#include <atomic>
+#include <cstdint>
+
+#include "util/uassert.hpp"
+
+using namespace std;
+using namespace synchro;
+
+namespace {
+  // Phase checks before sleeping: enough to catch a barrier whose parties
+  // arrive within a few microseconds of each other.
+  const int kSpins = 128;
+}
+
+cyclic_barrier::cyclic_barrier(int parties) :
+    parties_(parties), state_(0) {
+  UASSERT(parties > 0);
+}
+
+void cyclic_barrier::open(phase_type phase) {
+  // Every party has arrived and is waiting, so nobody else writes state_
+  // until they see the new phase: a store suffices, and clears the count.
+  state_.store(static_cast<uint64_t>(phase_type(phase + 1)) << kPhaseShift,
+               memory_order_release);
+  opened_.notify_all();
+}
+
+void cyclic_barrier::wait_for(phase_type phase) {
+  for (int i = 0; i < kSpins; ++i)
+    if (this->phase() != phase) return;
+  while (this->phase() == phase) {
+    auto key = opened_.prepare_wait();
+    if (this->phase() != phase) {
+      opened_.cancel_wait();
+      return;
+    }
+    opened_.wait(key);
+  }
+}
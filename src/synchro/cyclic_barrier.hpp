@@ -0,0 +1,103 @@
+/*
+  Vladimir Feinberg
+  synchro/cyclic_barrier.hpp
+  2026-10-15
+
+  Declares the cyclic barrier class.
+*/
+
+#ifndef SYNCHRO_CYCLIC_BARRIER_HPP_
+#define SYNCHRO_CYCLIC_BARRIER_HPP_
+
+#include <atomic>
+#include <cstdint>
+
+#include "synchro/eventcount.hpp"
+
+namespace synchro {
+
+// Reusable barrier for a fixed number of parties (from Java SE7's
+// CyclicBarrier). Each call to arrive_and_wait() blocks until all parties
+// have called it; the last arrival opens the barrier for the current phase
+// and the next phase starts at once, so iterative pipelines can call it
+// again without a reset (unlike countdown_latch).
+//
+// Arrivals and the phase share one atomic word, so arriving is a single
+// fetch-and-add. Waiters spin briefly on the phase, then sleep on an
+// eventcount, which the opening arrival notifies only if someone sleeps.
+// Nothing is allocated after construction.
+//
+// This class is thread safe.
+class cyclic_barrier {
+ public:
+  typedef std::uint32_t phase_type;
+
+  explicit cyclic_barrier(int parties); // requires parties > 0
+  cyclic_barrier(const cyclic_barrier&) = delete;
+  cyclic_barrier& operator=(const cyclic_barrier&) = delete;
+
+  /*
+   * INPUT:
+   * PRECONDITION:
+   * No party calls arrive_and_wait() twice in one phase.
+   * BEHAVIOR:
+   * Blocks until all parties have arrived in the current phase.
+   * RETURN:
+   * True for exactly one party per phase, the last to arrive.
+   */
+  bool arrive_and_wait() { return arrive_and_wait([] {}); }
+  /*
+   * INPUT:
+   * F completion - functor taking no arguments
+   * PRECONDITION:
+   * Same as above.
+   * BEHAVIOR:
+   * Same as above, but if the caller is the last party to arrive, it runs
+   * completion() before opening the barrier, so every party sees its
+   * effects on return. Other parties' completions are not called.
+   * RETURN:
+   * Same as above.
+   */
+  template<typename F>
+  bool arrive_and_wait(F completion);
+
+  // Number of phases completed so far (wraps around).
+  phase_type phase() const {
+    return static_cast<phase_type>(
+        state_.load(std::memory_order_acquire) >> kPhaseShift);
+  }
+  int parties() const { return parties_; }
+
+ private:
+  // Low half counts arrivals in the current phase, high half is the phase.
+  static const std::uint64_t kArrivedMask = 0xffffffffu;
+  static const int kPhaseShift = 32;
+
+  // Opens the barrier from 'phase' onto the next.
+  void open(phase_type phase);
+  // Waits for the end of 'phase'.
+  void wait_for(phase_type phase);
+
+  const int parties_;
+  std::atomic<std::uint64_t> state_;
+  eventcount opened_;
+};
+
+template<typename F>
+bool cyclic_barrier::arrive_and_wait(F completion) {
+  // Release publishes the caller's writes to the last arrival, and acquire
+  // lets the last arrival see everyone's.
+  auto prev = state_.fetch_add(1, std::memory_order_acq_rel);
+  auto phase = static_cast<phase_type>(prev >> kPhaseShift);
+  if ((prev & kArrivedMask) + 1 < static_cast<std::uint64_t>(parties_)) {
+    wait_for(phase);
+    return false;
+  }
+  completion();
+  open(phase);
+  return true;
+}
+
+} // namespace synchro
+
+#endif /* SYNCHRO_CYCLIC_BARRIER_HPP_ */
@@ -0,0 +1,135 @@
+/*
+  Vladimir Feinberg
+  synchro/epoch-test.cpp
+  2026-10-14
+
+  Epoch-based reclamation test.
+*/
+
+#include <atomic>
+#include <iostream>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "synchro/epoch.hpp"
+#include "util/uassert.hpp"
+
+using namespace std;
+using namespace synchro;
+
+namespace {
+
+// Tracks how many instances are alive, and poisons itself on deletion so
+// readers notice a premature free.
+struct counted {
+  static const int kMagic = 0x5eed;
+  explicit counted(int v = 0) : magic(kMagic), val(v) {
+    live.fetch_add(1, std::memory_order_relaxed);
+  }
+  ~counted() {
+    magic = 0;
+    live.fetch_sub(1, std::memory_order_relaxed);
+  }
+  volatile int magic;
+  int val;
+  static std::atomic<int> live;
+};
+std::atomic<int> counted::live(0);
+
+// Enough collections to advance the epoch past anything retired so far,
+// when no other thread is pinned.
+void collect_all() {
+  for (int i = 0; i < 4; ++i) epoch_domain::collect();
+}
+
+} // anonymous namespace
+
+int main(int, char**) {
+  cout << "Epoch reclamation testing." << endl;
+
+  cout << "=====> Testing basic sequential execution" << endl;
+  {
+    {
+      epoch_guard guard;
+      epoch_guard nested;
+      auto before = epoch_domain::epoch();
+      for (int i = 0; i < 10; ++i)
+        epoch_domain::schedule_deletion(new counted(i));
+      collect_all();
+      // Our own guard pins the epoch.
+      UASSERT(epoch_domain::epoch() <= before + 1)
+          << "epoch moved from " << before << " to " << epoch_domain::epoch();
+      UASSERT(counted::live.load() == 10)
+          << "deleted inside guard, " << counted::live.load() << " alive";
+    }
+    collect_all();
+    UASSERT(counted::live.load() == 0)
+        << "not reclaimed, " << counted::live.load() << " alive";
+  }
+  cout << "...... Complete!" << endl;
+
+  cout << "=====> Testing a pinned reader blocks reclamation" << endl;
+  {
+    std::atomic<bool> pinned(false), release(false);
+    auto reader = async(launch::async, [&]() {
+        epoch_guard guard;
+        pinned.store(true);
+        while (!release.load())
+          this_thread::yield();
+      });
+    while (!pinned.load())
+      this_thread::yield();
+    for (int i = 0; i < 300; ++i)
+      epoch_domain::schedule_deletion(new counted(i));
+    collect_all();
+    UASSERT(counted::live.load() == 300)
+        << "deleted under reader's guard, " << counted::live.load()
+        << " alive";
+    release.store(true);
+    reader.get();
+    collect_all();
+    UASSERT(counted::live.load() == 0)
+        << "not reclaimed, " << counted::live.load() << " alive";
+  }
+  cout << "...... Complete!" << endl;
+
+  cout << "=====> Testing multithreaded execution" << endl;
+  {
+    static const int kWriters = 4, kReaders = 8, kSlots = 16;
+    static const int kWrites = 5000;
+    std::atomic<counted*> slots[kSlots];
+    for (auto& s : slots) s.store(new counted, std::memory_order_relaxed);
+    std::atomic<int> writers_left(kWriters);
+
+    vector<future<void> > futs;
+    for (int i = 0; i < kReaders; ++i)
+      futs.push_back(async(launch::async, [&](int idx) {
+            int j = idx;
+            while (writers_left.load(std::memory_order_relaxed)) {
+              epoch_guard guard;
+              auto p = slots[j++ % kSlots].load(std::memory_order_acquire);
+              UASSERT(p->magic == counted::kMagic) << "read freed pointer";
+            }
+          }, i));
+    for (int i = 0; i < kWriters; ++i)
+      futs.push_back(async(launch::async, [&](int idx) {
+            for (int j = 0; j < kWrites; ++j) {
+              epoch_guard guard;
+              auto old = slots[(idx + j) % kSlots].exchange(
+                  new counted(j), std::memory_order_acq_rel);
+              UASSERT(old->magic == counted::kMagic) << "double free";
+              epoch_domain::schedule_deletion(old);
+            }
+            writers_left.fetch_sub(1, std::memory_order_relaxed);
+          }, i));
+    for (auto& fut : futs) fut.get();
+
+    for (auto& s : slots) delete s.load(std::memory_order_relaxed);
+    // Exited threads left their garbage behind for us.
+    collect_all();
+    UASSERT(counted::live.load() == 0)
+        << "orphans not reclaimed, " << counted::live.load() << " alive";
+  }
+  cout << "...... Complete!" << endl;
+}
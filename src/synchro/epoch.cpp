@@ -0,0 +1,222 @@
+/*
+  Vladimir Feinberg
+  synchro/epoch.cpp
+  2026-10-14
+
+  Epoch-based reclamation implementation.
+
+  There is one global epoch counter, and every thread that has used a guard
+  owns a record in a global (prepend-only) list. A record's state is either
+  0 (quiescent) or (e << 1 | 1), meaning the thread is in a critical section
+  that started when the global epoch was e.
+
+  The global epoch may only advance from e to e + 1 if every thread in a
+  critical section started it at e. So while a thread is pinned at e, the
+  global epoch is at most e + 1. A pointer retired while the global epoch
+  was r was unlinked before that, so only critical sections pinned at r or
+  earlier can have reached it - once the global epoch reaches r + 2 they have
+  all finished, and the pointer can be deleted.
+
+  Each thread keeps three limbo buckets, one for each epoch mod 3. When a
+  bucket is re-used for epoch e, whatever it held is from epoch e - 3 or
+  earlier, and can be reclaimed.
+*/
+
+#include "synchro/epoch.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+using std::pair;
+using std::size_t;
+using std::vector;
+using namespace synchro;
+
+namespace {
+
+// Number of retirements between each collect() attempt.
+const size_t kCollectEvery = 128;
+const size_t kBuckets = 3;
+
+struct epoch_record {
+  epoch_record() : state_(0), in_use_(true), next_(nullptr) {}
+  std::atomic<size_t> state_;
+  std::atomic<bool> in_use_;
+  epoch_record* next_;
+};
+
+typedef vector<pair<void*, epoch_domain::deleter_t> > rlist_t;
+
+struct limbo_bucket {
+  limbo_bucket() : epoch(0) {}
+  // A deleter may itself retire pointers (e.g. dropping the last reference
+  // to something with atomic_shared_ptr members), so run them off a
+  // detached list.
+  void reclaim() {
+    rlist_t doomed;
+    doomed.swap(items);
+    for (auto p : doomed) p.second(p.first);
+    // Keep the capacity around if nothing was retired meanwhile.
+    doomed.clear();
+    if (items.empty()) items.swap(doomed);
+  }
+  size_t epoch;
+  rlist_t items;
+};
+
+// Global epoch and the list of thread records. Records are never unlinked,
+// only released for reuse by a later thread.
+class epoch_state {
+ public:
+  epoch_state() : epoch_(0), head_(nullptr) {}
+  ~epoch_state() {
+    for (auto& b : orphans_) b.reclaim();
+    for (auto rec = head_.load(std::memory_order_acquire); rec;) {
+      auto next = rec->next_;
+      delete rec;
+      rec = next;
+    }
+  }
+
+  size_t epoch() const { return epoch_.load(std::memory_order_acquire); }
+
+  epoch_record* capture_record() {
+    for (auto rec = head_.load(std::memory_order_acquire); rec;
+         rec = rec->next_) {
+      bool expected = false;
+      if (!rec->in_use_.load(std::memory_order_relaxed) &&
+          rec->in_use_.compare_exchange_strong(expected, true,
+                                               std::memory_order_relaxed,
+                                               std::memory_order_relaxed))
+        return rec;
+    }
+    auto rec = new epoch_record;
+    auto oldhead = head_.load(std::memory_order_relaxed);
+    do rec->next_ = oldhead;
+    while (!head_.compare_exchange_weak(oldhead, rec,
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed));
+    return rec;
+  }
+
+  // Advances the global epoch if every pinned thread has seen the current
+  // one. Returns the (possibly new) global epoch.
+  size_t try_advance() {
+    auto e = epoch_.load(std::memory_order_relaxed);
+    // Pairs with the fence in pin(): either we see the other thread's
+    // state, or it sees our (or a later) epoch.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    for (auto rec = head_.load(std::memory_order_acquire); rec;
+         rec = rec->next_) {
+      auto state = rec->state_.load(std::memory_order_relaxed);
+      if ((state & 1) && (state >> 1) != e) return e;
+    }
+    if (epoch_.compare_exchange_strong(e, e + 1, std::memory_order_acq_rel,
+                                       std::memory_order_relaxed))
+      return e + 1;
+    return e; // someone else advanced it, 'e' was reloaded.
+  }
+
+  // Exiting threads leave their unreclaimed buckets here; this is rare
+  // enough that a lock is fine.
+  void add_orphans(limbo_bucket& b) {
+    std::lock_guard<std::mutex> lk(orphans_lock_);
+    orphans_.emplace_back();
+    orphans_.back().epoch = b.epoch;
+    orphans_.back().items.swap(b.items);
+  }
+
+  void reclaim_orphans(size_t e) {
+    std::unique_lock<std::mutex> lk(orphans_lock_, std::try_to_lock);
+    if (!lk.owns_lock() || orphans_.empty()) return;
+    size_t kept = 0;
+    for (auto& b : orphans_)
+      if (b.epoch + 2 <= e) b.reclaim();
+      else std::swap(orphans_[kept++], b);
+    orphans_.resize(kept);
+  }
+
+ private:
+  std::atomic<size_t> epoch_;
+  std::atomic<epoch_record*> head_;
+  std::mutex orphans_lock_;
+  vector<limbo_bucket> orphans_;
+};
+
+struct thread_state {
+  thread_state() : record(global.capture_record()), nesting(0), retired(0) {}
+  ~thread_state();
+
+  void pin() {
+    auto e = global.epoch();
+    record->state_.store((e << 1) | 1, std::memory_order_relaxed);
+    // The validating read of our state by an advancing thread must not be
+    // reordered before our subsequent reads of the shared structure.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+  void unpin() { record->state_.store(0, std::memory_order_release); }
+
+  void reclaim(size_t e) {
+    for (auto& b : limbo)
+      if (!b.items.empty() && b.epoch + 2 <= e) b.reclaim();
+  }
+
+  static epoch_state global;
+  epoch_record* record;
+  unsigned nesting;
+  size_t retired;
+  limbo_bucket limbo[kBuckets];
+};
+
+// Notice intentional order of definition, as in hazard.cpp: thread-local
+// states are destroyed before the global state is.
+epoch_state thread_state::global;
+thread_local thread_state local;
+
+thread_state::~thread_state() {
+  // this == &local
+  auto e = global.try_advance();
+  reclaim(e);
+  for (auto& b : limbo)
+    if (!b.items.empty()) global.add_orphans(b);
+  record->state_.store(0, std::memory_order_relaxed);
+  record->in_use_.store(false, std::memory_order_release);
+}
+
+} // anonymous namespace
+
+epoch_guard::epoch_guard() {
+  if (local.nesting++ == 0) local.pin();
+}
+
+epoch_guard::~epoch_guard() {
+  if (--local.nesting == 0) local.unpin();
+}
+
+void epoch_domain::schedule_deletion(void* ptr, deleter_t deleter) {
+  auto e = thread_state::global.epoch();
+  auto& bucket = local.limbo[e % kBuckets];
+  if (bucket.epoch != e) {
+    // Anything left is from epoch e - 3 or earlier.
+    bucket.reclaim();
+    bucket.epoch = e;
+  }
+  bucket.items.emplace_back(ptr, deleter);
+  if (++local.retired >= kCollectEvery) {
+    local.retired = 0;
+    collect();
+  }
+}
+
+void epoch_domain::collect() {
+  auto e = thread_state::global.try_advance();
+  local.reclaim(e);
+  thread_state::global.reclaim_orphans(e);
+}
+
+size_t epoch_domain::epoch() {
+  return thread_state::global.epoch();
+}
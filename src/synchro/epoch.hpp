@@ -0,0 +1,77 @@
+/*
+  Vladimir Feinberg
+  synchro/epoch.hpp
+  2026-10-14
+
+  Epoch-based reclamation (EBR) interface, an alternative to hazard pointers
+  for lockfree data structures. Instead of publishing every pointer it
+  dereferences, a thread marks an entire operation as a critical section
+  with an epoch_guard. Memory scheduled for deletion is only freed once every
+  thread that could have seen it has left its critical section.
+
+  Based on Keir Fraser's "Practical lock-freedom" (2004), section 5.2.3.
+
+  Compared to hazard pointers, EBR costs one fence per critical section
+  rather than one per protected pointer, but garbage is unbounded if a
+  thread stalls inside a critical section (it blocks every deletion, not
+  just the ones it protects). Like hazard_ptr, epoch_guard does not order
+  accesses to the protected data, only lifetimes.
+*/
+
+#ifndef SYNCHRO_EPOCH_HPP_
+#define SYNCHRO_EPOCH_HPP_
+
+#include <cstddef>
+
+namespace synchro {
+
+// RAII critical section. While any epoch_guard is alive on a thread, no
+// pointer that thread could have reached (via a structure whose deletions
+// go through epoch_domain::schedule_deletion) will be deleted.
+//
+// Guards nest; only the outermost one on a thread has any cost.
+// epoch_guard values may not have static or thread_local storage duration,
+// and must be destroyed on the thread that created them.
+class epoch_guard {
+ public:
+  epoch_guard();
+  ~epoch_guard();
+  epoch_guard(const epoch_guard&) = delete;
+  epoch_guard& operator=(const epoch_guard&) = delete;
+};
+
+// The process-wide epoch domain. All methods are thread safe.
+class epoch_domain {
+ public:
+  typedef void (*deleter_t)(void*);
+
+  // Same contract as hazard_ptr<T>::schedule_deletion(): should be called
+  // exactly once per pointer, after the pointer was unlinked so that no new
+  // critical section can reach it. 'ptr' may still be used by the calling
+  // thread until its current epoch_guard (if any) is released.
+  //
+  // The 'ptr' will be destructed (via a call to 'delete') at the latest
+  // during static destruction time.
+  template<typename T>
+  static void schedule_deletion(T* ptr) {
+    if (ptr) schedule_deletion(ptr, ptr_deleter<T>);
+  }
+  static void schedule_deletion(void* ptr, deleter_t deleter);
+
+  // Attempts to advance the global epoch, then deletes whatever the calling
+  // thread (or exited threads) retired that's now safe. Called automatically
+  // every so often by schedule_deletion(). Calling inside a critical section
+  // is allowed, but the thread's own guard may hold the epoch back.
+  static void collect();
+
+  // Current global epoch, for debugging.
+  static std::size_t epoch();
+
+ private:
+  template<typename T>
+  static void ptr_deleter(void* ptr) { delete static_cast<T*>(ptr); }
+};
+
+} // namespace synchro
+
+#endif /* SYNCHRO_EPOCH_HPP_ */
@@ -0,0 +1,63 @@
+/*
+  Vladimir Feinberg
+  synchro/eventcount.cpp
+  2026-10-14
+
+  Implements the eventcount class.
+*/
+
+#include "synchro/eventcount.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+#include "util/uassert.hpp"
+
+using namespace std;
+using namespace synchro;
+
+eventcount::key_type eventcount::prepare_wait() {
+  auto prev = state_.fetch_add(1, memory_order_relaxed);
+  UASSERT((prev & kWaiterMask) != kWaiterMask) << "too many waiters";
+  // Orders the registration before the waiter's re-check; pairs with the
+  // fence in notify_all().
+  atomic_thread_fence(memory_order_seq_cst);
+  return static_cast<key_type>(prev >> kEpochShift);
+}
+
+void eventcount::cancel_wait() {
+  state_.fetch_sub(1, memory_order_relaxed);
+}
+
+void eventcount::wait(key_type key) {
+  {
+    // The epoch only changes under the lock, so checking it under the lock
+    // can't miss a notification.
+    unique_lock<mutex> lk(lock_);
+    cv_.wait(lk, [this, key] { return epoch() != key; });
+  }
+  cancel_wait();
+}
+
+bool eventcount::wait_until(key_type key,
+                            chrono::steady_clock::time_point deadline) {
+  bool notified;
+  {
+    unique_lock<mutex> lk(lock_);
+    notified = cv_.wait_until(lk, deadline,
+                              [this, key] { return epoch() != key; });
+  }
+  cancel_wait();
+  return notified;
+}
+
+void eventcount::notify_slow(bool all) {
+  {
+    lock_guard<mutex> lk(lock_);
+    state_.fetch_add(uint64_t(1) << kEpochShift, memory_order_relaxed);
+  }
+  if (all) cv_.notify_all();
+  else cv_.notify_one();
+}
@@ -0,0 +1,101 @@
+/*
+  Vladimir Feinberg
+  synchro/eventcount.hpp
+  2026-10-14
+
+  Declares the eventcount class, a condition variable for lock-free
+  structures: waiters block until "something changed" without the
+  notifying side having to take a lock (or write anything) when nobody is
+  waiting.
+*/
+
+#ifndef SYNCHRO_EVENTCOUNT_HPP_
+#define SYNCHRO_EVENTCOUNT_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+namespace synchro {
+
+// Usage, for a waiter looking for some condition C that notifiers make
+// true before calling notify_all():
+//
+//   while (true) {
+//     if (C) break;
+//     auto key = ec.prepare_wait();
+//     if (C) { ec.cancel_wait(); break; }
+//     ec.wait(key);
+//   }
+//
+// The re-check after prepare_wait() is what prevents lost wake-ups: either
+// the waiter sees the notifier's change to C, or the notifier sees the
+// waiter and wakes it.
+//
+// A notifier that made C true for just one waiter (e.g., one item in a
+// queue) can call notify_one() instead, which wakes a single blocked
+// waiter rather than every one of them.
+//
+// notify_all() or notify_one() with no registered waiters is a fence and a
+// load, no read-modify-writes and no shared-line writes. Waiting and
+// notifying waiters go through a mutex and condition variable.
+//
+// This class is thread safe.
+class eventcount {
+ public:
+  typedef std::uint32_t key_type;
+
+  eventcount() : state_(0) {}
+  eventcount(const eventcount&) = delete;
+  eventcount& operator=(const eventcount&) = delete;
+
+  // Registers the calling thread as a waiter. Must be followed by exactly
+  // one of cancel_wait(), wait(), or wait_until() with the returned key.
+  key_type prepare_wait();
+  void cancel_wait();
+  // Blocks until a notify_all() after the matching prepare_wait().
+  void wait(key_type key);
+  // Same as wait(), but returns false if the deadline passed first.
+  bool wait_until(key_type key,
+                  std::chrono::steady_clock::time_point deadline);
+
+  // Wakes all threads waiting on a key from before this call.
+  void notify_all() {
+    // Orders the caller's preceding writes (making C true) before the
+    // waiter check; pairs with the fence in prepare_wait().
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (state_.load(std::memory_order_relaxed) & kWaiterMask)
+      notify_slow(true);
+  }
+  // Wakes at least one thread waiting on a key from before this call.
+  // Waiters that registered but haven't blocked yet return from wait()
+  // too, so more may wake; blocked ones beyond the first stay asleep until
+  // a later notification.
+  void notify_one() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (state_.load(std::memory_order_relaxed) & kWaiterMask)
+      notify_slow(false);
+  }
+
+ private:
+  // Low half counts registered waiters, high half is the epoch, bumped by
+  // each notification that found waiters.
+  static const std::uint64_t kWaiterMask = 0xffffffffu;
+  static const int kEpochShift = 32;
+
+  key_type epoch() const {
+    return static_cast<key_type>(
+        state_.load(std::memory_order_relaxed) >> kEpochShift);
+  }
+  void notify_slow(bool all);
+
+  std::atomic<std::uint64_t> state_;
+  std::mutex lock_;
+  std::condition_variable cv_;
+};
+
+} // namespace synchro
+
+#endif /* SYNCHRO_EVENTCOUNT_HPP_ */
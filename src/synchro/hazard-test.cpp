@@ -7,6 +7,8 @@
 */
 
 #include <atomic>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <future>
 #include <thread>
@@ -14,6 +16,7 @@
 #include <vector>
 
 #include "synchro/hazard.hpp"
+#include "util/bench.hpp"
 #include "util/uassert.hpp"
 
 using namespace std;
@@ -66,9 +69,56 @@ class hazard_tester {
   unordered_map<int, hazard_ptr<int>> hazards_;
 };
 
+// Tracks how many instances are alive, to observe reclamation.
+struct counted {
+  counted() { live.fetch_add(1, std::memory_order_relaxed); }
+  ~counted() { live.fetch_sub(1, std::memory_order_relaxed); }
+  static std::atomic<int> live;
+};
+std::atomic<int> counted::live(0);
+
+// Retires fresh garbage until a scan has run with the current thresholds.
+void force_scan() {
+  auto scans = thread_hazard_scan_stats().scans;
+  while (thread_hazard_scan_stats().scans == scans)
+    hazard_ptr<counted>::schedule_deletion(new counted);
+}
+
+// Making and dropping hazard pointers, with 'others' more alive on the
+// thread (past kThreadHazards, they make each new one walk the list).
+void bench_make(util::bench::suite& suite, int others) {
+  vector<hazard_ptr<int> > alive(others);
+  int x = 0;
+  std::atomic<int*> ptr(&x);
+  suite.run("hazard_ptr, " + to_string(others) + " others alive",
+            [&](uint64_t n) {
+      for (uint64_t i = 0; i < n; ++i) {
+        hazard_ptr<int> h;
+        h.acquire(ptr);
+      }
+    });
+  suite.run("hazard_guard<3>, " + to_string(others) + " others alive",
+            [&](uint64_t n) {
+      for (uint64_t i = 0; i < n; ++i) {
+        hazard_guard<int, 3> g;
+        for (size_t j = 0; j < g.size(); ++j) g.acquire(j, ptr);
+      }
+    }, 3);
+}
+
+void bench() {
+  util::bench::suite suite("Hazard pointer construction, per pointer");
+  for (int others : {0, 4, 16, 64}) bench_make(suite, others);
+}
+
 } // anonymous namespace
 
-int main(int, char**) {
+int main(int argc, char** argv) {
+  if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+    bench();
+    return 0;
+  }
+
   cout << "Hazard pointer testing." << endl;
 
   // We run this test with valgrind to check that the deletions actually occur.
@@ -149,4 +199,144 @@ int main(int, char**) {
       reader_futs[i].get();
   }
   cout << "...... Complete!" << endl;
+
+  cout << "=====> Testing batched reclamation thresholds" << endl;
+  {
+    auto old = get_hazard_thresholds();
+    static const int kBatch = 16;
+    set_hazard_thresholds({kBatch, 0});
+    UASSERT(get_hazard_thresholds().min_retired == kBatch);
+
+    // Retire until a scan happens, so the retired list starts out empty
+    // (nothing from above is protected anymore).
+    do hazard_ptr<counted>::schedule_deletion(new counted);
+    while (counted::live.load() != 0);
+
+    hazard_ptr<counted> guard;
+    guard.acquire(new counted);
+    hazard_ptr<counted>::schedule_deletion(guard.get());
+    for (int i = 0; i < kBatch - 2; ++i)
+      hazard_ptr<counted>::schedule_deletion(new counted);
+    UASSERT(counted::live.load() == kBatch - 1)
+        << "scanned early, " << counted::live.load() << " alive";
+    hazard_ptr<counted>::schedule_deletion(new counted);
+    UASSERT(counted::live.load() == 1)
+        << "protected pointer should survive scan, "
+        << counted::live.load() << " alive";
+
+    // A thread that exits with protected garbage hands it to the global
+    // list, where the next scan picks it up.
+    hazard_ptr<counted> other_guard;
+    async(launch::async, [&]() {
+        auto p = new counted;
+        other_guard.acquire(p);
+        hazard_ptr<counted>::schedule_deletion(p);
+      }).get();
+    UASSERT(counted::live.load() == 2) << counted::live.load() << " alive";
+    guard.reset();
+    other_guard.reset();
+    for (int i = 0; i < kBatch - 1; ++i)
+      hazard_ptr<counted>::schedule_deletion(new counted);
+    UASSERT(counted::live.load() == 0)
+        << "orphans not reclaimed, " << counted::live.load() << " alive";
+
+    set_hazard_thresholds(old);
+  }
+  cout << "...... Complete!" << endl;
+
+  cout << "=====> Testing many records per thread" << endl;
+  {
+    // Spans several record slabs, from a few threads at once.
+    static const int kThreads = 4, kPerThread = 50;
+    vector<future<void> > futs;
+    for (int t = 0; t < kThreads; ++t)
+      futs.push_back(async(launch::async, []() {
+            vector<hazard_ptr<counted> > guards(kPerThread);
+            for (auto& g : guards) {
+              g.acquire(new counted);
+              hazard_ptr<counted>::schedule_deletion(g.get());
+            }
+            for (int i = 0; i < 200; ++i)
+              hazard_ptr<counted>::schedule_deletion(new counted);
+            UASSERT(counted::live.load() >= kPerThread)
+                << "protected pointer deleted";
+          }));
+    for (auto& fut : futs) fut.get();
+    // Everything is unprotected now; keep retiring until a scan picks up
+    // the orphans along with our own.
+    for (int i = 0; i < 1000 && counted::live.load(); ++i)
+      hazard_ptr<counted>::schedule_deletion(new counted);
+    UASSERT(counted::live.load() == 0)
+        << "not reclaimed, " << counted::live.load() << " alive";
+  }
+  cout << "...... Complete!" << endl;
+
+  cout << "=====> Testing thread records and hazard guards" << endl;
+  {
+    auto old = get_hazard_thresholds();
+    set_hazard_thresholds({16, 0});
+    force_scan();
+    while (counted::live.load()) force_scan();
+
+    // Past the thread's own records, into the global list.
+    vector<hazard_ptr<counted> > guards(3 * kThreadHazards);
+    for (auto& g : guards) {
+      g.acquire(new counted);
+      hazard_ptr<counted>::schedule_deletion(g.get());
+    }
+    force_scan();
+    UASSERT(counted::live.load() == static_cast<int>(guards.size()))
+        << "protected pointer deleted, " << counted::live.load() << " alive";
+    guards.clear();
+    force_scan();
+    UASSERT(counted::live.load() == 0) << counted::live.load() << " alive";
+
+    hazard_guard<counted, 3> guard;
+    counted* ptrs[3];
+    for (int i = 0; i < 3; ++i) {
+      ptrs[i] = new counted;
+      guard.acquire(i, ptrs[i]);
+      hazard_ptr<counted>::schedule_deletion(ptrs[i]);
+    }
+    guard.swap(0, 1);
+    UASSERT(guard.get(0) == ptrs[1] && guard.get(1) == ptrs[0]);
+    UASSERT(guard[2].get() == ptrs[2]);
+    force_scan();
+    UASSERT(counted::live.load() == 3)
+        << "protected pointer deleted, " << counted::live.load() << " alive";
+    guard.reset(1);
+    force_scan();
+    UASSERT(counted::live.load() == 2) << counted::live.load() << " alive";
+    guard.reset();
+    force_scan();
+    UASSERT(counted::live.load() == 0) << counted::live.load() << " alive";
+
+    // Hazard pointers that change threads go back to the global list, and
+    // leave both threads' records intact.
+    hazard_ptr<counted> from_main;
+    hazard_ptr<counted> from_thread = async(launch::async, [&]() {
+        hazard_ptr<counted> dropped(std::move(from_main));
+        hazard_ptr<counted> kept;
+        return kept;
+      }).get();
+    {
+      vector<hazard_ptr<counted> > guards(kThreadHazards + 2);
+      for (auto& g : guards) {
+        g.acquire(new counted);
+        hazard_ptr<counted>::schedule_deletion(g.get());
+      }
+      from_thread.acquire(new counted);
+      hazard_ptr<counted>::schedule_deletion(from_thread.get());
+      force_scan();
+      UASSERT(counted::live.load() == static_cast<int>(guards.size()) + 1)
+          << "protected pointer deleted, " << counted::live.load()
+          << " alive";
+    }
+    from_thread.reset();
+    force_scan();
+    UASSERT(counted::live.load() == 0) << counted::live.load() << " alive";
+
+    set_hazard_thresholds(old);
+  }
+  cout << "...... Complete!" << endl;
 }
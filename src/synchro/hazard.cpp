@@ -12,13 +12,19 @@
 
 #include "synchro/hazard.hpp"
 
+#include <algorithm>
 #include <atomic>
-#include <unordered_set>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <new>
 #include <utility>
 #include <vector>
 
+#include "util/cache_line.hpp"
+
 using std::pair;
-using std::unordered_set;
+using std::size_t;
 using std::vector;
 using namespace synchro;
 using namespace _synchro_hazard_internal;
@@ -38,6 +44,47 @@ void delete_slist(Node head, Func f) {
   }
 }
 
+// Hazard records are carved out of contiguous slabs of line-sized slots.
+// Each thread takes new records from its own slab, so a record that its
+// owner publishes to never shares a cache line with another thread's
+// record (which scanners read, and other owners write), and scans walk
+// mostly contiguous memory. Slabs live until static destruction, same as
+// records always have.
+class record_slab {
+ public:
+  static const size_t kRecords = 8;
+  static constexpr size_t kStride = util::line_stride(sizeof(hazard_record));
+
+  record_slab() :
+      raw_(::operator new(kRecords * kStride + util::kCacheLine)),
+      used_(0), next_(nullptr) {
+    auto addr = reinterpret_cast<std::uintptr_t>(raw_);
+    addr = (addr + util::kCacheLine - 1) / util::kCacheLine * util::kCacheLine;
+    base_ = reinterpret_cast<char*>(addr);
+  }
+  ~record_slab() {
+    for (size_t i = 0; i < used_; ++i)
+      reinterpret_cast<hazard_record*>(base_ + i * kStride)->~hazard_record();
+    ::operator delete(raw_);
+  }
+  record_slab(const record_slab&) = delete;
+  record_slab& operator=(const record_slab&) = delete;
+
+  bool full() const { return used_ == kRecords; }
+  // Constructs the next (active) record in the slab.
+  hazard_record* make_record() {
+    return new (base_ + used_++ * kStride) hazard_record;
+  }
+  record_slab* next() const { return next_; }
+
+ private:
+  friend class hazard_list;
+  void* raw_;
+  char* base_;
+  size_t used_;
+  record_slab* next_;
+};
+
 // This file maintains the static
 // executable-wide hazard pointer list and thread-local retired lists.
 //
@@ -48,8 +95,11 @@ void delete_slist(Node head, Func f) {
 // until unlink time.
 class hazard_list {
  public:
-  hazard_list() : head_(nullptr), len_(0) {}
-  ~hazard_list() { delete_slist(head(), [](void*){}); }
+  hazard_list() : head_(nullptr), len_(0), slabs_(nullptr) {}
+  ~hazard_list() {
+    // Records are owned by their slabs.
+    delete_slist(slabs_.load(std::memory_order_acquire), [](void*){});
+  }
 
   static hazard_record* head() {
     // Use "acquire" semantics so we can read the 'next_' pointer.
@@ -71,68 +121,164 @@ class hazard_list {
   static size_t len() {
     return global_list_.len_.load(std::memory_order_relaxed);
   }
+  // Takes ownership of a slab (which may not be full yet).
+  static void add_slab(record_slab* slab) {
+    auto& slabs = global_list_.slabs_;
+    auto oldhead = slabs.load(std::memory_order_relaxed);
+    do slab->next_ = oldhead;
+    while (!slabs.compare_exchange_weak(oldhead, slab,
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed));
+  }
 
  private:
   std::atomic<hazard_record*> head_;
   std::atomic<size_t> len_;
   std::atomic<bool> on_;
+  std::atomic<record_slab*> slabs_;
   static hazard_list global_list_;
 };
 
-typedef vector<pair<void*, hazard_record::deleter_t> > rlist_t;
+// Retired pointers are kept in chains of fixed-size blocks, so that handing
+// a whole list to another owner (an exiting thread giving its leftovers to
+// the global list, or a scanning thread stealing them back) is a couple of
+// pointer moves instead of a copy of every element.
+struct retired_block {
+  static const size_t kCapacity = 64;
+  retired_block() : size(0), next_(nullptr) {}
+  retired_block* next() const { return next_; }
+  // Calls the deleter of every pointer in the block.
+  void reclaim() {
+    for (size_t i = 0; i < size; ++i) items[i].second(items[i].first);
+  }
+
+  size_t size;
+  retired_block* next_;
+  pair<void*, hazard_record::deleter_t> items[kCapacity];
+};
+
+// Owning chain of retired blocks. Only the last block is ever appended to,
+// but blocks in the middle may be partially full after a splice.
+class rlist_t {
+ public:
+  rlist_t() : head_(nullptr), tail_(nullptr), size_(0) {}
+  ~rlist_t() { delete_slist(head_, [](retired_block* b) { b->reclaim(); }); }
+  rlist_t(const rlist_t&) = delete;
+  rlist_t& operator=(const rlist_t&) = delete;
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  void push(void* ptr, hazard_record::deleter_t deleter) {
+    if (!tail_ || tail_->size == retired_block::kCapacity) {
+      auto block = new retired_block;
+      if (tail_) tail_->next_ = block;
+      else head_ = block;
+      tail_ = block;
+    }
+    tail_->items[tail_->size++] = std::make_pair(ptr, deleter);
+    ++size_;
+  }
+
+  // Takes ownership of the chain starting at 'first'. Only walks the
+  // blocks, not their contents.
+  void splice(retired_block* first) {
+    if (!first) return;
+    auto last = first;
+    size_ += last->size;
+    for (; last->next_; last = last->next_) size_ += last->next_->size;
+    last->next_ = head_;
+    if (!head_) tail_ = last;
+    head_ = first;
+  }
+
+  // Gives up ownership of the chain, returning its first and last blocks.
+  pair<retired_block*, retired_block*> release() {
+    auto ret = std::make_pair(head_, tail_);
+    head_ = tail_ = nullptr;
+    size_ = 0;
+    return ret;
+  }
+
+  // Calls the deleter on all pointers for which 'can_delete' is true and
+  // compacts the rest to the front of the chain, freeing emptied blocks.
+  template<typename Pred>
+  void reclaim_if(Pred can_delete) {
+    if (!head_) return;
+    auto wblock = head_;
+    size_t widx = 0;
+    size_ = 0;
+    for (auto rblock = head_; rblock; rblock = rblock->next_)
+      for (size_t i = 0; i < rblock->size; ++i) {
+        auto item = rblock->items[i];
+        if (can_delete(item.first)) {
+          item.second(item.first);
+          continue;
+        }
+        if (widx == retired_block::kCapacity) {
+          wblock->size = widx;
+          wblock = wblock->next_;
+          widx = 0;
+        }
+        wblock->items[widx++] = item;
+        ++size_;
+      }
+    wblock->size = widx;
+    delete_slist(wblock->next_, [](retired_block*){});
+    wblock->next_ = nullptr;
+    tail_ = wblock;
+  }
+
+ private:
+  retired_block* head_;
+  retired_block* tail_;
+  size_t size_;
+};
 
 // We need a 'global_retired' list to "pick up the scraps" left by
 // writer threads that exited and couldn't clear all their retired pointers.
-// This list is typically held very small, since active writer threads
-// constantly "pick up the slack" by "stealing" the global retried list
-// and using it as their own.
+// Scanning threads "steal" the global retired list and use it as their
+// own, so it's typically held very small. Both directions are splices of
+// whole block chains.
 class global_retired_list {
  public:
   global_retired_list() : head_(nullptr) {}
   ~global_retired_list() {
-    // For each node, clear the associated rlist, then delete the node.
     delete_slist(head_.load(std::memory_order_acquire),
-                 [](node* n) {
-                   for (auto p : n->to_retire_) p.second(p.first);
-                 });
+                 [](retired_block* b) { b->reclaim(); });
   }
-  void add_rlist(rlist_t rlist) {
-    node* next = new node(std::move(rlist));
+  void add_rlist(rlist_t& rlist) {
+    auto chain = rlist.release();
+    if (!chain.first) return;
     auto oldhead = head_.load(std::memory_order_relaxed);
-    do next->next_ = oldhead;
-    while (!head_.compare_exchange_weak(oldhead, next,
+    do chain.second->next_ = oldhead;
+    while (!head_.compare_exchange_weak(oldhead, chain.first,
                                         std::memory_order_release,
                                         std::memory_order_relaxed));
   }
   void steal(rlist_t& to_add) {
-    // Once the 'head_' has been stolen, for each node,
-    // copy the contents of the associated rlist to the current node's
-    // list.
-    // TODO: optimization: if rlist_t itself was just a singly-linked
-    // vector chain (separate module implementation needed), then
-    // instead of copies these could just be a couple pointer moves.
-    delete_slist(head_.exchange(nullptr, std::memory_order_relaxed),
-                 [&to_add](node* n) {
-                   const auto& rlist = n->to_retire_;
-                   to_add.insert(to_add.end(), rlist.begin(), rlist.end());
-                 });
+    // Cheap check first so that scans don't all write to the shared line
+    // when there's nothing to take.
+    if (!head_.load(std::memory_order_relaxed)) return;
+    to_add.splice(head_.exchange(nullptr, std::memory_order_acquire));
   }
 
  private:
-  struct node {
-    node(rlist_t rlist) : next_(nullptr), to_retire_(std::move(rlist)) {}
-    node* next() const { return next_; }
-    node* next_;
-    rlist_t to_retire_;
-  };
-
-  std::atomic<node*> head_;
+  std::atomic<retired_block*> head_;
 };
 
-// Thread-local "retired list" of pointers discarded by this thread.
+// Global reclamation thresholds, see hazard.hpp.
+std::atomic<size_t> min_retired(64);
+std::atomic<double> retired_ratio(2.0);
+
+// Thread-local "retired list" of pointers discarded by this thread, along
+// with scratch space for the protected-pointer snapshot so scans don't
+// allocate once warmed up, and the thread's scan statistics.
 struct retired_list {
   ~retired_list();
   rlist_t rlist;
+  vector<void*> snap;
+  hazard_scan_stats stats = {0, 0, 0};
 };
 
 // Notice intentional order of definition. C++11 ensures the destructors
@@ -141,37 +287,93 @@ struct retired_list {
 hazard_list hazard_list::global_list_;
 global_retired_list global_retired;
 thread_local retired_list thread_retired;
+// Slab new records are taken from. Trivially destructible: the slab is
+// owned by the global list, and its unused slots are simply abandoned
+// when the thread exits.
+thread_local record_slab* thread_slab = nullptr;
+
+// Records a thread keeps for itself (see kThreadHazards), so that most
+// hazard_ptrs are made without walking the global list or touching its
+// length: taking and giving back one of these is a bit flip in 'free'.
+// Trivially destructible, so it's still usable (empty) while other
+// thread_locals are destroyed.
+struct thread_records {
+  static const int kSlots = static_cast<int>(kThreadHazards);
+  hazard_record* slots[kSlots];
+  std::uint32_t free; // bit i is set iff slots[i] isn't in use
+};
+thread_local thread_records thread_cache = {};
+
+// Fills thread_cache on the thread's first hazard_ptr, and gives its
+// records back to the global list when the thread exits. A record that is
+// in use at that point, by a hazard_ptr moved to another thread, is given
+// back by that thread when it's done with it.
+struct thread_registration {
+  thread_registration() {
+    int taken = 0;
+    try {
+      for (; taken < thread_records::kSlots; ++taken)
+        thread_cache.slots[taken] = hazard_record::activated_record();
+    } catch (...) {
+      for (int i = 0; i < taken; ++i) thread_cache.slots[i]->deactivate();
+      throw;
+    }
+    thread_cache.free = (std::uint32_t(1) << thread_records::kSlots) - 1;
+  }
+  ~thread_registration() {
+    for (int i = 0; i < thread_records::kSlots; ++i) {
+      if (thread_cache.free & (std::uint32_t(1) << i))
+        thread_cache.slots[i]->deactivate();
+      thread_cache.slots[i] = nullptr;
+    }
+    thread_cache.free = 0;
+  }
+};
 
 // Thread iterates through the global hazard pointer list, searching
 // for non-null protected pointers. It then takes the set difference
 // (rlist) - (snapshot of protected pointers). This provides (according to
 // the contract by schedule_deletion) a conservative, safe estimate of pointers
 // viable for deletion.
+//
+// The snapshot is a sorted vector, which is cheaper to build and probe than
+// a node-based set at the sizes we see (one entry per live hazard pointer).
 void scan_delete() {
-  // TODO: potential optimization: pre-alloc len() size.
-  unordered_set<void*> snap;
-  rlist_t filtered;
+  auto start = std::chrono::steady_clock::now();
+  // Pick up any trash left around by exited threads.
+  global_retired.steal(thread_retired.rlist);
+  auto before = thread_retired.rlist.size();
+  auto& snap = thread_retired.snap;
+  snap.clear();
   for (auto rec = hazard_list::head(); rec; rec = rec->next()) {
     auto ptr = rec->protected_ptr();
-    if (ptr) snap.insert(ptr);
+    if (ptr) snap.push_back(ptr);
   }
-  for (auto p : thread_retired.rlist) {
-    auto ptr = p.first;
-    auto del = p.second;
-    if (snap.find(ptr) == snap.end()) del(ptr);
-    else filtered.push_back(p);
-  }
-  thread_retired.rlist.swap(filtered);
+  std::sort(snap.begin(), snap.end());
+  thread_retired.rlist.reclaim_if([&snap](void* ptr) {
+      return !std::binary_search(snap.begin(), snap.end(), ptr);
+    });
+  auto& stats = thread_retired.stats;
+  ++stats.scans;
+  stats.reclaimed += before - thread_retired.rlist.size();
+  stats.scan_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+// Whether the thread's retired list is large enough to be worth a scan.
+bool should_scan(size_t retired) {
+  auto floor = min_retired.load(std::memory_order_relaxed);
+  if (retired < floor) return false;
+  auto ratio = retired_ratio.load(std::memory_order_relaxed);
+  return retired >= ratio * hazard_list::len();
 }
 
 retired_list::~retired_list() {
   // this == &thread_retired
-  // TODO: optimization: is this scan_delete() worth it?
-  // perhaps it doesn't get much done anyway, maybe just move to global?
-  // certainly means less destructor work...
+  // One last scan catches everything that's no longer protected, the rest
+  // is handed off wholesale.
   scan_delete();
-  if (!rlist.empty())
-    global_retired.add_rlist(std::move(rlist));
+  global_retired.add_rlist(rlist);
 }
 
 } // anonymous namespace
@@ -200,15 +402,24 @@ bool hazard_record::capture() {
 hazard_record* hazard_record::activated_record() {
   auto tentative = hazard_list::head();
   // Search through the list for an available hazard_record.
+  // Re-used records count towards the in-use length just like new ones,
+  // deactivate() doesn't know the difference.
   for (; tentative; tentative = tentative->next_)
     if (tentative->active() || !tentative->capture()) continue;
-    else return tentative;
+    else {
+      hazard_list::incr_len();
+      return tentative;
+    }
 
-  // Search failed. Make a new hazard record.
-  // Note none of the below operations throw, so we're still providing
-  // a strong exception-safety guarnatee.
+  // Search failed. Make a new hazard record. Only the slab allocation may
+  // throw, and it comes first, so we're still providing a strong
+  // exception-safety guarantee.
+  if (!thread_slab || thread_slab->full()) {
+    thread_slab = new record_slab;
+    hazard_list::add_slab(thread_slab);
+  }
+  auto new_hazard = thread_slab->make_record();
   hazard_list::incr_len();
-  auto new_hazard = new hazard_record;
 
   // TODO: potential optimization: the below read can use std::mo_relaxed.
   auto oldhead = hazard_list::head();
@@ -218,13 +429,35 @@ hazard_record* hazard_record::activated_record() {
   return new_hazard;
 }
 
+hazard_record* hazard_record::take(int& slot) {
+  // Constructed on the thread's first call, and never again once destroyed.
+  static thread_local thread_registration registration;
+  auto& cache = thread_cache;
+  if (cache.free) {
+    slot = __builtin_ctz(cache.free);
+    cache.free &= cache.free - 1;
+    return cache.slots[slot];
+  }
+  slot = -1;
+  return activated_record();
+}
+
+void hazard_record::release(int slot) {
+  auto& cache = thread_cache;
+  // A record is in one thread's slots at most, and no other hazard_ptr can
+  // hold it while this one does, so this check is enough to tell that the
+  // record is ours even if the hazard_ptr came from another thread.
+  if (slot >= 0 && cache.slots[slot] == this) {
+    publish(nullptr);
+    cache.free |= std::uint32_t(1) << slot;
+    return;
+  }
+  deactivate();
+}
+
 void hazard_record::schedule_deletion(void* ptr, deleter_t deleter) {
-  thread_retired.rlist.emplace_back(ptr, deleter);
-  // Pick up any trash left around by others.
-  global_retired.steal(thread_retired.rlist);
-  // Use of magic constant 5/4 upon recommendation from source.
-  // Anything >1 will allow for constant-time amortization.
-  if (thread_retired.rlist.size() >= 5 * hazard_list::len() / 4)
+  thread_retired.rlist.push(ptr, deleter);
+  if (should_scan(thread_retired.rlist.size()))
     scan_delete();
 }
 
@@ -240,3 +473,19 @@ void hazard_record::deactivate() {
   // Reduce the number of hazard records in use.
   hazard_list::sub_len();
 }
+
+void synchro::set_hazard_thresholds(hazard_thresholds t) {
+  min_retired.store(t.min_retired, std::memory_order_relaxed);
+  retired_ratio.store(t.ratio, std::memory_order_relaxed);
+}
+
+hazard_scan_stats synchro::thread_hazard_scan_stats() {
+  return thread_retired.stats;
+}
+
+hazard_thresholds synchro::get_hazard_thresholds() {
+  hazard_thresholds t;
+  t.min_retired = min_retired.load(std::memory_order_relaxed);
+  t.ratio = retired_ratio.load(std::memory_order_relaxed);
+  return t;
+}
@@ -23,9 +23,51 @@
 #define SYNCHRO_HAZARD_HPP_
 
 #include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
 
 namespace synchro {
 
+// Reclamation tuning, shared by all hazard_ptr types. Pointers passed to
+// schedule_deletion() are batched per thread; the thread only scans the
+// hazard pointers in use (and picks up pointers left behind by exited
+// threads) once it holds at least
+//
+//   max(min_retired, ratio * <number of hazard records held>)
+//
+// retired pointers. Every thread that made a hazard_ptr holds kThreadHazards
+// records, plus one for each hazard_ptr beyond those it has alive at once.
+// Larger values amortize a scan over more deletions at the cost of more
+// garbage held by each thread. Any ratio > 1 keeps the amortized cost of a
+// deletion constant. Defaults are min_retired = 64, ratio = 2.
+//
+// Thresholds may be changed at any time, from any thread; they take effect
+// at each thread's next schedule_deletion().
+struct hazard_thresholds {
+  std::size_t min_retired;
+  double ratio;
+};
+void set_hazard_thresholds(hazard_thresholds t);
+hazard_thresholds get_hazard_thresholds();
+
+// The calling thread's reclamation work so far: scans run, their total
+// duration, and the pointers they deleted. Kept unconditionally, since a
+// scan is amortized over at least min_retired deletions anyway; for
+// instrumentation (see queues/queue_stats.hpp).
+struct hazard_scan_stats {
+  std::uint64_t scans;
+  std::uint64_t scan_ns;
+  std::uint64_t reclaimed;
+};
+hazard_scan_stats thread_hazard_scan_stats();
+
+// Hazard records each thread keeps for itself. Making and destroying one of
+// the first kThreadHazards hazard_ptrs a thread has alive at once costs a
+// bit flip; further ones walk the global record list, and update a global
+// count of records held.
+constexpr std::size_t kThreadHazards = 8;
+
 namespace _synchro_hazard_internal {
 class hazard_record; // Obviously, should not be used.
 } // namespace _synchro_hazard_internal
@@ -40,6 +82,8 @@ class hazard_record; // Obviously, should not be used.
 // shouldn't be an issue.
 //
 // hazard_ptr values may not have static or thread_local storage duration.
+// They may be moved to and destroyed on another thread, but are cheapest
+// destroyed on the thread that made them.
 //
 // A note on ownership: hazard_ptr takes no responsibility for the lifetimes
 // of the pointers it protects. It is up to the user to manage such lifetimes.
@@ -63,14 +107,15 @@ class hazard_ptr {
   // ptr may have been already deleted before this call completed.
   // It must be checked that the acquired pointer is indeed still valid.
   // If attempting to acquire an atomic pointer, use the atomic method,
-  // which checks for validity after the call.
+  // which checks for validity after the call. It returns the number of
+  // times it had to publish again because 'ptr' changed in the meantime.
   //
   // If 'ptr' was valid after the call to 'acquire' (or the second method
   // was used), then the 'ptr' is guaranteed valid for the duration of the
   // hazard_ptr's lifetime (or until a different pointer is acquired; a
   // hazard_ptr only protects one pointer at a time).
   void acquire(T* ptr);
-  void acquire(const std::atomic<T*>& ptr);
+  std::size_t acquire(const std::atomic<T*>& ptr);
 
   void reset() { acquire(nullptr); }
 
@@ -97,17 +142,53 @@ class hazard_ptr {
   // already met automatically.
   //
   // The 'ptr' will be destructed (via a call to 'delete') at the latest
-  // during thread_local destruction time.
+  // during static destruction time, if it was still protected when the
+  // retiring thread exited. See hazard_thresholds for when it's attempted.
   static void schedule_deletion(T* ptr);
 
  private:
   T* ptr_; // local non-atomic copy.
   _synchro_hazard_internal::hazard_record* record_;
+  // Index of record_ among the making thread's own records, or -1.
+  int slot_;
 
   // A hack to allow for type-agnostic separate compilation.
   static void ptr_deleter(void* ptr) { delete static_cast<T*>(ptr); }
 };
 
+// N hazard pointers in one, for structures whose operations hold several
+// nodes at a time: a list's predecessor and current node (Michael's
+// lock-free list), a skiplist's predecessor and successor, and so on. Each
+// index has the contract of a hazard_ptr; with N <= kThreadHazards, a
+// guard costs no more to make than a hazard_ptr does.
+template<typename T, std::size_t N>
+class hazard_guard {
+ public:
+  hazard_guard() {}
+  hazard_guard(hazard_guard&&) = default;
+  hazard_guard& operator=(hazard_guard&&) = default;
+
+  static constexpr std::size_t size() { return N; }
+
+  void acquire(std::size_t i, T* ptr) { ptrs_[i].acquire(ptr); }
+  std::size_t acquire(std::size_t i, const std::atomic<T*>& ptr) {
+    return ptrs_[i].acquire(ptr);
+  }
+  void reset(std::size_t i) { ptrs_[i].reset(); }
+  void reset() { for (auto& p : ptrs_) p.reset(); }
+  // Exchanges what indices i and j protect, without re-publishing (so
+  // neither pointer is ever unprotected). A list traversal advances with
+  // acquire(cur, next) after swap(prev, cur).
+  void swap(std::size_t i, std::size_t j);
+
+  T* get(std::size_t i) const { return ptrs_[i].get(); }
+  hazard_ptr<T>& operator[](std::size_t i) { return ptrs_[i]; }
+  const hazard_ptr<T>& operator[](std::size_t i) const { return ptrs_[i]; }
+
+ private:
+  hazard_ptr<T> ptrs_[N];
+};
+
 } // namespace synchro
 
 #include "synchro/hazard.tpp"
@@ -19,8 +19,17 @@ class hazard_record {
  public:
   hazard_record();
 
-  // Returns a fresh non-null pointer to an activated record.
+  // Returns a fresh non-null pointer to an activated record, from the
+  // global list.
   static hazard_record* activated_record();
+  // Returns an activated record, one of the calling thread's own if any is
+  // free (setting 'slot' to its index), else from the global list (setting
+  // 'slot' to -1).
+  static hazard_record* take(int& slot);
+  // Nullifies the protected pointer and gives the record back to wherever
+  // take() got it from: the calling thread's records if 'slot' is one of
+  // them, else the global list.
+  void release(int slot);
   // Marks pointer for deletion. Frees memory occasionally by scanning for
   // safe pointers to delete (not necessarily this one).
   typedef void (*deleter_t)(void*);
@@ -45,14 +54,14 @@ class hazard_record {
 template<typename T>
 hazard_ptr<T>::hazard_ptr() :
     ptr_(nullptr),
-    record_(_synchro_hazard_internal::hazard_record::activated_record()) {}
+    record_(_synchro_hazard_internal::hazard_record::take(slot_)) {}
 
 template<typename T>
-hazard_ptr<T>::~hazard_ptr() { if (record_) record_->deactivate(); }
+hazard_ptr<T>::~hazard_ptr() { if (record_) record_->release(slot_); }
 
 template<typename T>
 hazard_ptr<T>::hazard_ptr(hazard_ptr&& other) :
-    ptr_(other.ptr_), record_(other.record_) {
+    ptr_(other.ptr_), record_(other.record_), slot_(other.slot_) {
   other.ptr_ = nullptr;
   other.record_ = nullptr;
   // Only moved instances have record_ == nullptr. Note none of the
@@ -63,9 +72,10 @@ hazard_ptr<T>::hazard_ptr(hazard_ptr&& other) :
 
 template<typename T>
 hazard_ptr<T>& hazard_ptr<T>::operator=(hazard_ptr&& other) {
-  if (record_) record_->deactivate();
+  if (record_) record_->release(slot_);
   ptr_ = other.ptr_;
   record_ = other.record_;
+  slot_ = other.slot_;
   other.ptr_ = nullptr;
   other.record_ = nullptr;
   return *this;
@@ -78,15 +88,19 @@ void hazard_ptr<T>::acquire(T* ptr) {
 }
 
 template<typename T>
-void hazard_ptr<T>::acquire(const std::atomic<T*>& ptr) {
+std::size_t hazard_ptr<T>::acquire(const std::atomic<T*>& ptr) {
   T* oldval;
   T* newval = ptr.load(std::memory_order_relaxed);
-  do {
+  std::size_t retries = 0;
+  while (true) {
     oldval = newval;
     record_->publish(oldval);
     newval = ptr.load(std::memory_order_relaxed);
-  } while (newval != oldval);
+    if (newval == oldval) break;
+    ++retries;
+  }
   ptr_ = newval;
+  return retries;
 }
 
 template<typename T>
@@ -95,6 +109,14 @@ void hazard_ptr<T>::schedule_deletion(T* ptr) {
   _synchro_hazard_internal::hazard_record::schedule_deletion(ptr, ptr_deleter);
 }
 
+template<typename T, std::size_t N>
+void hazard_guard<T, N>::swap(std::size_t i, std::size_t j) {
+  if (i == j) return;
+  hazard_ptr<T> tmp(std::move(ptrs_[i]));
+  ptrs_[i] = std::move(ptrs_[j]);
+  ptrs_[j] = std::move(tmp);
+}
+
 } // namespace synchro
 
 #endif /* SYNCHRO_HAZARD_TPP_ */
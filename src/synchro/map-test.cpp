@@ -0,0 +1,277 @@
+/*
+  Vladimir Feinberg
+  synchro/map-test.cpp
+  2026-10-15
+
+  split_ordered_map tests. Pass "bench" (and optionally a maximum thread
+  count) to compare it with a mutex-guarded std::unordered_map under
+  read-heavy and write-heavy mixes.
+*/
+
+#include "synchro/split_ordered_map.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "util/bench.hpp"
+#include "util/uassert.hpp"
+
+using namespace std;
+using namespace synchro;
+
+namespace {
+
+// Tracks how many instances are alive, to observe reclamation.
+struct counted {
+  explicit counted(int v) : val(v) { live.fetch_add(1); }
+  counted(const counted& other) : val(other.val) { live.fetch_add(1); }
+  ~counted() { live.fetch_sub(1); }
+  int val;
+  static atomic<int> live;
+};
+atomic<int> counted::live(0);
+
+// Sends every key to one of four hashes, for long runs of equal split
+// order keys.
+struct bad_hash {
+  size_t operator()(int x) const { return x % 4; }
+};
+
+void test_sequential() {
+  cout << "=====> Testing sequential execution" << endl;
+  split_ordered_map<int, string> map(2);
+  UASSERT(map.empty());
+  UASSERT(map.bucket_count() == 2) << map.bucket_count();
+  UASSERT(!map.contains(1));
+  UASSERT(!map.lookup(1).valid());
+  UASSERT(!map.erase(1));
+
+  static const int kItems = 10000;
+  for (int i = 0; i < kItems; ++i)
+    UASSERT(map.insert(i, to_string(i))) << i;
+  UASSERT(map.size() == kItems) << map.size();
+  // Grew along the way.
+  UASSERT(map.bucket_count() * map.max_load_factor() >= kItems)
+      << map.bucket_count();
+  for (int i = 0; i < kItems; ++i) {
+    auto val = map.lookup(i);
+    UASSERT(val.valid()) << i;
+    UASSERT(val.access() == to_string(i)) << i << " -> " << val.access();
+  }
+  UASSERT(!map.insert(7, string("seven")));
+  UASSERT(map.lookup(7).access() == "7");
+  UASSERT(!map.contains(kItems));
+
+  for (int i = 0; i < kItems; i += 2) UASSERT(map.erase(i)) << i;
+  UASSERT(map.size() == kItems / 2) << map.size();
+  for (int i = 0; i < kItems; ++i) UASSERT(map.contains(i) == (i % 2)) << i;
+  UASSERT(!map.erase(0));
+  // Erased keys may be inserted again.
+  UASSERT(map.insert(0, string("zero")));
+  size_t len = 0;
+  UASSERT(map.visit(0, [&len](const string& s) { len = s.size(); }));
+  UASSERT(len == 4) << len;
+  UASSERT(!map.visit(2, [](const string&) { UASSERT(false); }));
+  cout << "...... Complete!" << endl;
+}
+
+void test_collisions() {
+  cout << "=====> Testing colliding hashes" << endl;
+  split_ordered_map<int, int, bad_hash> map;
+  for (int i = 0; i < 1000; ++i) UASSERT(map.insert(i, -i)) << i;
+  for (int i = 0; i < 1000; ++i) UASSERT(!map.insert(i, i)) << i;
+  for (int i = 0; i < 1000; i += 3) UASSERT(map.erase(i)) << i;
+  for (int i = 0; i < 1000; ++i) {
+    auto val = map.lookup(i);
+    UASSERT(val.valid() == (i % 3 != 0)) << i;
+    if (val.valid()) {
+      UASSERT(val.access() == -i) << i << " " << val.access();
+    }
+  }
+  cout << "...... Complete!" << endl;
+}
+
+void test_reclamation() {
+  cout << "=====> Testing reclamation" << endl;
+  // On its own thread, so that the thread's retired items are reclaimed
+  // when it exits.
+  thread([]() {
+      split_ordered_map<int, counted> map;
+      for (int i = 0; i < 1000; ++i) map.insert(i, counted(i));
+      UASSERT(counted::live == 1000) << counted::live;
+      for (int i = 0; i < 1000; i += 2) map.erase(i);
+      // Keys that are already there make no lasting copies.
+      for (int i = 1; i < 1000; i += 2) UASSERT(!map.insert(i, counted(0)));
+    }).join();
+  UASSERT(counted::live == 0) << counted::live;
+  cout << "...... Complete!" << endl;
+}
+
+// Every thread inserts and erases its own keys, while reading everyone's.
+// Values are always 3 * key, so a reader can tell a torn or freed one.
+void test_concurrent(int nthreads) {
+  cout << "=====> Testing " << nthreads << " threads" << endl;
+  static const int kKeys = 4000, kRounds = 4;
+  split_ordered_map<int, int> map(1);
+  vector<future<void> > futs;
+  for (int t = 0; t < nthreads; ++t)
+    futs.push_back(async(launch::async, [&map, nthreads, t]() {
+          for (int round = 0; round < kRounds; ++round) {
+            for (int k = t; k < kKeys; k += nthreads) {
+              UASSERT(map.insert(k, 3 * k)) << k;
+              auto other = map.lookup((k * 7919) % kKeys);
+              if (other.valid()) {
+                UASSERT(other.access() == 3 * ((k * 7919) % kKeys));
+              }
+            }
+            for (int k = t; k < kKeys; k += nthreads)
+              UASSERT(map.contains(k)) << k;
+            // Keep the last round's keys.
+            if (round == kRounds - 1) break;
+            for (int k = t; k < kKeys; k += nthreads) {
+              UASSERT(map.erase(k)) << k;
+              UASSERT(!map.erase(k)) << k;
+            }
+          }
+        }));
+  for (auto& f : futs) f.get();
+  UASSERT(map.size() == kKeys) << map.size();
+  for (int k = 0; k < kKeys; ++k) {
+    auto val = map.lookup(k);
+    UASSERT(val.valid() && val.access() == 3 * k) << k;
+  }
+  cout << "...... Complete!" << endl;
+}
+
+// Threads race to insert and erase the same keys: each key ends up
+// inserted by exactly as many threads as erased it, plus one if present.
+void test_contended(int nthreads) {
+  cout << "=====> Testing " << nthreads << " threads on shared keys" << endl;
+  static const int kKeys = 64, kOps = 20000;
+  split_ordered_map<int, int> map(1);
+  vector<atomic<int> > balance(kKeys);
+  for (auto& b : balance) b.store(0);
+  vector<future<void> > futs;
+  for (int t = 0; t < nthreads; ++t)
+    futs.push_back(async(launch::async, [&, t]() {
+          uint32_t x = t + 1;
+          for (int i = 0; i < kOps; ++i) {
+            x = x * 1664525 + 1013904223;
+            int k = (x >> 8) % kKeys;
+            if (x >> 31) {
+              if (map.insert(k, k)) balance[k].fetch_add(1);
+            } else if (map.erase(k)) {
+              balance[k].fetch_sub(1);
+            }
+          }
+        }));
+  for (auto& f : futs) f.get();
+  size_t present = 0;
+  for (int k = 0; k < kKeys; ++k) {
+    UASSERT(balance[k] == map.contains(k)) << k << " " << balance[k];
+    present += map.contains(k);
+  }
+  UASSERT(map.size() == present) << map.size() << " " << present;
+  cout << "...... Complete!" << endl;
+}
+
+// ---- bench
+
+// The baseline.
+class locked_map {
+ public:
+  bool insert(int key, int value) {
+    lock_guard<mutex> guard(lock_);
+    return map_.emplace(key, value).second;
+  }
+  bool erase(int key) {
+    lock_guard<mutex> guard(lock_);
+    return map_.erase(key);
+  }
+  bool contains(int key) const {
+    lock_guard<mutex> guard(lock_);
+    return map_.count(key);
+  }
+ private:
+  mutable mutex lock_;
+  unordered_map<int, int> map_;
+};
+
+// Keeps the lookups from being optimized out.
+atomic<long> sink(0);
+
+// Threads split a fixed number of random operations over kKeys keys,
+// half of which are in the map to start with: 'reads' percent lookups,
+// the rest evenly inserts and erases, so the map stays about half full.
+template<typename M>
+void bench_map(util::bench::suite& suite, const string& name, int nthreads,
+               int reads) {
+  static const int kKeys = 1 << 16, kOps = 1 << 20;
+  int per_thread = kOps / nthreads;
+  suite.run_manual(name + ", " + to_string(nthreads) + " threads", [&]() {
+      M map;
+      for (int k = 0; k < kKeys; k += 2) map.insert(k, k);
+      auto time = util::bench::time_threads(nthreads, [&](int t) {
+          uint32_t x = 2654435761u * (t + 1);
+          long found = 0;
+          for (int i = 0; i < per_thread; ++i) {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            int k = x % kKeys;
+            int op = (x >> 16) % 100;
+            if (op < reads) found += map.contains(k);
+            else if (op % 2) map.insert(k, k);
+            else map.erase(k);
+          }
+          sink.fetch_add(found, memory_order_relaxed);
+        });
+      return time;
+    }, per_thread * nthreads);
+}
+
+void bench(int max_threads) {
+  for (int reads : {90, 10}) {
+    util::bench::suite suite(
+        "Hash map, " + to_string(reads) + "% lookups, rest inserts and "
+        "erases (" + to_string(thread::hardware_concurrency()) +
+        " hardware threads)");
+    for (int n = 1; n <= max_threads; n *= 2) {
+      bench_map<locked_map>(suite, "mutex + unordered_map", n, reads);
+      bench_map<split_ordered_map<int, int> >(suite, "split_ordered_map", n,
+                                              reads);
+    }
+  }
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+  if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+    int hw = thread::hardware_concurrency();
+    bench(argc > 2 ? atoi(argv[2]) : 2 * (hw ? hw : 4));
+    return 0;
+  }
+
+  cout << "Split-ordered map testing." << endl;
+  test_sequential();
+  test_collisions();
+  test_reclamation();
+  // Oversubscribed too, so that threads get preempted mid-operation.
+  int many = 2 * max(4u, thread::hardware_concurrency());
+  test_concurrent(4);
+  test_concurrent(many);
+  test_contended(4);
+  test_contended(many);
+  return 0;
+}
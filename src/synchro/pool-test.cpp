@@ -0,0 +1,286 @@
+/*
+  Vladimir Feinberg
+  synchro/pool-test.cpp
+  2026-10-14
+
+  Work-stealing thread pool test. Pass "bench" to compare fork-join and
+  flat-task throughput against a pool over one shared hazard_queue.
+*/
+
+#include "synchro/work_stealing_pool.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "queues/hazard_queue.hpp"
+#include "util/bench.hpp"
+#include "util/uassert.hpp"
+
+using namespace std;
+using namespace synchro;
+
+namespace {
+
+// The baseline: every job, forked or not, goes through one shared queue.
+class central_pool {
+ public:
+  typedef function<void()> job;
+
+  class join_handle {
+   public:
+    join_handle() : pending_(make_shared<atomic<int> >(0)) {}
+    void wait() const {
+      // Workers help, other threads just spin: good enough for a bench.
+      while (!done())
+        if (!current_ || !current_->run_one()) this_thread::yield();
+    }
+    bool done() const { return pending_->load() == 0; }
+   private:
+    friend class central_pool;
+    shared_ptr<atomic<int> > pending_;
+  };
+
+  explicit central_pool(int nthreads) : stopping_(false) {
+    for (int i = 0; i < nthreads; ++i)
+      threads_.emplace_back([this]() {
+          current_ = this;
+          while (!stopping_.load() || !queue_.empty())
+            if (!run_one()) this_thread::yield();
+          current_ = nullptr;
+        });
+  }
+  ~central_pool() {
+    stopping_.store(true);
+    for (auto& t : threads_) t.join();
+  }
+
+  join_handle submit(job j) {
+    join_handle h;
+    submit(h, move(j));
+    return h;
+  }
+  void submit(const join_handle& h, job j) {
+    h.pending_->fetch_add(1);
+    queue_.enqueue(new task{move(j), h.pending_});
+  }
+
+ private:
+  struct task {
+    job fn;
+    shared_ptr<atomic<int> > pending;
+  };
+
+  bool run_one() {
+    auto opt = queue_.try_dequeue();
+    if (!opt.valid()) return false;
+    auto t = opt.access();
+    t->fn();
+    t->pending->fetch_sub(1);
+    delete t;
+    return true;
+  }
+
+  static thread_local central_pool* current_;
+
+  queues::hazard_queue<task*> queue_;
+  atomic<bool> stopping_;
+  vector<thread> threads_;
+};
+
+thread_local central_pool* central_pool::current_ = nullptr;
+
+long serial_fib(int n) {
+  return n < 2 ? n : serial_fib(n - 1) + serial_fib(n - 2);
+}
+
+// Forks fib(n - 1), computes fib(n - 2) inline, joins. Below the cutoff the
+// rest of the subtree is computed serially.
+template<typename P>
+long fork_fib(P& pool, int n, int cutoff) {
+  if (n < cutoff) return serial_fib(n);
+  long left = 0;
+  auto h = pool.submit([&pool, &left, n, cutoff]() {
+      left = fork_fib(pool, n - 1, cutoff);
+    });
+  long right = fork_fib(pool, n - 2, cutoff);
+  h.wait();
+  return left + right;
+}
+
+template<typename P>
+long run_fork_fib(P& pool, int n, int cutoff) {
+  long result = 0;
+  pool.submit([&]() { result = fork_fib(pool, n, cutoff); }).wait();
+  return result;
+}
+
+// Submits all jobs from the calling (non-worker) thread.
+template<typename P>
+void run_flat(P& pool, int njobs, atomic<long>& sum) {
+  typename P::join_handle h;
+  for (int i = 0; i < njobs; ++i)
+    pool.submit(h, [&sum, i]() { sum.fetch_add(i, memory_order_relaxed); });
+  h.wait();
+}
+
+// Splits the jobs into nthreads parents, which submit them from inside the
+// pool.
+template<typename P>
+void run_nested_flat(P& pool, int nparents, int njobs, atomic<long>& sum) {
+  typename P::join_handle all;
+  for (int p = 0; p < nparents; ++p)
+    pool.submit(all, [&pool, &sum, njobs]() {
+        typename P::join_handle h;
+        for (int i = 0; i < njobs; ++i)
+          pool.submit(h, [&sum, i]() {
+              sum.fetch_add(i, memory_order_relaxed);
+            });
+        h.wait();
+      });
+  all.wait();
+}
+
+template<typename P>
+void bench_pool(const string& title, int nthreads) {
+  static const int kFib = 30, kCutoff = 12;
+  static const int kFlat = 200000;
+  util::bench::suite suite(title + " (" + to_string(nthreads) +
+                           " threads)");
+  P pool(nthreads);
+  long fib = 0;
+  suite.run_fixed("Fork-join fib(30)", []() {}, [&]() {
+      fib = run_fork_fib(pool, kFib, kCutoff);
+    });
+  UASSERT(fib == serial_fib(kFib));
+  atomic<long> sum(0);
+  suite.run_fixed("Flat, 200000 external jobs", []() {}, [&]() {
+      run_flat(pool, kFlat, sum);
+    }, kFlat);
+  suite.run_fixed("Flat, 200000 jobs from inside", []() {}, [&]() {
+      run_nested_flat(pool, nthreads, kFlat / nthreads, sum);
+    }, kFlat / nthreads * nthreads);
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+  if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+    auto n = work_stealing_pool::default_threads();
+    bench_pool<work_stealing_pool>("Work-stealing pool", n);
+    bench_pool<central_pool>("Central hazard_queue pool", n);
+    return 0;
+  }
+
+  cout << "Work-stealing pool testing." << endl;
+
+  cout << "=====> Testing external submission" << endl;
+  {
+    work_stealing_pool pool(4);
+    atomic<int> ran(0);
+    vector<work_stealing_pool::join_handle> handles;
+    for (int i = 0; i < 1000; ++i)
+      handles.push_back(pool.submit([&ran]() { ran.fetch_add(1); }));
+    for (auto& h : handles) h.wait();
+    UASSERT(ran.load() == 1000) << ran.load() << " jobs ran";
+    for (auto& h : handles) UASSERT(h.done());
+    UASSERT(work_stealing_pool::join_handle().done());
+  }
+  cout << "...... Complete!" << endl;
+
+  cout << "=====> Testing groups" << endl;
+  {
+    work_stealing_pool pool(3);
+    atomic<long> sum(0);
+    run_flat(pool, 10000, sum);
+    UASSERT(sum.load() == 10000L * 9999 / 2) << "sum " << sum.load();
+  }
+  cout << "...... Complete!" << endl;
+
+  cout << "=====> Testing fork-join from inside jobs" << endl;
+  {
+    // With one worker, every join has to run the forked job itself.
+    for (int n : {1, 2, 4}) {
+      work_stealing_pool pool(n);
+      UASSERT(run_fork_fib(pool, 22, 4) == serial_fib(22))
+          << "wrong fib with " << n << " workers";
+      atomic<long> sum(0);
+      run_nested_flat(pool, 4, 5000, sum);
+      UASSERT(sum.load() == 4 * (5000L * 4999 / 2)) << "sum " << sum.load();
+    }
+  }
+  cout << "...... Complete!" << endl;
+
+  cout << "=====> Testing idle workers wake up" << endl;
+  {
+    work_stealing_pool pool(4);
+    for (int round = 0; round < 50; ++round) {
+      // Let the workers go to sleep between rounds.
+      if (round % 10 == 0) this_thread::sleep_for(chrono::milliseconds(5));
+      atomic<long> sum(0);
+      run_nested_flat(pool, 2, 100, sum);
+      UASSERT(sum.load() == 2 * (100L * 99 / 2)) << "sum " << sum.load();
+      atomic<int> ran(0);
+      pool.submit([&ran]() { ran.fetch_add(1); }).wait();
+      UASSERT(ran.load() == 1);
+    }
+  }
+  cout << "...... Complete!" << endl;
+
+  cout << "=====> Testing a submit wakes one idle worker" << endl;
+  {
+    static const int kWorkers = 4, kSubmits = 20;
+    work_stealing_pool pool(kWorkers);
+    auto before = pool.wakeups();
+    for (int i = 0; i < kSubmits; ++i) {
+      // Every worker is asleep by the time the job comes in.
+      this_thread::sleep_for(chrono::milliseconds(2));
+      pool.submit([]() {}).wait();
+    }
+    auto woken = pool.wakeups() - before;
+    // Waking everyone would be kWorkers per submit.
+    UASSERT(woken <= 2 * kSubmits) << woken << " wakeups for " << kSubmits
+                                   << " submits";
+  }
+  cout << "...... Complete!" << endl;
+
+  cout << "=====> Testing destruction drains submitted jobs" << endl;
+  {
+    atomic<int> ran(0);
+    {
+      work_stealing_pool pool(2);
+      for (int i = 0; i < 100; ++i)
+        pool.submit([&pool, &ran]() {
+            this_thread::yield();
+            // Submitted while the pool may already be shutting down.
+            pool.submit([&ran]() { ran.fetch_add(1); });
+            ran.fetch_add(1);
+          });
+    }
+    UASSERT(ran.load() == 200) << ran.load() << " jobs ran";
+  }
+  cout << "...... Complete!" << endl;
+
+  cout << "=====> Testing concurrent external submitters" << endl;
+  {
+    work_stealing_pool pool(3);
+    atomic<long> sum(0);
+    vector<future<void> > futs;
+    for (int t = 0; t < 4; ++t)
+      futs.push_back(async(launch::async, [&]() {
+            run_flat(pool, 5000, sum);
+          }));
+    for (auto& f : futs) f.get();
+    UASSERT(sum.load() == 4 * (5000L * 4999 / 2)) << "sum " << sum.load();
+  }
+  cout << "...... Complete!" << endl;
+
+  return 0;
+}
@@ -0,0 +1,86 @@
+/*
+  Vladimir Feinberg
+  synchro/reclamation.hpp
+  2026-10-14
+
+  Memory reclamation policies, for lockfree structures that want to be
+  parameterized on how they keep unlinked nodes alive (see
+  queues/hazard_queue.hpp).
+
+  A policy R provides:
+
+    R::region           - RAII object held for the duration of each
+                          operation on the structure.
+    R::guard<T>         - protects one pointer at a time, with the same
+                          acquire(), reset(), get(), -> and * interface as
+                          hazard_ptr<T> (acquiring from an atomic returns
+                          how many times the guard had to retry). Only
+                          valid inside a region.
+    R::schedule_deletion(T*)
+                        - same contract as hazard_ptr<T>::schedule_deletion.
+
+  hazard_reclaimer protects each pointer individually (bounded garbage, a
+  publish-and-validate per pointer), epoch_reclaimer protects the whole
+  region (one fence per operation, garbage unbounded if a thread stalls in
+  a region).
+*/
+
+#ifndef SYNCHRO_RECLAMATION_HPP_
+#define SYNCHRO_RECLAMATION_HPP_
+
+#include <atomic>
+#include <cstddef>
+
+#include "synchro/epoch.hpp"
+#include "synchro/hazard.hpp"
+
+namespace synchro {
+
+struct hazard_reclaimer {
+  struct region {
+    region() {} // hazard pointers need no per-operation state.
+  };
+
+  template<typename T>
+  using guard = hazard_ptr<T>;
+
+  template<typename T>
+  static void schedule_deletion(T* ptr) {
+    hazard_ptr<T>::schedule_deletion(ptr);
+  }
+};
+
+struct epoch_reclaimer {
+  typedef epoch_guard region;
+
+  // Inside an epoch region everything reachable is already protected, so
+  // a guard is just a local copy of the pointer.
+  template<typename T>
+  class guard {
+   public:
+    guard() : ptr_(nullptr) {}
+    void acquire(T* ptr) { ptr_ = ptr; }
+    std::size_t acquire(const std::atomic<T*>& ptr) {
+      ptr_ = ptr.load(std::memory_order_acquire);
+      return 0;
+    }
+    void reset() { ptr_ = nullptr; }
+
+    T* get() const { return ptr_; }
+    T& operator*() const { return *ptr_; }
+    T* operator->() const { return ptr_; }
+    explicit operator bool() const { return ptr_; }
+
+   private:
+    T* ptr_;
+  };
+
+  template<typename T>
+  static void schedule_deletion(T* ptr) {
+    epoch_domain::schedule_deletion(ptr);
+  }
+};
+
+} // namespace synchro
+
+#endif /* SYNCHRO_RECLAMATION_HPP_ */
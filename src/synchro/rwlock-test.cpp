@@ -0,0 +1,239 @@
+/*
+  Vladimir Feinberg
+  synchro/rwlock-test.cpp
+  2026-10-14
+
+  Reader-writer lock and seqlock tests. Pass "bench" (and optionally a
+  maximum thread count) to compare read-mostly throughput against the
+  pthread wrapper.
+*/
+
+#include "synchro/rwlock.hpp"
+#include "synchro/scalable_rw.hpp"
+#include "synchro/seqlock.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "util/bench.hpp"
+#include "util/uassert.hpp"
+
+using namespace std;
+using namespace synchro;
+
+namespace {
+
+// Single-threaded lock state checks.
+template<typename L>
+void test_try(L& lk) {
+  UASSERT(lk.try_lock_shared());
+  UASSERT(lk.try_lock_shared());
+  UASSERT(!lk.try_lock());
+  lk.unlock_shared();
+  lk.unlock_shared();
+  UASSERT(lk.try_lock());
+  UASSERT(!lk.try_lock());
+  UASSERT(!lk.try_lock_shared());
+  lk.unlock();
+  {
+    auto ro = lk.read_only();
+    lock_guard<decltype(ro)> read(ro);
+    UASSERT(!lk.try_lock());
+  }
+  {
+    lock_guard<L> write(lk);
+    UASSERT(!lk.try_lock_shared());
+  }
+}
+
+// Readers check that they never overlap a writer, and that the two halves
+// of the protected pair agree. Writers check they are alone.
+template<typename L>
+void test_exclusion(L& lk, int nthreads, int ops) {
+  atomic<int> readers(0), writers(0);
+  long first = 0, second = 0;
+  vector<future<void> > futs;
+  for (int t = 0; t < nthreads; ++t)
+    futs.push_back(async(launch::async, [&, t]() {
+          minstd_rand gen(t);
+          for (int i = 0; i < ops; ++i) {
+            if (gen() % 8 == 0) {
+              lock_guard<L> write(lk);
+              UASSERT(writers.fetch_add(1) == 0);
+              UASSERT(readers.load() == 0);
+              ++first;
+              this_thread::yield();
+              ++second;
+              writers.fetch_sub(1);
+            } else {
+              auto ro = lk.read_only();
+              lock_guard<decltype(ro)> read(ro);
+              readers.fetch_add(1);
+              UASSERT(writers.load() == 0);
+              UASSERT(first == second);
+              readers.fetch_sub(1);
+            }
+          }
+        }));
+  for (auto& f : futs) f.get();
+  UASSERT(first == second);
+}
+
+struct snapshot {
+  uint64_t a, b, c;
+  uint32_t d;
+};
+
+void test_seqlock(int nthreads, int ops) {
+  seqlock<snapshot> sl;
+  snapshot zero = sl.load();
+  UASSERT(zero.a == 0 && zero.b == 0 && zero.c == 0 && zero.d == 0);
+  sl.store(snapshot{1, 2, 3, 4});
+  snapshot one = sl.load();
+  UASSERT(one.a == 1 && one.b == 2 && one.c == 3 && one.d == 4);
+
+  // A throwing update leaves the value alone and the lock usable.
+  bool threw = false;
+  try {
+    sl.update([](snapshot& s) { s.a = 5; throw runtime_error("update"); });
+  } catch (const runtime_error&) {
+    threw = true;
+  }
+  UASSERT(threw);
+  UASSERT(sl.load().a == 1);
+  sl.store(snapshot{1, 2, 3, 4});
+
+  // Writers keep a == b == c == d, and c counting the updates.
+  sl.store(snapshot{0, 0, 0, 0});
+  vector<future<void> > futs;
+  for (int t = 0; t < nthreads; ++t)
+    futs.push_back(async(launch::async, [&sl, t, ops]() {
+          for (int i = 0; i < ops; ++i) {
+            if (t % 2 == 0 && i % 4 == 0) {
+              sl.update([](snapshot& s) {
+                  ++s.a; ++s.b; ++s.c; ++s.d;
+                });
+            } else {
+              snapshot s = sl.load();
+              UASSERT(s.a == s.b && s.b == s.c && s.c == s.d)
+                << s.a << " " << s.b << " " << s.c << " " << s.d;
+            }
+          }
+        }));
+  for (auto& f : futs) f.get();
+  int writers = (nthreads + 1) / 2;
+  UASSERT(sl.load().c == static_cast<uint64_t>(writers * ((ops + 3) / 4)));
+}
+
+// ---- bench
+
+// A small table, read under the lock, updated by 1 in kWriteEvery ops.
+const int kTable = 16;
+const int kWriteEvery = 1000;
+// Operations per trial, split among the threads.
+const int kOps = 1000000;
+// Keeps the reads from being optimized out.
+atomic<long> sink(0);
+
+template<typename L>
+void bench_rw(util::bench::suite& suite, const string& name, int nthreads) {
+  int per_thread = kOps / nthreads;
+  suite.run_manual(name + ", " + to_string(nthreads) + " threads", [&]() {
+      L lk;
+      long table[kTable] = {};
+      return util::bench::time_threads(nthreads, [&](int t) {
+          long sum = 0;
+          minstd_rand gen(t);
+          for (int i = 0; i < per_thread; ++i) {
+            if (gen() % kWriteEvery == 0) {
+              lock_guard<L> write(lk);
+              ++table[gen() % kTable];
+            } else {
+              auto ro = lk.read_only();
+              lock_guard<decltype(ro)> read(ro);
+              sum += table[i % kTable];
+            }
+          }
+          sink.fetch_add(sum, memory_order_relaxed);
+        });
+    }, per_thread * nthreads);
+}
+
+void bench_seqlock(util::bench::suite& suite, int nthreads) {
+  int per_thread = kOps / nthreads;
+  suite.run_manual("seqlock, " + to_string(nthreads) + " threads", [&]() {
+      seqlock<snapshot> sl;
+      return util::bench::time_threads(nthreads, [&](int t) {
+          long sum = 0;
+          minstd_rand gen(t);
+          for (int i = 0; i < per_thread; ++i) {
+            if (gen() % kWriteEvery == 0)
+              sl.update([](snapshot& s) { ++s.a; });
+            else
+              sum += sl.load().a;
+          }
+          sink.fetch_add(sum, memory_order_relaxed);
+        });
+    }, per_thread * nthreads);
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+  if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+    int hw = thread::hardware_concurrency();
+    int max_threads = argc > 2 ? atoi(argv[2]) : 2 * (hw ? hw : 4);
+    util::bench::suite suite(
+        "Read-mostly lock benchmark, 1 write per " + to_string(kWriteEvery) +
+        " ops (" + to_string(hw) + " hardware threads)");
+    for (int n = 1; n <= max_threads; n *= 2) {
+      bench_rw<locks::rw>(suite, "rw", n);
+      bench_rw<locks::distributed_rw>(suite, "distributed_rw", n);
+      bench_rw<locks::ticket_rw>(suite, "ticket_rw", n);
+      bench_seqlock(suite, n);
+    }
+    return 0;
+  }
+
+  cout << "Reader-writer lock testing." << endl;
+
+  cout << "=====> Testing try_lock" << endl;
+  {
+    locks::rw rw;
+    test_try(rw);
+    locks::distributed_rw drw;
+    test_try(drw);
+    locks::ticket_rw trw;
+    test_try(trw);
+  }
+  cout << "...... Complete!" << endl;
+
+  cout << "=====> Testing exclusion" << endl;
+  {
+    locks::rw rw;
+    test_exclusion(rw, 4, 20000);
+    locks::distributed_rw drw;
+    test_exclusion(drw, 4, 20000);
+    // More threads than slots, so that slots are shared.
+    test_exclusion(drw, locks::distributed_rw::kSlots + 8, 500);
+    locks::ticket_rw trw;
+    test_exclusion(trw, 4, 20000);
+  }
+  cout << "...... Complete!" << endl;
+
+  cout << "=====> Testing seqlock" << endl;
+  test_seqlock(4, 20000);
+  cout << "...... Complete!" << endl;
+
+  return 0;
+}
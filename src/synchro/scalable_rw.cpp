@@ -0,0 +1,142 @@
+/*
+ * Vladimir Feinberg
+ * synchro/scalable_rw.cpp
+ * 2026-10-14
+ *
+ * distributed_rw and ticket_rw implementation
+ */
+
+#include "synchro/scalable_rw.hpp"
+
+#include <thread>
+
+#include "util/thread_index.hpp"
+
+using namespace std;
+using namespace synchro;
+using namespace locks;
+
+namespace {
+  // Spins on 'done' for a while, then yields between tries.
+  template<typename F>
+  void spin_until(F done) {
+    for (int i = 0; !done(); ++i)
+      if (i >= 64) this_thread::yield();
+  }
+}
+
+// distributed_rw --------------------------------------------------------
+
+constexpr size_t distributed_rw::kSlots;
+
+distributed_rw::distributed_rw() : writer_(false) {
+  for (auto& s : slots_) s.readers.store(0, memory_order_relaxed);
+}
+
+distributed_rw::slot& distributed_rw::my_slot() {
+  return slots_[util::thread_index() & (kSlots - 1)];
+}
+
+bool distributed_rw::drained() const {
+  for (auto& s : slots_)
+    if (s.readers.load()) return false;
+  return true;
+}
+
+// The reader's count and the writer's flag are both stored, then the other
+// one loaded, all sequentially consistent: at least one side sees the
+// other, so a reader and a writer never both get in.
+
+void distributed_rw::lock_shared() {
+  auto& s = my_slot();
+  while (true) {
+    s.readers.fetch_add(1);
+    if (!writer_.load()) return;
+    s.readers.fetch_sub(1, memory_order_release);
+    spin_until([this]() { return !writer_.load(memory_order_relaxed); });
+  }
+}
+
+bool distributed_rw::try_lock_shared() noexcept {
+  auto& s = my_slot();
+  s.readers.fetch_add(1);
+  if (!writer_.load()) return true;
+  s.readers.fetch_sub(1, memory_order_release);
+  return false;
+}
+
+void distributed_rw::unlock_shared() {
+  my_slot().readers.fetch_sub(1, memory_order_release);
+}
+
+void distributed_rw::lock() {
+  writers_.lock();
+  writer_.store(true);
+  spin_until([this]() { return drained(); });
+}
+
+bool distributed_rw::try_lock() noexcept {
+  if (!writers_.try_lock()) return false;
+  writer_.store(true);
+  if (drained()) return true;
+  unlock();
+  return false;
+}
+
+void distributed_rw::unlock() {
+  writer_.store(false, memory_order_release);
+  writers_.unlock();
+}
+
+// ticket_rw -------------------------------------------------------------
+
+// As above, readers_ and writers_ are each incremented and then the other
+// loaded, sequentially consistently.
+
+void ticket_rw::lock_shared() {
+  while (true) {
+    spin_until([this]() { return !writers_.load(memory_order_relaxed); });
+    readers_.fetch_add(1);
+    if (!writers_.load()) return;
+    readers_.fetch_sub(1, memory_order_release);
+  }
+}
+
+bool ticket_rw::try_lock_shared() noexcept {
+  if (writers_.load(memory_order_relaxed)) return false;
+  readers_.fetch_add(1);
+  if (!writers_.load()) return true;
+  readers_.fetch_sub(1, memory_order_release);
+  return false;
+}
+
+void ticket_rw::unlock_shared() {
+  readers_.fetch_sub(1, memory_order_release);
+}
+
+void ticket_rw::lock() {
+  writers_.fetch_add(1);
+  uint32_t ticket = next_ticket_.fetch_add(1, memory_order_relaxed);
+  spin_until([this, ticket]() {
+      return serving_.load(memory_order_acquire) == ticket;
+    });
+  spin_until([this]() { return !readers_.load(); });
+}
+
+bool ticket_rw::try_lock() noexcept {
+  // Only take a ticket that would be served right away.
+  uint32_t ticket = serving_.load(memory_order_acquire);
+  if (!next_ticket_.compare_exchange_strong(ticket, ticket + 1,
+                                            memory_order_relaxed))
+    return false;
+  writers_.fetch_add(1);
+  if (!readers_.load()) return true;
+  unlock();
+  return false;
+}
+
+void ticket_rw::unlock() {
+  writers_.fetch_sub(1, memory_order_release);
+  serving_.store(serving_.load(memory_order_relaxed) + 1,
+                 memory_order_release);
+}
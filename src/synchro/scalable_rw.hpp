@@ -0,0 +1,134 @@
+/*
+ * Vladimir Feinberg
+ * synchro/scalable_rw.hpp
+ * 2026-10-14
+ *
+ * Reader-writer locks that scale past a handful of readers, as drop-in
+ * replacements for locks::rw (see synchro/rwlock.hpp).
+ */
+
+#ifndef SYNCHRO_SCALABLE_RW_HPP_
+#define SYNCHRO_SCALABLE_RW_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include "util/cache_line.hpp"
+
+namespace synchro {
+namespace locks {
+
+// Shared view of a reader-writer lock L: lock() and unlock() take and
+// release L shared, so that std::lock_guard can hold it in read mode.
+// Only valid as long as the lock is.
+template<typename L>
+class shared_view {
+ public:
+  explicit shared_view(L& lk) : lk_(lk) {}
+  void lock() { lk_.lock_shared(); }
+  bool try_lock() { return lk_.try_lock_shared(); }
+  void unlock() { lk_.unlock_shared(); }
+ private:
+  L& lk_;
+};
+
+// Reader-writer lock with a distributed reader indicator, after the
+// "big-reader" locks of the Linux kernel and BRAVO (Dice and Kogan,
+// "BRAVO - Biased Locking for Reader-Writer Locks").
+//
+// Each reader counts itself in one of kSlots line-sized slots, picked by
+// thread, and then checks for a writer; a writer announces itself and
+// waits for every slot to drain. Readers on different slots touch no
+// common line unless a writer shows up, so read-side throughput scales with
+// the number of threads. Writes pay for it: each acquisition scans all
+// slots, so this lock suits read-mostly data (configuration, cache
+// shards).
+//
+// Writers are preferred: arriving readers wait while one is waiting. Writers
+// are queued on a std::mutex among themselves. Waiters spin, then yield.
+//
+// Never throws. Neither shared nor exclusive locking is recursive.
+class distributed_rw {
+ public:
+  typedef shared_view<distributed_rw> ronly;
+  // Reader slots. A power of two.
+  static constexpr std::size_t kSlots = 64;
+
+  distributed_rw();
+  distributed_rw(const distributed_rw&) = delete;
+  distributed_rw& operator=(const distributed_rw&) = delete;
+
+  // read, lock behavior undef if owned, unlock undef if not
+  void lock_shared();
+  bool try_lock_shared() noexcept;
+  void unlock_shared();
+  // write, lock behavior undef if owned, unlock undef if not
+  void lock();
+  bool try_lock() noexcept;
+  void unlock();
+  // read-only reference (lock() is a lock_shared).
+  ronly read_only() { return ronly(*this); }
+
+ private:
+  struct slot {
+    std::atomic<std::uint32_t> readers;
+    util::cache_pad<sizeof(std::atomic<std::uint32_t>)> pad_;
+  };
+
+  // Slot of the calling thread.
+  slot& my_slot();
+  // Whether every slot is empty.
+  bool drained() const;
+
+  util::cache_pad<0> pad0_;
+  std::atomic<bool> writer_;
+  util::cache_pad<sizeof(std::atomic<bool>)> pad1_;
+  slot slots_[kSlots];
+  std::mutex writers_;
+};
+
+// Writer-preferring ticket reader-writer lock: a single word of reader
+// count, plus writer tickets.
+//
+// Writers take a ticket and are let in in ticket order, once the readers
+// present have left. Readers keep out while any writer holds the lock or
+// waits for it, so a steady stream of readers cannot starve writers (the
+// pthread default prefers readers). The lock is a few words with no
+// system calls, so it is cheap when uncontended; but every reader still
+// writes the shared count, which distributed_rw avoids.
+//
+// Never throws. Neither shared nor exclusive locking is recursive.
+class ticket_rw {
+ public:
+  typedef shared_view<ticket_rw> ronly;
+
+  ticket_rw() : readers_(0), writers_(0), next_ticket_(0), serving_(0) {}
+  ticket_rw(const ticket_rw&) = delete;
+  ticket_rw& operator=(const ticket_rw&) = delete;
+
+  // read, lock behavior undef if owned, unlock undef if not
+  void lock_shared();
+  bool try_lock_shared() noexcept;
+  void unlock_shared();
+  // write, lock behavior undef if owned, unlock undef if not
+  void lock();
+  bool try_lock() noexcept;
+  void unlock();
+  // read-only reference (lock() is a lock_shared).
+  ronly read_only() { return ronly(*this); }
+
+ private:
+  // Readers holding the lock.
+  std::atomic<std::uint32_t> readers_;
+  // Writers holding the lock or waiting for it.
+  std::atomic<std::uint32_t> writers_;
+  std::atomic<std::uint32_t> next_ticket_;
+  std::atomic<std::uint32_t> serving_;
+};
+
+} // namespace locks
+} // namespace synchro
+
+#endif /* SYNCHRO_SCALABLE_RW_HPP_ */
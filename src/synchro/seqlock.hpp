@@ -0,0 +1,101 @@
+/*
+ * Vladimir Feinberg
+ * synchro/seqlock.hpp
+ * 2026-10-14
+ *
+ * Declares seqlock, a sequence-locked value for small snapshots.
+ */
+
+#ifndef SYNCHRO_SEQLOCK_HPP_
+#define SYNCHRO_SEQLOCK_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace synchro {
+
+// A value of trivially copyable type T, read without ever writing shared
+// memory.
+//
+// A sequence count is odd while a write is in progress. Readers copy the
+// value between two reads of the count, and retry if it was odd or
+// changed; writers bump the count around their write. Reads therefore
+// scale perfectly and never block writers, but may retry while writes
+// keep coming: made for small, read-mostly values (a configuration
+// snapshot, a pair of counters) where copying T is cheap.
+//
+// The value is kept as an array of relaxed atomic words, so a reader
+// racing a writer reads torn words (which it then throws away) rather
+// than racing on plain memory.
+//
+// Writers are serialized among themselves, by spinning on the count.
+//
+// seqlock<T>
+// T - type of the value, trivially copyable
+//
+// This class is thread safe.
+template<typename T>
+class seqlock {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "seqlock values are copied word by word");
+ public:
+  typedef T value_type;
+
+  // Value-initialized value.
+  seqlock() : seqlock(T()) {}
+  explicit seqlock(const T& val);
+  seqlock(const seqlock&) = delete;
+  seqlock& operator=(const seqlock&) = delete;
+
+  /*
+   * INPUT:
+   * PRECONDITION:
+   * BEHAVIOR:
+   * Copies out the value, retrying until no write overlapped the copy.
+   * RETURN:
+   * A value stored by some store(), or the initial value.
+   */
+  T load() const;
+  /*
+   * INPUT:
+   * const T& val - new value
+   * PRECONDITION:
+   * BEHAVIOR:
+   * Replaces the value. Waits for other writers.
+   * RETURN:
+   */
+  void store(const T& val);
+  /*
+   * INPUT:
+   * F f - functor accepting a T&
+   * PRECONDITION:
+   * BEHAVIOR:
+   * Atomically with respect to other writers, replaces the value with a
+   * copy that f has modified. If f throws, the value is unchanged and the
+   * exception propagates.
+   * RETURN:
+   */
+  template<typename F>
+  void update(F f);
+
+ private:
+  typedef std::uintptr_t word;
+  static constexpr std::size_t kWords =
+      (sizeof(T) + sizeof(word) - 1) / sizeof(word);
+
+  // Takes the write side, returning the (odd) count it set.
+  std::uint64_t begin_write();
+  void write_words(const T& val);
+  void end_write(std::uint64_t seq);
+
+  std::atomic<std::uint64_t> seq_;
+  std::atomic<word> words_[kWords];
+};
+
+} // namespace synchro
+
+#include "synchro/seqlock.tpp"
+
+#endif /* SYNCHRO_SEQLOCK_HPP_ */
@@ -0,0 +1,102 @@
+/*
+ * Vladimir Feinberg
+ * synchro/seqlock.tpp
+ * 2026-10-14
+ *
+ * Contains implementation of seqlock.hpp methods.
+ *
+ * Orderings after Boehm, "Can Seqlocks Get Along With Programming Language
+ * Memory Models?"
+ */
+
+#include <cstring>
+#include <thread>
+
+namespace synchro {
+
+template<typename T>
+constexpr std::size_t seqlock<T>::kWords;
+
+template<typename T>
+seqlock<T>::seqlock(const T& val) : seq_(0) {
+  write_words(val);
+}
+
+template<typename T>
+T seqlock<T>::load() const {
+  word copy[kWords];
+  for (int tries = 0;; ++tries) {
+    std::uint64_t before = seq_.load(std::memory_order_acquire);
+    if (!(before & 1)) {
+      for (std::size_t i = 0; i < kWords; ++i)
+        copy[i] = words_[i].load(std::memory_order_relaxed);
+      // Keeps the word loads above the second count load.
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (seq_.load(std::memory_order_relaxed) == before) break;
+    }
+    if (tries >= 64) std::this_thread::yield();
+  }
+  T val;
+  std::memcpy(&val, copy, sizeof(T));
+  return val;
+}
+
+template<typename T>
+void seqlock<T>::store(const T& val) {
+  auto seq = begin_write();
+  write_words(val);
+  end_write(seq);
+}
+
+template<typename T>
+template<typename F>
+void seqlock<T>::update(F f) {
+  auto seq = begin_write();
+  // Only writers change the words, and we are the only writer.
+  word copy[kWords];
+  for (std::size_t i = 0; i < kWords; ++i)
+    copy[i] = words_[i].load(std::memory_order_relaxed);
+  T val;
+  std::memcpy(&val, copy, sizeof(T));
+  try {
+    f(val);
+  } catch (...) {
+    // The words are untouched, so this just releases the write side.
+    end_write(seq);
+    throw;
+  }
+  write_words(val);
+  end_write(seq);
+}
+
+// ---- helper methods
+
+template<typename T>
+std::uint64_t seqlock<T>::begin_write() {
+  for (int tries = 0;; ++tries) {
+    std::uint64_t seq = seq_.load(std::memory_order_relaxed);
+    if (!(seq & 1) &&
+        seq_.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire,
+                                   std::memory_order_relaxed)) {
+      // Keeps the word stores below the odd count.
+      std::atomic_thread_fence(std::memory_order_release);
+      return seq + 1;
+    }
+    if (tries >= 64) std::this_thread::yield();
+  }
+}
+
+template<typename T>
+void seqlock<T>::write_words(const T& val) {
+  word copy[kWords] = {};
+  std::memcpy(copy, &val, sizeof(T));
+  for (std::size_t i = 0; i < kWords; ++i)
+    words_[i].store(copy[i], std::memory_order_relaxed);
+}
+
+template<typename T>
+void seqlock<T>::end_write(std::uint64_t seq) {
+  seq_.store(seq + 1, std::memory_order_release);
+}
+
+} // namespace synchro
@@ -0,0 +1,197 @@
+/*
+  Vladimir Feinberg
+  synchro/spinlock-test.cpp
+  2026-10-15
+
+  Spinlock and queue lock tests. Pass "bench" (and optionally a maximum
+  thread count) to measure time per acquisition and fairness across
+  thread counts and critical section lengths.
+*/
+
+#include "synchro/spinlock.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef HAVE_BOOST
+#include <boost/smart_ptr/detail/spinlock.hpp>
+#endif /* HAVE_BOOST */
+
+#include "util/bench.hpp"
+#include "util/uassert.hpp"
+
+using namespace std;
+using namespace synchro;
+
+namespace {
+
+template<typename L>
+void test_try(L& lk) {
+  UASSERT(lk.try_lock());
+  UASSERT(!lk.try_lock());
+  lk.unlock();
+  {
+    lock_guard<L> guard(lk);
+    UASSERT(!lk.try_lock());
+  }
+  UASSERT(lk.try_lock());
+  lk.unlock();
+}
+
+// Threads increment a plain counter under the lock, mixing lock() and
+// try_lock(), and holding a second lock of the same type inside the first
+// half the time. Each thread runs on its own std::async thread, so queue
+// nodes are handed between threads as they exit.
+template<typename L>
+void test_exclusion(int nthreads, int ops) {
+  L outer, inner;
+  long count = 0, nested = 0;
+  atomic<int> inside(0);
+  vector<future<void> > futs;
+  for (int t = 0; t < nthreads; ++t)
+    futs.push_back(async(launch::async, [&, t]() {
+          for (int i = 0; i < ops; ++i) {
+            if ((i + t) % 4 == 0) {
+              while (!outer.try_lock()) this_thread::yield();
+            } else {
+              outer.lock();
+            }
+            UASSERT(inside.fetch_add(1) == 0);
+            ++count;
+            if (i % 2) {
+              lock_guard<L> guard(inner);
+              ++nested;
+            }
+            inside.fetch_sub(1);
+            outer.unlock();
+          }
+        }));
+  for (auto& f : futs) f.get();
+  UASSERT(count == static_cast<long>(nthreads) * ops) << count;
+  UASSERT(nested == static_cast<long>(nthreads) * (ops / 2)) << nested;
+}
+
+template<typename L>
+void test_lock(const string& name) {
+  cout << "=====> Testing " << name << endl;
+  {
+    L lk;
+    test_try(lk);
+  }
+  test_exclusion<L>(4, 20000);
+  // Oversubscribed, so that holders and next-in-line waiters get preempted.
+  test_exclusion<L>(4 * max(1u, thread::hardware_concurrency()), 2000);
+  cout << "...... Complete!" << endl;
+}
+
+// ---- bench
+
+#ifdef HAVE_BOOST
+// boost's internal spinlock (what boost::shared_ptr's atomics use), which
+// is an aggregate that needs an initializer.
+class boost_spinlock {
+ public:
+  boost_spinlock() : impl(BOOST_DETAIL_SPINLOCK_INIT) {}
+  void lock() { impl.lock(); }
+  bool try_lock() { return impl.try_lock(); }
+  void unlock() { impl.unlock(); }
+ private:
+  boost::detail::spinlock impl;
+};
+#endif /* HAVE_BOOST */
+
+// Work of about 'units' dependent adds.
+long work(long x, int units) {
+  for (int i = 0; i < units; ++i)
+    x = x * 7 + i;
+  return x;
+}
+
+// Keeps the work from being optimized out.
+atomic<long> sink(0);
+
+// Each thread alternates a critical section of 'cs' work units on shared
+// data with as much work outside, for a fixed number of acquisitions
+// split among the threads. Fairness is the median over trials of the
+// fastest thread's time over the slowest's: 1 is perfectly fair.
+template<typename L>
+void bench_lock(util::bench::suite& suite, const string& name, int nthreads,
+                int cs) {
+  int per_thread = 2000000 / (1 + cs / 10) / nthreads;
+  vector<double> fairness;
+  suite.run_manual(name + ", " + to_string(nthreads) + " threads", [&]() {
+      L lk;
+      long shared = 0;
+      vector<util::bench::clock::duration> took(nthreads);
+      auto time = util::bench::time_threads(nthreads, [&](int t) {
+          auto start = util::bench::clock::now();
+          long local = t;
+          for (int i = 0; i < per_thread; ++i) {
+            {
+              lock_guard<L> guard(lk);
+              shared = work(shared, cs);
+            }
+            local = work(local, cs);
+          }
+          sink.fetch_add(local, memory_order_relaxed);
+          took[t] = util::bench::clock::now() - start;
+        });
+      sink.fetch_add(shared, memory_order_relaxed);
+      auto range = minmax_element(took.begin(), took.end());
+      fairness.push_back(range.second->count()
+                         ? static_cast<double>(range.first->count()) /
+                           range.second->count()
+                         : 1);
+      return time;
+    }, per_thread * nthreads);
+  sort(fairness.begin(), fairness.end());
+  suite.log() << "    fairness " << fairness[fairness.size() / 2] << endl;
+}
+
+void bench(int max_threads) {
+  for (int cs : {0, 50, 500}) {
+    util::bench::suite suite(
+        "Lock benchmark, critical section and outside work of " +
+        to_string(cs) + " units (" +
+        to_string(thread::hardware_concurrency()) + " hardware threads)");
+    for (int n = 1; n <= max_threads; n *= 2) {
+      bench_lock<mutex>(suite, "std::mutex", n, cs);
+      bench_lock<locks::tas>(suite, "tas", n, cs);
+      bench_lock<locks::ttas_backoff>(suite, "ttas_backoff", n, cs);
+      bench_lock<locks::ticket>(suite, "ticket", n, cs);
+      bench_lock<locks::mcs>(suite, "mcs", n, cs);
+      bench_lock<locks::clh>(suite, "clh", n, cs);
+#ifdef HAVE_BOOST
+      bench_lock<boost_spinlock>(suite, "boost spinlock", n, cs);
+#endif /* HAVE_BOOST */
+    }
+  }
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+  if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+    int hw = thread::hardware_concurrency();
+    bench(argc > 2 ? atoi(argv[2]) : 2 * (hw ? hw : 4));
+    return 0;
+  }
+
+  cout << "Spinlock testing." << endl;
+  test_lock<locks::tas>("tas");
+  test_lock<locks::ttas_backoff>("ttas_backoff");
+  test_lock<locks::ticket>("ticket");
+  test_lock<locks::mcs>("mcs");
+  test_lock<locks::clh>("clh");
+  return 0;
+}
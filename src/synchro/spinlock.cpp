@@ -0,0 +1,280 @@
+/*
+ * Vladimir Feinberg
+ * synchro/spinlock.cpp
+ * 2026-10-15
+ *
+ * Spinlock and queue lock implementation
+ */
+
+#include "synchro/spinlock.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace synchro;
+using namespace locks;
+
+namespace synchro {
+namespace locks {
+struct qnode {
+  // Set while the node's thread holds the lock or waits for it (mcs), or
+  // until it releases it (clh).
+  atomic<bool> locked;
+  // Successor (mcs only), or the next free node.
+  atomic<qnode*> next;
+  util::cache_pad<sizeof(atomic<bool>) + sizeof(atomic<qnode*>)> pad_;
+};
+} // namespace locks
+} // namespace synchro
+
+namespace {
+  // Spin-wait hint: lets the sibling hyperthread run and keeps the loop
+  // from flooding the memory pipeline.
+  inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+  }
+
+  // Pauses 'n' times per call at first; after kSpins pauses, yields
+  // instead.
+  class spinner {
+   public:
+    void operator()(uint32_t n = 1) {
+      if (spins_ >= kSpins) {
+        this_thread::yield();
+        return;
+      }
+      spins_ += n;
+      for (uint32_t i = 0; i < n; ++i) cpu_relax();
+    }
+   private:
+    static const uint32_t kSpins = 256;
+    uint32_t spins_ = 0;
+  };
+
+  // xorshift32, seeded from the thread's address space.
+  uint32_t backoff_random() {
+    static thread_local uint32_t state = 0;
+    if (!state)
+      state = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&state)) | 1;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+  }
+
+  // Queue nodes are never freed, so that clh::try_lock() can look at a
+  // tail node that another thread is done with. Threads keep their free
+  // nodes in a list through qnode::next, and hand them to a shared list
+  // when they exit; there are never more nodes than threads once had in
+  // queues at the same time.
+  struct shared_nodes {
+    mutex lock;
+    qnode* head = nullptr;
+  };
+  // Leaked, for threads exiting after static destruction.
+  shared_nodes& orphans() {
+    static auto shared = new shared_nodes;
+    return *shared;
+  }
+
+  // Prepends the list from 'first' to 'last' to 'head'.
+  void splice(qnode*& head, qnode* first, qnode* last) {
+    last->next.store(head, memory_order_relaxed);
+    head = first;
+  }
+
+  class node_cache {
+   public:
+    ~node_cache() {
+      if (!head_) return;
+      auto last = head_;
+      while (auto n = last->next.load(memory_order_relaxed)) last = n;
+      auto& shared = orphans();
+      lock_guard<mutex> guard(shared.lock);
+      splice(shared.head, head_, last);
+    }
+    qnode* take() {
+      if (!head_) {
+        auto& shared = orphans();
+        lock_guard<mutex> guard(shared.lock);
+        if (!shared.head) return new qnode;
+        head_ = shared.head;
+        shared.head = nullptr;
+      }
+      auto n = head_;
+      head_ = n->next.load(memory_order_relaxed);
+      return n;
+    }
+    void give(qnode* n) { splice(head_, n, n); }
+   private:
+    qnode* head_ = nullptr;
+  };
+  thread_local node_cache nodes;
+}
+
+// tas -------------------------------------------------------------------
+
+void tas::lock() {
+  spinner spin;
+  while (locked_.exchange(true, memory_order_acquire)) spin();
+}
+
+bool tas::try_lock() noexcept {
+  return !locked_.exchange(true, memory_order_acquire);
+}
+
+void tas::unlock() { locked_.store(false, memory_order_release); }
+
+// ttas_backoff ----------------------------------------------------------
+
+constexpr uint32_t ttas_backoff::kMinBackoff;
+constexpr uint32_t ttas_backoff::kMaxBackoff;
+
+void ttas_backoff::lock() {
+  spinner spin;
+  uint32_t limit = kMinBackoff;
+  while (true) {
+    while (locked_.load(memory_order_relaxed)) spin();
+    if (!locked_.exchange(true, memory_order_acquire)) return;
+    spin(backoff_random() % limit + 1);
+    limit = min(2 * limit, kMaxBackoff);
+  }
+}
+
+bool ttas_backoff::try_lock() noexcept {
+  return !locked_.load(memory_order_relaxed) &&
+      !locked_.exchange(true, memory_order_acquire);
+}
+
+void ttas_backoff::unlock() { locked_.store(false, memory_order_release); }
+
+// ticket ----------------------------------------------------------------
+
+void ticket::lock() {
+  uint32_t mine = next_.fetch_add(1, memory_order_relaxed);
+  spinner spin;
+  while (true) {
+    uint32_t ahead = mine - serving_.load(memory_order_acquire);
+    if (!ahead) return;
+    spin(ahead);
+  }
+}
+
+bool ticket::try_lock() noexcept {
+  uint32_t serving = serving_.load(memory_order_relaxed);
+  return next_.compare_exchange_strong(serving, serving + 1,
+                                       memory_order_acquire,
+                                       memory_order_relaxed);
+}
+
+void ticket::unlock() {
+  serving_.store(serving_.load(memory_order_relaxed) + 1,
+                 memory_order_release);
+}
+
+// mcs -------------------------------------------------------------------
+
+void mcs::lock() {
+  auto n = nodes.take();
+  n->next.store(nullptr, memory_order_relaxed);
+  n->locked.store(true, memory_order_relaxed);
+  // Release publishes the node's fields to the predecessor; acquire pairs
+  // with its unlock() when the queue was empty.
+  auto pred = tail_.exchange(n, memory_order_acq_rel);
+  if (pred) {
+    pred->next.store(n, memory_order_release);
+    spinner spin;
+    while (n->locked.load(memory_order_acquire)) spin();
+  }
+  holder_ = n;
+}
+
+bool mcs::try_lock() {
+  auto n = nodes.take();
+  n->next.store(nullptr, memory_order_relaxed);
+  qnode* expected = nullptr;
+  if (tail_.compare_exchange_strong(expected, n, memory_order_acq_rel,
+                                    memory_order_relaxed)) {
+    holder_ = n;
+    return true;
+  }
+  nodes.give(n);
+  return false;
+}
+
+void mcs::unlock() {
+  auto n = holder_;
+  auto succ = n->next.load(memory_order_acquire);
+  if (!succ) {
+    auto expected = n;
+    if (tail_.compare_exchange_strong(expected, nullptr,
+                                      memory_order_release,
+                                      memory_order_relaxed)) {
+      nodes.give(n);
+      return;
+    }
+    // A successor swapped itself in, but hasn't linked itself yet.
+    spinner spin;
+    while (!(succ = n->next.load(memory_order_acquire))) spin();
+  }
+  succ->locked.store(false, memory_order_release);
+  nodes.give(n);
+}
+
+// clh -------------------------------------------------------------------
+
+clh::clh() : tail_(nodes.take()), holder_(nullptr), pred_(nullptr) {
+  tail_.load(memory_order_relaxed)->locked.store(false,
+                                                 memory_order_relaxed);
+}
+
+// To the shared list, as clh locks may outlive their thread's cache.
+clh::~clh() {
+  auto n = tail_.load(memory_order_relaxed);
+  auto& shared = orphans();
+  lock_guard<mutex> guard(shared.lock);
+  splice(shared.head, n, n);
+}
+
+void clh::lock() {
+  auto n = nodes.take();
+  n->locked.store(true, memory_order_relaxed);
+  auto pred = tail_.exchange(n, memory_order_acq_rel);
+  spinner spin;
+  while (pred->locked.load(memory_order_acquire)) spin();
+  holder_ = n;
+  pred_ = pred;
+}
+
+bool clh::try_lock() {
+  auto pred = tail_.load(memory_order_relaxed);
+  if (pred->locked.load(memory_order_relaxed)) return false;
+  auto n = nodes.take();
+  n->locked.store(true, memory_order_relaxed);
+  if (!tail_.compare_exchange_strong(pred, n, memory_order_acq_rel,
+                                     memory_order_relaxed)) {
+    nodes.give(n);
+    return false;
+  }
+  // pred was free when checked, so this only spins if it was recycled.
+  spinner spin;
+  while (pred->locked.load(memory_order_acquire)) spin();
+  holder_ = n;
+  pred_ = pred;
+  return true;
+}
+
+void clh::unlock() {
+  auto n = holder_;
+  auto pred = pred_;
+  n->locked.store(false, memory_order_release);
+  // Nobody spins on pred any more: we were its only successor.
+  nodes.give(pred);
+}
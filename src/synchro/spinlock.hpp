@@ -0,0 +1,151 @@
+/*
+ * Vladimir Feinberg
+ * synchro/spinlock.hpp
+ * 2026-10-15
+ *
+ * Spinlocks and queue locks for short critical sections, after Herlihy and
+ * Shavit, "The Art of Multiprocessor Programming", ch. 7.
+ */
+
+#ifndef SYNCHRO_SPINLOCK_HPP_
+#define SYNCHRO_SPINLOCK_HPP_
+
+#include <atomic>
+#include <cstdint>
+
+#include "util/cache_line.hpp"
+
+namespace synchro {
+namespace locks {
+
+// All of the locks below are Lockable (lock(), try_lock(), unlock()), so
+// they work with std::lock_guard and std::unique_lock, and as the Lock of
+// multiqueue. None are recursive, and all must be unlocked by the thread
+// that locked them. Only the queue locks (mcs, clh) throw: their lock()
+// and try_lock(), and clh's constructor, take a queue node, which may
+// allocate one (std::bad_alloc) or lock the list of nodes left by exited
+// threads (std::system_error).
+//
+// Waiters spin for a while, then yield between checks, so that a holder
+// that got preempted can still run when there are more threads than cores.
+// Nothing here ever sleeps in the kernel: these are for critical sections
+// of a few hundred cycles at most, anything longer wants a std::mutex.
+
+// Test-and-set: every waiter swaps the flag in a loop. The simplest lock,
+// and the fastest uncontended, but waiters keep the flag's line bouncing
+// between their caches, slowing down the holder too.
+class tas {
+ public:
+  tas() : locked_(false) {}
+  tas(const tas&) = delete;
+  tas& operator=(const tas&) = delete;
+
+  void lock();
+  bool try_lock() noexcept;
+  void unlock();
+
+ private:
+  std::atomic<bool> locked_;
+};
+
+// Test-and-test-and-set with exponential backoff: waiters spin reading
+// their cached copy of the flag, and only swap once it reads free. A waiter
+// that loses the swap backs off for a random delay, doubling its bound
+// each time, so that a release doesn't set off a storm of swaps.
+// Unfair: a thread that just released often gets the lock back.
+class ttas_backoff {
+ public:
+  // Backoff bounds, in pause instructions.
+  static constexpr std::uint32_t kMinBackoff = 4;
+  static constexpr std::uint32_t kMaxBackoff = 1024;
+
+  ttas_backoff() : locked_(false) {}
+  ttas_backoff(const ttas_backoff&) = delete;
+  ttas_backoff& operator=(const ttas_backoff&) = delete;
+
+  void lock();
+  bool try_lock() noexcept;
+  void unlock();
+
+ private:
+  std::atomic<bool> locked_;
+};
+
+// Ticket lock: FIFO. A thread takes the next ticket and waits until it is
+// served. Waiters back off in proportion to their place in line. Arrivals
+// (next_) and waiters (serving_) use separate lines, but all waiters still
+// read the one serving_ line, which every release invalidates.
+class ticket {
+ public:
+  ticket() : next_(0), serving_(0) {}
+  ticket(const ticket&) = delete;
+  ticket& operator=(const ticket&) = delete;
+
+  void lock();
+  bool try_lock() noexcept;
+  void unlock();
+
+ private:
+  std::atomic<std::uint32_t> next_;
+  util::cache_pad<sizeof(std::atomic<std::uint32_t>)> pad_;
+  std::atomic<std::uint32_t> serving_;
+};
+
+// Queue lock node, one cache line. Defined in spinlock.cpp, and cached per
+// thread there, so that lock() allocates only the first few times a thread
+// calls it.
+struct qnode;
+
+// MCS lock (Mellor-Crummey and Scott): FIFO. Waiters queue up in a linked
+// list, each spinning on a flag in its own node, which its predecessor
+// clears on release. A release thus invalidates one waiter's line instead
+// of every waiter's.
+class mcs {
+ public:
+  mcs() : tail_(nullptr), holder_(nullptr) {}
+  mcs(const mcs&) = delete;
+  mcs& operator=(const mcs&) = delete;
+
+  void lock();
+  bool try_lock();
+  void unlock();
+
+ private:
+  std::atomic<qnode*> tail_;
+  util::cache_pad<sizeof(std::atomic<qnode*>)> pad_;
+  // Node of the thread holding the lock; only touched by the holder.
+  qnode* holder_;
+};
+
+// CLH lock (Craig, Landin and Hagersten): FIFO. Like mcs, but each waiter
+// spins on its predecessor's node, which needs no next pointers and makes
+// unlock() a single store. On release a thread keeps its predecessor's
+// node for later, so nodes migrate between threads; the lock owns the one
+// node in its tail.
+//
+// try_lock() only enqueues behind a free tail. If that node is recycled
+// and taken again between the check and the swap, try_lock() waits for
+// its holder, like lock().
+class clh {
+ public:
+  clh();
+  ~clh();
+  clh(const clh&) = delete;
+  clh& operator=(const clh&) = delete;
+
+  void lock();
+  bool try_lock();
+  void unlock();
+
+ private:
+  std::atomic<qnode*> tail_;
+  util::cache_pad<sizeof(std::atomic<qnode*>)> pad_;
+  // Holder's node and its predecessor's; only touched by the holder.
+  qnode* holder_;
+  qnode* pred_;
+};
+
+} // namespace locks
+} // namespace synchro
+
+#endif /* SYNCHRO_SPINLOCK_HPP_ */
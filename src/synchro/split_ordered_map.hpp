@@ -0,0 +1,229 @@
+/*
+  Vladimir Feinberg
+  synchro/split_ordered_map.hpp
+  2026-10-15
+
+  Declares split_ordered_map, a lock-free hash map that grows without
+  rehashing, with hazard pointers for memory safety.
+
+  Based on Shalev and Shavit, "Split-Ordered Lists: Lock-Free Extensible
+  Hash Tables" (JACM 2006), over Michael's lock-free list ("High Performance
+  Dynamic Lock-Free Hash Tables and List-Based Sets", SPAA 2002).
+*/
+
+#ifndef SYNCHRO_SPLIT_ORDERED_MAP_HPP_
+#define SYNCHRO_SPLIT_ORDERED_MAP_HPP_
+
+#include <atomic>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+
+#include "synchro/hazard.hpp"
+#include "util/cache_line.hpp"
+#include "util/hash.hpp"
+#include "util/optional.hpp"
+
+namespace synchro {
+
+// All items live in one lock-free sorted linked list, ordered by the bit
+// reversal of their hashes (their "split order"). A bucket is just a
+// pointer to a dummy node in that list, marking where the bucket's items
+// start: with 2^k buckets, bucket b's items are those whose hashes end in
+// the k bits of b, and in split order they all sit between b's dummy and
+// the next one.
+//
+// So doubling the bucket count moves nothing. It is a single CAS on the
+// count; each new bucket b + 2^k splits off the back half of bucket b the
+// first time it's used, by linking a dummy into b's run of items. No
+// operation ever waits on a rehash, and buckets are never shrunk.
+//
+// Bucket pointers are kept in segments of doubling size, allocated on
+// first use, so the table never moves either.
+//
+// Items are removed by marking their link (Michael's list), then unlinked
+// by the remover or whichever traversal gets there first, and retired with
+// hazard_ptr::schedule_deletion(). Every operation holds a
+// hazard_guard<node, 2> over the node it's at and its predecessor.
+//
+// Keys and values are immutable once inserted: to replace a value, erase
+// and insert it again. Readers get a copy (lookup()) or a const reference
+// that lives as long as a callback (visit()).
+//
+// split_ordered_map<Key, Value, Hash, Pred>
+// Key - key type
+// Value - mapped type
+// Hash - hash functor for Key
+// Pred - equality predicate for Key
+//
+// This class is thread safe, and lock-free.
+template<typename Key, typename Value, typename Hash = std::hash<Key>,
+         typename Pred = std::equal_to<Key> >
+class split_ordered_map {
+ public:
+  typedef Key key_type;
+  typedef Value mapped_type;
+  typedef std::size_t size_type;
+  typedef Hash hasher;
+  typedef Pred key_equal;
+
+  static constexpr size_type kDefaultBuckets = 16;
+  static constexpr double kDefaultLoad = 2.0;
+
+  /*
+   * INPUT:
+   * size_type buckets = kDefaultBuckets - initial bucket count
+   * double max_load = kDefaultLoad - items per bucket past which the
+   * bucket count doubles
+   * PRECONDITION:
+   * buckets > 0, max_load > 0
+   * BEHAVIOR:
+   * Generates an empty map, with buckets rounded up to a power of two.
+   */
+  explicit split_ordered_map(size_type buckets = kDefaultBuckets,
+                             double max_load = kDefaultLoad);
+  // Frees every node still in the map. Removed items may outlive it,
+  // until their deletion runs.
+  ~split_ordered_map();
+  split_ordered_map(const split_ordered_map&) = delete;
+  split_ordered_map& operator=(const split_ordered_map&) = delete;
+
+  // Snapshots under concurrent modification.
+  size_type size() const { return count_.load(std::memory_order_relaxed); }
+  bool empty() const { return size() == 0; }
+  size_type bucket_count() const {
+    return buckets_.load(std::memory_order_relaxed);
+  }
+  double max_load_factor() const { return max_load_; }
+
+  /*
+   * INPUT:
+   * K&& key
+   * V&& value
+   * PRECONDITION:
+   * BEHAVIOR:
+   * Inserts (key, value) if key isn't in the map. Strong guarantee: only
+   * the construction of the item may throw.
+   * RETURN:
+   * Whether the item was inserted.
+   */
+  template<typename K, typename V>
+  bool insert(K&& key, V&& value);
+  /*
+   * INPUT:
+   * const key_type& key
+   * PRECONDITION:
+   * BEHAVIOR:
+   * Removes key's item, if any. Its deletion is scheduled with the hazard
+   * pointer domain.
+   * RETURN:
+   * Whether an item was removed.
+   */
+  bool erase(const key_type& key);
+  bool contains(const key_type& key) const;
+  /*
+   * INPUT:
+   * const key_type& key
+   * PRECONDITION:
+   * BEHAVIOR:
+   * Copies key's value.
+   * RETURN:
+   * The copy, or an invalid (unconstructed) optional if key isn't in the
+   * map.
+   */
+  util::optional<mapped_type> lookup(const key_type& key) const;
+  /*
+   * INPUT:
+   * const key_type& key
+   * F f - functor taking a const mapped_type&
+   * PRECONDITION:
+   * BEHAVIOR:
+   * Calls f on key's value, if any, without copying it. The value stays
+   * valid for the duration of the call even if key is erased meanwhile.
+   * RETURN:
+   * Whether f was called.
+   */
+  template<typename F>
+  bool visit(const key_type& key, F f) const;
+
+  static hasher hash_function() { return hasher(); }
+
+ private:
+  typedef std::uint64_t so_key;
+
+  // Dummy nodes (bucket heads) have even split-order keys, items odd ones.
+  struct node {
+    explicit node(so_key k) : key(k), next(0) {}
+    const so_key key;
+    // Successor's address; the low bit is set once this node is removed.
+    std::atomic<std::uintptr_t> next;
+  };
+  // node is the only base, so an item and its node share an address, which
+  // is what hazard records compare.
+  struct item : node {
+    template<typename K, typename V>
+    item(so_key k, K&& key, V&& value) :
+        node(k), kv(std::forward<K>(key), std::forward<V>(value)) {}
+    const std::pair<const key_type, const mapped_type> kv;
+  };
+  typedef hazard_guard<node, 2> guard_type;
+  // guard_type indices.
+  static const std::size_t kPrev = 0;
+  static const std::size_t kCur = 1;
+
+  // Where a key is, or would be inserted: between the node owning *prev
+  // and cur (which may be null, at the end of the list).
+  struct position {
+    std::atomic<std::uintptr_t>* prev;
+    node* cur;
+  };
+
+  static const int kSegments = sizeof(size_type) * CHAR_BIT;
+
+  static so_key reverse(so_key k);
+  static so_key item_key(size_type hash);
+  static so_key dummy_key(size_type bucket);
+  static bool is_item(const node* n) { return n->key & 1; }
+  static const item* as_item(const node* n) {
+    return static_cast<const item*>(n);
+  }
+  static void retire(node* n);
+  static size_type hash_of(const key_type& key);
+
+  // Bucket b's slot, allocating its segment if needed.
+  std::atomic<node*>& slot(size_type b) const;
+  // Bucket b's dummy, linking it in first if b wasn't used yet.
+  node* bucket(size_type b) const;
+  node* init_bucket(size_type b) const;
+  // Head of the bucket for 'hash', at the current bucket count.
+  node* bucket_for(size_type hash) const;
+  // Searches the list, starting at dummy 'head', for the node with split
+  // order key k (and equal to *key, if k is an item's), unlinking removed
+  // nodes it comes across. On return, g protects pos.cur and the node
+  // owning pos.prev.
+  bool find(node* head, so_key k, const key_type* key, guard_type& g,
+            position& pos) const;
+  // Links n at the position find() would return for it. Returns the
+  // node already there if find() matches, else n.
+  node* link(node* head, node* n, const key_type* key, guard_type& g) const;
+  void grow(size_type count);
+
+  static hasher hashf;
+  static key_equal eqf;
+  const double max_load_;
+  // Read by every operation, rarely written.
+  std::atomic<size_type> buckets_;
+  mutable std::atomic<std::atomic<node*>*> segments_[kSegments];
+  util::cache_pad<0> pad1_;
+  // Updated by every insert and erase, so kept on its own line.
+  std::atomic<size_type> count_;
+  util::cache_pad<sizeof(std::atomic<size_type>)> pad2_;
+};
+
+} // namespace synchro
+
+#include "synchro/split_ordered_map.tpp"
+
+#endif /* SYNCHRO_SPLIT_ORDERED_MAP_HPP_ */
@@ -0,0 +1,295 @@
+/*
+  Vladimir Feinberg
+  synchro/split_ordered_map.tpp
+  2026-10-15
+
+  Contains implementation of split_ordered_map.hpp's methods.
+*/
+
+// Implementation details:
+//
+// A link (node::next) holds the successor's address, with its low bit set
+// once the node owning the link has been removed. Nobody links a node after
+// a marked one, so a removed node's successor never changes again, and
+// exactly one CAS on its predecessor's link unlinks it: whoever makes that
+// CAS retires it.
+//
+// find() protects each node before using it the way hazard_ptr::acquire()
+// does for an atomic pointer: publish, then re-read the predecessor's link
+// and start over if it changed. Dummies are never removed, so the bucket
+// head a search starts from needs no protection.
+
+#include "util/uassert.hpp"
+
+namespace synchro {
+
+template<typename K, typename V, typename H, typename P>
+constexpr typename split_ordered_map<K,V,H,P>::size_type
+split_ordered_map<K,V,H,P>::kDefaultBuckets;
+
+template<typename K, typename V, typename H, typename P>
+constexpr double split_ordered_map<K,V,H,P>::kDefaultLoad;
+
+template<typename K, typename V, typename H, typename P>
+typename split_ordered_map<K,V,H,P>::hasher
+split_ordered_map<K,V,H,P>::hashf {};
+
+template<typename K, typename V, typename H, typename P>
+typename split_ordered_map<K,V,H,P>::key_equal
+split_ordered_map<K,V,H,P>::eqf {};
+
+template<typename K, typename V, typename H, typename P>
+split_ordered_map<K,V,H,P>::split_ordered_map(size_type buckets,
+                                              double max_load) :
+    max_load_(max_load), buckets_(1), count_(0) {
+  UASSERT(buckets > 0);
+  UASSERT(max_load > 0);
+  size_type n = 1;
+  while (n < buckets && n < (size_type(1) << (kSegments - 1))) n <<= 1;
+  buckets_.store(n, std::memory_order_relaxed);
+  for (auto& seg : segments_) seg.store(nullptr, std::memory_order_relaxed);
+  // Bucket 0's dummy heads the whole list.
+  slot(0).store(new node(dummy_key(0)), std::memory_order_relaxed);
+}
+
+template<typename K, typename V, typename H, typename P>
+split_ordered_map<K,V,H,P>::~split_ordered_map() {
+  auto n = slot(0).load(std::memory_order_relaxed);
+  while (n) {
+    auto next = reinterpret_cast<node*>(
+        n->next.load(std::memory_order_relaxed) & ~std::uintptr_t(1));
+    if (is_item(n)) delete as_item(n);
+    else delete n;
+    n = next;
+  }
+  for (auto& seg : segments_) delete[] seg.load(std::memory_order_relaxed);
+}
+
+// Split order -----------------------------------------------------------
+
+template<typename K, typename V, typename H, typename P>
+auto split_ordered_map<K,V,H,P>::reverse(so_key k) -> so_key {
+  k = ((k >> 1) & 0x5555555555555555ull) | ((k & 0x5555555555555555ull) << 1);
+  k = ((k >> 2) & 0x3333333333333333ull) | ((k & 0x3333333333333333ull) << 2);
+  k = ((k >> 4) & 0x0f0f0f0f0f0f0f0full) | ((k & 0x0f0f0f0f0f0f0f0full) << 4);
+  return __builtin_bswap64(k);
+}
+
+template<typename K, typename V, typename H, typename P>
+auto split_ordered_map<K,V,H,P>::item_key(size_type hash) -> so_key {
+  // The set top bit becomes the low bit, which dummies lack.
+  return reverse(so_key(hash) | (so_key(1) << 63));
+}
+
+template<typename K, typename V, typename H, typename P>
+auto split_ordered_map<K,V,H,P>::dummy_key(size_type bucket) -> so_key {
+  return reverse(bucket);
+}
+
+template<typename K, typename V, typename H, typename P>
+void split_ordered_map<K,V,H,P>::retire(node* n) {
+  hazard_ptr<item>::schedule_deletion(static_cast<item*>(n));
+}
+
+template<typename K, typename V, typename H, typename P>
+auto split_ordered_map<K,V,H,P>::hash_of(const key_type& key)
+    -> size_type {
+  // std::hash is the identity for integers; mix so that keys with a
+  // common stride don't share buckets.
+  return static_cast<size_type>(util::mix_hash(hashf(key)));
+}
+
+// Buckets ---------------------------------------------------------------
+
+template<typename K, typename V, typename H, typename P>
+auto split_ordered_map<K,V,H,P>::slot(size_type b) const
+    -> std::atomic<node*>& {
+  // Segment 0 holds bucket 0, segment s > 0 buckets [2^(s-1), 2^s).
+  int s = b ? kSegments - __builtin_clzll(b) : 0;
+  size_type first = s ? size_type(1) << (s - 1) : 0;
+  auto seg = segments_[s].load(std::memory_order_acquire);
+  if (!seg) {
+    auto fresh = new std::atomic<node*>[s ? first : 1]();
+    if (segments_[s].compare_exchange_strong(seg, fresh,
+                                             std::memory_order_acq_rel,
+                                             std::memory_order_acquire))
+      seg = fresh;
+    else
+      delete[] fresh;
+  }
+  return seg[b - first];
+}
+
+template<typename K, typename V, typename H, typename P>
+auto split_ordered_map<K,V,H,P>::bucket(size_type b) const -> node* {
+  auto head = slot(b).load(std::memory_order_acquire);
+  return head ? head : init_bucket(b);
+}
+
+template<typename K, typename V, typename H, typename P>
+auto split_ordered_map<K,V,H,P>::init_bucket(size_type b) const -> node* {
+  // The parent, b without its top bit, holds b's items until now.
+  auto parent = bucket(b & ~(size_type(1) << (kSegments - 1 -
+                                                __builtin_clzll(b))));
+  guard_type g;
+  auto dummy = new node(dummy_key(b));
+  auto head = link(parent, dummy, nullptr, g);
+  // Someone else linked it first.
+  if (head != dummy) delete dummy;
+  slot(b).store(head, std::memory_order_release);
+  return head;
+}
+
+template<typename K, typename V, typename H, typename P>
+auto split_ordered_map<K,V,H,P>::bucket_for(size_type hash) const -> node* {
+  auto n = buckets_.load(std::memory_order_relaxed);
+  return bucket(hash & (n - 1));
+}
+
+template<typename K, typename V, typename H, typename P>
+void split_ordered_map<K,V,H,P>::grow(size_type count) {
+  auto n = buckets_.load(std::memory_order_relaxed);
+  if (count <= max_load_ * n || n == size_type(1) << (kSegments - 1))
+    return;
+  // Losing means someone else doubled it.
+  buckets_.compare_exchange_strong(n, 2 * n, std::memory_order_relaxed,
+                                   std::memory_order_relaxed);
+}
+
+// List ------------------------------------------------------------------
+
+template<typename K, typename V, typename H, typename P>
+bool split_ordered_map<K,V,H,P>::find(node* head, so_key k,
+                                      const key_type* key, guard_type& g,
+                                      position& pos) const {
+ retry:
+  auto prev = &head->next;
+  auto curw = prev->load(std::memory_order_acquire);
+  while (true) {
+    // A marked link means the predecessor was removed under us.
+    if (curw & 1) goto retry;
+    auto cur = reinterpret_cast<node*>(curw);
+    if (!cur) {
+      pos.prev = prev;
+      pos.cur = nullptr;
+      return false;
+    }
+    g.acquire(kCur, cur);
+    if (prev->load(std::memory_order_acquire) != curw) goto retry;
+
+    auto nextw = cur->next.load(std::memory_order_acquire);
+    if (nextw & 1) {
+      auto expected = curw;
+      if (!prev->compare_exchange_strong(expected, nextw & ~std::uintptr_t(1),
+                                         std::memory_order_release,
+                                         std::memory_order_relaxed))
+        goto retry;
+      retire(cur);
+      curw = nextw & ~std::uintptr_t(1);
+      continue;
+    }
+
+    if (cur->key >= k) {
+      pos.prev = prev;
+      pos.cur = cur;
+      if (cur->key > k) return false;
+      // Dummy keys are unique; items with the same split order key (their
+      // hashes collide) are compared in turn.
+      if (!key || eqf(as_item(cur)->kv.first, *key)) return true;
+    }
+    prev = &cur->next;
+    g.swap(kPrev, kCur);
+    curw = nextw;
+  }
+}
+
+template<typename K, typename V, typename H, typename P>
+auto split_ordered_map<K,V,H,P>::link(node* head, node* n,
+                                      const key_type* key,
+                                      guard_type& g) const -> node* {
+  position pos;
+  while (true) {
+    if (find(head, n->key, key, g, pos)) return pos.cur;
+    auto curw = reinterpret_cast<std::uintptr_t>(pos.cur);
+    n->next.store(curw, std::memory_order_relaxed);
+    if (pos.prev->compare_exchange_weak(curw,
+                                        reinterpret_cast<std::uintptr_t>(n),
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed))
+      return n;
+  }
+}
+
+// Operations ------------------------------------------------------------
+
+template<typename K, typename V, typename H, typename P>
+template<typename Kf, typename Vf>
+bool split_ordered_map<K,V,H,P>::insert(Kf&& key, Vf&& value) {
+  auto h = hash_of(key);
+  auto n = new item(item_key(h), std::forward<Kf>(key),
+                    std::forward<Vf>(value));
+  guard_type g;
+  if (link(bucket_for(h), n, &n->kv.first, g) != n) {
+    delete n;
+    return false;
+  }
+  grow(count_.fetch_add(1, std::memory_order_relaxed) + 1);
+  return true;
+}
+
+template<typename K, typename V, typename H, typename P>
+bool split_ordered_map<K,V,H,P>::erase(const key_type& key) {
+  auto h = hash_of(key);
+  auto head = bucket_for(h);
+  auto k = item_key(h);
+  guard_type g;
+  position pos;
+  std::uintptr_t nextw;
+  while (true) {
+    if (!find(head, k, &key, g, pos)) return false;
+    nextw = pos.cur->next.load(std::memory_order_acquire);
+    // If it's marked, another erase got there first, and the next find()
+    // unlinks it.
+    if (nextw & 1) continue;
+    if (pos.cur->next.compare_exchange_weak(nextw, nextw | 1,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed))
+      break;
+  }
+  count_.fetch_sub(1, std::memory_order_relaxed);
+  // Marked, so nextw is its successor for good.
+  auto curw = reinterpret_cast<std::uintptr_t>(pos.cur);
+  if (pos.prev->compare_exchange_strong(curw, nextw,
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed))
+    retire(pos.cur);
+  else
+    find(head, k, &key, g, pos); // unlinks it on the way
+  return true;
+}
+
+template<typename K, typename V, typename H, typename P>
+bool split_ordered_map<K,V,H,P>::contains(const key_type& key) const {
+  return visit(key, [](const mapped_type&) {});
+}
+
+template<typename K, typename V, typename H, typename P>
+util::optional<typename split_ordered_map<K,V,H,P>::mapped_type>
+split_ordered_map<K,V,H,P>::lookup(const key_type& key) const {
+  util::optional<mapped_type> ret;
+  visit(key, [&ret](const mapped_type& val) { ret.construct(val); });
+  return ret;
+}
+
+template<typename K, typename V, typename H, typename P>
+template<typename F>
+bool split_ordered_map<K,V,H,P>::visit(const key_type& key, F f) const {
+  auto h = hash_of(key);
+  guard_type g;
+  position pos;
+  if (!find(bucket_for(h), item_key(h), &key, g, pos)) return false;
+  f(as_item(pos.cur)->kv.second);
+  return true;
+}
+
+} // namespace synchro
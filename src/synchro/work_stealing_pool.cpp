@@ -0,0 +1,183 @@
+/*
+  Vladimir Feinberg
+  synchro/work_stealing_pool.cpp
+  2026-10-14
+
+  Implements the work-stealing thread pool.
+*/
+
+#include "synchro/work_stealing_pool.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "util/node_pool.hpp"
+#include "util/uassert.hpp"
+
+using namespace std;
+using namespace synchro;
+
+struct work_stealing_pool::join_handle::state {
+  state() : pending(0) {}
+  void up() { pending.fetch_add(1, memory_order_relaxed); }
+  void down() {
+    if (pending.fetch_sub(1, memory_order_acq_rel) != 1) return;
+    // Waiters check 'pending' under the lock, so taking it here means none
+    // of them can miss the notification.
+    lock_guard<mutex> lk(lock);
+    done.notify_all();
+  }
+  atomic<int> pending;
+  mutex lock;
+  condition_variable done;
+};
+
+struct work_stealing_pool::task : util::pooled<task> {
+  task(job j, shared_ptr<join_handle::state> s) :
+      fn(move(j)), group(move(s)) {}
+  job fn;
+  shared_ptr<join_handle::state> group;
+};
+
+struct work_stealing_pool::worker {
+  worker(work_stealing_pool* p, unsigned seed) : pool(p), rng(seed) {}
+  work_stealing_pool* pool;
+  queues::ws_deque<task*> deque;
+  minstd_rand rng;
+  std::thread thread;
+};
+
+thread_local work_stealing_pool::worker* work_stealing_pool::current_ =
+    nullptr;
+
+work_stealing_pool::join_handle::join_handle() :
+    state_(make_shared<state>()) {}
+
+bool work_stealing_pool::join_handle::done() const {
+  return state_->pending.load(memory_order_acquire) == 0;
+}
+
+void work_stealing_pool::join_handle::wait() const {
+  auto w = current_;
+  if (w) {
+    while (!done())
+      if (!w->pool->run_one(*w)) this_thread::yield();
+    return;
+  }
+  unique_lock<mutex> lk(state_->lock);
+  state_->done.wait(lk, [this] { return done(); });
+}
+
+int work_stealing_pool::default_threads() {
+  auto hw = static_cast<int>(thread::hardware_concurrency());
+  return hw > 0 ? hw : 1;
+}
+
+work_stealing_pool::work_stealing_pool(int nthreads) :
+    stopping_(false), wakeups_(0) {
+  UASSERT(nthreads > 0);
+  random_device seeds;
+  // All workers exist before any starts stealing from the others.
+  for (int i = 0; i < nthreads; ++i)
+    workers_.emplace_back(new worker(this, seeds()));
+  for (auto& w : workers_) {
+    auto wp = w.get();
+    w->thread = std::thread([this, wp]() { work(*wp); });
+  }
+}
+
+work_stealing_pool::~work_stealing_pool() {
+  stopping_.store(true, memory_order_release);
+  idle_.notify_all();
+  for (auto& w : workers_)
+    w->thread.join();
+  UASSERT(injection_.empty());
+}
+
+work_stealing_pool::join_handle work_stealing_pool::submit(job j) {
+  join_handle h;
+  submit(h, move(j));
+  return h;
+}
+
+void work_stealing_pool::submit(const join_handle& h, job j) {
+  h.state_->up();
+  enqueue(new task(move(j), h.state_));
+}
+
+void work_stealing_pool::enqueue(task* t) {
+  auto w = current_;
+  if (w && w->pool == this)
+    w->deque.push(t);
+  else
+    injection_.enqueue(t);
+  // One task needs one worker; waking them all would send the rest
+  // straight back to sleep.
+  idle_.notify_one();
+}
+
+work_stealing_pool::task* work_stealing_pool::find_task(worker& w) {
+  auto opt = w.deque.pop();
+  if (opt.valid()) return opt.access();
+  auto injected = injection_.try_dequeue();
+  if (injected.valid()) return injected.access();
+  // Visit every other worker once, starting from a random one.
+  auto n = workers_.size();
+  auto start = w.rng() % n;
+  for (size_t i = 0; i < n; ++i) {
+    auto& victim = *workers_[(start + i) % n];
+    if (&victim == &w) continue;
+    // A failed steal may just mean another thief won the top item, so
+    // keep going while the victim has work left.
+    while (!victim.deque.empty()) {
+      opt = victim.deque.steal();
+      if (opt.valid()) return opt.access();
+    }
+  }
+  return nullptr;
+}
+
+bool work_stealing_pool::run_one(worker& w) {
+  auto t = find_task(w);
+  if (!t) return false;
+  run(t);
+  return true;
+}
+
+void work_stealing_pool::run(task* t) {
+  t->fn();
+  auto group = move(t->group);
+  delete t;
+  group->down();
+}
+
+void work_stealing_pool::work(worker& w) {
+  current_ = &w;
+  while (true) {
+    if (run_one(w)) continue;
+    auto key = idle_.prepare_wait();
+    // Re-check once registered, see synchro/eventcount.hpp.
+    auto t = find_task(w);
+    if (t) {
+      idle_.cancel_wait();
+      run(t);
+      continue;
+    }
+    // Only leave once nothing is left to find: jobs still running on other
+    // workers only ever add to those workers' own deques.
+    if (stopping_.load(memory_order_acquire)) {
+      idle_.cancel_wait();
+      break;
+    }
+    idle_.wait(key);
+    wakeups_.fetch_add(1, memory_order_relaxed);
+  }
+  current_ = nullptr;
+}
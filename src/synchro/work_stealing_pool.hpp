@@ -0,0 +1,104 @@
+/*
+  Vladimir Feinberg
+  synchro/work_stealing_pool.hpp
+  2026-10-14
+
+  Declares the work-stealing thread pool.
+*/
+
+#ifndef SYNCHRO_WORK_STEALING_POOL_HPP_
+#define SYNCHRO_WORK_STEALING_POOL_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "queues/hazard_queue.hpp"
+#include "queues/ws_deque.hpp"
+#include "synchro/eventcount.hpp"
+
+namespace synchro {
+
+// Fixed set of worker threads running submitted jobs.
+//
+// Each worker owns a work-stealing deque (queues/ws_deque.hpp). Jobs
+// submitted from inside a job go onto the submitting worker's deque, with
+// no shared lock or shared write on the way; the worker runs its own jobs
+// newest first, and idle workers steal the oldest ones from random
+// victims. Jobs submitted from other threads go through a global
+// hazard_queue, which workers check after their own deque. Workers with
+// nothing to do sleep on an eventcount.
+//
+// Jobs must not throw.
+//
+// This class is thread safe.
+class work_stealing_pool {
+ private:
+  struct task;
+  struct worker;
+
+ public:
+  typedef std::function<void()> job;
+
+  // Tracks a group of jobs, like a countdown_latch whose count goes up by
+  // one with every job submitted against it and down as each finishes.
+  // Copies refer to the same group.
+  class join_handle {
+   public:
+    join_handle(); // empty group, already done
+    // Blocks until all jobs of the group have finished, including ones
+    // submitted while waiting. Called by a worker of any pool, it runs
+    // that pool's jobs in the meantime instead of blocking, so jobs can
+    // fork and join subtasks without starving the pool.
+    void wait() const;
+    bool done() const;
+   private:
+    friend class work_stealing_pool;
+    struct state;
+    std::shared_ptr<state> state_;
+  };
+
+  // Defaults to one worker per hardware thread. Requires nthreads > 0.
+  explicit work_stealing_pool(int nthreads = default_threads());
+  // Runs every job submitted so far (and the ones they submit) to
+  // completion, then joins the workers. No job may be submitted from
+  // outside the pool once destruction starts.
+  ~work_stealing_pool();
+  work_stealing_pool(const work_stealing_pool&) = delete;
+  work_stealing_pool& operator=(const work_stealing_pool&) = delete;
+
+  join_handle submit(job j);
+  // Adds j to the group of 'h'.
+  void submit(const join_handle& h, job j);
+
+  int size() const { return static_cast<int>(workers_.size()); }
+  // Number of times a sleeping worker has woken up, for tests and tuning.
+  // Each submit wakes at most one.
+  std::uint64_t wakeups() const {
+    return wakeups_.load(std::memory_order_relaxed);
+  }
+  static int default_threads();
+
+ private:
+  void enqueue(task* t);
+  void work(worker& w);
+  task* find_task(worker& w);
+  // Runs one job if there is any, from the calling worker's point of view.
+  bool run_one(worker& w);
+  static void run(task* t);
+
+  // Worker of the calling thread, or nullptr on non-worker threads.
+  static thread_local worker* current_;
+
+  std::vector<std::unique_ptr<worker> > workers_;
+  queues::hazard_queue<task*> injection_;
+  eventcount idle_;
+  std::atomic<bool> stopping_;
+  std::atomic<std::uint64_t> wakeups_;
+};
+
+} // namespace synchro
+
+#endif /* SYNCHRO_WORK_STEALING_POOL_HPP_ */
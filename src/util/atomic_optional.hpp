@@ -14,6 +14,11 @@
 
 namespace util {
 
+// Tag for constructors that build their value in place from the
+// arguments that follow it.
+struct in_place_t {};
+constexpr in_place_t in_place {};
+
 // Atomic optional may or may not hold a value, atomically.
 // It is meant to be used by only one construction/destruction
 // iteration, where only one thread gets to destruct the object.
@@ -28,6 +33,8 @@ class atomic_optional {
   // Constructors
   atomic_optional(); // does not default-initialize T
   atomic_optional(T&& rval);
+  template<typename... Args>
+  explicit atomic_optional(in_place_t, Args&&... args);
   ~atomic_optional();
 
   // Assignment operators
@@ -48,7 +55,7 @@ class atomic_optional {
 
  private:
   std::atomic<bool> initialized;
-  char store[sizeof(T)];
+  alignas(T) char store[sizeof(T)];
 };
 
 } // namespace util
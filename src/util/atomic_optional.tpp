@@ -6,6 +6,9 @@
   Implementation of atomic_optional class
 */
 
+#include <new>
+#include <utility>
+
 namespace util {
 
 template<typename T>
@@ -18,6 +21,13 @@ atomic_optional<T>::atomic_optional(T&& rval) :
   new (get()) T(std::forward<T>(rval));
 }
 
+template<typename T>
+template<typename... Args>
+atomic_optional<T>::atomic_optional(in_place_t, Args&&... args) :
+    initialized(true) {
+  new (get()) T(std::forward<Args>(args)...);
+}
+
 // need not be initialized
 template<typename T>
 T *atomic_optional<T>::get() const {
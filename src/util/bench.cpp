@@ -0,0 +1,172 @@
+/*
+  Vladimir Feinberg
+  util/bench.cpp
+  2026-10-15
+
+  Benchmark statistics and reporting.
+*/
+
+#include "util/bench.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "util/uassert.hpp"
+
+using namespace std;
+using namespace util;
+using namespace bench;
+
+namespace {
+  // Positive integer from the environment, or 'dflt'.
+  int env_int(const char* var, int dflt) {
+    const char* val = getenv(var);
+    if (!val) return dflt;
+    int parsed = atoi(val);
+    return parsed > 0 ? parsed : dflt;
+  }
+
+  string json_string(const string& s) {
+    string out = "\"";
+    for (char c : s) {
+      if (c == '"' || c == '\\') out += '\\';
+      out += c;
+    }
+    return out + "\"";
+  }
+
+  // Nanoseconds in the largest unit that keeps them at least 1.
+  string human_time(double ns) {
+    static const char* units[] = {"ns", "us", "ms", "s"};
+    int unit = 0;
+    while (ns >= 1000 && unit < 3) {
+      ns /= 1000;
+      ++unit;
+    }
+    ostringstream out;
+    out << fixed << setprecision(ns < 10 ? 2 : 1) << ns << units[unit];
+    return out.str();
+  }
+
+  string csv_field(const string& s) {
+    if (s.find_first_of(",\"") == string::npos) return s;
+    string out = "\"";
+    for (char c : s) {
+      if (c == '"') out += '"';
+      out += c;
+    }
+    return out + "\"";
+  }
+}
+
+options options::from_env() {
+  options opts;
+  if (const char* fmt = getenv("BENCH_FORMAT")) {
+    string f = fmt;
+    if (f == "csv") opts.fmt = format::csv;
+    else if (f == "json") opts.fmt = format::json;
+  }
+  // Zero warmup runs is a valid choice.
+  if (const char* warmup = getenv("BENCH_WARMUP"))
+    opts.warmup = max(0, atoi(warmup));
+  opts.trials = env_int("BENCH_TRIALS", opts.trials);
+  opts.min_trial = chrono::milliseconds(env_int(
+      "BENCH_MIN_TRIAL_MS", static_cast<int>(
+          chrono::duration_cast<chrono::milliseconds>(
+              opts.min_trial).count())));
+  return opts;
+}
+
+result bench::summarize(const string& suite, const string& name,
+                        uint64_t iterations, vector<double> samples) {
+  UASSERT(!samples.empty());
+  sort(samples.begin(), samples.end());
+  size_t n = samples.size();
+  result r;
+  r.suite = suite;
+  r.name = name;
+  r.trials = static_cast<int>(n);
+  r.iterations = iterations;
+  r.min = samples.front();
+  r.median = n % 2 ? samples[n / 2]
+                   : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+  // The median lies between the j-th and k-th smallest of n samples with
+  // probability about 95%, by the normal approximation to the binomial.
+  double spread = 1.96 * sqrt(static_cast<double>(n)) / 2;
+  auto j = static_cast<long>(floor(n / 2.0 - spread));
+  auto k = static_cast<long>(ceil(n / 2.0 + spread));
+  r.median_lo = samples[max(j, 1L) - 1];
+  r.median_hi = samples[min(k, static_cast<long>(n)) - 1];
+  // Nearest rank.
+  r.p99 = samples[static_cast<size_t>(ceil(0.99 * n)) - 1];
+  r.mean = accumulate(samples.begin(), samples.end(), 0.0) / n;
+  double sq = 0;
+  for (double s : samples) sq += (s - r.mean) * (s - r.mean);
+  r.stddev = n > 1 ? sqrt(sq / (n - 1)) : 0;
+  return r;
+}
+
+// suite -----------------------------------------------------------------
+
+suite::suite(const string& title, const options& opts) :
+    title_(title), opts_(opts) {
+  UASSERT(opts_.trials > 0);
+  log() << title_ << endl << "  (time per item: median [95% CI], min, p99;"
+        << " items/s at the median; " << opts_.trials << " trials)" << endl;
+}
+
+ostream& suite::log() {
+  // An ostream without a buffer fails every write, silently.
+  static ostream sink(nullptr);
+  return opts_.fmt == format::text ? cout : sink;
+}
+
+const result& suite::add(const string& name, uint64_t iterations,
+                         vector<double> samples) {
+  results_.push_back(summarize(title_, name, iterations, move(samples)));
+  const result& r = results_.back();
+  switch (opts_.fmt) {
+  case format::text: {
+    ostringstream line;
+    line << "  " << left << setw(40) << name << right << setw(10)
+         << human_time(r.median) << " [" << human_time(r.median_lo) << ", "
+         << human_time(r.median_hi) << "]  min " << human_time(r.min)
+         << "  p99 " << human_time(r.p99) << "  " << setprecision(4)
+         << r.mitems_per_sec() << " M/s";
+    cout << line.str() << endl;
+    break;
+  }
+  case format::csv: {
+    static bool header = false;
+    if (!header) {
+      cout << "suite,name,trials,iterations,min_ns,median_ns,median_lo_ns,"
+           << "median_hi_ns,p99_ns,mean_ns,stddev_ns,mitems_per_s" << endl;
+      header = true;
+    }
+    cout << csv_field(r.suite) << "," << csv_field(r.name) << ","
+         << r.trials << "," << r.iterations << "," << r.min << ","
+         << r.median << "," << r.median_lo << "," << r.median_hi << ","
+         << r.p99 << "," << r.mean << "," << r.stddev << ","
+         << r.mitems_per_sec() << endl;
+    break;
+  }
+  case format::json:
+    cout << "{\"suite\": " << json_string(r.suite) << ", \"name\": "
+         << json_string(r.name) << ", \"trials\": " << r.trials
+         << ", \"iterations\": " << r.iterations << ", \"min_ns\": " << r.min
+         << ", \"median_ns\": " << r.median << ", \"median_lo_ns\": "
+         << r.median_lo << ", \"median_hi_ns\": " << r.median_hi
+         << ", \"p99_ns\": " << r.p99 << ", \"mean_ns\": " << r.mean
+         << ", \"stddev_ns\": " << r.stddev << ", \"mitems_per_s\": "
+         << r.mitems_per_sec() << "}" << endl;
+    break;
+  }
+  return r;
+}
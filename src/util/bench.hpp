@@ -0,0 +1,171 @@
+/*
+  Vladimir Feinberg
+  util/bench.hpp
+  2026-10-15
+
+  Micro-benchmark harness: warmup, repeated trials with a calibrated
+  iteration count, and robust statistics over the trials.
+*/
+
+#ifndef UTIL_BENCH_HPP_
+#define UTIL_BENCH_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace util {
+namespace bench {
+
+typedef std::chrono::steady_clock clock;
+
+enum class format {
+  text, // aligned, human-readable lines
+  csv,  // one header row, then one row per result
+  json  // one JSON object per line (JSON Lines)
+};
+
+struct options {
+  format fmt = format::text;
+  // Untimed runs before the trials.
+  int warmup = 1;
+  int trials = 10;
+  // suite::run() repeats its operation until a trial takes this long.
+  std::chrono::nanoseconds min_trial = std::chrono::milliseconds(20);
+
+  // Defaults, overridden by the environment variables BENCH_FORMAT
+  // (text, csv or json), BENCH_WARMUP, BENCH_TRIALS and BENCH_MIN_TRIAL_MS.
+  static options from_env();
+};
+
+// Statistics over a benchmark's trials, in nanoseconds per item.
+struct result {
+  std::string suite;
+  std::string name;
+  int trials;
+  // Operations timed per trial.
+  std::uint64_t iterations;
+  double min;
+  double median;
+  // Distribution-free 95% confidence interval for the median, from order
+  // statistics; as wide as [min, max] with 7 trials or fewer.
+  double median_lo;
+  double median_hi;
+  double p99;
+  double mean;
+  double stddev;
+
+  // Items per second at the median, in millions.
+  double mitems_per_sec() const { return 1e3 / median; }
+};
+
+// Summarizes per-trial samples of nanoseconds per item.
+result summarize(const std::string& suite, const std::string& name,
+                 std::uint64_t iterations, std::vector<double> samples);
+
+// Usage:
+//   util::bench::suite s("hazard_queue");
+//   s.run("enqueue", [&](std::uint64_t n) {
+//       for (std::uint64_t i = 0; i < n; ++i) q.enqueue(i);
+//     });
+//   s.run_fixed("sort 1e6", [&]() { v = backup; },
+//               [&]() { std::sort(v.begin(), v.end()); }, v.size());
+//
+// Results are written to std::cout as they come, in the options' format.
+// Commentary a benchmark prints should go through log(), which discards it
+// unless the format is text, so that csv and json output stays parseable.
+class suite {
+ public:
+  explicit suite(const std::string& title,
+                 const options& opts = options::from_env());
+  suite(const suite&) = delete;
+  suite& operator=(const suite&) = delete;
+
+  /*
+   * INPUT:
+   * const std::string& name - benchmark name, unique within the suite
+   * F op - functor taking a std::uint64_t n, doing n operations
+   * double items - items each operation processes
+   * PRECONDITION:
+   * op(n) takes time roughly proportional to n.
+   * BEHAVIOR:
+   * Doubles n (or more) until op(n) takes at least min_trial, then runs
+   * the warmup and times each trial of op(n).
+   * RETURN:
+   * The result, also reported.
+   */
+  template<typename F>
+  const result& run(const std::string& name, F op, double items = 1);
+  /*
+   * INPUT:
+   * const std::string& name - as above
+   * S setup - functor taking no arguments, run untimed before each trial
+   * F op - functor taking no arguments, timed once per trial
+   * double items - items op processes
+   * PRECONDITION:
+   * op() is long enough to time by itself (a millisecond or more).
+   * BEHAVIOR:
+   * Runs the warmup, then times each trial of op(). For operations that
+   * consume their input, like sorts.
+   * RETURN:
+   * The result, also reported.
+   */
+  template<typename S, typename F>
+  const result& run_fixed(const std::string& name, S setup, F op,
+                          double items = 1);
+  /*
+   * INPUT:
+   * const std::string& name - as above
+   * F trial - functor taking no arguments, running one trial and
+   * returning the clock::duration it measured
+   * double items - items a trial processes
+   * PRECONDITION:
+   * BEHAVIOR:
+   * Runs the warmup, then each trial. For multithreaded workloads, where
+   * the trial sets up its threads and times them with time_threads().
+   * RETURN:
+   * The result, also reported.
+   */
+  template<typename F>
+  const result& run_manual(const std::string& name, F trial,
+                           double items = 1);
+
+  // Stream for commentary: std::cout for text output, else a sink.
+  std::ostream& log();
+  // Every result so far; references stay valid as results are added.
+  const std::deque<result>& results() const { return results_; }
+  const options& opts() const { return opts_; }
+
+ private:
+  const result& add(const std::string& name, std::uint64_t iterations,
+                    std::vector<double> samples);
+
+  std::string title_;
+  options opts_;
+  std::deque<result> results_;
+};
+
+/*
+ * INPUT:
+ * int nthreads - threads to start
+ * F body - functor taking the thread's index, from 0 to nthreads - 1
+ * PRECONDITION:
+ * nthreads > 0. The caller links the synchro library.
+ * BEHAVIOR:
+ * Starts nthreads threads, and once all are running releases them
+ * together through a countdown_latch to each call body(index).
+ * RETURN:
+ * Time from the release until every body returned.
+ */
+template<typename F>
+clock::duration time_threads(int nthreads, F body);
+
+} // namespace bench
+} // namespace util
+
+#include "util/bench.tpp"
+
+#endif /* UTIL_BENCH_HPP_ */
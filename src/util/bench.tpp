@@ -0,0 +1,92 @@
+/*
+  Vladimir Feinberg
+  util/bench.tpp
+  2026-10-15
+
+  Contains implementation of the util/bench.hpp templates.
+*/
+
+#include <algorithm>
+#include <thread>
+
+#include "synchro/countdown_latch.hpp"
+#include "util/uassert.hpp"
+
+namespace util {
+namespace bench {
+
+namespace _bench_internal {
+
+template<typename F>
+std::chrono::duration<double, std::nano> time_once(F& op) {
+  auto start = clock::now();
+  op();
+  return clock::now() - start;
+}
+
+} // namespace _bench_internal
+
+template<typename F>
+const result& suite::run(const std::string& name, F op, double items) {
+  std::uint64_t n = 1;
+  auto trial = [&]() { op(n); };
+  double min_ns = static_cast<double>(opts_.min_trial.count());
+  while (true) {
+    double ns = _bench_internal::time_once(trial).count();
+    if (ns >= min_ns) break;
+    // Aim a bit past the target, growing at most tenfold per step.
+    double scale = ns > 0 ? 1.4 * min_ns / ns : 10;
+    n = static_cast<std::uint64_t>(n * std::min(10.0, std::max(2.0, scale)));
+  }
+  for (int i = 0; i < opts_.warmup; ++i) trial();
+  std::vector<double> samples;
+  samples.reserve(opts_.trials);
+  for (int i = 0; i < opts_.trials; ++i)
+    samples.push_back(_bench_internal::time_once(trial).count() /
+                      (n * items));
+  return add(name, n, std::move(samples));
+}
+
+template<typename S, typename F>
+const result& suite::run_fixed(const std::string& name, S setup, F op,
+                               double items) {
+  return run_manual(name, [&]() {
+      setup();
+      return _bench_internal::time_once(op);
+    }, items);
+}
+
+template<typename F>
+const result& suite::run_manual(const std::string& name, F trial,
+                                double items) {
+  for (int i = 0; i < opts_.warmup; ++i) trial();
+  std::vector<double> samples;
+  samples.reserve(opts_.trials);
+  for (int i = 0; i < opts_.trials; ++i) {
+    std::chrono::duration<double, std::nano> ns = trial();
+    samples.push_back(ns.count() / items);
+  }
+  return add(name, 1, std::move(samples));
+}
+
+template<typename F>
+clock::duration time_threads(int nthreads, F body) {
+  UASSERT(nthreads > 0);
+  synchro::countdown_latch ready(nthreads), go(1);
+  std::vector<std::thread> threads;
+  threads.reserve(nthreads);
+  for (int i = 0; i < nthreads; ++i)
+    threads.emplace_back([&ready, &go, &body, i]() {
+        ready.down();
+        go.wait();
+        body(i);
+      });
+  ready.wait();
+  auto start = clock::now();
+  go.down();
+  for (auto& t : threads) t.join();
+  return clock::now() - start;
+}
+
+} // namespace bench
+} // namespace util
@@ -0,0 +1,60 @@
+/*
+  Vladimir Feinberg
+  util/cache_line.hpp
+  2026-10-14
+
+  Cache-line layout helpers, for keeping atomics that different threads
+  hammer on (a queue's head and tail, two threads' hazard records) from
+  sharing a line and invalidating each other on every write.
+
+  Padding can be turned off by defining UTIL_PAD_CACHE_LINES as 0 (CMake:
+  -DPADDING=0), so that benchmarks can be compared against the packed
+  layout. Everything here then degenerates to the natural layout.
+*/
+
+#ifndef UTIL_CACHE_LINE_HPP_
+#define UTIL_CACHE_LINE_HPP_
+
+#include <cstddef>
+
+#ifndef UTIL_PAD_CACHE_LINES
+#define UTIL_PAD_CACHE_LINES 1
+#endif /* UTIL_PAD_CACHE_LINES */
+
+namespace util {
+
+// Destructive interference size of all the x86 and most ARM parts we care
+// about (std::hardware_destructive_interference_size is C++17).
+constexpr std::size_t kCacheLine = 64;
+constexpr bool kPadCacheLines = UTIL_PAD_CACHE_LINES;
+
+// Member filler. Placed after 'Used' bytes of hot members, it pushes the
+// next member onto a fresh cache line. A line-sized pad before the first
+// hot member keeps it off whatever precedes it (e.g., a vtable pointer or
+// read-only fields).
+//
+// The enclosing object is not itself line-aligned (C++11 new doesn't
+// honor over-alignment), so the group may straddle a line boundary, and
+// only a full line of padding after its last byte guarantees the next
+// member a line of its own. The pad is that line plus whatever rounds
+// group and pad up to whole lines, so that in an object that does happen
+// to be line-aligned (e.g., a line_stride() slot) every group starts on
+// a line.
+template<std::size_t Used, bool Enabled = kPadCacheLines>
+struct cache_pad {
+  char pad_[kCacheLine + (kCacheLine - Used % kCacheLine) % kCacheLine];
+};
+
+template<std::size_t Used>
+struct cache_pad<Used, false> {};
+
+// Size of a slot holding an object of 'size' bytes in an array of one-per-
+// line elements, i.e., 'size' rounded up to a multiple of kCacheLine.
+constexpr std::size_t line_stride(std::size_t size) {
+  return kPadCacheLines ? (size + kCacheLine - 1) / kCacheLine * kCacheLine
+                        : size;
+}
+
+} // namespace util
+
+#endif /* UTIL_CACHE_LINE_HPP_ */
@@ -0,0 +1,31 @@
+/*
+  Vladimir Feinberg
+  util/hash.hpp
+  2026-10-15
+
+  Hash mixing, for hash tables and shard selection over std::hash, which
+  is the identity for integers.
+*/
+
+#ifndef UTIL_HASH_HPP_
+#define UTIL_HASH_HPP_
+
+#include <cstdint>
+
+namespace util {
+
+// murmur3's 64-bit finalizer. Every output bit depends on every input
+// bit, so keys with a common stride (or that differ only in their high
+// bits) spread over any range of buckets, high bits or low.
+inline std::uint64_t mix_hash(std::uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ull;
+  h ^= h >> 33;
+  return h;
+}
+
+} // namespace util
+
+#endif /* UTIL_HASH_HPP_ */
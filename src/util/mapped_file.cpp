@@ -0,0 +1,126 @@
+/*
+  Vladimir Feinberg
+  util/mapped_file.cpp
+  2026-10-15
+
+  Memory-mapped file and atomic file replacement, on POSIX.
+*/
+
+#include "util/mapped_file.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace util;
+
+namespace {
+  [[noreturn]] void throw_errno(const string& what) {
+    throw system_error(errno, generic_category(), what);
+  }
+
+  // Buffered writes are flushed in chunks of this many bytes.
+  const size_t kWriteBuffer = 1 << 20;
+}
+
+// mapped_file -----------------------------------------------------------
+
+mapped_file::mapped_file(const string& path) : addr_(nullptr), size_(0) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) throw_errno("open " + path);
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    int err = errno;
+    close(fd);
+    errno = err;
+    throw_errno("stat " + path);
+  }
+  size_ = static_cast<size_t>(st.st_size);
+  if (size_) {
+    addr_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr_ == MAP_FAILED) {
+      int err = errno;
+      close(fd);
+      errno = err;
+      throw_errno("mmap " + path);
+    }
+    // Only a hint, so failure doesn't matter.
+    madvise(addr_, size_, MADV_SEQUENTIAL);
+  }
+  // The mapping keeps the file alive.
+  close(fd);
+}
+
+mapped_file::~mapped_file() {
+  if (addr_) munmap(addr_, size_);
+}
+
+// file_replacer ---------------------------------------------------------
+
+file_replacer::file_replacer(const string& path) :
+    path_(path), tmp_path_(path + ".tmp"), fd_(-1) {
+  fd_ = open(tmp_path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+             0644);
+  if (fd_ < 0) throw_errno("open " + tmp_path_);
+  buf_.reserve(kWriteBuffer);
+}
+
+file_replacer::~file_replacer() {
+  if (fd_ < 0) return;
+  close(fd_);
+  unlink(tmp_path_.c_str());
+}
+
+void file_replacer::write(const void* data, size_t size) {
+  auto bytes = static_cast<const char*>(data);
+  while (size) {
+    size_t n = min(size, kWriteBuffer - buf_.size());
+    buf_.insert(buf_.end(), bytes, bytes + n);
+    bytes += n;
+    size -= n;
+    if (buf_.size() == kWriteBuffer) flush();
+  }
+}
+
+void file_replacer::flush() {
+  const char* p = buf_.data();
+  size_t left = buf_.size();
+  while (left) {
+    auto n = ::write(fd_, p, left);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      throw_errno("write " + tmp_path_);
+    }
+    p += n;
+    left -= n;
+  }
+  buf_.clear();
+}
+
+void file_replacer::commit() {
+  flush();
+  if (fsync(fd_) != 0) throw_errno("fsync " + tmp_path_);
+  if (close(fd_) != 0) {
+    int err = errno;
+    fd_ = -1;
+    unlink(tmp_path_.c_str());
+    errno = err;
+    throw_errno("close " + tmp_path_);
+  }
+  fd_ = -1;
+  if (rename(tmp_path_.c_str(), path_.c_str()) != 0) {
+    int err = errno;
+    unlink(tmp_path_.c_str());
+    errno = err;
+    throw_errno("rename " + tmp_path_);
+  }
+}
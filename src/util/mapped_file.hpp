@@ -0,0 +1,69 @@
+/*
+  Vladimir Feinberg
+  util/mapped_file.hpp
+  2026-10-15
+
+  Whole-file I/O for snapshots: a read-only memory map, and a buffered
+  writer that replaces its target atomically.
+*/
+
+#ifndef UTIL_MAPPED_FILE_HPP_
+#define UTIL_MAPPED_FILE_HPP_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace util {
+
+// A file mapped read-only into memory, for as long as this lives. Pages
+// are faulted in as they're read, with readahead set up for a front to
+// back pass, so a loader can parse the data in place without copying it
+// through read buffers first.
+//
+// Throws std::system_error if the file can't be opened or mapped.
+class mapped_file {
+ public:
+  explicit mapped_file(const std::string& path);
+  ~mapped_file();
+  mapped_file(const mapped_file&) = delete;
+  mapped_file& operator=(const mapped_file&) = delete;
+
+  // Null if the file is empty.
+  const char* data() const { return static_cast<const char*>(addr_); }
+  std::size_t size() const { return size_; }
+
+ private:
+  void* addr_;
+  std::size_t size_;
+};
+
+// Writes a file in place of 'path', all at once or not at all: data goes
+// to a temporary file next to it, which is synced and renamed over 'path'
+// by commit(). Destroying the writer without committing removes the
+// temporary, leaving 'path' as it was.
+//
+// Throws std::system_error on any I/O failure.
+class file_replacer {
+ public:
+  explicit file_replacer(const std::string& path);
+  ~file_replacer();
+  file_replacer(const file_replacer&) = delete;
+  file_replacer& operator=(const file_replacer&) = delete;
+
+  // Buffered.
+  void write(const void* data, std::size_t size);
+  void commit();
+
+ private:
+  void flush();
+
+  std::string path_;
+  std::string tmp_path_;
+  int fd_;
+  std::vector<char> buf_;
+};
+
+} // namespace util
+
+#endif /* UTIL_MAPPED_FILE_HPP_ */
@@ -0,0 +1,156 @@
+/*
+  Vladimir Feinberg
+  util/node_pool.hpp
+  2026-10-14
+
+  Per-type freelist allocator for fixed-size nodes (linked structure nodes,
+  mostly), which keeps freed blocks around for reuse instead of handing them
+  back to malloc.
+
+  Each thread has a bounded local cache of free blocks, so allocate() and
+  deallocate() are usually a couple of pointer swaps with no synchronization.
+  When a thread's cache overflows, half of it is moved to a mutex-protected
+  global list in one batch; a thread with an empty cache takes a whole batch
+  back from there before falling back to operator new. Producer/consumer
+  patterns, where one set of threads frees what another allocates, thus
+  cost one lock per batch rather than one malloc arena round trip per node.
+*/
+
+#ifndef UTIL_NODE_POOL_HPP_
+#define UTIL_NODE_POOL_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace util {
+
+// All methods are static and thread safe. Every block is an individual
+// operator new allocation, so memory from the pool can always be
+// released with operator delete, even after the pool itself was destroyed
+// at static destruction time (which the pool does automatically for
+// deallocations that come in that late, e.g., from hazard pointer
+// cleanup).
+//
+// T may be incomplete when node_pool<T> is named, but not when its methods
+// are used.
+template<typename T>
+class node_pool {
+ public:
+  // Free blocks a thread keeps to itself before overflowing to the global
+  // list, and how many move at a time.
+  static constexpr std::size_t kLocalCapacity = 256;
+  static constexpr std::size_t kBatch = kLocalCapacity / 2;
+  // Batches kept globally; anything past this is returned to the system.
+  static constexpr std::size_t kGlobalBatches = 64;
+
+  // Uninitialized storage for one T. Throws std::bad_alloc.
+  static void* allocate();
+  // 'ptr' must have come from allocate() (of any thread), or be null.
+  static void deallocate(void* ptr) noexcept;
+
+  template<typename... Args>
+  static T* create(Args&&... args);
+  static void destroy(T* ptr) noexcept;
+
+  // Type-erased destroy(), with the signature synchro's schedule_deletion()
+  // methods expect of a deleter.
+  static void ptr_deleter(void* ptr) { destroy(static_cast<T*>(ptr)); }
+
+  // Free blocks cached by the calling thread and globally, for testing.
+  static std::size_t local_size();
+  static std::size_t global_size();
+
+ private:
+  struct block { block* next; };
+  struct chain {
+    block* head;
+    std::size_t size;
+  };
+
+  static constexpr std::size_t kBlockSize =
+      sizeof(T) < sizeof(block) ? sizeof(block) : sizeof(T);
+
+  class local_cache {
+   public:
+    constexpr local_cache() : head_(nullptr), size_(0), closed_(false) {}
+    ~local_cache();
+    bool closed() const { return closed_; }
+    std::size_t size() const { return size_; }
+    void push(block* b);
+    block* pop();
+    // Takes ownership of c, which must be empty.
+    void refill(chain c);
+    // Removes the first n blocks.
+    chain split(std::size_t n);
+
+   private:
+    block* head_;
+    std::size_t size_;
+    bool closed_; // after thread exit, deallocations bypass the cache.
+  };
+
+  class global_list {
+   public:
+    global_list() { chains_.reserve(kGlobalBatches); }
+    ~global_list();
+    void give(chain c) noexcept;
+    chain take();
+    std::size_t size();
+
+   private:
+    std::mutex lock_;
+    std::vector<chain> chains_;
+  };
+
+  static global_list& global();
+  static void free_chain(chain c) noexcept;
+
+  static thread_local local_cache local_;
+  // Set once global() is destroyed.
+  static std::atomic<bool> closed_;
+};
+
+// Mixin that routes new and delete of Derived through node_pool<Derived>,
+// so that everything deleting a Derived (including hazard_ptr's and
+// epoch_domain's default deleters) returns it to the pool. Allocations of
+// classes further derived from Derived go to the global operator new.
+template<typename Derived>
+struct pooled {
+  static void* operator new(std::size_t size);
+  static void operator delete(void* ptr, std::size_t size) noexcept;
+};
+
+// Standard allocator over node_pool, for node-based containers. Requests
+// for single objects come from the pool; arrays (e.g., hash buckets) from
+// operator new.
+template<typename T>
+class pool_allocator {
+ public:
+  typedef T value_type;
+
+  pool_allocator() noexcept {}
+  template<typename U>
+  pool_allocator(const pool_allocator<U>&) noexcept {}
+
+  T* allocate(std::size_t n);
+  void deallocate(T* ptr, std::size_t n) noexcept;
+};
+
+template<typename T, typename U>
+bool operator==(const pool_allocator<T>&, const pool_allocator<U>&) {
+  return true;
+}
+
+template<typename T, typename U>
+bool operator!=(const pool_allocator<T>&, const pool_allocator<U>&) {
+  return false;
+}
+
+} // namespace util
+
+#include "util/node_pool.tpp"
+
+#endif /* UTIL_NODE_POOL_HPP_ */
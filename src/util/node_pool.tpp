@@ -0,0 +1,219 @@
+/*
+  Vladimir Feinberg
+  util/node_pool.tpp
+  2026-10-14
+
+  node_pool implementation.
+*/
+
+// Implementation details:
+//
+// Free blocks are threaded through their own storage into singly linked
+// chains. The local cache is one chain; the global list is a vector of
+// chains, each typically kBatch long.
+//
+// Teardown is the delicate part. Deallocation may happen after the calling
+// thread's cache is destroyed (other thread_local destructors, such as
+// hazard pointer cleanup, run after it) or after the global list is
+// destroyed (static destructors of objects constructed before it). Each
+// level remembers that it was closed, and deallocations skip to the next
+// level: cache, then global list, then operator delete.
+
+#include <utility>
+
+namespace util {
+
+template<typename T>
+constexpr std::size_t node_pool<T>::kLocalCapacity;
+template<typename T>
+constexpr std::size_t node_pool<T>::kBatch;
+template<typename T>
+constexpr std::size_t node_pool<T>::kGlobalBatches;
+template<typename T>
+constexpr std::size_t node_pool<T>::kBlockSize;
+
+template<typename T>
+thread_local typename node_pool<T>::local_cache node_pool<T>::local_;
+template<typename T>
+std::atomic<bool> node_pool<T>::closed_(false);
+
+template<typename T>
+void node_pool<T>::local_cache::push(block* b) {
+  b->next = head_;
+  head_ = b;
+  ++size_;
+}
+
+template<typename T>
+auto node_pool<T>::local_cache::pop() -> block* {
+  block* b = head_;
+  if (b) {
+    head_ = b->next;
+    --size_;
+  }
+  return b;
+}
+
+template<typename T>
+void node_pool<T>::local_cache::refill(chain c) {
+  head_ = c.head;
+  size_ = c.size;
+}
+
+template<typename T>
+auto node_pool<T>::local_cache::split(std::size_t n) -> chain {
+  chain c = {head_, 0};
+  block* last = nullptr;
+  while (c.size < n && head_) {
+    last = head_;
+    head_ = head_->next;
+    ++c.size;
+  }
+  if (last) last->next = nullptr;
+  size_ -= c.size;
+  return c;
+}
+
+template<typename T>
+node_pool<T>::local_cache::~local_cache() {
+  // this == &local_
+  closed_ = true;
+  chain c = split(size_);
+  if (!c.head) return;
+  if (node_pool<T>::closed_.load(std::memory_order_acquire)) free_chain(c);
+  else global().give(c);
+}
+
+template<typename T>
+node_pool<T>::global_list::~global_list() {
+  node_pool<T>::closed_.store(true, std::memory_order_release);
+  for (auto c : chains_) free_chain(c);
+}
+
+template<typename T>
+void node_pool<T>::global_list::give(chain c) noexcept {
+  {
+    std::lock_guard<std::mutex> lk(lock_);
+    if (chains_.size() < kGlobalBatches) {
+      // Capacity is reserved up front, so this can't throw.
+      chains_.push_back(c);
+      return;
+    }
+  }
+  free_chain(c);
+}
+
+template<typename T>
+auto node_pool<T>::global_list::take() -> chain {
+  std::lock_guard<std::mutex> lk(lock_);
+  if (chains_.empty()) return chain{nullptr, 0};
+  chain c = chains_.back();
+  chains_.pop_back();
+  return c;
+}
+
+template<typename T>
+std::size_t node_pool<T>::global_list::size() {
+  std::lock_guard<std::mutex> lk(lock_);
+  std::size_t total = 0;
+  for (auto c : chains_) total += c.size;
+  return total;
+}
+
+template<typename T>
+auto node_pool<T>::global() -> global_list& {
+  static global_list list;
+  return list;
+}
+
+template<typename T>
+void node_pool<T>::free_chain(chain c) noexcept {
+  while (c.head) {
+    block* next = c.head->next;
+    ::operator delete(c.head);
+    c.head = next;
+  }
+}
+
+template<typename T>
+void* node_pool<T>::allocate() {
+  static_assert(alignof(T) <= alignof(std::max_align_t),
+                "node_pool blocks are only aligned as operator new's are");
+  if (!local_.size() && !local_.closed() &&
+      !closed_.load(std::memory_order_acquire))
+    local_.refill(global().take());
+  if (block* b = local_.pop()) return b;
+  return ::operator new(kBlockSize);
+}
+
+template<typename T>
+void node_pool<T>::deallocate(void* ptr) noexcept {
+  if (!ptr) return;
+  block* b = static_cast<block*>(ptr);
+  if (!local_.closed()) {
+    local_.push(b);
+    if (local_.size() > kLocalCapacity) global().give(local_.split(kBatch));
+    return;
+  }
+  if (!closed_.load(std::memory_order_acquire)) {
+    b->next = nullptr;
+    global().give(chain{b, 1});
+    return;
+  }
+  ::operator delete(ptr);
+}
+
+template<typename T>
+template<typename... Args>
+T* node_pool<T>::create(Args&&... args) {
+  void* ptr = allocate();
+  try {
+    return new (ptr) T(std::forward<Args>(args)...);
+  } catch (...) {
+    deallocate(ptr);
+    throw;
+  }
+}
+
+template<typename T>
+void node_pool<T>::destroy(T* ptr) noexcept {
+  if (!ptr) return;
+  ptr->~T();
+  deallocate(ptr);
+}
+
+template<typename T>
+std::size_t node_pool<T>::local_size() {
+  return local_.size();
+}
+
+template<typename T>
+std::size_t node_pool<T>::global_size() {
+  return closed_.load(std::memory_order_acquire) ? 0 : global().size();
+}
+
+template<typename Derived>
+void* pooled<Derived>::operator new(std::size_t size) {
+  if (size != sizeof(Derived)) return ::operator new(size);
+  return node_pool<Derived>::allocate();
+}
+
+template<typename Derived>
+void pooled<Derived>::operator delete(void* ptr, std::size_t size) noexcept {
+  if (size != sizeof(Derived)) ::operator delete(ptr);
+  else node_pool<Derived>::deallocate(ptr);
+}
+
+template<typename T>
+T* pool_allocator<T>::allocate(std::size_t n) {
+  if (n == 1) return static_cast<T*>(node_pool<T>::allocate());
+  return static_cast<T*>(::operator new(n * sizeof(T)));
+}
+
+template<typename T>
+void pool_allocator<T>::deallocate(T* ptr, std::size_t n) noexcept {
+  if (n == 1) node_pool<T>::deallocate(ptr);
+  else ::operator delete(ptr);
+}
+
+} // namespace util
@@ -13,10 +13,17 @@
 
 namespace util {
 
-class nullstream : public std::ostream {
+// Not an std::ostream itself: the inherited operator<< overloads would be as
+// good a match as the catch-all below, making every use ambiguous.
+class nullstream {
  public:
   template<typename T>
   inline nullstream& operator<<(const T&) { return *this; }
+  // Manipulators (std::endl and friends) are overloaded, so T can't be
+  // deduced for them.
+  inline nullstream& operator<<(std::ostream& (*)(std::ostream&)) {
+    return *this;
+  }
 };
 
 } // namespace util
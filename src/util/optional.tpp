@@ -6,12 +6,22 @@
 * Implements optional.
 */
 
+#include <utility>
+
+#include "util/uassert.hpp"
+
 namespace util {
 
 template<typename T>
 optional<T>::optional() :
     initialized(false) {}
 
+template<typename T>
+optional<T>::optional(const T& lval) :
+    optional() {
+  construct(lval);
+}
+
 template<typename T>
 optional<T>::optional(T&& rval) :
     optional() {
@@ -3,14 +3,22 @@
   util/radix.hpp
   2015-04-07
 
-  Describes the interface for an in-place radix sort, the American flag sort.
+  Describes the interface for radix sorts: the in-place MSD American flag
+  sort, its parallel version, an out-of-place LSD sort for integer keys, and
+  a string sort over cached key prefixes.
 */
 
 #ifndef UTIL_RADIX_HPP_
 #define UTIL_RADIX_HPP_
 
+#include <cstddef>
+
 namespace util {
 
+// Ranges at most this long are finished with an insertion sort by the MSD
+// sorts, rather than partitioned further.
+constexpr std::size_t kRadixInsertionCutoff = 32;
+
 // Radix should be strictly greater than 0. DigitAt should be a type of a
 // functor which should have a method that accepts a reference to an element
 // pointed to by the iterator and returns an integer in the range [-1, Radix).
@@ -27,6 +35,12 @@ namespace util {
 // of msd - most significant digit - this is the index reading left-to-right).
 // The integer passed to the above operator will never be negative.
 // 'digit_of' should be pure from the sort's perspective.
+//
+// Both MSD sorts partition in place, bucket by bucket (American flag sort),
+// and insertion sort ranges of at most kRadixInsertionCutoff elements,
+// comparing them digit by digit. Neither is stable. The recursive version
+// recurses once per bucket, at most (key length) deep; msd_in_place_radix()
+// keeps the ranges left to sort on an explicit stack instead.
 template<std::size_t Radix, typename RandomIt, typename DigitAt>
 void msd_in_place_radix_recursive(
     RandomIt first, RandomIt last, DigitAt digit_of);
@@ -34,6 +48,83 @@ void msd_in_place_radix_recursive(
 template<std::size_t Radix, typename RandomIt, typename DigitAt>
 void msd_in_place_radix(RandomIt first, RandomIt last, DigitAt digit_of);
 
+// Ranges at most this long are sorted sequentially by parallel_radix_sort().
+constexpr std::size_t kParallelRadixCutoff = 1 << 16;
+
+// MSD radix sort of [first, last) with the jobs of 'pool', with the same
+// Radix and DigitAt requirements as msd_in_place_radix(). 'digit_of' is
+// called from several threads at once, and must not throw. Elements must be
+// default constructible and move assignable. Pool should have the interface
+// of synchro::work_stealing_pool: a join_handle type with wait(), a
+// submit(const join_handle&, job) method and size(), its number of threads.
+//
+// The range is cut into one chunk per thread. Each chunk's digit counts
+// are taken by its own job, their prefix sums give every (chunk, digit)
+// pair its own run of the output, and the chunks then scatter into a buffer
+// of (last - first) elements in parallel. Each resulting bucket is then
+// moved back and sorted by a job running the sequential recursive MSD sort.
+// Buckets holding more than a thread's share of the input (e.g., every key
+// shares its first digit) are partitioned in parallel again, by the next
+// digit, rather than being handed to one job.
+//
+// Not stable. Blocks until sorted; when called from a worker of 'pool', the
+// caller helps run the sort's jobs in the meantime.
+template<std::size_t Radix, typename RandomIt, typename DigitAt,
+         typename Pool>
+void parallel_radix_sort(
+    RandomIt first, RandomIt last, DigitAt digit_of, Pool& pool);
+
+// Stable out-of-place LSD radix sort by an unsigned integer key, one byte per
+// pass, using a buffer of (last - first) elements. KeyOf should have a method
+// compatible with
+//
+//   Unsigned KeyOf::operator()(const T&)
+//
+// for an unsigned integral type Unsigned. Elements must be default
+// constructible and move assignable.
+//
+// All the passes' counts are taken in a single read of the input, and passes
+// in which every key has the same byte are skipped. Elements of trivially
+// copyable types of up to 16 bytes (e.g. 32 and 64 bit integers) are
+// scattered through a cache line sized buffer per bucket, so that each flush
+// to the output writes a line's worth of contiguous bytes (at most two lines,
+// as buckets needn't start on a line boundary), rather than one element to
+// each of 256 lines at random.
+template<typename RandomIt, typename KeyOf>
+void lsd_radix_sort(RandomIt first, RandomIt last, KeyOf key_of);
+
+// Sorts integers (signed or unsigned) by their values, with the above.
+template<typename RandomIt>
+void lsd_radix_sort(RandomIt first, RandomIt last);
+
+// Groups of strings at most this large are sorted by multikey quicksort
+// in string_radix_sort(), rather than partitioned by a byte of their
+// prefixes; at most kStringInsertionCutoff, by insertion sort.
+constexpr std::size_t kStringQuicksortCutoff = 1 << 12;
+constexpr std::size_t kStringInsertionCutoff = 16;
+
+// Sorts strings into the order of std::sort() with operator<, that is, by
+// their bytes as unsigned chars, shorter strings first on a tie. Elements
+// need data() and size() over chars (e.g., std::string) and must be move
+// constructible and move assignable. Not stable.
+//
+// Rather than moving strings around and reading their characters through
+// a digit functor, the sort works on an array of (prefix, pointer) pairs:
+// 8 bytes of each key, from the depth its group is being sorted at, as a
+// big-endian integer, so that one integer comparison compares 8
+// characters. Groups larger than kStringQuicksortCutoff are partitioned
+// in place by the first byte in which their prefixes differ (the bytes
+// every key in the group shares, like "https://", are skipped by looking
+// at the smallest and largest prefix); smaller ones by a three-way
+// quicksort on the prefix. Keys whose prefixes tie are sorted on the next
+// 8 bytes, loaded once per key. Only then are the strings moved, each
+// twice, into their places.
+//
+// Uses an array of (last - first) pairs and one of (last - first)
+// elements.
+template<typename RandomIt>
+void string_radix_sort(RandomIt first, RandomIt last);
+
 } // namespace util
 
 #include "util/radix.tpp"
@@ -14,90 +14,561 @@
 
 #include <algorithm>
 #include <array>
-#include <numeric>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
+#include "util/cache_line.hpp"
 #include "util/uassert.hpp"
 
 namespace util {
 
 namespace internal {
 
-// Recursive MSD implementation that relies on the external radix arrays.
-// See documentation of msd_in_place_radix() for templates description.
-// Recall 'digit_of' returns '-1' as an end-of-key indicator.
+// Bucket boundaries of a partitioned range: bucket b (digit b - 1, so that
+// bucket 0 holds the ended keys) is [starts[b], starts[b + 1]).
+template<std::size_t Radix>
+using radix_starts = std::array<std::size_t, Radix + 2>;
+
+template<std::size_t Radix, typename T, typename DigitAt>
+int checked_digit(DigitAt& digit_of, int index, const T& elem) {
+  int digit = digit_of(index, elem);
+  UASSERT(-1 <= digit && digit < static_cast<int>(Radix))
+    << "digit index " << digit << " not in range [-1, " << Radix << ")";
+  return digit;
+}
+
+// Whether a's key, from digit 'index' on, is less than b's.
+template<std::size_t Radix, typename T, typename DigitAt>
+bool digits_less(DigitAt& digit_of, int index, const T& a, const T& b) {
+  for (;; ++index) {
+    int da = checked_digit<Radix>(digit_of, index, a);
+    int db = checked_digit<Radix>(digit_of, index, b);
+    if (da != db) return da < db;
+    if (da < 0) return false;
+  }
+}
+
+// Insertion sort of a range whose keys agree before digit 'index'.
+template<std::size_t Radix, typename RandomIt, typename DigitAt>
+void digit_insertion_sort(RandomIt first, RandomIt last, DigitAt& digit_of,
+                          int index) {
+  if (first == last) return;
+  for (auto i = std::next(first); i != last; ++i) {
+    if (!digits_less<Radix>(digit_of, index, *i, *std::prev(i))) continue;
+    auto moving = std::move(*i);
+    auto j = i;
+    do {
+      *j = std::move(*std::prev(j));
+      --j;
+    } while (j != first &&
+             digits_less<Radix>(digit_of, index, moving, *std::prev(j)));
+    *j = std::move(moving);
+  }
+}
+
+// Permutes [first, last) into buckets by digit 'index', leaving the bucket
+// boundaries in 'starts'.
 //
-// We are able to reuse the 'counts' and 'num_remaining' arrays between stack
-// frames because this method returns the index it left off at (which it
-// can compute by looking backwards in the array).
+// Each bucket's unsorted part begins at 'heads'. Walking the buckets in
+// order, the element at the head of the current bucket is swapped into
+// the head of the bucket it belongs to, until the current bucket is full;
+// the last bucket is then full already.
+template<std::size_t Radix, typename RandomIt, typename DigitAt>
+void flag_partition(RandomIt first, RandomIt last, DigitAt& digit_of,
+                    int index, radix_starts<Radix>& starts) {
+  std::fill(starts.begin(), starts.end(), 0);
+  for (auto i = first; i != last; ++i)
+    ++starts[checked_digit<Radix>(digit_of, index, *i) + 2];
+  for (std::size_t b = 1; b < starts.size(); ++b) starts[b] += starts[b - 1];
+
+  std::array<std::size_t, Radix + 1> heads;
+  std::copy(starts.begin(), starts.end() - 1, heads.begin());
+  for (std::size_t b = 0; b < Radix; ++b)
+    while (heads[b] < starts[b + 1]) {
+      auto& elem = first[heads[b]];
+      std::size_t target = checked_digit<Radix>(digit_of, index, elem) + 1;
+      if (target == b) ++heads[b];
+      else std::swap(elem, first[heads[target]++]);
+    }
+}
+
+// Recursive MSD implementation, for a range whose keys agree before digit
+// 'index'.
 template<std::size_t Radix, typename RandomIt, typename DigitAt>
-RandomIt msd_in_place_recursive(RandomIt first, RandomIt end, DigitAt digit_of,
-                                int index,
-                                std::array<int, (Radix + 2)>& counts,
-                                std::array<int, (Radix + 1)>& num_remaining) {
-  // TODO: potential optimization: cutoff to insertion sort (may
-  // require a comparator for ints...)
-
-  // TODO: merge this loop with below?
-  if (first == end) return end;
-  auto last = first;
-  if (index > 0) {
-    auto prev = index - 1;
-    auto digit = digit_of(prev, *last++);
-    UASSERT(-1 <= digit && digit < static_cast<int>(Radix))
-      << "digit index " << digit << " not in range [-1, " << Radix << ")";
-    while (last != end && digit_of(prev, *last) == digit) ++last;
-  } else last = end;
-
-  // Clear arrays
-  std::fill(counts.begin(), counts.end(), 0);
-  std::fill(num_remaining.begin(), num_remaining.end(), 0);
-
-  // Find the counts of each digit. Note we offset by one here so we
-  // may compute the index start for the *next-next* bucket.
-  // The double shift allows for the -1 indicator value.
-  for (auto i = first; i != last; ++i) {
-    auto digit = digit_of(index, *i) + 1;
-    UASSERT(0 <= digit && digit <= static_cast<int>(Radix))
-      << "1 + digit index " << digit << " not in range [0, " << Radix << "]";
-    ++counts[digit + 1];
-    ++num_remaining[digit];
-  }
-
-  // Compute each bucket's offset.
-  std::partial_sum(counts.begin(), counts.end(), counts.begin());
-
-  for (std::size_t bucket = 0; bucket < Radix; ++bucket)
-    while (num_remaining[bucket] > 0) {
-      auto i = counts[bucket];
-      auto target = digit_of(index, first[i]) + 1;
-      UASSERT(0 <= target && target <= static_cast<int>(Radix))
-        << "1 + digit index " << target << " not in range [0, " << Radix << "]";
-      std::swap(first[i], first[counts[target]]);
-      ++counts[target];
-      --num_remaining[target];
+void msd_in_place_recursive(RandomIt first, RandomIt last, DigitAt& digit_of,
+                            int index) {
+  if (static_cast<std::size_t>(last - first) <= kRadixInsertionCutoff) {
+    digit_insertion_sort<Radix>(first, last, digit_of, index);
+    return;
+  }
+  radix_starts<Radix> starts;
+  flag_partition<Radix>(first, last, digit_of, index, starts);
+  // Bucket 0 holds ended keys, which are all equal.
+  for (std::size_t b = 1; b <= Radix; ++b)
+    if (starts[b + 1] - starts[b] > 1)
+      msd_in_place_recursive<Radix>(first + starts[b], first + starts[b + 1],
+                                    digit_of, index + 1);
+}
+
+// Order-preserving map from integers to unsigned integers of the same size:
+// signed values have their sign bit flipped, so negatives come first.
+template<typename T>
+struct integer_radix_key {
+  static_assert(std::is_integral<T>::value,
+                "lsd_radix_sort() without a key needs integers");
+  typedef typename std::make_unsigned<T>::type key_type;
+  static constexpr key_type kFlip = std::is_signed<T>::value ?
+      key_type(1) << (std::numeric_limits<key_type>::digits - 1) : 0;
+  key_type operator()(T val) const {
+    return static_cast<key_type>(val) ^ kFlip;
+  }
+};
+
+template<typename T>
+constexpr typename integer_radix_key<T>::key_type integer_radix_key<T>::kFlip;
+
+constexpr std::size_t kLsdRadix = 256;
+// Ranges at most this long are insertion sorted by lsd_radix_sort().
+constexpr std::size_t kLsdInsertionCutoff = 64;
+
+template<typename T>
+struct use_write_combining : std::integral_constant<bool,
+    std::is_trivially_copyable<T>::value && sizeof(T) <= 16 &&
+    kCacheLine % sizeof(T) == 0> {};
+
+// Stable insertion sort by key.
+template<typename T, typename KeyOf>
+void key_insertion_sort(T* first, T* last, KeyOf& key_of) {
+  for (T* i = first + 1; i < last; ++i) {
+    auto key = key_of(*i);
+    if (!(key < key_of(i[-1]))) continue;
+    T moving = std::move(*i);
+    T* j = i;
+    do {
+      *j = std::move(j[-1]);
+      --j;
+    } while (j != first && key < key_of(j[-1]));
+    *j = std::move(moving);
+  }
+}
+
+// Moves each element of [src, src + n) to dst + offsets[its byte at
+// 'shift'], incrementing that offset.
+template<typename T, typename KeyOf>
+void lsd_scatter(T* src, std::size_t n, T* dst, int shift,
+                 std::array<std::size_t, kLsdRadix>& offsets, KeyOf& key_of,
+                 std::false_type /* write combining */) {
+  for (std::size_t i = 0; i < n; ++i)
+    dst[offsets[(key_of(src[i]) >> shift) & 0xFF]++] = std::move(src[i]);
+}
+
+// As above, but collects each bucket's elements in a line sized buffer,
+// and only writes full buffers out.
+template<typename T, typename KeyOf>
+void lsd_scatter(T* src, std::size_t n, T* dst, int shift,
+                 std::array<std::size_t, kLsdRadix>& offsets, KeyOf& key_of,
+                 std::true_type /* write combining */) {
+  constexpr std::size_t kPerLine = kCacheLine / sizeof(T);
+  struct alignas(kCacheLine) line { unsigned char bytes[kCacheLine]; };
+  // 16KB: the buffers stay in L1.
+  line lines[kLsdRadix];
+  std::array<unsigned char, kLsdRadix> fill;
+  fill.fill(0);
+  for (std::size_t i = 0; i < n; ++i) {
+    std::size_t b = (key_of(src[i]) >> shift) & 0xFF;
+    std::memcpy(lines[b].bytes + fill[b] * sizeof(T), src + i, sizeof(T));
+    if (++fill[b] == kPerLine) {
+      std::memcpy(dst + offsets[b], lines[b].bytes, kCacheLine);
+      offsets[b] += kPerLine;
+      fill[b] = 0;
+    }
+  }
+  for (std::size_t b = 0; b < kLsdRadix; ++b) {
+    std::memcpy(dst + offsets[b], lines[b].bytes, fill[b] * sizeof(T));
+    offsets[b] += fill[b];
+  }
+}
+
+template<typename T, typename KeyOf>
+void lsd_sort(T* data, std::size_t n, KeyOf& key_of) {
+  typedef typename std::decay<decltype(key_of(*data))>::type key_type;
+  static_assert(std::is_integral<key_type>::value &&
+                std::is_unsigned<key_type>::value,
+                "lsd_radix_sort() keys should be unsigned integers");
+  constexpr int kPasses = sizeof(key_type);
+
+  if (n <= kLsdInsertionCutoff) {
+    key_insertion_sort(data, data + n, key_of);
+    return;
+  }
+
+  // Every pass's counts, from one read.
+  std::vector<std::array<std::size_t, kLsdRadix> > counts(kPasses);
+  for (auto& c : counts) c.fill(0);
+  for (std::size_t i = 0; i < n; ++i) {
+    key_type key = key_of(data[i]);
+    for (int p = 0; p < kPasses; ++p) ++counts[p][(key >> (8 * p)) & 0xFF];
+  }
+
+  std::vector<T> buffer;
+  T* src = data;
+  for (int p = 0; p < kPasses; ++p) {
+    // A pass whose byte is the same for every key would only copy.
+    auto& c = counts[p];
+    std::size_t first_used = 0;
+    while (c[first_used] == 0) ++first_used;
+    if (c[first_used] == n) continue;
+
+    if (buffer.empty()) buffer.resize(n);
+    T* dst = src == data ? buffer.data() : data;
+    std::array<std::size_t, kLsdRadix> offsets;
+    std::size_t sum = 0;
+    for (std::size_t b = 0; b < kLsdRadix; ++b) {
+      offsets[b] = sum;
+      sum += c[b];
     }
+    lsd_scatter(src, n, dst, 8 * p, offsets, key_of,
+                use_write_combining<T>());
+    src = dst;
+  }
+  if (src != data) std::move(src, src + n, data);
+}
+
+template<typename RandomIt>
+struct is_contiguous_iterator : std::integral_constant<bool,
+    std::is_pointer<RandomIt>::value || std::is_same<RandomIt,
+        typename std::vector<typename std::iterator_traits<RandomIt>::
+                             value_type>::iterator>::value> {};
 
-  auto next = first + counts[0]; // skip ended keys
-  do next = msd_in_place_recursive<Radix>(next, last, digit_of, index + 1,
-                                          counts, num_remaining);
-  while (next != last);
-  return next;
+template<typename RandomIt, typename KeyOf>
+void lsd_radix_sort(RandomIt first, RandomIt last, KeyOf& key_of,
+                    std::true_type /* contiguous */) {
+  if (first != last) lsd_sort(&*first, last - first, key_of);
+}
+
+template<typename RandomIt, typename KeyOf>
+void lsd_radix_sort(RandomIt first, RandomIt last, KeyOf& key_of,
+                    std::false_type /* contiguous */) {
+  typedef typename std::iterator_traits<RandomIt>::value_type T;
+  std::vector<T> copy(std::make_move_iterator(first),
+                      std::make_move_iterator(last));
+  lsd_sort(copy.data(), copy.size(), key_of);
+  std::move(copy.begin(), copy.end(), first);
+}
+
+// Smallest chunk given its own job by a parallel partition.
+constexpr std::size_t kParallelRadixMinChunk = 1 << 14;
+
+// State of one parallel_radix_sort() call, on contiguous elements.
+template<std::size_t Radix, typename T, typename DigitAt, typename Pool>
+struct parallel_radix {
+  typedef std::array<std::size_t, Radix + 1> bucket_counts;
+
+  parallel_radix(T* data, std::size_t n, DigitAt& digit_of, Pool& pool) :
+      data(data), digit_of(digit_of), pool(pool),
+      big(std::max<std::size_t>(kParallelRadixCutoff, n / pool.size())) {}
+
+  // Scatters [lo, hi) of 'src', whose keys agree before digit 'index', to
+  // the same positions of 'dst', in buckets by digit 'index'. Buckets of at
+  // most 'big' elements are then sorted into 'data' by jobs in the
+  // 'sorting' group; larger ones by another parallel level.
+  void level(T* src, T* dst, std::size_t lo, std::size_t hi, int index) {
+    std::size_t n = hi - lo;
+    std::size_t nchunks = std::min<std::size_t>(
+        pool.size(), std::max<std::size_t>(1, n / kParallelRadixMinChunk));
+    auto chunk = [=](std::size_t c) { return lo + n * c / nchunks; };
+
+    // counts[c][d + 1] is the count of digit d in chunk c, and then where
+    // the chunk's next element with that digit goes.
+    std::vector<bucket_counts> counts(nchunks);
+    typename Pool::join_handle counted;
+    for (std::size_t c = 0; c < nchunks; ++c)
+      pool.submit(counted, [&, c]() {
+          auto& mine = counts[c];
+          mine.fill(0);
+          for (std::size_t i = chunk(c); i < chunk(c + 1); ++i)
+            ++mine[checked_digit<Radix>(digit_of, index, src[i]) + 1];
+        });
+    counted.wait();
+
+    // Only Radix + 1 sums per chunk: not worth more jobs.
+    radix_starts<Radix> starts;
+    starts[0] = 0;
+    std::size_t pos = lo;
+    for (std::size_t b = 0; b <= Radix; ++b) {
+      for (auto& mine : counts) {
+        std::size_t count = mine[b];
+        mine[b] = pos;
+        pos += count;
+      }
+      starts[b + 1] = pos - lo;
+    }
+
+    typename Pool::join_handle scattered;
+    for (std::size_t c = 0; c < nchunks; ++c)
+      pool.submit(scattered, [&, c]() {
+          auto& mine = counts[c];
+          for (std::size_t i = chunk(c); i < chunk(c + 1); ++i)
+            dst[mine[digit_of(index, src[i]) + 1]++] = std::move(src[i]);
+        });
+    scattered.wait();
+
+    for (std::size_t b = 0; b <= Radix; ++b) {
+      std::size_t blo = lo + starts[b], bhi = lo + starts[b + 1];
+      if (blo == bhi) continue;
+      // Bucket 0 holds ended keys, which are all equal.
+      if (b > 0 && bhi - blo > big) {
+        level(dst, src, blo, bhi, index + 1);
+        continue;
+      }
+      T* from = dst;
+      T* to = data;
+      DigitAt& digits = digit_of;
+      pool.submit(sorting, [=, &digits]() {
+          if (from != to) std::move(from + blo, from + bhi, to + blo);
+          if (b > 0 && bhi - blo > 1)
+            msd_in_place_recursive<Radix>(to + blo, to + bhi, digits,
+                                          index + 1);
+        });
+    }
+  }
+
+  T* data;
+  DigitAt& digit_of;
+  Pool& pool;
+  std::size_t big;
+  typename Pool::join_handle sorting;
+};
+
+template<std::size_t Radix, typename RandomIt, typename DigitAt,
+         typename Pool>
+void parallel_radix_sort(RandomIt first, RandomIt last, DigitAt& digit_of,
+                         Pool& pool, std::true_type /* contiguous */) {
+  typedef typename std::iterator_traits<RandomIt>::value_type T;
+  std::size_t n = last - first;
+  std::vector<T> buffer(n);
+  parallel_radix<Radix, T, DigitAt, Pool> sort(&*first, n, digit_of, pool);
+  sort.level(&*first, buffer.data(), 0, n, 0);
+  sort.sorting.wait();
+}
+
+template<std::size_t Radix, typename RandomIt, typename DigitAt,
+         typename Pool>
+void parallel_radix_sort(RandomIt first, RandomIt last, DigitAt& digit_of,
+                         Pool& pool, std::false_type /* contiguous */) {
+  typedef typename std::iterator_traits<RandomIt>::value_type T;
+  std::vector<T> copy(std::make_move_iterator(first),
+                      std::make_move_iterator(last));
+  parallel_radix_sort<Radix>(copy.begin(), copy.end(), digit_of, pool,
+                             std::true_type());
+  std::move(copy.begin(), copy.end(), first);
+}
+
+// A string being sorted by string_radix_sort(): 8 bytes of its key from
+// the depth its group is at (zero past its end), as a big-endian integer,
+// and where the string is.
+template<typename T>
+struct string_entry {
+  std::uint64_t prefix;
+  T* str;
+};
+
+constexpr std::size_t kPrefixBytes = sizeof(std::uint64_t);
+
+template<typename T>
+std::uint64_t load_prefix(const T& str, std::size_t depth) {
+  std::size_t size = str.size();
+  if (depth >= size) return 0;
+  std::uint64_t word = 0;
+  std::memcpy(&word, str.data() + depth,
+              std::min(kPrefixBytes, size - depth));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  word = __builtin_bswap64(word);
+#endif
+  return word;
+}
+
+template<typename T>
+void string_sort(string_entry<T>* e, std::size_t n, std::size_t depth);
+
+// Sorts a group whose keys agree before depth + 8 (zero padded). Keys
+// ending by then differ only in their lengths and come first; the others
+// go on to their next 8 bytes.
+template<typename T>
+void string_sort_tied(string_entry<T>* e, std::size_t n, std::size_t depth) {
+  if (n <= 1) return;
+  std::size_t next = depth + kPrefixBytes;
+  auto ended = std::partition(e, e + n, [next](const string_entry<T>& x) {
+      return x.str->size() <= next;
+    });
+  std::sort(e, ended, [](const string_entry<T>& a, const string_entry<T>& b) {
+      return a.str->size() < b.str->size();
+    });
+  for (auto x = ended; x != e + n; ++x) x->prefix = load_prefix(*x->str, next);
+  string_sort(ended, e + n - ended, next);
+}
+
+// Insertion sort on the prefixes, then each run of equal ones on the rest
+// of its keys.
+template<typename T>
+void string_insertion_sort(string_entry<T>* e, std::size_t n,
+                           std::size_t depth) {
+  for (std::size_t i = 1; i < n; ++i) {
+    auto moving = e[i];
+    std::size_t j = i;
+    for (; j > 0 && moving.prefix < e[j - 1].prefix; --j) e[j] = e[j - 1];
+    e[j] = moving;
+  }
+  for (std::size_t i = 0, j; i < n; i = j) {
+    for (j = i + 1; j < n && e[j].prefix == e[i].prefix; ++j) {}
+    string_sort_tied(e + i, j - i, depth);
+  }
+}
+
+// Multikey quicksort with 8 byte characters: a three-way partition around
+// the median of three prefixes, with the equal part going on to the next 8
+// bytes.
+template<typename T>
+void string_quicksort(string_entry<T>* e, std::size_t n, std::size_t depth) {
+  while (n > kStringInsertionCutoff) {
+    std::uint64_t a = e[0].prefix, b = e[n / 2].prefix, c = e[n - 1].prefix;
+    std::uint64_t pivot = std::max(std::min(a, b), std::min(std::max(a, b), c));
+    // [0, lt) < pivot, [lt, i) == pivot, [gt, n) > pivot.
+    std::size_t lt = 0, i = 0, gt = n;
+    while (i < gt) {
+      if (e[i].prefix < pivot) std::swap(e[lt++], e[i++]);
+      else if (e[i].prefix > pivot) std::swap(e[i], e[--gt]);
+      else ++i;
+    }
+    string_sort_tied(e + lt, gt - lt, depth);
+    // Recurse on the smaller side, loop on the larger.
+    if (lt < n - gt) {
+      string_quicksort(e, lt, depth);
+      e += gt;
+      n -= gt;
+    } else {
+      string_quicksort(e + gt, n - gt, depth);
+      n = lt;
+    }
+  }
+  string_insertion_sort(e, n, depth);
+}
+
+// Sorts a group whose keys agree before 'depth', with prefixes loaded from
+// there.
+template<typename T>
+void string_sort(string_entry<T>* e, std::size_t n, std::size_t depth) {
+  if (n <= kStringQuicksortCutoff) {
+    string_quicksort(e, n, depth);
+    return;
+  }
+  auto minmax = std::minmax_element(
+      e, e + n, [](const string_entry<T>& x, const string_entry<T>& y) {
+        return x.prefix < y.prefix;
+      });
+  std::uint64_t differ = minmax.first->prefix ^ minmax.second->prefix;
+  if (!differ) {
+    string_sort_tied(e, n, depth);
+    return;
+  }
+  // Bytes before the first one that differs are the same in every key.
+  int byte = __builtin_clzll(differ) / 8;
+  auto digit_of = [](int index, const string_entry<T>& x) {
+    return static_cast<int>((x.prefix >> (56 - 8 * index)) & 0xFF);
+  };
+  radix_starts<256> starts;
+  flag_partition<256>(e, e + n, digit_of, byte, starts);
+  // Bucket b holds digit b - 1; none end.
+  for (std::size_t b = 1; b <= 256; ++b)
+    if (starts[b + 1] - starts[b] > 1)
+      string_sort(e + starts[b], starts[b + 1] - starts[b], depth);
 }
 
 } // namespace internal
 
+template<std::size_t Radix, typename RandomIt, typename DigitAt>
+void msd_in_place_radix_recursive(
+    RandomIt first, RandomIt last, DigitAt digit_of) {
+  internal::msd_in_place_recursive<Radix>(first, last, digit_of, 0);
+}
+
 template<std::size_t Radix, typename RandomIt, typename DigitAt>
 void msd_in_place_radix(RandomIt first, RandomIt last, DigitAt digit_of) {
-  std::array<int, (Radix + 2)> counts;
-  // TODO: potential optimization would be to remove the 'num_remaining'
-  // in favor of keeping a single variable 'i' that tracks progress of the
-  // current sweep. See wikipedia implementation for details.
-  std::array<int, (Radix + 1)> num_remaining;
-  internal::msd_in_place_recursive<Radix>(
-      first, last, digit_of, 0, counts, num_remaining);
+  // Ranges left to sort, and the digit they should be sorted by. At most
+  // Radix ranges are pushed per digit of the key.
+  struct range {
+    std::size_t first, last;
+    int index;
+  };
+  std::vector<range> stack;
+  stack.push_back({0, static_cast<std::size_t>(last - first), 0});
+  internal::radix_starts<Radix> starts;
+  while (!stack.empty()) {
+    range r = stack.back();
+    stack.pop_back();
+    auto begin = first + r.first, end = first + r.last;
+    if (r.last - r.first <= kRadixInsertionCutoff) {
+      internal::digit_insertion_sort<Radix>(begin, end, digit_of, r.index);
+      continue;
+    }
+    internal::flag_partition<Radix>(begin, end, digit_of, r.index, starts);
+    // Pushed last bucket first, so that the ranges are sorted left to right
+    // while the partition just done is still in cache. Bucket 0 holds ended
+    // keys, which are all equal.
+    for (std::size_t b = Radix; b > 0; --b)
+      if (starts[b + 1] - starts[b] > 1)
+        stack.push_back({r.first + starts[b], r.first + starts[b + 1],
+                         r.index + 1});
+  }
+}
+
+template<std::size_t Radix, typename RandomIt, typename DigitAt,
+         typename Pool>
+void parallel_radix_sort(
+    RandomIt first, RandomIt last, DigitAt digit_of, Pool& pool) {
+  if (static_cast<std::size_t>(last - first) <= kParallelRadixCutoff ||
+      pool.size() <= 1) {
+    msd_in_place_radix<Radix>(first, last, digit_of);
+    return;
+  }
+  internal::parallel_radix_sort<Radix>(
+      first, last, digit_of, pool,
+      internal::is_contiguous_iterator<RandomIt>());
+}
+
+template<typename RandomIt, typename KeyOf>
+void lsd_radix_sort(RandomIt first, RandomIt last, KeyOf key_of) {
+  internal::lsd_radix_sort(first, last, key_of,
+                           internal::is_contiguous_iterator<RandomIt>());
+}
+
+template<typename RandomIt>
+void lsd_radix_sort(RandomIt first, RandomIt last) {
+  typedef typename std::iterator_traits<RandomIt>::value_type T;
+  lsd_radix_sort(first, last, internal::integer_radix_key<T>());
+}
+
+template<typename RandomIt>
+void string_radix_sort(RandomIt first, RandomIt last) {
+  typedef typename std::iterator_traits<RandomIt>::value_type T;
+  std::size_t n = last - first;
+  std::vector<internal::string_entry<T> > entries(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    T& str = first[i];
+    entries[i] = {internal::load_prefix(str, 0), &str};
+  }
+  internal::string_sort(entries.data(), n, 0);
+  std::vector<T> sorted;
+  sorted.reserve(n);
+  for (auto& x : entries) sorted.push_back(std::move(*x.str));
+  std::move(sorted.begin(), sorted.end(), first);
 }
 
-  // TODO: non-recursive based msd in place radix to beat built-in string sort?
   // TODO: how does it compare to three-way radix?
 
 } // namespace util
@@ -9,15 +9,21 @@
 #include <algorithm>
 #include <cstdint>
 #include <chrono>
+#include <cstdlib>
+#include <deque>
 #include <iostream>
 #include <functional>
 #include <limits>
+#include <random>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
+#include "synchro/work_stealing_pool.hpp"
+#include "util/bench.hpp"
 #include "util/radix.hpp"
 #include "util/line_wrap.hpp"
-#include "util/timer.hpp"
 #include "util/uassert.hpp"
 #include "util/util.hpp"
 
@@ -69,34 +75,189 @@ int uint32_digit_at(int index, uint32_t val) {
   return byte;
 }
 
-void bench_uints() {
-  start("1M uint32");
+// Random examples long enough to be partitioned, rather than only insertion
+// sorted.
+template<class T>
+vector<vector<T> > random_examples(std::mt19937_64& gen) {
+  vector<vector<T> > examples;
+  for (size_t n : {10, 100, 1000, 50000}) {
+    vector<T> full(n), narrow(n);
+    for (auto& i : full) i = static_cast<T>(gen());
+    // Few distinct values, so that many keys tie.
+    for (auto& i : narrow) i = static_cast<T>(gen() % 16) - 8;
+    examples.push_back(full);
+    examples.push_back(narrow);
+  }
+  return examples;
+}
 
-  vector<uint32_t> backup(1000 * 1000, 0);
-  for (auto& i : backup) i = std::rand();
-  auto uints = backup;
+vector<vector<string> > random_strings(std::mt19937_64& gen) {
+  vector<vector<string> > examples;
+  for (size_t n : {10, 100, 1000, 20000}) {
+    vector<string> strs(n);
+    for (auto& s : strs) {
+      // Shared prefixes, and a small alphabet, make for deep buckets.
+      s = gen() % 2 ? "prefix" : "";
+      for (size_t len = gen() % 12; len > 0; --len) s += 'a' + gen() % 3;
+    }
+    examples.push_back(strs);
+  }
+  return examples;
+}
 
-  // warmup before
+// URL-like strings: few schemes and hosts, so that keys share long
+// prefixes, then random paths.
+vector<string> url_strings(size_t n, std::mt19937_64& gen) {
+  static const char* kSchemes[] = {"http://", "https://"};
+  static const char* kHosts[] = {"www.example.com", "www.example.org",
+                                 "cdn.example.com", "api.example.com",
+                                 "en.wikipedia.org", "news.ycombinator.com"};
+  static const char* kWords[] = {"index", "users", "posts", "img", "static",
+                                 "v1", "v2", "search", "about", "a", "wiki"};
+  vector<string> urls(n);
+  for (auto& url : urls) {
+    url = kSchemes[gen() % 2];
+    url += kHosts[gen() % 6];
+    for (size_t segs = 1 + gen() % 4; segs > 0; --segs) {
+      url += '/';
+      url += kWords[gen() % 11];
+    }
+    if (gen() % 2) url += "?id=" + to_string(gen() % 100000);
+  }
+  return urls;
+}
 
-  TIME_BLOCK(std::chrono::milliseconds, "") {
-    msd_in_place_radix<UINT32_RADIX>(
-        uints.begin(), uints.end(), uint32_digit_at);
+template<int Digits>
+int uint64_digit_at(int index, uint64_t val) {
+  if (index >= Digits) return -1;
+  return (val >> 8 * (Digits - index - 1)) & 0xFF;
+}
+
+void test_lsd_stable(std::mt19937_64& gen) {
+  // Sorted by the first value only: equal keys keep their input order.
+  typedef pair<uint16_t, int> elem;
+  vector<elem> user(30000);
+  for (size_t i = 0; i < user.size(); ++i)
+    user[i] = elem(gen() % 300, i);
+  auto sys = user;
+  lsd_radix_sort(user.begin(), user.end(),
+                 [](const elem& e) { return e.first; });
+  std::stable_sort(sys.begin(), sys.end(),
+                   [](const elem& a, const elem& b) {
+                     return a.first < b.first;
+                   });
+  UASSERT(user == sys);
+}
+
+// Sorts a fresh copy of 'backup' per trial.
+template<class T, class F>
+void bench_sort(bench::suite& suite, const string& name,
+                const vector<T>& backup, vector<T>& work, F sort) {
+  suite.run_fixed(name, [&]() { work = backup; },
+                  [&]() { sort(work.begin(), work.end()); }, backup.size());
+  UASSERT(std::is_sorted(work.begin(), work.end()));
+}
+
+template<class T>
+void bench_integer_sizes(const string& type, size_t max_n) {
+  std::mt19937_64 gen(std::rand());
+  for (size_t n = 1000 * 1000; n <= max_n; n *= 10) {
+    bench::suite suite(to_string(n) + " " + type);
+    vector<T> backup(n), work;
+    for (auto& i : backup) i = static_cast<T>(gen());
+    typedef typename vector<T>::iterator it;
+    bench_sort(suite, "std::sort", backup, work,
+               [](it a, it b) { std::sort(a, b); });
+    bench_sort(suite, "lsd_radix_sort", backup, work,
+               [](it a, it b) { lsd_radix_sort(a, b); });
+    bench_sort(suite, "msd_in_place_radix", backup, work,
+               [](it a, it b) {
+                 msd_in_place_radix<256>(a, b, uint64_digit_at<sizeof(T)>);
+               });
+  }
+}
+
+void test_parallel(std::mt19937_64& gen) {
+  synchro::work_stealing_pool pool(4);
+  auto sort_strings = [&](vector<string>::iterator a,
+                          vector<string>::iterator b) {
+    parallel_radix_sort<STRING_RADIX>(a, b, string_digit_at, pool);
+  };
+  vector<vector<string> > strings(1);
+  for (size_t i = 0; i < 3 * kParallelRadixCutoff; ++i) {
+    string s;
+    for (size_t len = gen() % 6; len > 0; --len) s += 'a' + gen() % 26;
+    strings[0].push_back(s);
   }
+  test_sort(strings, sort_strings);
+  test_sort(string_examples, sort_strings);
 
-  for (std::size_t i = 0; i < uints.size(); ++i) uints[i] = backup[i];
+  auto sort_uints = [&](vector<uint32_t>::iterator a,
+                        vector<uint32_t>::iterator b) {
+    parallel_radix_sort<UINT32_RADIX>(a, b, uint32_digit_at, pool);
+  };
+  // Uniform keys, then keys sharing their top two bytes, which are split
+  // by nested parallel partitions.
+  vector<vector<uint32_t> > uints(2, vector<uint32_t>(
+      4 * kParallelRadixCutoff));
+  for (auto& i : uints[0]) i = static_cast<uint32_t>(gen());
+  for (auto& i : uints[1]) i = 0xAB0000 | (gen() & 0xFFFF);
+  test_sort(uints, sort_uints);
 
-  start("  std::sort for comparison");
-  TIME_BLOCK(std::chrono::milliseconds, "") {
-    std::sort(uints.begin(), uints.end());
+  // From inside a job, non-contiguous.
+  deque<uint32_t> dq(uints[0].begin(), uints[0].end());
+  pool.submit([&]() {
+      parallel_radix_sort<UINT32_RADIX>(dq.begin(), dq.end(),
+                                        uint32_digit_at, pool);
+    }).wait();
+  UASSERT(std::is_sorted(dq.begin(), dq.end()));
+}
+
+void bench_parallel(size_t n) {
+  bench::suite suite("parallel_radix_sort scaling, " + to_string(n) +
+                     " uint32");
+  std::mt19937_64 gen(std::rand());
+  vector<uint32_t> backup(n), work;
+  for (auto& i : backup) i = static_cast<uint32_t>(gen());
+  bench_sort(suite, "msd_in_place_radix", backup, work,
+             [](vector<uint32_t>::iterator a,
+                vector<uint32_t>::iterator b) {
+               msd_in_place_radix<UINT32_RADIX>(a, b,
+                                                uint32_digit_at);
+             });
+  int hw = synchro::work_stealing_pool::default_threads();
+  for (int threads = 1;; threads = std::min(2 * threads, hw)) {
+    synchro::work_stealing_pool pool(threads);
+    bench_sort(suite, to_string(threads) + " threads", backup, work,
+               [&](vector<uint32_t>::iterator a,
+                   vector<uint32_t>::iterator b) {
+                 parallel_radix_sort<UINT32_RADIX>(
+                     a, b, uint32_digit_at, pool);
+               });
+    if (threads == hw) break;
   }
 }
 
+void bench_uints() {
+  bench::suite suite("1M uint32, MSD in-place radix sort");
+  vector<uint32_t> backup(1000 * 1000, 0), uints;
+  for (auto& i : backup) i = std::rand();
+  typedef vector<uint32_t>::iterator it;
+  bench_sort(suite, "msd_in_place_radix", backup, uints,
+             [](it a, it b) {
+               msd_in_place_radix<UINT32_RADIX>(a, b,
+                                                uint32_digit_at);
+             });
+  bench_sort(suite, "std::sort", backup, uints,
+             [](it a, it b) { std::sort(a, b); });
+}
+
 void bench_strings() {
-  start("1M rand-len (max 20) string");
+  bench::suite suite("1M rand-len (max 20) string, MSD in-place radix sort");
 
   const int max_size = 20;
 
-  vector<std::string> backup(1000 * 1000, "");
+  vector<std::string> backup(1000 * 1000, ""), strs;
   for (auto& i : backup) {
     // true modulo, works for negatives.
     auto len = ((std::rand() % max_size) + max_size) % max_size;
@@ -104,16 +265,32 @@ void bench_strings() {
       i += static_cast<char>(std::rand());
     }
   }
-  auto strs = backup;
 
-  TIME_BLOCK(std::chrono::milliseconds, "") {
-    msd_in_place_radix<STRING_RADIX>(strs.begin(), strs.end(), string_digit_at);
-  }
+  typedef vector<std::string>::iterator it;
+  bench_sort(suite, "msd_in_place_radix", backup, strs,
+             [](it a, it b) {
+               msd_in_place_radix<STRING_RADIX>(a, b,
+                                                string_digit_at);
+             });
+  bench_sort(suite, "std::sort", backup, strs,
+             [](it a, it b) { std::sort(a, b); });
+}
 
-  for (std::size_t i = 0; i < strs.size(); ++i) strs[i] = backup[i];
-  start("  std::sort for comparison");
-  TIME_BLOCK(std::chrono::milliseconds, "") {
-    std::sort(strs.begin(), strs.end());
+void bench_url_strings(size_t max_n) {
+  std::mt19937_64 gen(std::rand());
+  for (size_t n = 1000 * 1000; n <= max_n; n *= 10) {
+    bench::suite suite(to_string(n) + " URL-like strings");
+    auto backup = url_strings(n, gen);
+    vector<string> work;
+    typedef vector<string>::iterator it;
+    bench_sort(suite, "std::sort", backup, work,
+               [](it a, it b) { std::sort(a, b); });
+    bench_sort(suite, "msd_in_place_radix", backup, work,
+               [](it a, it b) {
+                 msd_in_place_radix<STRING_RADIX>(a, b, string_digit_at);
+               });
+    bench_sort(suite, "string_radix_sort", backup, work,
+               [](it a, it b) { string_radix_sort(a, b); });
   }
 }
 
@@ -121,15 +298,21 @@ void bench_strings() {
 
 int main(int argc, char* argv[]) {
 
-  if (argc == 2 && string(argv[1]) == "bench") {
-    cout << endl;
-    cout << "Benching MSD in-place radix sort" << endl;
+  if (argc >= 2 && string(argv[1]) == "bench") {
     auto time =
       std::chrono::high_resolution_clock::now().time_since_epoch().count();
-    cout << "    Using seed: " << time << endl;
     std::srand(time);
     bench_uints();
     bench_strings();
+
+    // Sizes from 1e6 up to 'bench N' (10^9 32-bit keys need 12GB: the
+    // input, a copy, and the LSD buffer).
+    size_t max_n = argc >= 3 ? std::strtoull(argv[2], nullptr, 10)
+                             : 10 * 1000 * 1000;
+    bench_url_strings(max_n);
+    bench_integer_sizes<uint32_t>("uint32", max_n);
+    bench_integer_sizes<uint64_t>("uint64", max_n);
+    bench_parallel(max_n);
     return 0;
   }
 
@@ -151,6 +334,93 @@ int main(int argc, char* argv[]) {
       uint32_digit_at));
   complete();
 
+  start("String sort, recursive");
+  test_sort(string_examples, bind(
+      msd_in_place_radix_recursive<STRING_RADIX, vector<string>::iterator,
+      decltype(string_digit_at)>, placeholders::_1, placeholders::_2,
+      string_digit_at));
+  complete();
+
+  std::mt19937_64 gen(1234);
+  auto long_strings = random_strings(gen);
+  start("Random string sort");
+  test_sort(long_strings, [](vector<string>::iterator a,
+                             vector<string>::iterator b) {
+              msd_in_place_radix<STRING_RADIX>(a, b, string_digit_at);
+            });
+  test_sort(long_strings, [](vector<string>::iterator a,
+                             vector<string>::iterator b) {
+              msd_in_place_radix_recursive<STRING_RADIX>(a, b,
+                                                         string_digit_at);
+            });
+  complete();
+
+  auto long_uint32s = random_examples<uint32_t>(gen);
+  start("Random uint32 sort");
+  test_sort(long_uint32s, [](vector<uint32_t>::iterator a,
+                             vector<uint32_t>::iterator b) {
+              msd_in_place_radix<UINT32_RADIX>(a, b, uint32_digit_at);
+            });
+  complete();
+
+  start("String radix sort");
+  auto string_radix = [](vector<string>::iterator a,
+                         vector<string>::iterator b) {
+    string_radix_sort(a, b);
+  };
+  test_sort(string_examples, string_radix);
+  test_sort(long_strings, string_radix);
+  // Ties broken by length past the prefix, NULs, bytes over 0x7F, and
+  // groups large enough to be partitioned by a byte.
+  test_sort(vector<vector<string> >{
+      {"ab", string("ab\0", 3), "a", string(1, '\0'), "", string(2, '\0'),
+       "\xff", "\x7f", "\x80" "a", "12345678", "123456789", "12345678\xff",
+       string("12345678\0", 9), "1234567"},
+      url_strings(20000, gen), url_strings(3000, gen)}, string_radix);
+  deque<string> dq_strings(long_strings.back().begin(),
+                           long_strings.back().end());
+  string_radix_sort(dq_strings.begin(), dq_strings.end());
+  UASSERT(std::is_sorted(dq_strings.begin(), dq_strings.end()));
+  complete();
+
+  start("LSD uint32 sort");
+  auto lsd = [](vector<uint32_t>::iterator a, vector<uint32_t>::iterator b) {
+    lsd_radix_sort(a, b);
+  };
+  test_sort(uint32_examples, lsd);
+  test_sort(long_uint32s, lsd);
+  complete();
+
+  start("LSD uint64, int64, int8 sort");
+  test_sort(random_examples<uint64_t>(gen),
+            [](vector<uint64_t>::iterator a, vector<uint64_t>::iterator b) {
+              lsd_radix_sort(a, b);
+            });
+  test_sort(random_examples<int64_t>(gen),
+            [](vector<int64_t>::iterator a, vector<int64_t>::iterator b) {
+              lsd_radix_sort(a, b);
+            });
+  test_sort(random_examples<int8_t>(gen),
+            [](vector<int8_t>::iterator a, vector<int8_t>::iterator b) {
+              lsd_radix_sort(a, b);
+            });
+  complete();
+
+  start("LSD non-contiguous sort");
+  deque<int> dq;
+  for (int i = 0; i < 1000; ++i) dq.push_back(static_cast<int>(gen()));
+  lsd_radix_sort(dq.begin(), dq.end());
+  UASSERT(std::is_sorted(dq.begin(), dq.end()));
+  complete();
+
+  start("LSD stability");
+  test_lsd_stable(gen);
+  complete();
+
+  start("Parallel sort");
+  test_parallel(gen);
+  complete();
+
   start("");
   complete("...........Success!");
   cout << endl;
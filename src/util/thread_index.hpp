@@ -0,0 +1,29 @@
+/*
+  Vladimir Feinberg
+  util/thread_index.hpp
+  2026-10-15
+
+  Small per-thread indices, for spreading threads over per-thread slots
+  (statistics, reader counts) without hashing thread ids.
+*/
+
+#ifndef UTIL_THREAD_INDEX_HPP_
+#define UTIL_THREAD_INDEX_HPP_
+
+#include <atomic>
+#include <cstddef>
+
+namespace util {
+
+// The n-th thread to ask gets n, for good. Indices aren't reused when
+// threads exit, so callers take it modulo their number of slots.
+inline std::size_t thread_index() {
+  static std::atomic<std::size_t> next(0);
+  static thread_local std::size_t index =
+      next.fetch_add(1, std::memory_order_relaxed);
+  return index;
+}
+
+} // namespace util
+
+#endif /* UTIL_THREAD_INDEX_HPP_ */
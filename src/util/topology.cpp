@@ -0,0 +1,157 @@
+/*
+  Vladimir Feinberg
+  util/topology.cpp
+  2026-10-15
+
+  Reads the NUMA topology from sysfs and pins threads, on Linux.
+*/
+
+#include "util/topology.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "util/uassert.hpp"
+
+using namespace std;
+using namespace util;
+
+namespace {
+  const char* kNodeDir = "/sys/devices/system/node/";
+
+  // Node the thread was last pinned to, or -1.
+  thread_local int pinned_node = -1;
+
+  // Parses the kernel's list format, e.g., "0-3,8,10-11". Empty if 'path'
+  // can't be read.
+  vector<int> read_list(const string& path) {
+    ifstream in(path);
+    string text;
+    vector<int> ids;
+    if (!(in >> text)) return ids;
+    stringstream ss(text);
+    string range;
+    while (getline(ss, range, ',')) {
+      auto dash = range.find('-');
+      int lo = stoi(range.substr(0, dash));
+      int hi = dash == string::npos ? lo : stoi(range.substr(dash + 1));
+      for (int i = lo; i <= hi; ++i) ids.push_back(i);
+    }
+    return ids;
+  }
+
+  topology read_system() {
+    auto online = read_list(string(kNodeDir) + "online");
+    // Memory-only nodes have nobody to pin to them, so only nodes with
+    // cpus are kept, renumbered; 'kept' has their places in 'online'.
+    vector<vector<int> > cpus, rows;
+    vector<size_t> kept;
+    for (size_t i = 0; i < online.size(); ++i) {
+      string dir = kNodeDir + ("node" + to_string(online[i])) + "/";
+      auto node_cpus = read_list(dir + "cpulist");
+      if (node_cpus.empty()) continue;
+      cpus.push_back(node_cpus);
+      kept.push_back(i);
+      // One distance per online node, in order.
+      ifstream in(dir + "distance");
+      vector<int> row;
+      int d;
+      while (in >> d) row.push_back(d);
+      rows.push_back(row);
+    }
+    if (cpus.empty()) {
+      int n = max(1u, thread::hardware_concurrency());
+      vector<int> all;
+      for (int i = 0; i < n; ++i) all.push_back(i);
+      return topology({all});
+    }
+    vector<vector<int> > distances;
+    for (auto& row : rows) {
+      // Malformed, so use the defaults.
+      if (row.size() != online.size()) return topology(cpus);
+      vector<int> kept_row;
+      for (auto k : kept) kept_row.push_back(row[k]);
+      distances.push_back(kept_row);
+    }
+    return topology(cpus, distances);
+  }
+
+  void set_affinity(const vector<int>& cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus)
+      if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (err) throw system_error(err, generic_category(), "pin thread");
+  }
+}
+
+// topology --------------------------------------------------------------
+
+const topology& topology::system() {
+  static const topology sys = read_system();
+  return sys;
+}
+
+topology::topology(vector<vector<int> > node_cpus,
+                   vector<vector<int> > distances) :
+    cpus_(move(node_cpus)), distances_(move(distances)) {
+  UASSERT(!cpus_.empty());
+  if (distances_.empty()) {
+    int n = nodes();
+    distances_.assign(n, vector<int>(n, 20));
+    for (int i = 0; i < n; ++i) distances_[i][i] = 10;
+  }
+  UASSERT(distances_.size() == cpus_.size());
+  for (int node = nodes() - 1; node >= 0; --node)
+    for (int cpu : cpus_[node]) {
+      UASSERT(cpu >= 0) << cpu;
+      if (cpu >= static_cast<int>(node_of_.size()))
+        node_of_.resize(cpu + 1, 0);
+      // Backwards, so that the first node sharing a cpu wins.
+      node_of_[cpu] = node;
+    }
+}
+
+int topology::node_of(int cpu) const {
+  return cpu >= 0 && cpu < static_cast<int>(node_of_.size()) ?
+      node_of_[cpu] : 0;
+}
+
+vector<int> topology::remote_order(int node) const {
+  vector<int> order;
+  for (int i = 0; i < nodes(); ++i)
+    if (i != node) order.push_back(i);
+  stable_sort(order.begin(), order.end(), [this, node](int a, int b) {
+      return distance(node, a) < distance(node, b);
+    });
+  return order;
+}
+
+// Pinning ---------------------------------------------------------------
+
+void util::pin_to_cpu(int cpu) {
+  set_affinity({cpu});
+  pinned_node = -1;
+}
+
+void util::pin_to_node(const topology& topo, int node) {
+  UASSERT(node >= 0 && node < topo.nodes()) << node;
+  set_affinity(topo.cpus(node));
+  pinned_node = node;
+}
+
+int util::current_node(const topology& topo) {
+  if (pinned_node >= 0) return pinned_node;
+  return topo.node_of(sched_getcpu());
+}
@@ -0,0 +1,79 @@
+/*
+  Vladimir Feinberg
+  util/topology.hpp
+  2026-10-15
+
+  NUMA topology of the machine (which cpus belong to which memory node,
+  and how far apart the nodes are), and helpers to pin threads to cpus
+  and nodes.
+*/
+
+#ifndef UTIL_TOPOLOGY_HPP_
+#define UTIL_TOPOLOGY_HPP_
+
+#include <vector>
+
+namespace util {
+
+// Nodes are numbered 0 ... nodes() - 1, densely, even if the system's
+// numbering has gaps (then node i is the i-th online node).
+//
+// This class is immutable, so thread safe.
+class topology {
+ public:
+  // The machine's, read from sysfs once. A machine without NUMA support
+  // (or without sysfs) is one node holding every hardware thread.
+  static const topology& system();
+
+  // Nodes with the given cpus each. Unless given, distances are 10 within
+  // a node and 20 across, as in the kernel's default SLIT. Lets a test
+  // pretend to have several nodes: they may share cpus, in which case the
+  // cpu belongs to the first for node_of().
+  explicit topology(std::vector<std::vector<int> > node_cpus,
+                    std::vector<std::vector<int> > distances = {});
+
+  int nodes() const { return static_cast<int>(cpus_.size()); }
+  const std::vector<int>& cpus(int node) const { return cpus_[node]; }
+  // Relative memory access cost from 'from' to 'to' (10 for local).
+  int distance(int from, int to) const { return distances_[from][to]; }
+  // 0 for cpus it doesn't know.
+  int node_of(int cpu) const;
+  // Every node but 'node', nearest first (ties by number).
+  std::vector<int> remote_order(int node) const;
+
+ private:
+  std::vector<std::vector<int> > cpus_;
+  std::vector<std::vector<int> > distances_;
+  std::vector<int> node_of_;
+};
+
+/*
+ * INPUT:
+ * int cpu - cpu to run on
+ * PRECONDITION:
+ * BEHAVIOR:
+ * Restricts the calling thread to 'cpu'. Throws std::system_error if the
+ * thread may not run there.
+ */
+void pin_to_cpu(int cpu);
+
+/*
+ * INPUT:
+ * const topology& topo - topology 'node' is from
+ * int node - node to run on
+ * PRECONDITION:
+ * 0 <= node < topo.nodes()
+ * BEHAVIOR:
+ * Restricts the calling thread to the cpus of 'node', and makes 'node'
+ * the thread's current_node() from now on. Throws std::system_error if
+ * the thread may not run on any of them.
+ */
+void pin_to_node(const topology& topo, int node);
+
+// Node of the calling thread: the last one it was pinned to with
+// pin_to_node(), else the node of the cpu it happens to be running on.
+int current_node(const topology& topo = topology::system());
+
+} // namespace util
+
+#endif /* UTIL_TOPOLOGY_HPP_ */
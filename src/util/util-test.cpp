@@ -6,6 +6,138 @@
   Defines test for utilities
 */
 
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <set>
+#include <vector>
 
+#include "util/hash.hpp"
+#include "util/node_pool.hpp"
+#include "util/thread_index.hpp"
+#include "util/uassert.hpp"
 
-int main() { return 0; }
+using namespace std;
+using namespace util;
+
+namespace {
+
+struct counted {
+  counted() { live.fetch_add(1, std::memory_order_relaxed); }
+  ~counted() { live.fetch_sub(1, std::memory_order_relaxed); }
+  long pad[4];
+  static std::atomic<int> live;
+};
+std::atomic<int> counted::live(0);
+
+struct pooled_node : pooled<pooled_node> {
+  int val;
+};
+
+void test_node_pool() {
+  typedef node_pool<counted> pool;
+
+  cout << "=====> Testing node_pool sequential reuse" << endl;
+  {
+    auto p = pool::create();
+    UASSERT(counted::live == 1);
+    pool::destroy(p);
+    UASSERT(counted::live == 0);
+    auto q = pool::create();
+    UASSERT(p == q) << "freed block was not reused";
+    pool::ptr_deleter(q);
+    UASSERT(counted::live == 0);
+  }
+  cout << "...... Complete!" << endl;
+
+  cout << "=====> Testing node_pool overflow to global list" << endl;
+  {
+    vector<void*> blocks;
+    for (size_t i = 0; i < 4 * pool::kLocalCapacity; ++i)
+      blocks.push_back(pool::allocate());
+    UASSERT(set<void*>(blocks.begin(), blocks.end()).size() == blocks.size());
+    auto before = pool::global_size();
+    for (auto b : blocks) pool::deallocate(b);
+    UASSERT(pool::local_size() <= pool::kLocalCapacity)
+        << pool::local_size() << " cached locally";
+    UASSERT(pool::global_size() > before);
+  }
+  cout << "...... Complete!" << endl;
+
+  cout << "=====> Testing node_pool cross-thread handoff" << endl;
+  {
+    static const int kItems = 10000;
+    vector<void*> blocks;
+    // Allocated here, freed on another thread, which leaves its cache to
+    // the global list when it exits.
+    for (int i = 0; i < kItems; ++i) blocks.push_back(pool::allocate());
+    async(launch::async, [&]() {
+        for (auto b : blocks) pool::deallocate(b);
+      }).get();
+    UASSERT(pool::global_size() >= pool::kBatch);
+    vector<void*> again;
+    for (int i = 0; i < kItems; ++i) again.push_back(pool::allocate());
+    for (auto b : again) pool::deallocate(b);
+  }
+  cout << "...... Complete!" << endl;
+
+  cout << "=====> Testing pooled new/delete" << endl;
+  {
+    auto n = new pooled_node;
+    delete n;
+    auto m = new pooled_node;
+    UASSERT(n == m) << "pooled delete did not return to pool";
+    delete m;
+    UASSERT(node_pool<pooled_node>::local_size() >= 1);
+  }
+  cout << "...... Complete!" << endl;
+}
+
+void test_thread_index() {
+  cout << "=====> Testing thread_index" << endl;
+  {
+    static const int kThreads = 8;
+    auto mine = thread_index();
+    UASSERT(thread_index() == mine) << "index changed";
+    vector<future<size_t> > futs;
+    for (int i = 0; i < kThreads; ++i)
+      futs.push_back(async(launch::async, []() { return thread_index(); }));
+    set<size_t> seen{mine};
+    for (auto& f : futs) seen.insert(f.get());
+    UASSERT(seen.size() == kThreads + 1) << "indices were shared";
+  }
+  cout << "...... Complete!" << endl;
+}
+
+void test_mix_hash() {
+  cout << "=====> Testing mix_hash spreads strided keys" << endl;
+  {
+    // Multiples of 1024 would all land in bucket 0 unmixed.
+    static const int kBuckets = 16, kKeys = 1 << 14;
+    vector<int> low(kBuckets), high(kBuckets);
+    for (uint64_t i = 0; i < kKeys; ++i) {
+      auto h = mix_hash(i << 10);
+      ++low[h % kBuckets];
+      ++high[h >> 60];
+    }
+    for (int b = 0; b < kBuckets; ++b) {
+      UASSERT(abs(low[b] - kKeys / kBuckets) < kKeys / kBuckets / 4)
+          << "bucket " << b << " has " << low[b];
+      UASSERT(abs(high[b] - kKeys / kBuckets) < kKeys / kBuckets / 4)
+          << "bucket " << b << " has " << high[b];
+    }
+  }
+  cout << "...... Complete!" << endl;
+}
+
+} // anonymous namespace
+
+int main() {
+  cout << "Utilities testing." << endl;
+  test_node_pool();
+  test_thread_index();
+  test_mix_hash();
+  return 0;
+}